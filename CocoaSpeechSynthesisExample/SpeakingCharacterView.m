@@ -56,41 +56,364 @@ NSString *	kCharacterExpressionIdentifierVowel			= @"ExpressionIdentifierVowel";
 static NSString *	kCharacterExpressionFrameDurationKey		= @"FrameDuration";				// TimeInterval
 static NSString *	kCharacterExpressionFrameImageFileNameKey	= @"FrameImageFileName";
 
+// Posted on the main thread once every frame of a character atlas has been decoded.
+static NSString *	kSpeakingCharacterAtlasDidLoadNotification	= @"SpeakingCharacterAtlasDidLoadNotification";
+
+
+/*----------------------------------------------------------------------------------------
+	SpeakingCharacterAtlas
+	 
+	Holds a character's description and every frame image it names, decoded once into a
+	single packed bitmap.  Atlases are shared by character name, so every view showing the
+	same character uses the same pixels.  Decoding happens on a background thread; until it
+	finishes imageForFrameNamed: returns NULL and views draw nothing.
+----------------------------------------------------------------------------------------*/
+@interface SpeakingCharacterAtlas : NSObject {
+	NSDictionary *	_characterDescription;
+	NSDictionary *	_frameImages;		// frame image file name -> CGImageRef within the atlas
+	BOOL			_isLoaded;
+}
+
++ (SpeakingCharacterAtlas *)atlasForCharacterNamed:(NSString *)name;
+- (id)initWithCharacterNamed:(NSString *)name;
+- (NSDictionary *)characterDescription;
+- (BOOL)isLoaded;
+- (CGImageRef)imageForFrameNamed:(NSString *)frameImageName;
+
+@end
+
+@implementation SpeakingCharacterAtlas
+
+/*----------------------------------------------------------------------------------------
+	atlasForCharacterNamed:
+	 
+	Returns the shared atlas for the named character, creating it and starting its decode
+	the first time the character is asked for.  Must be called on the main thread.
+----------------------------------------------------------------------------------------*/
++ (SpeakingCharacterAtlas *)atlasForCharacterNamed:(NSString *)name
+{
+	static NSMutableDictionary *	sAtlases = NULL;
+	
+	if (sAtlases == NULL)
+		sAtlases = [NSMutableDictionary new];
+	
+	SpeakingCharacterAtlas *	atlas = [sAtlases objectForKey:name];
+	if (atlas == NULL) {
+		atlas = [[SpeakingCharacterAtlas alloc] initWithCharacterNamed:name];
+		[sAtlases setObject:atlas forKey:name];
+		[atlas release];
+	}
+	
+	return atlas;
+}
+
+/*----------------------------------------------------------------------------------------
+	initWithCharacterNamed:
+	 
+	Loads the character's description dictionary, gathers the paths of the frame images
+	it names and hands them to a background thread to be decoded into the atlas.
+----------------------------------------------------------------------------------------*/
+- (id)initWithCharacterNamed:(NSString *)name
+{
+	self = [super init];
+	if (self) {
+		_characterDescription = [[NSDictionary alloc] initWithContentsOfFile:[[NSBundle mainBundle] pathForResource:name ofType:@"plist"]];
+		
+		// Each frame image is listed once even if several expressions use it.
+		NSMutableDictionary *	framePaths = [NSMutableDictionary dictionary];
+		NSEnumerator *			expressionEnumerator = [_characterDescription objectEnumerator];
+		NSArray *				frameArray;
+		while ((frameArray = [expressionEnumerator nextObject])) {
+			NSEnumerator *	frameEnumerator = [frameArray objectEnumerator];
+			NSDictionary *	frameDictionary;
+			while ((frameDictionary = [frameEnumerator nextObject])) {
+				NSString *	frameImageName = [frameDictionary objectForKey:kCharacterExpressionFrameImageFileNameKey];
+				NSString *	framePath = [[NSBundle mainBundle] pathForResource:frameImageName ofType:@""];
+				if (framePath)
+					[framePaths setObject:framePath forKey:frameImageName];
+			}
+		}
+		
+		[NSThread detachNewThreadSelector:@selector(decodeFramesAtPaths:) toTarget:self withObject:framePaths];
+	}
+	return self;
+}
+
+/*----------------------------------------------------------------------------------------
+	dealloc
+----------------------------------------------------------------------------------------*/
+- (void)dealloc
+{
+	[_characterDescription release];
+	[_frameImages release];
+	[super dealloc];
+}
+
+/*----------------------------------------------------------------------------------------
+	decodeFramesAtPaths:
+	 
+	Runs on its own thread.  Decodes every frame image and draws it into one cell of a
+	grid sized to the largest frame.  Drawing into the bitmap context forces the full
+	decode here rather than on first display.  Each frame is then handed out as a
+	sub-image of the finished atlas, which shares the atlas's pixels.
+----------------------------------------------------------------------------------------*/
+- (void)decodeFramesAtPaths:(NSDictionary *)framePaths
+{
+	NSAutoreleasePool *		pool = [NSAutoreleasePool new];
+	CFMutableDictionaryRef	decodedImages = CFDictionaryCreateMutable(NULL, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+	CFMutableDictionaryRef	frameImages = CFDictionaryCreateMutable(NULL, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+	size_t					cellWidth = 0;
+	size_t					cellHeight = 0;
+	
+	NSEnumerator *	nameEnumerator = [framePaths keyEnumerator];
+	NSString *		frameImageName;
+	while ((frameImageName = [nameEnumerator nextObject])) {
+		CGImageSourceRef	source = CGImageSourceCreateWithURL((CFURLRef)[NSURL fileURLWithPath:[framePaths objectForKey:frameImageName]], NULL);
+		if (source) {
+			CGImageRef	image = CGImageSourceCreateImageAtIndex(source, 0, NULL);
+			if (image) {
+				CFDictionarySetValue(decodedImages, frameImageName, image);
+				if (CGImageGetWidth(image) > cellWidth)
+					cellWidth = CGImageGetWidth(image);
+				if (CGImageGetHeight(image) > cellHeight)
+					cellHeight = CGImageGetHeight(image);
+				CGImageRelease(image);
+			}
+			CFRelease(source);
+		}
+	}
+	
+	CFIndex	frameCount = CFDictionaryGetCount(decodedImages);
+	if (frameCount > 0) {
+		size_t				columns = (size_t)ceil(sqrt((double)frameCount));
+		size_t				rows = (frameCount + columns - 1) / columns;
+		size_t				atlasWidth = columns * cellWidth;
+		size_t				atlasHeight = rows * cellHeight;
+		CGColorSpaceRef		colorSpace = CGColorSpaceCreateDeviceRGB();
+		CGContextRef		atlasContext = CGBitmapContextCreate(NULL, atlasWidth, atlasHeight, 8, atlasWidth * 4, colorSpace, kCGImageAlphaPremultipliedFirst | kCGBitmapByteOrder32Host);
+		CGRect				frameRects[frameCount];
+		NSString *			frameNames[frameCount];
+		CFIndex				frameIndex = 0;
+		
+		if (atlasContext) {
+			CGContextClearRect(atlasContext, CGRectMake(0, 0, atlasWidth, atlasHeight));
+			
+			nameEnumerator = [(NSDictionary *)decodedImages keyEnumerator];
+			while ((frameImageName = [nameEnumerator nextObject])) {
+				CGImageRef	image = (CGImageRef)CFDictionaryGetValue(decodedImages, frameImageName);
+				size_t		width = CGImageGetWidth(image);
+				size_t		height = CGImageGetHeight(image);
+				size_t		left = (frameIndex % columns) * cellWidth;
+				size_t		top = (frameIndex / columns) * cellHeight;
+				
+				// The context's origin is at the bottom left, the atlas image's at the top left.
+				CGContextDrawImage(atlasContext, CGRectMake(left, atlasHeight - top - height, width, height), image);
+				frameRects[frameIndex] = CGRectMake(left, top, width, height);
+				frameNames[frameIndex] = frameImageName;
+				frameIndex++;
+			}
+			
+			CGImageRef	atlasImage = CGBitmapContextCreateImage(atlasContext);
+			if (atlasImage) {
+				for (frameIndex = 0; frameIndex < frameCount; frameIndex++) {
+					CGImageRef	frameImage = CGImageCreateWithImageInRect(atlasImage, frameRects[frameIndex]);
+					if (frameImage) {
+						CFDictionarySetValue(frameImages, frameNames[frameIndex], frameImage);
+						CGImageRelease(frameImage);
+					}
+				}
+				CGImageRelease(atlasImage);
+			}
+			CGContextRelease(atlasContext);
+		}
+		CGColorSpaceRelease(colorSpace);
+	}
+	
+	CFRelease(decodedImages);
+	[self performSelectorOnMainThread:@selector(finishLoadingWithFrameImages:) withObject:(NSDictionary *)frameImages waitUntilDone:NO];
+	CFRelease(frameImages);
+	
+	[pool release];
+}
+
+/*----------------------------------------------------------------------------------------
+	finishLoadingWithFrameImages:
+	 
+	Called on the main thread once decoding is complete.  Publishes the frames and tells
+	any views showing this character to redraw.
+----------------------------------------------------------------------------------------*/
+- (void)finishLoadingWithFrameImages:(NSDictionary *)frameImages
+{
+	_frameImages = [frameImages retain];
+	_isLoaded = YES;
+	[[NSNotificationCenter defaultCenter] postNotificationName:kSpeakingCharacterAtlasDidLoadNotification object:self];
+}
+
+/*----------------------------------------------------------------------------------------
+	characterDescription
+	 
+	Returns the character's expression dictionary.
+----------------------------------------------------------------------------------------*/
+- (NSDictionary *)characterDescription
+{
+	return _characterDescription;
+}
+
+/*----------------------------------------------------------------------------------------
+	isLoaded
+	 
+	Returns whether the frame images have finished decoding.
+----------------------------------------------------------------------------------------*/
+- (BOOL)isLoaded
+{
+	return _isLoaded;
+}
+
+/*----------------------------------------------------------------------------------------
+	imageForFrameNamed:
+	 
+	Returns the decoded image for the named frame, or NULL if the atlas is still loading
+	or the frame couldn't be read.  The image is owned by the atlas.
+----------------------------------------------------------------------------------------*/
+- (CGImageRef)imageForFrameNamed:(NSString *)frameImageName
+{
+	return (CGImageRef)[_frameImages objectForKey:frameImageName];
+}
+
+@end
+
 
 @interface SpeakingCharacterView (PrivateSpeakingCharacterView)
 
-- (void)animateNextExpressionFrame;
-- (void)startIdleExpression;
+- (void)animateFrameForTime:(double)time;
+- (void)displayChangedFrame;
 - (void)loadChacaterByName:(NSString *)name;
+- (void)characterAtlasDidLoad:(NSNotification *)notification;
 
 @end
 
+// How long a vowel or consonant stays on screen when no further phoneme replaces it.
+static const double	kMouthShapeHoldTime		= 0.5;
+
+// Room for the phonemes and speech events that may arrive between two refreshes, with plenty to spare.
+static const uint32_t	kTimelineCapacity	= 256;
+
+/*----------------------------------------------------------------------------------------
+	CurrentHostSeconds
+	 
+	The clock utterance start times are taken on; the same one the display link reports.
+----------------------------------------------------------------------------------------*/
+static double CurrentHostSeconds(void)
+{
+	return (double)CVGetCurrentHostTime() / CVGetHostClockFrequency();
+}
+
+/*----------------------------------------------------------------------------------------
+	ExpressionForViseme
+	 
+	Maps a timeline mouth shape to the character expression that draws it.
+----------------------------------------------------------------------------------------*/
+static NSString * ExpressionForViseme(SynthViseme viseme)
+{
+	switch (viseme) {
+		case kSynthVisemeSleep:		return kCharacterExpressionIdentifierSleep;
+		case kSynthVisemeConsonant:	return kCharacterExpressionIdentifierConsonant;
+		case kSynthVisemeVowel:		return kCharacterExpressionIdentifierVowel;
+		default:					return kCharacterExpressionIdentifierIdle;
+	}
+}
+
+/*----------------------------------------------------------------------------------------
+	DisplayLinkCallBack
+	 
+	Called on the display link's thread once per screen refresh with the time the next
+	frame will appear.
+----------------------------------------------------------------------------------------*/
+static CVReturn DisplayLinkCallBack(CVDisplayLinkRef displayLink, const CVTimeStamp * inNow, const CVTimeStamp * inOutputTime, CVOptionFlags flagsIn, CVOptionFlags * flagsOut, void * displayLinkContext)
+{
+    NSAutoreleasePool *	pool = [[NSAutoreleasePool alloc] init];
+
+	[(SpeakingCharacterView *)displayLinkContext animateFrameForTime:(double)inOutputTime->hostTime / CVGetHostClockFrequency()];
+
+    [pool release];
+	return kCVReturnSuccess;
+}
+
 @implementation SpeakingCharacterView
 
 /*----------------------------------------------------------------------------------------
 	initWithFrame:
 	 
-	Our designated initializer.  We load the default character and set the expression to sleep.
+	Our designated initializer.  We load the default character, set the expression to sleep
+	and create the display link that will step the animation.
 ----------------------------------------------------------------------------------------*/
 - (id)initWithFrame:(NSRect)frame {
     self = [super initWithFrame:frame];
     if (self) {
 	
+		_animationLock = [NSLock new];
+		if (SynthAnimationTimelineCreate(kTimelineCapacity, kMouthShapeHoldTime, &_timeline) != noErr || SynthEngineEventQueueCreate(kTimelineCapacity, &_speechEvents) != noErr) {
+			[self release];
+			return NULL;
+		}
+		if (CVDisplayLinkCreateWithActiveCGDisplays(&_displayLink) == kCVReturnSuccess)
+			CVDisplayLinkSetOutputCallback(_displayLink, DisplayLinkCallBack, self);
+		
 		[self loadChacaterByName:@"Buster"];
 		[self setExpression:kCharacterExpressionIdentifierSleep];
     }
     return self;
 }
 
+/*----------------------------------------------------------------------------------------
+	dealloc
+----------------------------------------------------------------------------------------*/
+- (void)dealloc
+{
+	if (_displayLink) {
+		CVDisplayLinkStop(_displayLink);
+		CVDisplayLinkRelease(_displayLink);
+	}
+	SynthAnimationTimelineDispose(_timeline);
+	SynthEngineEventQueueDispose(_speechEvents);
+	[[NSNotificationCenter defaultCenter] removeObserver:self];
+	[_characterAtlas release];
+	[_animationLock release];
+	[super dealloc];
+}
+
+/*----------------------------------------------------------------------------------------
+	viewDidMoveToWindow
+	 
+	Runs the display link only while we're in a window.
+----------------------------------------------------------------------------------------*/
+- (void)viewDidMoveToWindow
+{
+	if (_displayLink == NULL)
+		return;
+	
+	if ([self window])
+		CVDisplayLinkStart(_displayLink);
+	else
+		CVDisplayLinkStop(_displayLink);
+}
+
 /*----------------------------------------------------------------------------------------
 	initWithFrdrawRectame:
 	 
-	Our main draw routine.
+	Our main draw routine.  Frames come straight from the character's atlas, so nothing
+	is read or decoded here.
 ----------------------------------------------------------------------------------------*/
 - (void)drawRect:(NSRect)rect {
 
+	[_animationLock lock];
+	CGImageRef	frameImage = [_characterAtlas imageForFrameNamed:_curFrameName];
+	[_animationLock unlock];
+	if (frameImage == NULL)
+		return;
+
 	NSPoint	thePointToDraw;
-	NSSize	sourceSize = [_curFrameImage size];
+	NSSize	sourceSize = NSMakeSize(CGImageGetWidth(frameImage), CGImageGetHeight(frameImage));
 	NSSize	destSize = rect.size;
 	
 	if (destSize.width >= sourceSize.width)
@@ -103,108 +426,190 @@ static NSString *	kCharacterExpressionFrameImageFileNameKey	= @"FrameImageFileNa
 	else
 		thePointToDraw.y = 0;
 	
-	[_curFrameImage compositeToPoint:thePointToDraw operation:(NSCompositingOperation)NSCompositeSourceOver fraction:1.0];
+	CGContextDrawImage((CGContextRef)[[NSGraphicsContext currentContext] graphicsPort], CGRectMake(thePointToDraw.x, thePointToDraw.y, sourceSize.width, sourceSize.height), frameImage);
+}
+
+/*----------------------------------------------------------------------------------------
+	speechEventQueue
+	 
+	The queue to hand a speech channel as its kSynthEngineEventQueueProperty.  The display
+	link drains it each refresh and places every phoneme by its sample position.
+----------------------------------------------------------------------------------------*/
+- (SynthEngineEventQueue *)speechEventQueue
+{
+	return _speechEvents;
+}
+
+/*----------------------------------------------------------------------------------------
+	noteUtteranceStarting
+	 
+	Call just before starting an utterance on a channel posting to our event queue.
+	Returns the tag to give the utterance; events carrying any other tag, such as those
+	left over from an utterance that was stopped, are ignored.
+----------------------------------------------------------------------------------------*/
+- (uint64_t)noteUtteranceStarting
+{
+	uint64_t	utteranceTag;
+
+	[_animationLock lock];
+	utteranceTag = ++_utteranceTag;
+	_utteranceStartTime = CurrentHostSeconds();
+	[_animationLock unlock];
+	
+	return utteranceTag;
+}
+
+/*----------------------------------------------------------------------------------------
+	noteUtteranceContinuing
+	 
+	Call after continuing a paused utterance.  The sample positions resume where they
+	stopped, so the utterance is anchored again on the first event that follows.
+----------------------------------------------------------------------------------------*/
+- (void)noteUtteranceContinuing
+{
+	[_animationLock lock];
+	_utteranceStartTime = 0;
+	[_animationLock unlock];
 }
 
 /*----------------------------------------------------------------------------------------
 	setExpressionForPhoneme:
 	 
-	Sets the current expression to the expression corresponding to the given phoneme ID.
+	Shows the expression for the given phoneme ID from now on.  For synthesizers that only
+	report phonemes through callbacks; events from our queue are placed more exactly.
+	Safe to call from a speech callback thread.
 ----------------------------------------------------------------------------------------*/
 - (void)setExpressionForPhoneme:(NSNumber *)phoneme;
 {
-	int	phonemeValue = [phoneme shortValue];
-
-	if (phonemeValue == 0 || phonemeValue == 1)
-		[self setExpression:kCharacterExpressionIdentifierIdle];
-	else if (phonemeValue >= 2 && phonemeValue <= 17)
-		[self setExpression:kCharacterExpressionIdentifierVowel];
-	else
-		[self setExpression:kCharacterExpressionIdentifierConsonant];
+	SynthAnimationTimelineAddPhoneme(_timeline, CurrentHostSeconds(), [phoneme shortValue]);
 }
 
 /*----------------------------------------------------------------------------------------
 	setExpression:
 	 
-	Sets the current expression to the named expresison identifier, then forces the
-	character image on screen to be updated.
+	Sets the current expression to the named expresison identifier.  Sleep and idle become
+	the expression shown whenever the mouth is at rest; the mouth shapes are shown until
+	the next phoneme, or for half a second.
 ----------------------------------------------------------------------------------------*/
 - (void)setExpression:(NSString *)expression
 {
-	// Set up to begin animating the frames
-	[_expressionFrameTimer invalidate];
-	_expressionFrameTimer = NULL;
-	[_currentExpression release];
-	_currentExpression = [expression retain];
-	_curFrameArray = [_characterDescription objectForKey:_currentExpression];
-	_curFrameIndex = 0;
-	[self animateNextExpressionFrame];
-	
-	// If the expression we just set is NOT the idle or sleep expression, then set up the idle start timer.
-	if (! ([expression isEqualToString:kCharacterExpressionIdentifierIdle] || [expression isEqualToString:kCharacterExpressionIdentifierSleep])) {
-		[_idleStartTimer invalidate];
-		_idleStartTimer = [NSTimer scheduledTimerWithTimeInterval:0.5 target:self selector:@selector(startIdleExpression) userInfo:NULL repeats:NO];
-	}
-	else {
-		[_idleStartTimer invalidate];
-		_idleStartTimer = NULL;
+	double	now = CurrentHostSeconds();
+
+	if ([expression isEqualToString:kCharacterExpressionIdentifierSleep] || [expression isEqualToString:kCharacterExpressionIdentifierIdle]) {
+		SynthAnimationTimelineSetRestingViseme(_timeline, [expression isEqualToString:kCharacterExpressionIdentifierSleep] ? kSynthVisemeSleep : kSynthVisemeIdle);
+		SynthAnimationTimelineAddViseme(_timeline, now, kSynthVisemeIdle);
 	}
+	else if ([expression isEqualToString:kCharacterExpressionIdentifierVowel])
+		SynthAnimationTimelineAddViseme(_timeline, now, kSynthVisemeVowel);
+	else
+		SynthAnimationTimelineAddViseme(_timeline, now, kSynthVisemeConsonant);
 }
 
 /*----------------------------------------------------------------------------------------
-	animateNextExpressionFrame
+	animateFrameForTime:
 	 
-	Determines the next frame to animate, loads the image and forces it to be drawn.  If 
-	the expression contains multiple frames, sets up timer for the next frame to be drawn.
+	Called from the display link for every refresh.  Moves any speech events to the
+	timeline, samples it for the expression showing at the given time, steps through
+	that expression's frames by their durations, and asks for a redraw only if the frame
+	has changed.  The work per refresh is the same however fast phonemes arrive.
 ----------------------------------------------------------------------------------------*/
-- (void)animateNextExpressionFrame
+- (void)animateFrameForTime:(double)time
 {
-	_expressionFrameTimer = NULL;
+	SynthEngineEvent	event;
+	double			startTime;
+	SynthViseme		viseme;
+	BOOL			frameChanged;
 	
-	NSDictionary *	frameDictionary = [_curFrameArray objectAtIndex:_curFrameIndex];
+	[_animationLock lock];
 	
-	// Grab image and force draw.  Use cache to reduce disk hits
-	NSString *	frameImageName = [frameDictionary objectForKey:kCharacterExpressionFrameImageFileNameKey];
-	_curFrameImage = [_imageCache objectForKey:frameImageName];
-	if (_curFrameImage == NULL) {
-		_curFrameImage = [[NSImage alloc] initWithContentsOfFile:[[NSBundle mainBundle] pathForResource:frameImageName ofType:@""]];
-		[_imageCache setObject:_curFrameImage forKey:frameImageName];
-		[_curFrameImage release];
+	while (SynthEngineEventQueueTryNext(_speechEvents, &event)) {
+		if (event.utteranceTag != _utteranceTag)
+			continue;
+		if (_utteranceStartTime == 0)
+			_utteranceStartTime = CurrentHostSeconds() - SynthEngineSamplesToSeconds(event.samplePosition);
+		SynthAnimationTimelineAddEngineEvent(_timeline, &event, _utteranceStartTime);
+		
+		// Text queued behind it under the same tag, such as the next chunk, starts where it ended.
+		if (event.kind == kSynthEngineSpeechDoneEvent)
+			_utteranceStartTime += SynthEngineSamplesToSeconds(event.samplePosition);
 	}
-	[self display];
+	viseme = SynthAnimationTimelineSample(_timeline, time, &startTime);
 	
-	// If there is more than one frame, then schedule drawing of the next and increment our frame index.
-	if ([_curFrameArray count] > 0) {
-		_curFrameIndex++;
-		_curFrameIndex %= [_curFrameArray count];
-		_expressionFrameTimer = [NSTimer scheduledTimerWithTimeInterval:[[frameDictionary objectForKey:kCharacterExpressionFrameDurationKey] floatValue] target:self selector:@selector(animateNextExpressionFrame) userInfo:NULL repeats:NO];
+	NSArray *		frameArray = [_characterDescription objectForKey:ExpressionForViseme(viseme)];
+	unsigned		frameCount = [frameArray count];
+	NSString *		frameImageName = NULL;
+	
+	if (frameCount > 0) {
+		double		totalDuration = 0;
+		double		elapsed = time - startTime;
+		unsigned	frameIndex;
+		
+		for (frameIndex = 0; frameIndex < frameCount; frameIndex++)
+			totalDuration += [[[frameArray objectAtIndex:frameIndex] objectForKey:kCharacterExpressionFrameDurationKey] doubleValue];
+		if (totalDuration > 0 && elapsed > 0)
+			elapsed = fmod(elapsed, totalDuration);
+		
+		for (frameIndex = 0; frameIndex < frameCount - 1; frameIndex++) {
+			elapsed -= [[[frameArray objectAtIndex:frameIndex] objectForKey:kCharacterExpressionFrameDurationKey] doubleValue];
+			if (elapsed < 0)
+				break;
+		}
+		frameImageName = [[frameArray objectAtIndex:frameIndex] objectForKey:kCharacterExpressionFrameImageFileNameKey];
 	}
+	
+	frameChanged = ! (frameImageName == _curFrameName || [frameImageName isEqualToString:_curFrameName]);
+	_curFrameName = frameImageName;
+	
+	[_animationLock unlock];
+	
+	if (frameChanged)
+		[self performSelectorOnMainThread:@selector(displayChangedFrame) withObject:NULL waitUntilDone:NO];
 }
 
 /*----------------------------------------------------------------------------------------
-	startIdleExpression
+	displayChangedFrame
 	 
-	Starts the idle expression.  Called by the idle timer after certain expressions (mainly
-	phoneme expressions) expire.
+	Marks the view for redrawing after the display link has moved to a new frame.
 ----------------------------------------------------------------------------------------*/
-- (void)startIdleExpression
+- (void)displayChangedFrame
 {
-	_idleStartTimer = NULL;
-	
-	[self setExpression:kCharacterExpressionIdentifierIdle];
+	[self setNeedsDisplay:YES];
 }
 
 /*----------------------------------------------------------------------------------------
 	loadChacaterByName:
 	 
-	Loads description dictionary for the named character and flushes any cached images.
+	Switches to the shared atlas for the named character.  The first view to ask for a
+	character starts its frames decoding; later views, and later switches back, reuse it.
 ----------------------------------------------------------------------------------------*/
 - (void)loadChacaterByName:(NSString *)name
 {
-	[_imageCache release];
-	_imageCache = [NSMutableDictionary new];
-	[_characterDescription release];
-	_characterDescription = [[NSDictionary alloc] initWithContentsOfFile:[[NSBundle mainBundle] pathForResource:name ofType:@"plist"]];
+	NSNotificationCenter *		center = [NSNotificationCenter defaultCenter];
+	SpeakingCharacterAtlas *	atlas = [SpeakingCharacterAtlas atlasForCharacterNamed:name];
+	
+	[center removeObserver:self name:kSpeakingCharacterAtlasDidLoadNotification object:_characterAtlas];
+	
+	[_animationLock lock];
+	[atlas retain];
+	[_characterAtlas release];
+	_characterAtlas = atlas;
+	_characterDescription = [_characterAtlas characterDescription];
+	_curFrameName = NULL;
+	[_animationLock unlock];
+	
+	if (! [_characterAtlas isLoaded])
+		[center addObserver:self selector:@selector(characterAtlasDidLoad:) name:kSpeakingCharacterAtlasDidLoadNotification object:_characterAtlas];
+}
+
+/*----------------------------------------------------------------------------------------
+	characterAtlasDidLoad:
+	 
+	Redraws the current frame once the character's atlas has finished decoding.
+----------------------------------------------------------------------------------------*/
+- (void)characterAtlasDidLoad:(NSNotification *)notification
+{
+	[[NSNotificationCenter defaultCenter] removeObserver:self name:kSpeakingCharacterAtlasDidLoadNotification object:_characterAtlas];
+	[self setNeedsDisplay:YES];
 }
 
 @end
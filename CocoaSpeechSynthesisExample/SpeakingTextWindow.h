@@ -51,6 +51,7 @@
 #import <fcntl.h>
 
 #import "SpeakingCharacterView.h"
+#import "SynthVoiceIndex.h"
 
 @interface SpeakingTextWindow : NSDocument
 {
@@ -97,6 +98,7 @@
 	NSRange					fOrgSelectionRange;
 	long					fSelectedVoiceID;
 	long					fSelectedVoiceCreator;
+	SynthVoiceIndex			*fVoiceIndex;
     SpeechChannel			fCurSpeechChannel;
     long					fOffsetToSpokenText;
     unsigned long			fLastErrorCode;
@@ -105,8 +107,25 @@
     BOOL					fCurrentlySpeaking;
     BOOL					fCurrentlyPaused;
     BOOL					fSavingToFile;
+    BOOL					fCharacterFollowsEvents;
     NSData					*fTextData;
     NSString				*fTextDataType;
+
+    // Streaming speech.  The text is handed to the channel a chunk at a time, from the text-done callback, out of
+    // two buffers:  one the channel has, and one holding the next chunk.  Guarded by fChunkCondition.
+    NSCondition				*fChunkCondition;
+    char					*fChunkBuffers[2];
+    UniChar					*fChunkCharacters;
+    unsigned long			fChunkLengths[2];
+    long					fChunkOffsets[2];
+    BOOL					fChunkHasWords[2];
+    long					fReadyChunk;
+    long					fHandedChunk;
+    unsigned long			fNextChunkLocation;
+    unsigned long			fEndOfSpokenText;
+    long					fPendingChunkOffsets[4];
+    long					fPendingChunkCount;
+    long					fLastWordEnd;
 }
 
     // Initialization/deallocation
@@ -119,6 +138,7 @@
 - (void)setTextDataType:(NSString *)theData;
 - (NSString *)textDataType;
 - (SpeakingCharacterView *)characterView;
+- (BOOL)characterFollowsEvents;
 - (BOOL)shouldDisplayWordCallbacks;
 - (BOOL)shouldDisplayPhonemeCallbacks;
 - (BOOL)shouldDisplayErrorCallbacks;
@@ -141,6 +161,14 @@
 - (OSErr)createNewSpeechChannel:(VoiceSpec *)voiceSpec;
 - (void)startSpeakingTextViewToURL:(NSURL *)url;
 
+    // Streaming speech
+- (BOOL)prepareChunk:(long)index maxLength:(unsigned long)maxLength;
+- (void)prepareNextChunk;
+- (BOOL)handOffNextChunk:(const void **)nextBuf length:(unsigned long *)byteLen;
+- (long)textOffsetOfWordAtPosition:(long)position length:(long)length;
+- (long)textOffsetOfPosition:(long)position;
+- (void)stopStreaming;
+
     // Options panel actions
 - (IBAction)voicePopupSelected:(id)sender;
 - (IBAction)charByCharCheckboxSelected:(id)sender;
@@ -50,6 +50,12 @@
 //
 // Constants
 //
+
+// The example synthesizer's own channel properties, from SynthesizerSimulator.h.  Other synthesizers
+// reject them, and the character then follows phoneme callbacks instead.
+#define soSynthEngineEventQueue		'evtq'
+#define soSynthEngineUtteranceTag	'utag'
+
 NSString *	kPlainTextDataTypeString 	= @"Plain Text";
 NSString *  kDefaultWindowTextString 	= @"Welcome to Cocoa Speech Synthesis Example.  This application provides an example of using Apple's speech synthesis technology in a Cocoa-based application.";
 
@@ -58,6 +64,9 @@ NSString *	kWordCallbackParamLength	= @"ParamLength";
 NSString *	kErrorCallbackParamPosition	= @"ParamPosition";
 NSString *	kErrorCallbackParamError	= @"ParamError";
 
+const unsigned long	kFirstSpeechChunkLength	= 256;		// Short, so speech starts right away however long the text is.
+const unsigned long	kSpeechChunkLength		= 4096;
+
 //
 // Prototypes
 //
@@ -67,6 +76,8 @@ static pascal void 	OurSpeechDoneCallBackProc(SpeechChannel inSpeechChannel, lon
 static pascal void 	OurSyncCallBackProc(SpeechChannel inSpeechChannel, long inRefCon, OSType inSyncMessage);
 static pascal void 	OurPhonemeCallBackProc(SpeechChannel inSpeechChannel, long inRefCon, short inPhonemeOpcode);
 static pascal void 	OurWordCallBackProc(SpeechChannel inSpeechChannel, long inRefCon, long inWordPos, short inWordLen);
+static unsigned long	SentenceAlignedChunkLength(const UniChar * inCharacters, unsigned long inLength);
+static void			ConvertChunkToMacRoman(const UniChar * inCharacters, unsigned long inLength, char * outBytes);
 static UInt32		BCDNumToLong(UInt32 inBCDNum);
 static NSString*	VersionNumToString(NumVersion inVersionNum);
 
@@ -88,6 +99,7 @@ static NSString*	VersionNumToString(NumVersion inVersionNum);
         // Set our default window text.
         [self setTextData:[NSData dataWithBytes:[kDefaultWindowTextString cString] length:[kDefaultWindowTextString cStringLength]]];
         [self setTextDataType:kPlainTextDataTypeString];
+        fChunkCondition = [NSCondition new];
     }
     
     return self;
@@ -100,8 +112,17 @@ static NSString*	VersionNumToString(NumVersion inVersionNum);
 ----------------------------------------------------------------------------------------*/
 -(void)dealloc
 {
+	// The channel posts to the character view's event queue, and calls back with us as its refcon.
+	if (fCurSpeechChannel)
+		DisposeSpeechChannel(fCurSpeechChannel);
     [fTextData release];
     [fTextDataType release];
+    [fChunkCondition release];
+    free(fChunkBuffers[0]);
+    free(fChunkBuffers[1]);
+    free(fChunkCharacters);
+	if (fVoiceIndex)
+		SynthVoiceIndexClose(fVoiceIndex);
 }
 
 /*----------------------------------------------------------------------------------------
@@ -167,6 +188,17 @@ static NSString*	VersionNumToString(NumVersion inVersionNum);
 	return fCharacterView;
 }
 
+/*----------------------------------------------------------------------------------------
+	characterFollowsEvents
+	
+	Returns whether the character view is fed from the channel's events rather than from
+	our phoneme callback.
+----------------------------------------------------------------------------------------*/
+- (BOOL)characterFollowsEvents
+{
+	return fCharacterFollowsEvents;
+}
+
 /*----------------------------------------------------------------------------------------
 	shouldDisplayWordCallbacks
 	
@@ -246,18 +278,43 @@ static NSString*	VersionNumToString(NumVersion inVersionNum);
     	long 		voiceIndex;
     	BOOL		voiceFoundAndSelected = false;
     	VoiceSpec	theVoiceSpec;
+    	char		indexPath[PATH_MAX];
 
     	// Delete the existing voices from the bottom of the menu.
     	while([fVoicesPopUpButton numberOfItems] > 2)
             [fVoicesPopUpButton removeItemAtIndex:2];
 
-    	// Ask TTS API for each available voicez
-		theErr = CountVoices(&numOfVoices);
-		if (theErr != noErr)
-   			NSRunAlertPanel(@"CountVoices", [NSString stringWithFormat:@"Error #%d returned.", theErr], @"Oh?", NULL, NULL);
+		// Use the compiled voice index if no voice was installed or removed since it was built.  Listing it
+		// doesn't open every voice bundle the way GetIndVoice and GetVoiceDescription do.
+		if (SynthVoiceIndexGetDefaultPath(indexPath, sizeof(indexPath)) == noErr && SynthVoiceIndexOpen(indexPath, &fVoiceIndex) == noErr) {
+			if (! SynthVoiceIndexIsCurrent(fVoiceIndex)) {
+				SynthVoiceIndexClose(fVoiceIndex);
+				fVoiceIndex = NULL;
+			}
+		}
+
+		if (fVoiceIndex)
+			numOfVoices = SynthVoiceIndexGetCount(fVoiceIndex);
+		else {
+    		// Ask TTS API for each available voicez
+			theErr = CountVoices(&numOfVoices);
+			if (theErr != noErr)
+   				NSRunAlertPanel(@"CountVoices", [NSString stringWithFormat:@"Error #%d returned.", theErr], @"Oh?", NULL, NULL);
+		}
 
     	if (theErr == noErr) {
             for (voiceIndex = 1; voiceIndex <= numOfVoices; voiceIndex++) {
+				if (fVoiceIndex) {
+					const SynthVoiceRecord *	theVoice = SynthVoiceIndexGetVoice(fVoiceIndex, voiceIndex - 1);
+
+					[fVoicesPopUpButton addItemWithTitle:[NSString stringWithUTF8String:SynthVoiceIndexGetString(fVoiceIndex, theVoice->nameOffset)]];
+					if (theVoice->creator == fSelectedVoiceCreator && theVoice->id == fSelectedVoiceID) {
+						[fVoicesPopUpButton selectItemAtIndex:voiceIndex-1];
+						voiceFoundAndSelected = true;
+					}
+					continue;
+				}
+
         		VoiceDescription	theVoiceDesc;
 				theErr = GetIndVoice(voiceIndex, &theVoiceSpec);
 				if (theErr != noErr)
@@ -375,7 +432,7 @@ static NSString*	VersionNumToString(NumVersion inVersionNum);
 ----------------------------------------------------------------------------------------*/
 - (void)highlightWordWithParams:(NSDictionary *)params
 {
-	UInt32	selectionPosition = [[params objectForKey:kWordCallbackParamPosition] longValue] + fOffsetToSpokenText;
+	UInt32	selectionPosition = [[params objectForKey:kWordCallbackParamPosition] longValue];
 	UInt32	wordLength = [[params objectForKey:kWordCallbackParamLength] longValue];
 	
     [fSpokenTextView scrollRangeToVisible:NSMakeRange(selectionPosition, wordLength)];
@@ -391,7 +448,7 @@ static NSString*	VersionNumToString(NumVersion inVersionNum);
 - (void)displayErrorAlertWithParams:(NSDictionary *)params
 {
 
-	UInt32	errorPosition = [[params objectForKey:kErrorCallbackParamPosition] longValue] + fOffsetToSpokenText;
+	UInt32	errorPosition = [[params objectForKey:kErrorCallbackParamPosition] longValue];
 	UInt32	errorCode = [[params objectForKey:kErrorCallbackParamError] longValue];
 
 	if (errorCode != fLastErrorCode) {
@@ -417,6 +474,8 @@ static NSString*	VersionNumToString(NumVersion inVersionNum);
 			theErr = ContinueSpeech(fCurSpeechChannel);
 			if (theErr != noErr)
    				NSRunAlertPanel(@"ContinueSpeech", [NSString stringWithFormat:@"Error #%d returned.", theErr], @"Oh?", NULL, NULL);
+			else if (fCharacterFollowsEvents)
+   				[fCharacterView noteUtteranceContinuing];
 		}
 
 		fLastErrorCode = errorCode;
@@ -451,6 +510,8 @@ static NSString*	VersionNumToString(NumVersion inVersionNum);
         theErr = ContinueSpeech(fCurSpeechChannel);
         if (theErr != noErr)
             NSRunAlertPanel(@"ContinueSpeech", [NSString stringWithFormat:@"Error #%d returned.", theErr], @"Oh?", NULL, NULL);
+        else if (fCharacterFollowsEvents)
+            [fCharacterView noteUtteranceContinuing];
     }
 
 }
@@ -463,6 +524,7 @@ static NSString*	VersionNumToString(NumVersion inVersionNum);
 ----------------------------------------------------------------------------------------*/
 - (void)speechIsDone
 {
+	[self stopStreaming];
 	fCurrentlySpeaking = false;
     [self updateSpeakingControlState];
 	[self enableCallbackControlsBasedOnSavingToFileFlag:false];
@@ -481,6 +543,10 @@ static NSString*	VersionNumToString(NumVersion inVersionNum);
 	OSErr	theErr = noErr;
     unsigned long alertButtonClicked;
 
+    // The text done callback is installed when saving to a file too, since it feeds the channel, but there's no alert then.
+    if (fSavingToFile)
+        return;
+
     // Tell engine to pause while we display this dialog.
     theErr = PauseSpeechAt(fCurSpeechChannel, kImmediate);
     if (theErr != noErr)
@@ -495,6 +561,8 @@ static NSString*	VersionNumToString(NumVersion inVersionNum);
         theErr = ContinueSpeech(fCurSpeechChannel);
         if (theErr != noErr)
             NSRunAlertPanel(@"ContinueSpeech", [NSString stringWithFormat:@"Error #%d returned.", theErr], @"Oh?", NULL, NULL);
+        else if (fCharacterFollowsEvents)
+            [fCharacterView noteUtteranceContinuing];
     }
 }
 
@@ -520,6 +588,9 @@ static NSString*	VersionNumToString(NumVersion inVersionNum);
 			whereToStop = kEndOfSentence;
 		else
 			whereToStop = kImmediate;
+
+		// Nothing more is handed to the channel, whichever way it stops.
+		[self stopStreaming];
         
 		if (whereToStop == kImmediate) {
             // NOTE:  	We could just call StopSpeechAt with kImmediate, but for test purposes
@@ -573,18 +644,17 @@ static NSString*	VersionNumToString(NumVersion inVersionNum);
 {
 
     OSErr		theErr = noErr;
-    NSString * 	theViewText;
     
-    // Grab the selection substring, or if no selection then grab entire text.
+    // Speak the selection, or if no selection then the entire text.
     fOrgSelectionRange = [fSpokenTextView selectedRange];
     
     if (fOrgSelectionRange.length == 0) {
-        theViewText = [fSpokenTextView string];
-        fOffsetToSpokenText = 0;
+        fNextChunkLocation = 0;
+        fEndOfSpokenText = [[fSpokenTextView string] length];
     }
     else {
-        theViewText = [[fSpokenTextView string] substringWithRange:fOrgSelectionRange];
-        fOffsetToSpokenText = fOrgSelectionRange.location;
+        fNextChunkLocation = fOrgSelectionRange.location;
+        fEndOfSpokenText = NSMaxRange(fOrgSelectionRange);
     }
 	
 	// Setup our callbacks
@@ -611,7 +681,7 @@ static NSString*	VersionNumToString(NumVersion inVersionNum);
 	}
 
 	if (theErr == noErr) {
-		theErr = SetSpeechInfo(fCurSpeechChannel, soTextDoneCallBack, fSavingToFile?NULL:OurTextDoneCallBackProc);
+		theErr = SetSpeechInfo(fCurSpeechChannel, soTextDoneCallBack, OurTextDoneCallBackProc);
 		if (theErr != noErr)
    			NSRunAlertPanel(@"SetSpeechInfo(soTextDoneCallBack)", [NSString stringWithFormat:@"Error #%d returned.", theErr], @"Oh?", NULL, NULL);
 	}
@@ -624,13 +694,49 @@ static NSString*	VersionNumToString(NumVersion inVersionNum);
     // Set URL to save file to disk
 	SetSpeechInfo(fCurSpeechChannel, 'opaf', url);	// Use selector constant soOutputToFileWithCFURL with 10.3 or later
        
-        // Convert NSString to cString. 
-    char * theTextToSpeak = (char *)[theViewText lossyCString];
-    if (theTextToSpeak) {
+    // The buffers are made once, and are all the memory speaking takes, however long the text.
+    if (fChunkBuffers[0] == NULL) {
+        fChunkBuffers[0] = malloc(kSpeechChunkLength);
+        fChunkBuffers[1] = malloc(kSpeechChunkLength);
+        fChunkCharacters = malloc(kSpeechChunkLength * sizeof(UniChar));
+        if (fChunkBuffers[0] == NULL || fChunkBuffers[1] == NULL || fChunkCharacters == NULL) {
+            free(fChunkBuffers[0]);
+            free(fChunkBuffers[1]);
+            free(fChunkCharacters);
+            fChunkBuffers[0] = fChunkBuffers[1] = NULL;
+            fChunkCharacters = NULL;
+            theErr = memFullErr;
+        }
+    }
+
+    // Start with a short first chunk, and have the one after it ready for the text done callback.
+    if (theErr == noErr) {
+        [fChunkCondition lock];
+        fReadyChunk = -1;
+        fHandedChunk = 0;
+        fPendingChunkCount = 0;
+        fLastWordEnd = 0;
+        fChunkLengths[0] = 0;
+        fOffsetToSpokenText = fNextChunkLocation;
+        if ([self prepareChunk:0 maxLength:kFirstSpeechChunkLength]) {
+            fOffsetToSpokenText = fChunkOffsets[0];
+            if ([self prepareChunk:1 maxLength:kSpeechChunkLength])
+                fReadyChunk = 1;
+        }
+        [fChunkCondition unlock];
+    }
+
+    if (theErr == noErr) {
         // We want the text view the active view.  Also saves any parameters currently being edited.
         [fWindow makeFirstResponder:fSpokenTextView];  
 
-        OSErr  theErr = SpeakText(fCurSpeechChannel, theTextToSpeak, strlen(theTextToSpeak));
+        // Events left from an earlier utterance, or from one saved to a file, carry another tag and are ignored.
+        if (fCharacterFollowsEvents) {
+        	uint64_t	utteranceTag = (fSavingToFile || ! [self shouldDisplayPhonemeCallbacks]) ? 0 : [fCharacterView noteUtteranceStarting];
+        	SetSpeechInfo(fCurSpeechChannel, soSynthEngineUtteranceTag, &utteranceTag);
+        }
+
+        theErr = SpeakText(fCurSpeechChannel, fChunkBuffers[0], fChunkLengths[0]);
         if (theErr == noErr) {
         
             // Update our vars
@@ -641,15 +747,163 @@ static NSString*	VersionNumToString(NumVersion inVersionNum);
             fCurrentlyPaused = false;
             [self updateSpeakingControlState];
         }
-        else {
-            NSRunAlertPanel(@"SpeakText", [NSString stringWithFormat:@"Error #%d returned.", theErr], @"Oh?", NULL, NULL);
-        }
+    }
+    if (theErr != noErr) {
+        [self stopStreaming];
+        NSRunAlertPanel(@"SpeakText", [NSString stringWithFormat:@"Error #%d returned.", theErr], @"Oh?", NULL, NULL);
     }
 	
 	[self enableCallbackControlsBasedOnSavingToFileFlag:fSavingToFile];
 
 }
 
+/*----------------------------------------------------------------------------------------
+	prepareChunk:maxLength:
+	
+	Takes the next chunk of the text to speak from the text storage, ending it after a
+	sentence where there is one, and puts it in one of the chunk buffers.  Called on the
+	main thread, the only one that reads the text storage, with fChunkCondition locked.
+	Returns false when there's no more text.
+----------------------------------------------------------------------------------------*/
+- (BOOL)prepareChunk:(long)index maxLength:(unsigned long)maxLength
+{
+    NSString *			theText = [[fSpokenTextView textStorage] string];
+    NSCharacterSet *	spaces = [NSCharacterSet whitespaceAndNewlineCharacterSet];
+    NSCharacterSet *	wordCharacters = [NSCharacterSet alphanumericCharacterSet];
+    unsigned long		end = MIN(fEndOfSpokenText, [theText length]);
+    unsigned long		start = fNextChunkLocation;
+    unsigned long		length, i;
+
+    // Each chunk starts with its first word, so word positions in it start over near zero.
+    while (start < end && [spaces characterIsMember:[theText characterAtIndex:start]])
+        start++;
+    if (start >= end) {
+        fNextChunkLocation = fEndOfSpokenText;
+        return false;
+    }
+
+    length = MIN(end - start, maxLength);
+    [theText getCharacters:fChunkCharacters range:NSMakeRange(start, length)];
+    if (start + length < end)
+        length = SentenceAlignedChunkLength(fChunkCharacters, length);
+
+    fChunkHasWords[index] = false;
+    for (i = 0; i < length && ! fChunkHasWords[index]; i++)
+        fChunkHasWords[index] = [wordCharacters characterIsMember:fChunkCharacters[i]];
+    ConvertChunkToMacRoman(fChunkCharacters, length, fChunkBuffers[index]);
+    fChunkLengths[index] = length;
+    fChunkOffsets[index] = start;
+    fNextChunkLocation = start + length;
+    return true;
+}
+
+/*----------------------------------------------------------------------------------------
+	prepareNextChunk
+	
+	Fills the buffer the channel is done with from the text, as soon as the text done
+	callback has handed the other one off, so it's ready long before it's asked for.
+----------------------------------------------------------------------------------------*/
+- (void)prepareNextChunk
+{
+    [fChunkCondition lock];
+    if (fReadyChunk < 0 && fNextChunkLocation < fEndOfSpokenText) {
+        long	index = (fHandedChunk == 0) ? 1 : 0;
+        if ([self prepareChunk:index maxLength:kSpeechChunkLength])
+            fReadyChunk = index;
+    }
+    [fChunkCondition broadcast];
+    [fChunkCondition unlock];
+}
+
+/*----------------------------------------------------------------------------------------
+	handOffNextChunk:length:
+	
+	Called from the text done callback to give the channel the next chunk, if there is
+	one.  The channel is done with the previous buffer by then, so it's filled again next.
+----------------------------------------------------------------------------------------*/
+- (BOOL)handOffNextChunk:(const void **)nextBuf length:(unsigned long *)byteLen
+{
+    BOOL		handedOff = false;
+    NSDate *	giveUpDate = [NSDate dateWithTimeIntervalSinceNow:1.0];
+
+    [fChunkCondition lock];
+
+    // The main thread has fallen a whole chunk behind if it's still making this one, so wait a little for it.
+    while (fReadyChunk < 0 && fNextChunkLocation < fEndOfSpokenText) {
+        if (! [fChunkCondition waitUntilDate:giveUpDate])
+            break;
+    }
+    if (fReadyChunk >= 0) {
+        *nextBuf = fChunkBuffers[fReadyChunk];
+        *byteLen = fChunkLengths[fReadyChunk];
+
+        // Words are matched to chunks in the order they're spoken, and a chunk without any never gets a word callback.
+        if (fChunkHasWords[fReadyChunk] && fPendingChunkCount < (long)(sizeof(fPendingChunkOffsets) / sizeof(long)))
+            fPendingChunkOffsets[fPendingChunkCount++] = fChunkOffsets[fReadyChunk];
+        fHandedChunk = fReadyChunk;
+        fReadyChunk = -1;
+        handedOff = true;
+    }
+    [fChunkCondition unlock];
+
+    if (handedOff)
+        [self performSelectorOnMainThread:@selector(prepareNextChunk) withObject:NULL waitUntilDone:false];
+    return handedOff;
+}
+
+/*----------------------------------------------------------------------------------------
+	textOffsetOfWordAtPosition:length:
+	
+	Returns where in the text view a word reported by the word callback is.  Positions
+	go forward within a chunk and start over with the next, so a word that doesn't come
+	after the last one is the first word of the chunk handed off after it.
+----------------------------------------------------------------------------------------*/
+- (long)textOffsetOfWordAtPosition:(long)position length:(long)length
+{
+    long	offset;
+
+    [fChunkCondition lock];
+    if (fPendingChunkCount > 0 && position < fLastWordEnd) {
+        fOffsetToSpokenText = fPendingChunkOffsets[0];
+        memmove(&fPendingChunkOffsets[0], &fPendingChunkOffsets[1], --fPendingChunkCount * sizeof(long));
+    }
+    fLastWordEnd = position + length;
+    offset = fOffsetToSpokenText + position;
+    [fChunkCondition unlock];
+
+    return offset;
+}
+
+/*----------------------------------------------------------------------------------------
+	textOffsetOfPosition:
+	
+	Returns where in the text view a position in the chunk being spoken is.
+----------------------------------------------------------------------------------------*/
+- (long)textOffsetOfPosition:(long)position
+{
+    long	offset;
+
+    [fChunkCondition lock];
+    offset = fOffsetToSpokenText + position;
+    [fChunkCondition unlock];
+
+    return offset;
+}
+
+/*----------------------------------------------------------------------------------------
+	stopStreaming
+	
+	Leaves no more text to hand to the channel.
+----------------------------------------------------------------------------------------*/
+- (void)stopStreaming
+{
+    [fChunkCondition lock];
+    fNextChunkLocation = fEndOfSpokenText;
+    fReadyChunk = -1;
+    [fChunkCondition broadcast];
+    [fChunkCondition unlock];
+}
+
 /*----------------------------------------------------------------------------------------
 	pauseContinueButtonPressed:
 	
@@ -668,6 +922,8 @@ static NSString*	VersionNumToString(NumVersion inVersionNum);
 		theErr = ContinueSpeech(fCurSpeechChannel);
 		if (theErr != noErr)
 			NSRunAlertPanel(@"ContinueSpeech", [NSString stringWithFormat:@"Error #%d returned.", theErr], @"Oh?", NULL, NULL);
+		else if (fCharacterFollowsEvents)
+			[fCharacterView noteUtteranceContinuing];
 	
 		fCurrentlyPaused = false;
         [self updateSpeakingControlState];
@@ -710,17 +966,30 @@ static NSString*	VersionNumToString(NumVersion inVersionNum);
         //
 		// Use the default voice from preferences.
         //
-        // Our only choice is to close and reopen the speech channel to get the default voice.
+        // GetVoiceDescription describes the default voice when not given one, so the channel can switch to it in
+        // place.  Only if it belongs to another synthesizer do we close and reopen the speech channel.
+		VoiceDescription	theVoiceDesc;
+
 		fSelectedVoiceCreator = 0;
-        theErr = [self createNewSpeechChannel:NULL];
+		theErr = GetVoiceDescription(NULL, &theVoiceDesc, sizeof(theVoiceDesc));
+		if (theErr != noErr || fCurSpeechChannel == NULL || SetSpeechInfo(fCurSpeechChannel, soCurrentVoice, &theVoiceDesc.voice) != noErr)
+        	theErr = [self createNewSpeechChannel:NULL];
 	}
 	else {
 		// 
 		// Use the voice the user selected.
 		//
-		theErr = GetIndVoice([sender indexOfSelectedItem] - 1, &theVoiceSpec);
-		if (theErr != noErr)
-   			NSRunAlertPanel(@"GetIndVoice", [NSString stringWithFormat:@"Error #%d returned.", theErr], @"Oh?", NULL, NULL);
+		if (fVoiceIndex) {
+			const SynthVoiceRecord *	theVoice = SynthVoiceIndexGetVoice(fVoiceIndex, [sender indexOfSelectedItem] - 2);
+
+			theVoiceSpec.creator	= theVoice->creator;
+			theVoiceSpec.id			= theVoice->id;
+		}
+		else {
+			theErr = GetIndVoice([sender indexOfSelectedItem] - 1, &theVoiceSpec);
+			if (theErr != noErr)
+   				NSRunAlertPanel(@"GetIndVoice", [NSString stringWithFormat:@"Error #%d returned.", theErr], @"Oh?", NULL, NULL);
+		}
 
 		if (theErr == noErr) {
         	// Update our object fields with the selection
@@ -808,39 +1077,60 @@ static NSString*	VersionNumToString(NumVersion inVersionNum);
 	
 	An action method called when the user clicks the Dump Phonemes button.  We ask
     the speech channel for a phoneme representation of the window text then save the
-    result to a text file at a location determined by the user.
+    result to a text file at a location determined by the user.  The text is converted
+    a sentence-aligned chunk at a time, and each chunk's phonemes written as they come,
+    so memory stays the same however long the text is.
 ----------------------------------------------------------------------------------------*/
 - (IBAction)dumpPhonemesSelected:(id)sender
 {
     NSSavePanel *panel = [NSSavePanel savePanel];
     
     if ([panel runModal]) {
-		long 	theNumOfPhonBytes 	= 0;
-		
-		// Get and speech text
-		char *	theTextToSpeak = (char *)[[fSpokenTextView string] lossyCString];
-		if (theTextToSpeak) {
-		
-			Handle thePhonemeHandle = NewHandle(0);
-			if (thePhonemeHandle) {
-				
-				OSErr	theErr = TextToPhonemes(fCurSpeechChannel, (Ptr)theTextToSpeak, (long)strlen(theTextToSpeak), thePhonemeHandle, (long *)&theNumOfPhonBytes);
+		NSString *		theText = [fSpokenTextView string];
+		unsigned long	theTextLength = [theText length];
+		unsigned long	theLocation = 0;
+		BOOL			theWroteAny = false;
+		OSErr			theErr = noErr;
+		UniChar *		theCharacters = malloc(kSpeechChunkLength * sizeof(UniChar));
+		char *			theChunk = malloc(kSpeechChunkLength);
+		Handle			thePhonemeHandle = NewHandle(0);
+		FILE *			thePhonemeFile = NULL;
+
+		if (theCharacters == NULL || theChunk == NULL || thePhonemeHandle == NULL)
+			NSRunAlertPanel(@"TextToPhonemes", @"Could not allocate handle for phonemes", @"Oh?", NULL, NULL);
+		else if ((thePhonemeFile = fopen([[[panel URL] path] fileSystemRepresentation], "w")) == NULL)
+			NSRunAlertPanel(@"TextToPhonemes", @"Phoneme file could not be written to disk", @"Oh?", NULL, NULL);
+		else {
+			while (theErr == noErr && theLocation < theTextLength) {
+				unsigned long	theLength = MIN(theTextLength - theLocation, kSpeechChunkLength);
+				long			theNumOfPhonBytes = 0;
+
+				[theText getCharacters:theCharacters range:NSMakeRange(theLocation, theLength)];
+				if (theLocation + theLength < theTextLength)
+					theLength = SentenceAlignedChunkLength(theCharacters, theLength);
+				ConvertChunkToMacRoman(theCharacters, theLength, theChunk);
+				theLocation += theLength;
+
+				// The handle is reused for every chunk, and only ever holds one chunk's phonemes.
+				theErr = TextToPhonemes(fCurSpeechChannel, (Ptr)theChunk, (long)theLength, thePhonemeHandle, &theNumOfPhonBytes);
 				if (theErr != noErr)
 					NSRunAlertPanel(@"TextToPhonemes", [NSString stringWithFormat:@"Error #%d returned.", theErr], @"Oh?", NULL, NULL);
-				else {
-				
-					// Create NSData object with resulting handle and then write to disk.
-					NSData * 	thePhonemeText = [NSData dataWithBytesNoCopy:*thePhonemeHandle length:theNumOfPhonBytes freeWhenDone:false];
-					if(! [thePhonemeText writeToURL:[panel URL] atomically:false])
+				else if (theNumOfPhonBytes > 0) {
+					if ((theWroteAny && fputc(' ', thePhonemeFile) == EOF) || fwrite(*thePhonemeHandle, 1, theNumOfPhonBytes, thePhonemeFile) != (size_t)theNumOfPhonBytes) {
 						NSRunAlertPanel(@"TextToPhonemes", @"Phoneme file could not be written to disk", @"Oh?", NULL, NULL);
+						theErr = ioErr;
+					}
+					theWroteAny = true;
 				}
-	
-				DisposeHandle(thePhonemeHandle);
 			}
-			else 
-				NSRunAlertPanel(@"TextToPhonemes", @"Could not allocate handle for phonemes", @"Oh?", NULL, NULL);
-
+			if (fclose(thePhonemeFile) != 0 && theErr == noErr)
+				NSRunAlertPanel(@"TextToPhonemes", @"Phoneme file could not be written to disk", @"Oh?", NULL, NULL);
 		}
+
+		if (thePhonemeHandle)
+			DisposeHandle(thePhonemeHandle);
+		free(theChunk);
+		free(theCharacters);
 	}
 	
 }
@@ -1098,6 +1388,9 @@ static NSString*	VersionNumToString(NumVersion inVersionNum);
    			NSRunAlertPanel(@"SetSpeechInfo(soRefCon)", [NSString stringWithFormat:@"Error #%d returned.", theErr], @"Oh?", NULL, NULL);
 	}
 
+	// Let the character follow the audio by sample position when the synthesizer can post its events to a queue.
+	fCharacterFollowsEvents = (theErr == noErr && SetSpeechInfo(fCurSpeechChannel, soSynthEngineEventQueue, [fCharacterView speechEventQueue]) == noErr);
+
     return theErr;
 }
 
@@ -1193,7 +1486,7 @@ pascal void OurErrorCallBackProc(SpeechChannel inSpeechChannel, long inRefCon, O
     NSAutoreleasePool *	pool = [[NSAutoreleasePool alloc] init];
 	
 	if ([(SpeakingTextWindow *)inRefCon shouldDisplayTextDoneCallbacks])
-        [(SpeakingTextWindow *)inRefCon performSelectorOnMainThread:@selector(displayErrorAlertWithParams:) withObject:[NSDictionary dictionaryWithObjectsAndKeys:[NSNumber numberWithLong:inBytePos], kErrorCallbackParamPosition, [NSNumber numberWithLong:inError], kErrorCallbackParamError, NULL] waitUntilDone:false]; 
+        [(SpeakingTextWindow *)inRefCon performSelectorOnMainThread:@selector(displayErrorAlertWithParams:) withObject:[NSDictionary dictionaryWithObjectsAndKeys:[NSNumber numberWithLong:[(SpeakingTextWindow *)inRefCon textOffsetOfPosition:inBytePos]], kErrorCallbackParamPosition, [NSNumber numberWithLong:inError], kErrorCallbackParamError, NULL] waitUntilDone:false]; 
 		
     [pool release];
 }
@@ -1202,15 +1495,17 @@ pascal void OurErrorCallBackProc(SpeechChannel inSpeechChannel, long inRefCon, O
 	OurTextDoneCallBackProc
 	
     Called by speech channel when all text has been processed.  Additional text can be 
-    passed back to continue processing.
+    passed back to continue processing, which is how the text is fed to the channel a
+    chunk at a time.
 ----------------------------------------------------------------------------------------*/
 pascal void OurTextDoneCallBackProc(SpeechChannel inSpeechChannel, long inRefCon, const void ** nextBuf, unsigned long * byteLen, long * controlFlags)
 {
     NSAutoreleasePool *	pool = [[NSAutoreleasePool alloc] init];
 
 	*nextBuf = NULL;
+	*byteLen = 0;
 
-	if ([(SpeakingTextWindow *)inRefCon shouldDisplayTextDoneCallbacks])
+	if (! [(SpeakingTextWindow *)inRefCon handOffNextChunk:nextBuf length:byteLen] && [(SpeakingTextWindow *)inRefCon shouldDisplayTextDoneCallbacks])
         [(SpeakingTextWindow *)inRefCon performSelectorOnMainThread:@selector(displayTextDoneAlert) withObject:NULL waitUntilDone:false]; 
 		
     [pool release];
@@ -1250,14 +1545,15 @@ pascal void OurSyncCallBackProc(SpeechChannel inSpeechChannel, long inRefCon, OS
 	OurPhonemeCallBackProc
 	
     Called by speech channel every time a phoneme is about to be generated.  You might use
-    this to animate a speaking character.
+    this to animate a speaking character.  Only used when the channel can't post to the
+    character view's event queue, which places each phoneme by its sample position.
 ----------------------------------------------------------------------------------------*/
 pascal void OurPhonemeCallBackProc(SpeechChannel inSpeechChannel, long inRefCon, short inPhonemeOpcode)
 {
     NSAutoreleasePool *	pool = [[NSAutoreleasePool alloc] init];
 
-	if ([(SpeakingTextWindow *)inRefCon shouldDisplayPhonemeCallbacks])
-		[[(SpeakingTextWindow *)inRefCon characterView] performSelectorOnMainThread:@selector(setExpressionForPhoneme:) withObject:[NSNumber numberWithShort:inPhonemeOpcode] waitUntilDone:false];
+	if ([(SpeakingTextWindow *)inRefCon shouldDisplayPhonemeCallbacks] && ! [(SpeakingTextWindow *)inRefCon characterFollowsEvents])
+		[[(SpeakingTextWindow *)inRefCon characterView] setExpressionForPhoneme:[NSNumber numberWithShort:inPhonemeOpcode]];
 
     [pool release];
 }
@@ -1272,13 +1568,87 @@ pascal void OurWordCallBackProc(SpeechChannel inSpeechChannel, long inRefCon, lo
 {
     NSAutoreleasePool *	pool = [[NSAutoreleasePool alloc] init];
 
+	// Worked out here rather than on the main thread, since by then the channel may be speaking another chunk.
+	long	theTextOffset = [(SpeakingTextWindow *)inRefCon textOffsetOfWordAtPosition:inWordPos length:inWordLen];
+
 	if ([(SpeakingTextWindow *)inRefCon shouldDisplayWordCallbacks])
-        [(SpeakingTextWindow *)inRefCon performSelectorOnMainThread:@selector(highlightWordWithParams:) withObject:[NSDictionary dictionaryWithObjectsAndKeys:[NSNumber numberWithLong:inWordPos], kWordCallbackParamPosition, [NSNumber numberWithLong:inWordLen], kWordCallbackParamLength, NULL] waitUntilDone:false]; 
+        [(SpeakingTextWindow *)inRefCon performSelectorOnMainThread:@selector(highlightWordWithParams:) withObject:[NSDictionary dictionaryWithObjectsAndKeys:[NSNumber numberWithLong:theTextOffset], kWordCallbackParamPosition, [NSNumber numberWithLong:inWordLen], kWordCallbackParamLength, NULL] waitUntilDone:false]; 
 	
     [pool release];
 }
 
 
+//
+// Streaming speech utility routines
+//
+
+/*----------------------------------------------------------------------------------------
+	SentenceAlignedChunkLength:
+	
+	Returns how much of a chunk to speak so it ends after its last sentence, or failing
+	that its last word.  A break is only taken once the chunk is a quarter full, so the
+	last word of one chunk is always well past where the first word of the next one is.
+----------------------------------------------------------------------------------------*/
+static unsigned long SentenceAlignedChunkLength(const UniChar * inCharacters, unsigned long inLength)
+{
+	NSCharacterSet *	spaces = [NSCharacterSet whitespaceAndNewlineCharacterSet];
+	unsigned long		sentenceBreak = 0;
+	unsigned long		wordBreak = 0;
+	unsigned long		i, j;
+
+	for (i = MAX(inLength / 4, 1); i < inLength; i++) {
+		if ([spaces characterIsMember:inCharacters[i]] && ! [spaces characterIsMember:inCharacters[i - 1]]) {
+			wordBreak = i + 1;
+
+			// Look past closing quotes and parentheses for the end of a sentence.
+			for (j = i - 1; j > 0 && (inCharacters[j] == '"' || inCharacters[j] == '\'' || inCharacters[j] == ')' || inCharacters[j] == 0x2019 || inCharacters[j] == 0x201D); j--)
+				;
+			if (inCharacters[j] == '.' || inCharacters[j] == '!' || inCharacters[j] == '?' || inCharacters[i] == '\n' || inCharacters[i] == '\r')
+				sentenceBreak = i + 1;
+		}
+	}
+	if (sentenceBreak)
+		return sentenceBreak;
+	if (wordBreak)
+		return wordBreak;
+
+	// No break at all, so at least don't split a surrogate pair.
+	if (inLength > 1 && CFStringIsSurrogateHighCharacter(inCharacters[inLength - 1]))
+		return inLength - 1;
+	return inLength;
+}
+
+/*----------------------------------------------------------------------------------------
+	ConvertChunkToMacRoman:
+	
+	Converts a chunk to the bytes given to the channel, one for each character, so the
+	positions in the word callback are positions in the text view too.
+----------------------------------------------------------------------------------------*/
+static void ConvertChunkToMacRoman(const UniChar * inCharacters, unsigned long inLength, char * outBytes)
+{
+	CFStringRef		theString = NULL;
+	unsigned long	i;
+
+	for (i = 0; i < inLength; i++) {
+		if (inCharacters[i] < 0x80)
+			outBytes[i] = inCharacters[i];
+		else {
+			UInt8	theByte = '?';
+			CFIndex	usedBufLen = 0;
+
+			// Anything without a Mac Roman equivalent, including each half of a surrogate pair, becomes a '?'.
+			if (theString == NULL)
+				theString = CFStringCreateWithCharactersNoCopy(NULL, inCharacters, inLength, kCFAllocatorNull);
+			if (theString == NULL || CFStringGetBytes(theString, CFRangeMake(i, 1), kCFStringEncodingMacRoman, '?', false, &theByte, 1, &usedBufLen) != 1 || usedBufLen != 1)
+				theByte = '?';
+			outBytes[i] = theByte;
+		}
+	}
+	if (theString)
+		CFRelease(theString);
+}
+
+
 //
 // Version display utility routines
 //
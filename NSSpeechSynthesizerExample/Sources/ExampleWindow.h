@@ -47,6 +47,7 @@
 
 #import <Cocoa/Cocoa.h>
 #import "SpeakingCharacterView.h"
+#import "SynthVoiceIndex.h"
 
 @interface NSSpeechExampleWindow : NSObject {
 
@@ -66,6 +67,9 @@
     
     NSSpeechSynthesizer *		_speechSynthesizer;
     NSSpeechRecognizer *		_speechRecognizer;
+    BOOL				_characterFollowsEvents;	// The character view is fed from the synthesizer's events, not willSpeakPhoneme.
+
+    NSMutableArray *			_voiceIdentifiers;	// Parallel to the voice menu items after the fixed ones.
 
 }
 
@@ -73,6 +77,7 @@
 - (IBAction)savetButtonSelected:(id)sender;
 - (void)startSpeakingTextViewToURL:(NSURL *)url;
 - (void)getSpeechVoices;
+- (BOOL)getSpeechVoicesFromIndex;
 
 @end
 
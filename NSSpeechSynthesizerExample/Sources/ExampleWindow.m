@@ -48,6 +48,11 @@
 
 const UInt32 kNumOfFixedMenuItemsInVoicePopup = 2;
 
+// The example synthesizer's own channel properties, from SynthesizerSimulator.h.  Other synthesizers
+// reject them, and the character then follows the phoneme delegate method instead.
+static NSString * kSynthEngineEventQueueProperty = @"evtq";
+static NSString * kSynthEngineUtteranceTagProperty = @"utag";
+
 @implementation NSSpeechExampleWindow
 - (void)awakeFromNib
 {
@@ -65,7 +70,8 @@ const UInt32 kNumOfFixedMenuItemsInVoicePopup = 2;
 
 - (void)speechSynthesizer:(NSSpeechSynthesizer *)sender willSpeakPhoneme:(short)phonemeOpcode
 {
-    [_characterView setExpressionForPhoneme:[NSNumber numberWithShort:phonemeOpcode]];
+    if (! _characterFollowsEvents)
+        [_characterView setExpressionForPhoneme:[NSNumber numberWithShort:phonemeOpcode]];
 }
 
 - (void)speechSynthesizer:(NSSpeechSynthesizer *)sender didFinishSpeaking:(BOOL)finishedSpeaking
@@ -130,9 +136,15 @@ const UInt32 kNumOfFixedMenuItemsInVoicePopup = 2;
         }
         else
         {
-            [_speechSynthesizer setVoice:[[NSSpeechSynthesizer availableVoices] objectAtIndex:[_voicePop indexOfSelectedItem] - kNumOfFixedMenuItemsInVoicePopup]];
+            [_speechSynthesizer setVoice:[_voiceIdentifiers objectAtIndex:[_voicePop indexOfSelectedItem] - kNumOfFixedMenuItemsInVoicePopup]];
         }
         
+        // Where the synthesizer can post its events to the character view's queue, the character follows the audio
+        // by sample position.  Events tagged for an earlier utterance, or for one saved to a file, are ignored.
+        uint64_t	utteranceTag = (url) ? 0 : [_characterView noteUtteranceStarting];
+        _characterFollowsEvents = [_speechSynthesizer setObject:[NSNumber numberWithLong:(long)[_characterView speechEventQueue]] forProperty:kSynthEngineEventQueueProperty error:NULL]
+            && [_speechSynthesizer setObject:[NSNumber numberWithUnsignedLongLong:utteranceTag] forProperty:kSynthEngineUtteranceTagProperty error:NULL];
+        
         if (url)
         {
             [_speechSynthesizer startSpeakingString:theViewText toURL:url];
@@ -155,15 +167,52 @@ const UInt32 kNumOfFixedMenuItemsInVoicePopup = 2;
     // Delete any items int the voice menu
     while([_voicePop numberOfItems] > kNumOfFixedMenuItemsInVoicePopup)
         [_voicePop removeItemAtIndex:[_voicePop numberOfItems] - 1];
-    
+
+    [_voiceIdentifiers release];
+    _voiceIdentifiers = [NSMutableArray new];
+
+    // Prefer the compiled voice index, which lists every voice without opening each bundle's Info.plist.
+    if (! [self getSpeechVoicesFromIndex]) {
         NSString * aVoice = NULL;
         NSEnumerator * voiceEnumerator = [[NSSpeechSynthesizer availableVoices] objectEnumerator];
         while(aVoice = [voiceEnumerator nextObject]) {
             NSDictionary * dictionaryOfVoiceAttributes = [NSSpeechSynthesizer attributesForVoice:aVoice];
             NSString *	voiceDisplayName = [dictionaryOfVoiceAttributes objectForKey:NSVoiceName];
   
-        [_voicePop addItemWithTitle:voiceDisplayName];
+            [_voicePop addItemWithTitle:voiceDisplayName];
+            [_voiceIdentifiers addObject:aVoice];
         }
+    }
+}
+
+- (BOOL)getSpeechVoicesFromIndex
+{
+    char				indexPath[PATH_MAX];
+    SynthVoiceIndex *	voiceIndex = NULL;
+    BOOL				usedIndex = NO;
+
+    if (SynthVoiceIndexGetDefaultPath(indexPath, sizeof(indexPath)) == noErr && SynthVoiceIndexOpen(indexPath, &voiceIndex) == noErr) {
+
+        // A voice installed or removed since the index was compiled makes it stale; fall back to asking each voice.
+        if (SynthVoiceIndexIsCurrent(voiceIndex)) {
+            uint32_t	voiceCount = SynthVoiceIndexGetCount(voiceIndex);
+            uint32_t	voiceIter;
+
+            for (voiceIter = 0; voiceIter < voiceCount; voiceIter++) {
+                const SynthVoiceRecord *	voice = SynthVoiceIndexGetVoice(voiceIndex, voiceIter);
+                const char *				identifier = SynthVoiceIndexGetString(voiceIndex, voice->identifierOffset);
+
+                if (identifier[0] == 0)
+                    continue;
+                [_voicePop addItemWithTitle:[NSString stringWithUTF8String:SynthVoiceIndexGetString(voiceIndex, voice->nameOffset)]];
+                [_voiceIdentifiers addObject:[NSString stringWithUTF8String:identifier]];
+            }
+            usedIndex = YES;
+        }
+        SynthVoiceIndexClose(voiceIndex);
+    }
+
+    return usedIndex;
 }
 
 @end
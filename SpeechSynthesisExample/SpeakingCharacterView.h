@@ -45,21 +45,29 @@
 */
 
 #import <Cocoa/Cocoa.h>
+#import <QuartzCore/QuartzCore.h>
+#import "SynthAnimationTimeline.h"
+
+@class SpeakingCharacterAtlas;
 
 extern NSString *	kCharacterExpressionIdentifierSleep;
 extern NSString *	kCharacterExpressionIdentifierIdle;
 
 @interface SpeakingCharacterView : NSView {
-	NSString *				_currentExpression;
-	NSTimer *				_idleStartTimer;
-	NSTimer *				_expressionFrameTimer;
-	int						_curFrameIndex;
-	NSArray *				_curFrameArray;
-	NSImage *				_curFrameImage;
+	SynthAnimationTimeline *	_timeline;
+	SynthEngineEventQueue *	_speechEvents;			// Posted to by the speech channel, drained by the display link thread.
+	uint64_t				_utteranceTag;			// Events for any other utterance are ignored.
+	double					_utteranceStartTime;	// Host time of the utterance's first sample, or 0 until the next event anchors it.
+	CVDisplayLinkRef		_displayLink;
+	NSLock *				_animationLock;			// Guards the frame and character, which the display link thread reads.
+	NSString *				_curFrameName;
 	NSDictionary *			_characterDescription;
-	NSMutableDictionary *	_imageCache;
+	SpeakingCharacterAtlas *	_characterAtlas;
 }
 
+- (SynthEngineEventQueue *)speechEventQueue;
+- (uint64_t)noteUtteranceStarting;
+- (void)noteUtteranceContinuing;
 - (void)setExpressionForPhoneme:(NSNumber *)phoneme;
 - (void)setExpression:(NSString *)expression;
 
@@ -51,6 +51,7 @@
 #import <fcntl.h>
 
 #import "SpeakingCharacterView.h"
+#import "SynthVoiceIndex.h"
 
 @interface SpeakingTextWindow : NSDocument
 {
@@ -96,6 +97,7 @@
 	NSRange					fOrgSelectionRange;
 	OSType					fSelectedVoiceID;
 	OSType					fSelectedVoiceCreator;
+	SynthVoiceIndex			*fVoiceIndex;
     SpeechChannel			fCurSpeechChannel;
     long					fOffsetToSpokenText;
     unsigned long			fLastErrorCode;
@@ -104,6 +106,7 @@
     BOOL					fCurrentlySpeaking;
     BOOL					fCurrentlyPaused;
     BOOL					fSavingToFile;
+    BOOL					fCharacterFollowsEvents;
     NSData					*fTextData;
     NSString				*fTextDataType;
 }
@@ -118,6 +121,7 @@
 - (void)setTextDataType:(NSString *)theData;
 - (NSString *)textDataType;
 - (SpeakingCharacterView *)characterView;
+- (BOOL)characterFollowsEvents;
 - (BOOL)shouldDisplayWordCallbacks;
 - (BOOL)shouldDisplayPhonemeCallbacks;
 - (BOOL)shouldDisplayErrorCallbacks;
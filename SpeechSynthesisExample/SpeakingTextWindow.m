@@ -50,6 +50,12 @@
 //
 // Constants
 //
+
+// The example synthesizer's own channel properties, from SynthesizerSimulator.h.  Other synthesizers
+// reject them, and the character then follows phoneme callbacks instead.
+#define soSynthEngineEventQueue		'evtq'
+#define soSynthEngineUtteranceTag	'utag'
+
 NSString *	kPlainTextDataTypeString 	= @"Plain Text";
 NSString *  kDefaultWindowTextString 	= @"Welcome to the Speech Synthesis Example.  This application provides an example of using Apple's Speech Synthesis API.";
 
@@ -96,8 +102,13 @@ static void			OurWordCFCallBackProc(SpeechChannel chan, SRefCon refCon, CFString
 ----------------------------------------------------------------------------------------*/
 -(void)dealloc
 {
+	// The channel posts to the character view's event queue, and calls back with us as its refcon.
+	if (fCurSpeechChannel)
+		DisposeSpeechChannel(fCurSpeechChannel);
     [fTextData release];
     [fTextDataType release];
+	if (fVoiceIndex)
+		SynthVoiceIndexClose(fVoiceIndex);
 	[super dealloc];
 }
 
@@ -167,6 +178,17 @@ static void			OurWordCFCallBackProc(SpeechChannel chan, SRefCon refCon, CFString
 	return fCharacterView;
 }
 
+/*----------------------------------------------------------------------------------------
+	characterFollowsEvents
+	
+	Returns whether the character view is fed from the channel's events rather than from
+	our phoneme callback.
+----------------------------------------------------------------------------------------*/
+- (BOOL)characterFollowsEvents
+{
+	return fCharacterFollowsEvents;
+}
+
 /*----------------------------------------------------------------------------------------
 	shouldDisplayWordCallbacks
 	
@@ -244,19 +266,44 @@ static void			OurWordCFCallBackProc(SpeechChannel chan, SRefCon refCon, CFString
     	long 		voiceIndex;
     	BOOL		voiceFoundAndSelected = false;
     	VoiceSpec	theVoiceSpec;
+    	char		indexPath[PATH_MAX];
 
     	// Delete the existing voices from the bottom of the menu.
     	while([fVoicesPopUpButton numberOfItems] > 2)
             [fVoicesPopUpButton removeItemAtIndex:2];
 
-    	// Ask TTS API for each available voicez
-		theErr = CountVoices(&numOfVoices);
-		if (theErr != noErr)
-   			NSRunAlertPanel(@"CountVoices", [NSString stringWithFormat:@"Error #%d returned.", theErr], @"Oh?", NULL, NULL);
+		// Use the compiled voice index if no voice was installed or removed since it was built.  Listing it
+		// doesn't open every voice bundle the way GetIndVoice and GetVoiceDescription do.
+		if (SynthVoiceIndexGetDefaultPath(indexPath, sizeof(indexPath)) == noErr && SynthVoiceIndexOpen(indexPath, &fVoiceIndex) == noErr) {
+			if (! SynthVoiceIndexIsCurrent(fVoiceIndex)) {
+				SynthVoiceIndexClose(fVoiceIndex);
+				fVoiceIndex = NULL;
+			}
+		}
+
+		if (fVoiceIndex)
+			numOfVoices = SynthVoiceIndexGetCount(fVoiceIndex);
+		else {
+    		// Ask TTS API for each available voicez
+			theErr = CountVoices(&numOfVoices);
+			if (theErr != noErr)
+   				NSRunAlertPanel(@"CountVoices", [NSString stringWithFormat:@"Error #%d returned.", theErr], @"Oh?", NULL, NULL);
+		}
 
     	if (theErr == noErr) {
             for (voiceIndex = 1; voiceIndex <= numOfVoices; voiceIndex++) {
 			
+				if (fVoiceIndex) {
+					const SynthVoiceRecord *	theVoice = SynthVoiceIndexGetVoice(fVoiceIndex, voiceIndex - 1);
+
+					[fVoicesPopUpButton addItemWithTitle:[NSString stringWithUTF8String:SynthVoiceIndexGetString(fVoiceIndex, theVoice->nameOffset)]];
+					if (theVoice->creator == fSelectedVoiceCreator && theVoice->id == fSelectedVoiceID) {
+						[fVoicesPopUpButton selectItemAtIndex:voiceIndex-1];
+						voiceFoundAndSelected = true;
+					}
+					continue;
+				}
+
         		VoiceDescription	theVoiceDesc;
 				theErr = GetIndVoice(voiceIndex, &theVoiceSpec);
 				if (theErr != noErr)
@@ -462,6 +509,8 @@ static void			OurWordCFCallBackProc(SpeechChannel chan, SRefCon refCon, CFString
         theErr = ContinueSpeech(fCurSpeechChannel);
         if (theErr != noErr)
             NSRunAlertPanel(@"ContinueSpeech", [NSString stringWithFormat:@"Error #%d returned.", theErr], @"Oh?", NULL, NULL);
+        else if (fCharacterFollowsEvents)
+            [fCharacterView noteUtteranceContinuing];
     }
 
 }
@@ -506,6 +555,8 @@ static void			OurWordCFCallBackProc(SpeechChannel chan, SRefCon refCon, CFString
         theErr = ContinueSpeech(fCurSpeechChannel);
         if (theErr != noErr)
             NSRunAlertPanel(@"ContinueSpeech", [NSString stringWithFormat:@"Error #%d returned.", theErr], @"Oh?", NULL, NULL);
+        else if (fCharacterFollowsEvents)
+            [fCharacterView noteUtteranceContinuing];
     }
 }
 
@@ -639,6 +690,12 @@ static void			OurWordCFCallBackProc(SpeechChannel chan, SRefCon refCon, CFString
         // We want the text view the active view.  Also saves any parameters currently being edited.
         [fWindow makeFirstResponder:fSpokenTextView];  
 
+	// Events left from an earlier utterance, or from one saved to a file, carry another tag and are ignored.
+	if (fCharacterFollowsEvents) {
+		uint64_t	utteranceTag = (fSavingToFile || ! [self shouldDisplayPhonemeCallbacks]) ? 0 : [fCharacterView noteUtteranceStarting];
+		SetSpeechInfo(fCurSpeechChannel, soSynthEngineUtteranceTag, &utteranceTag);
+	}
+
 	theErr = SpeakCFString(fCurSpeechChannel, (CFStringRef)theViewText, NULL);
 	if (theErr == noErr) {
 	
@@ -677,6 +734,8 @@ static void			OurWordCFCallBackProc(SpeechChannel chan, SRefCon refCon, CFString
 		theErr = ContinueSpeech(fCurSpeechChannel);
 		if (theErr != noErr)
 			NSRunAlertPanel(@"ContinueSpeech", [NSString stringWithFormat:@"Error #%d returned.", theErr], @"Oh?", NULL, NULL);
+		else if (fCharacterFollowsEvents)
+			[fCharacterView noteUtteranceContinuing];
 	
 		fCurrentlyPaused = false;
 		fCurrentlySpeaking = true;
@@ -722,17 +781,30 @@ static void			OurWordCFCallBackProc(SpeechChannel chan, SRefCon refCon, CFString
         //
 		// Use the default voice from preferences.
         //
-        // Our only choice is to close and reopen the speech channel to get the default voice.
+        // GetVoiceDescription describes the default voice when not given one, so the channel can switch to it in
+        // place.  Only if it belongs to another synthesizer do we close and reopen the speech channel.
+		VoiceDescription	theVoiceDesc;
+
 		fSelectedVoiceCreator = 0;
-        theErr = [self createNewSpeechChannel:NULL];
+		theErr = GetVoiceDescription(NULL, &theVoiceDesc, sizeof(theVoiceDesc));
+		if (theErr != noErr || fCurSpeechChannel == NULL || SetSpeechProperty(fCurSpeechChannel, kSpeechCurrentVoiceProperty, [NSDictionary dictionaryWithObjectsAndKeys:[NSNumber numberWithLong:theVoiceDesc.voice.creator], (NSString *)kSpeechVoiceCreator, [NSNumber numberWithLong:theVoiceDesc.voice.id], (NSString *)kSpeechVoiceID, NULL]) != noErr)
+        	theErr = [self createNewSpeechChannel:NULL];
 	}
 	else {
 		// 
 		// Use the voice the user selected.
 		//
-		theErr = GetIndVoice([sender indexOfSelectedItem] - 1, &theVoiceSpec);
-		if (theErr != noErr)
-   			NSRunAlertPanel(@"GetIndVoice", [NSString stringWithFormat:@"Error #%d returned.", theErr], @"Oh?", NULL, NULL);
+		if (fVoiceIndex) {
+			const SynthVoiceRecord *	theVoice = SynthVoiceIndexGetVoice(fVoiceIndex, [sender indexOfSelectedItem] - 2);
+
+			theVoiceSpec.creator	= theVoice->creator;
+			theVoiceSpec.id			= theVoice->id;
+		}
+		else {
+			theErr = GetIndVoice([sender indexOfSelectedItem] - 1, &theVoiceSpec);
+			if (theErr != noErr)
+   				NSRunAlertPanel(@"GetIndVoice", [NSString stringWithFormat:@"Error #%d returned.", theErr], @"Oh?", NULL, NULL);
+		}
 
 		if (theErr == noErr) {
         	// Update our object fields with the selection
@@ -1086,6 +1158,9 @@ static void			OurWordCFCallBackProc(SpeechChannel chan, SRefCon refCon, CFString
    			NSRunAlertPanel(@"SetSpeechProperty(kSpeechRefConProperty)", [NSString stringWithFormat:@"Error #%d returned.", theErr], @"Oh?", NULL, NULL);
 	}
 
+	// Let the character follow the audio by sample position when the synthesizer can post its events to a queue.
+	fCharacterFollowsEvents = (theErr == noErr && SetSpeechInfo(fCurSpeechChannel, soSynthEngineEventQueue, [fCharacterView speechEventQueue]) == noErr);
+
     return theErr;
 }
 
@@ -1227,14 +1302,15 @@ pascal void OurSyncCallBackProc(SpeechChannel inSpeechChannel, long inRefCon, OS
 	OurPhonemeCallBackProc
 	
     Called by speech channel every time a phoneme is about to be generated.  You might use
-    this to animate a speaking character.
+    this to animate a speaking character.  Only used when the channel can't post to the
+    character view's event queue, which places each phoneme by its sample position.
 ----------------------------------------------------------------------------------------*/
 pascal void OurPhonemeCallBackProc(SpeechChannel inSpeechChannel, long inRefCon, short inPhonemeOpcode)
 {
     NSAutoreleasePool *	pool = [[NSAutoreleasePool alloc] init];
 
-	if ([(SpeakingTextWindow *)inRefCon shouldDisplayPhonemeCallbacks])
-		[[(SpeakingTextWindow *)inRefCon characterView] performSelectorOnMainThread:@selector(setExpressionForPhoneme:) withObject:[NSNumber numberWithShort:inPhonemeOpcode] waitUntilDone:false];
+	if ([(SpeakingTextWindow *)inRefCon shouldDisplayPhonemeCallbacks] && ! [(SpeakingTextWindow *)inRefCon characterFollowsEvents])
+		[[(SpeakingTextWindow *)inRefCon characterView] setExpressionForPhoneme:[NSNumber numberWithShort:inPhonemeOpcode]];
 
     [pool release];
 }
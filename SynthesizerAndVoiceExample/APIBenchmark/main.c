@@ -0,0 +1,835 @@
+/*
+	main.c
+	APIBenchmark
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Loads a synthesizer bundle and drives the same work through its buffer-based
+	and its CFString-based entry points, and writes the cost of each call and the
+	speed of rendering through each as JSON.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#include <ApplicationServices/ApplicationServices.h>
+#include <errno.h>
+#include <mach/mach.h>
+#include <mach/mach_time.h>
+#include <malloc/malloc.h>
+#include <objc/objc-runtime.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "SynthEngineWorkers.h"
+
+// Defining this causes SpeechEngine.h to define the older synthesizer plug-in API as well.
+#define _SUPPORT_SPEECH_SYNTHESIS_IN_MAC_OS_X_VERSION_10_0_THROUGH_10_4__ true
+#include "SpeechEngine.h"
+
+#define kDefaultIterations			10000
+#define kDefaultRenders				20
+#define kDefaultText				"The quick brown fox jumps over the lazy dog."
+#define kCallsPerPool				1000
+#define kRenderStep					0.01				// Virtual seconds the engine's clock is advanced by at a time.
+#define kSecondsPerCharacter		0.5					// How long to wait for an utterance before giving up on it.
+#define kMaxRenderTextLength		4096
+
+// The entry points of the bundle under test.  The ones of a family it doesn't export are NULL.
+typedef struct EntryPoints {
+	long	(*openSpeechChannel)(SpeechChannelIdentifier * ssr);
+	long	(*closeSpeechChannel)(SpeechChannelIdentifier ssr);
+	long	(*stopSpeechAt)(SpeechChannelIdentifier ssr, unsigned long whereToStop);
+
+	long	(*speakBuffer)(SpeechChannelIdentifier ssr, Ptr textBuf, long byteLen, long controlFlags);
+	long	(*getSpeechInfo)(SpeechChannelIdentifier ssr, unsigned long selector, void * speechInfo);
+	long	(*setSpeechInfo)(SpeechChannelIdentifier ssr, unsigned long selector, void * speechInfo);
+	long	(*textToPhonemes)(SpeechChannelIdentifier ssr, char * textBuf, long textBytes, void ** phonemeBuf, long * phonBytes);
+
+	long	(*speakCFString)(SpeechChannelIdentifier ssr, CFStringRef text, CFDictionaryRef options);
+	long	(*copySpeechProperty)(SpeechChannelIdentifier ssr, CFStringRef property, CFTypeRef * object);
+	long	(*setSpeechProperty)(SpeechChannelIdentifier ssr, CFStringRef property, CFTypeRef object);
+	long	(*copyPhonemesFromText)(SpeechChannelIdentifier ssr, CFStringRef text, CFStringRef * phonemes);
+
+	// Only the example engine has these; with them the benchmark runs the engine's clock itself.
+	SynthEngineWorkers *	(*workersShared)(void);
+	Boolean	(*workersIsVirtual)(const SynthEngineWorkers * workers);
+	double	(*workersCurrentTime)(const SynthEngineWorkers * workers);
+	long	(*workersRunUntil)(SynthEngineWorkers * workers, double time, uint64_t * outJobsRun);
+} EntryPoints;
+
+enum {
+	kBufferFamily		= 0,
+	kCFFamily			= 1,
+	kFamilyCount		= 2
+};
+
+// Everything a workload needs.  The engine runs its jobs on this thread when its clock is virtual, so nothing here is shared.
+typedef struct Bench {
+	EntryPoints				entry;
+	SynthEngineWorkers *	workers;		// NULL unless the engine runs on a virtual clock.
+	SpeechChannelIdentifier	channel;
+	char *					bytes;			// The text as Mac Roman bytes, for the buffer-based calls.
+	long					byteLength;
+	CFStringRef				text;			// The same text, for the CFString-based calls.
+	CFNumberRef				rates[2];
+	Boolean					done;
+	double					doneTime;
+} Bench;
+
+typedef long (*WorkloadProc)(Bench * bench, uint32_t iteration);
+
+// One kind of call, made the same way through each family.
+typedef struct Workload {
+	const char *	name;
+	WorkloadProc	procs[kFamilyCount];
+	Boolean			settle;			// Leaves work queued on the engine, which is run between calls.
+} Workload;
+
+// What making one kind of call many times found.
+typedef struct CallResult {
+	uint32_t		calls;
+	uint32_t		errors;
+	double *		seconds;		// Of each call.
+	double			totalSeconds;
+	uint64_t		allocations;
+	uint64_t		allocatedBytes;
+} CallResult;
+
+// What speaking a series of utterances to the end found.
+typedef struct RenderResult {
+	uint32_t		utterances;
+	uint32_t		finished;
+	uint32_t		errors;
+	double			wallSeconds;
+	double			audioSeconds;
+	uint64_t		allocations;
+	uint64_t		allocatedBytes;
+} RenderResult;
+
+static const char *	sFamilyNames[kFamilyCount] = { "buffer", "cf" };
+
+static atomic_ulong	sAllocations;
+static atomic_ulong	sAllocatedBytes;
+static void *		(*sZoneMalloc)(struct _malloc_zone_t * zone, size_t size);
+static void *		(*sZoneCalloc)(struct _malloc_zone_t * zone, size_t count, size_t size);
+static void *		(*sZoneValloc)(struct _malloc_zone_t * zone, size_t size);
+static void *		(*sZoneRealloc)(struct _malloc_zone_t * zone, void * pointer, size_t size);
+static double		sSecondsPerTick;
+
+static long		BufferGetRate(Bench * bench, uint32_t iteration);
+static long		BufferSetRate(Bench * bench, uint32_t iteration);
+static long		BufferStatus(Bench * bench, uint32_t iteration);
+static long		BufferTextToPhonemes(Bench * bench, uint32_t iteration);
+static long		BufferSpeak(Bench * bench, uint32_t iteration);
+static long		BufferSpeakAndStop(Bench * bench, uint32_t iteration);
+static long		BufferSetDoneCallBack(Bench * bench, uint32_t iteration);
+static long		CFGetRate(Bench * bench, uint32_t iteration);
+static long		CFSetRate(Bench * bench, uint32_t iteration);
+static long		CFStatus(Bench * bench, uint32_t iteration);
+static long		CFTextToPhonemes(Bench * bench, uint32_t iteration);
+static long		CFSpeak(Bench * bench, uint32_t iteration);
+static long		CFSpeakAndStop(Bench * bench, uint32_t iteration);
+static long		CFSetDoneCallBack(Bench * bench, uint32_t iteration);
+
+static const Workload sWorkloads[] = {
+	{ "getRate",		{ BufferGetRate,		CFGetRate },		false },
+	{ "setRate",		{ BufferSetRate,		CFSetRate },		false },
+	{ "status",			{ BufferStatus,			CFStatus },			false },
+	{ "textToPhonemes",	{ BufferTextToPhonemes,	CFTextToPhonemes },	false },
+	{ "speakAndStop",	{ BufferSpeakAndStop,	CFSpeakAndStop },	true }
+};
+#define kWorkloadCount		(sizeof(sWorkloads) / sizeof(sWorkloads[0]))
+
+static const WorkloadProc	sSpeakProcs[kFamilyCount] = { BufferSpeak, CFSpeak };
+static const WorkloadProc	sSetDoneCallBackProcs[kFamilyCount] = { BufferSetDoneCallBack, CFSetDoneCallBack };
+
+static long		LoadEntryPoints(const char * path, CFBundleRef * outBundle, EntryPoints * entry);
+static Boolean	HasFamily(const EntryPoints * entry, int family);
+static long		SetText(Bench * bench, const char * utf8Text);
+static void		MeasureCalls(Bench * bench, const Workload * workload, int family, uint32_t iterations, CallResult * result);
+static void		MeasureRenders(Bench * bench, int family, const char * utf8Text, uint32_t renders, RenderResult * result);
+static void		Settle(Bench * bench);
+static void		WriteCallResult(FILE * file, CallResult * result);
+static void		WriteRenderResult(FILE * file, const RenderResult * result);
+static void		WriteString(FILE * file, const char * string);
+static int		CompareDoubles(const void * a, const void * b);
+static Boolean	StartCountingAllocations(void);
+static void		ReadAllocations(uint64_t * allocations, uint64_t * allocatedBytes);
+static void *	CountingMalloc(struct _malloc_zone_t * zone, size_t size);
+static void *	CountingCalloc(struct _malloc_zone_t * zone, size_t count, size_t size);
+static void *	CountingValloc(struct _malloc_zone_t * zone, size_t size);
+static void *	CountingRealloc(struct _malloc_zone_t * zone, void * pointer, size_t size);
+static id		CreateAutoreleasePool(void);
+static void		ReleaseAutoreleasePool(id pool);
+static pascal void	BenchSpeechDoneProc(SpeechChannel inSpeechChannel, long inRefCon);
+static void		PrintUsage(const char * toolName);
+
+int main(int argc, char * argv[])
+{
+	const char * textString = kDefaultText;
+	const char * outputPath = NULL;
+	uint32_t iterations = kDefaultIterations;
+	uint32_t renders = kDefaultRenders;
+	CallResult callResults[kWorkloadCount][kFamilyCount];
+	Boolean haveFamily[kFamilyCount];
+	Boolean countingAllocations;
+	mach_timebase_info_data_t timebase;
+	CFBundleRef bundle = NULL;
+	Bench bench;
+	FILE * file;
+	uint32_t index;
+	long error;
+	int option, family;
+
+	while ((option = getopt(argc, argv, "n:o:r:t:")) != -1) {
+		switch (option) {
+			case 'n':
+				iterations = (uint32_t)strtoul(optarg, NULL, 10);
+				break;
+			case 'o':
+				outputPath = optarg;
+				break;
+			case 'r':
+				renders = (uint32_t)strtoul(optarg, NULL, 10);
+				break;
+			case 't':
+				textString = optarg;
+				break;
+			default:
+				PrintUsage(argv[0]);
+				return 1;
+		}
+	}
+	if (optind != argc - 1 || iterations == 0 || strlen(textString) + 16 > kMaxRenderTextLength) {
+		PrintUsage(argv[0]);
+		return 1;
+	}
+
+	// The example engine reads this when it makes its worker pool, so it has to be set before the bundle is loaded.
+	// On the virtual clock the engine's jobs run here, between calls, instead of on threads of their own; that
+	// keeps the measurements of one family free of work left over from the other, and rendering as fast as it can.
+	setenv(kSynthEngineVirtualClockVariable, "1", 1);
+
+	memset(&bench, 0, sizeof(bench));
+	error = LoadEntryPoints(argv[optind], &bundle, &bench.entry);
+	if (error != noErr) {
+		fprintf(stderr, "%s: couldn't load a synthesizer from %s (error %ld)\n", argv[0], argv[optind], error);
+		return 1;
+	}
+	if (bench.entry.workersShared && bench.entry.workersIsVirtual && bench.entry.workersCurrentTime && bench.entry.workersRunUntil) {
+		bench.workers = bench.entry.workersShared();
+		if (bench.workers && ! bench.entry.workersIsVirtual(bench.workers)) {
+			bench.workers = NULL;
+		}
+	}
+	for (family = 0; family < kFamilyCount; family++) {
+		haveFamily[family] = HasFamily(&bench.entry, family);
+	}
+	if (! haveFamily[kBufferFamily] && ! haveFamily[kCFFamily]) {
+		fprintf(stderr, "%s: %s exports neither family of entry points\n", argv[0], argv[optind]);
+		return 1;
+	}
+	error = SetText(&bench, textString);
+	if (error != noErr) {
+		fprintf(stderr, "%s: the text isn't UTF-8 (error %ld)\n", argv[0], error);
+		return 1;
+	}
+	bench.rates[0] = CFNumberCreate(NULL, kCFNumberFloatType, &(float){ 180.0f });
+	bench.rates[1] = CFNumberCreate(NULL, kCFNumberFloatType, &(float){ 181.0f });
+	mach_timebase_info(&timebase);
+	sSecondsPerTick = (double)timebase.numer / (double)timebase.denom * 1.0e-9;
+	file = (outputPath) ? fopen(outputPath, "w") : stdout;
+	if (file == NULL) {
+		fprintf(stderr, "%s: couldn't write %s (%s)\n", argv[0], outputPath, strerror(errno));
+		return 1;
+	}
+
+	// Counting starts after loading, so what the bundle allocates as it's initialized isn't charged to any call.
+	countingAllocations = StartCountingAllocations();
+
+	fprintf(file, "{\n\t\"bundle\": ");
+	WriteString(file, argv[optind]);
+	fprintf(file, ",\n\t\"text\": ");
+	WriteString(file, textString);
+	fprintf(file, ",\n\t\"iterations\": %u,\n\t\"virtualClock\": %s,\n\t\"countsAllocations\": %s,\n\t\"families\": {",
+			iterations, (bench.workers) ? "true" : "false", (countingAllocations) ? "true" : "false");
+
+	// Each family gets a channel of its own, opened and set up the same way.
+	for (family = 0; family < kFamilyCount; family++) {
+		fprintf(file, (family > 0) ? ",\n\t\t\"%s\": " : "\n\t\t\"%s\": ", sFamilyNames[family]);
+		if (! haveFamily[family]) {
+			fprintf(file, "null");
+			continue;
+		}
+		error = bench.entry.openSpeechChannel(&bench.channel);
+		if (error != noErr) {
+			fprintf(stderr, "%s: couldn't open a channel (error %ld)\n", argv[0], error);
+			fprintf(file, "null");
+			haveFamily[family] = false;
+			continue;
+		}
+		fprintf(file, "{");
+		for (index = 0; index < kWorkloadCount; index++) {
+			MeasureCalls(&bench, &sWorkloads[index], family, iterations, &callResults[index][family]);
+			fprintf(file, (index > 0) ? ",\n\t\t\t\"%s\": " : "\n\t\t\t\"%s\": ", sWorkloads[index].name);
+			WriteCallResult(file, &callResults[index][family]);
+		}
+		fprintf(file, ",\n\t\t\t\"render\": ");
+		if (bench.workers && renders > 0) {
+			RenderResult renderResult;
+			MeasureRenders(&bench, family, textString, renders, &renderResult);
+			WriteRenderResult(file, &renderResult);
+		}
+		else {
+			// Without the engine's clock in hand there's no telling how much audio was rendered.
+			fprintf(file, "null");
+		}
+		fprintf(file, "\n\t\t}");
+		bench.entry.stopSpeechAt(bench.channel, kImmediate);
+		Settle(&bench);
+		bench.entry.closeSpeechChannel(bench.channel);
+		bench.channel = 0;
+	}
+	fprintf(file, "\n\t}");
+
+	// How many times longer each call takes, and how many more allocations it makes, through the CFString-based entry point.
+	if (haveFamily[kBufferFamily] && haveFamily[kCFFamily]) {
+		fprintf(file, ",\n\t\"cfOverBuffer\": {");
+		for (index = 0; index < kWorkloadCount; index++) {
+			CallResult * bufferResult = &callResults[index][kBufferFamily];
+			CallResult * cfResult = &callResults[index][kCFFamily];
+			fprintf(file, (index > 0) ? ",\n\t\t\"%s\": { " : "\n\t\t\"%s\": { ", sWorkloads[index].name);
+			if (bufferResult->totalSeconds > 0.0) {
+				fprintf(file, "\"timeRatio\": %.3f, ", cfResult->totalSeconds / bufferResult->totalSeconds);
+			}
+			else {
+				fprintf(file, "\"timeRatio\": null, ");
+			}
+			fprintf(file, "\"extraAllocationsPerCall\": %.3f }",
+					((double)cfResult->allocations - (double)bufferResult->allocations) / (double)iterations);
+		}
+		fprintf(file, "\n\t}");
+	}
+	fprintf(file, "\n}\n");
+
+	for (family = 0; family < kFamilyCount; family++) {
+		if (haveFamily[family]) {
+			for (index = 0; index < kWorkloadCount; index++) {
+				free(callResults[index][family].seconds);
+			}
+		}
+	}
+	CFRelease(bench.rates[0]);
+	CFRelease(bench.rates[1]);
+	CFRelease(bench.text);
+	free(bench.bytes);
+	if (file != stdout && fclose(file) != 0) {
+		fprintf(stderr, "%s: couldn't write %s (%s)\n", argv[0], outputPath, strerror(errno));
+		return 1;
+	}
+	// The bundle stays loaded: the engine may still have work of its own queued.
+	return 0;
+}
+
+static long LoadEntryPoints(const char * path, CFBundleRef * outBundle, EntryPoints * entry)
+{
+	CFURLRef url = CFURLCreateFromFileSystemRepresentation(NULL, (const UInt8 *)path, strlen(path), true);
+	CFBundleRef bundle;
+
+	if (url == NULL) {
+		return memFullErr;
+	}
+	bundle = CFBundleCreate(NULL, url);
+	CFRelease(url);
+	if (bundle == NULL) {
+		return fnfErr;
+	}
+	if (! CFBundleLoadExecutable(bundle)) {
+		CFRelease(bundle);
+		return noSynthFound;
+	}
+
+	entry->openSpeechChannel = CFBundleGetFunctionPointerForName(bundle, CFSTR("SEOpenSpeechChannel"));
+	entry->closeSpeechChannel = CFBundleGetFunctionPointerForName(bundle, CFSTR("SECloseSpeechChannel"));
+	entry->stopSpeechAt = CFBundleGetFunctionPointerForName(bundle, CFSTR("SEStopSpeechAt"));
+	entry->speakBuffer = CFBundleGetFunctionPointerForName(bundle, CFSTR("SESpeakBuffer"));
+	entry->getSpeechInfo = CFBundleGetFunctionPointerForName(bundle, CFSTR("SEGetSpeechInfo"));
+	entry->setSpeechInfo = CFBundleGetFunctionPointerForName(bundle, CFSTR("SESetSpeechInfo"));
+	entry->textToPhonemes = CFBundleGetFunctionPointerForName(bundle, CFSTR("SETextToPhonemes"));
+	entry->speakCFString = CFBundleGetFunctionPointerForName(bundle, CFSTR("SESpeakCFString"));
+	entry->copySpeechProperty = CFBundleGetFunctionPointerForName(bundle, CFSTR("SECopySpeechProperty"));
+	entry->setSpeechProperty = CFBundleGetFunctionPointerForName(bundle, CFSTR("SESetSpeechProperty"));
+	entry->copyPhonemesFromText = CFBundleGetFunctionPointerForName(bundle, CFSTR("SECopyPhonemesFromText"));
+	entry->workersShared = CFBundleGetFunctionPointerForName(bundle, CFSTR("SynthEngineWorkersShared"));
+	entry->workersIsVirtual = CFBundleGetFunctionPointerForName(bundle, CFSTR("SynthEngineWorkersIsVirtual"));
+	entry->workersCurrentTime = CFBundleGetFunctionPointerForName(bundle, CFSTR("SynthEngineWorkersCurrentTime"));
+	entry->workersRunUntil = CFBundleGetFunctionPointerForName(bundle, CFSTR("SynthEngineWorkersRunUntil"));
+	if (entry->openSpeechChannel == NULL || entry->closeSpeechChannel == NULL || entry->stopSpeechAt == NULL) {
+		return noSynthFound;
+	}
+	*outBundle = bundle;
+	return noErr;
+}
+
+static Boolean HasFamily(const EntryPoints * entry, int family)
+{
+	if (family == kBufferFamily) {
+		return entry->speakBuffer && entry->getSpeechInfo && entry->setSpeechInfo && entry->textToPhonemes;
+	}
+	else {
+		return entry->speakCFString && entry->copySpeechProperty && entry->setSpeechProperty && entry->copyPhonemesFromText;
+	}
+}
+
+static long SetText(Bench * bench, const char * utf8Text)
+{
+	CFStringRef text = CFStringCreateWithCString(NULL, utf8Text, kCFStringEncodingUTF8);
+	CFIndex length, byteLength = 0;
+	char * bytes;
+
+	if (text == NULL) {
+		return paramErr;
+	}
+
+	// Both families are given the same characters: what doesn't fit Mac Roman is replaced in the CFString too.
+	length = CFStringGetLength(text);
+	bytes = (char *)malloc((length) ? length : 1);
+	if (bytes == NULL) {
+		CFRelease(text);
+		return memFullErr;
+	}
+	CFStringGetBytes(text, CFRangeMake(0, length), kCFStringEncodingMacRoman, '?', false, (UInt8 *)bytes, length, &byteLength);
+	CFRelease(text);
+	text = CFStringCreateWithBytes(NULL, (const UInt8 *)bytes, byteLength, kCFStringEncodingMacRoman, false);
+	if (text == NULL) {
+		free(bytes);
+		return memFullErr;
+	}
+
+	if (bench->text) {
+		CFRelease(bench->text);
+	}
+	free(bench->bytes);
+	bench->text = text;
+	bench->bytes = bytes;
+	bench->byteLength = byteLength;
+	return noErr;
+}
+
+static void MeasureCalls(Bench * bench, const Workload * workload, int family, uint32_t iterations, CallResult * result)
+{
+	WorkloadProc proc = workload->procs[family];
+	uint32_t index, warmUp = iterations / 10 + 1;
+	uint64_t allocationsBefore, bytesBefore, allocationsAfter, bytesAfter;
+	uint64_t start, end;
+	id pool;
+
+	memset(result, 0, sizeof(CallResult));
+	result->seconds = (double *)calloc(iterations, sizeof(double));
+	if (result->seconds == NULL) {
+		return;
+	}
+
+	// Warm up first, so the engine's caches and pools are as full for the first measured call as for the last.
+	pool = CreateAutoreleasePool();
+	for (index = 0; index < warmUp; index++) {
+		proc(bench, index);
+		if (workload->settle) {
+			Settle(bench);
+		}
+	}
+	ReleaseAutoreleasePool(pool);
+
+	// Only the call is timed and counted.  Autoreleased objects it makes are counted when they're made, and the pool
+	// they go into, which an application's run loop would provide, is emptied now and then between calls.
+	pool = CreateAutoreleasePool();
+	for (index = 0; index < iterations; index++) {
+		ReadAllocations(&allocationsBefore, &bytesBefore);
+		start = mach_absolute_time();
+		if (proc(bench, index) != noErr) {
+			result->errors++;
+		}
+		end = mach_absolute_time();
+		ReadAllocations(&allocationsAfter, &bytesAfter);
+		result->seconds[index] = (double)(end - start) * sSecondsPerTick;
+		result->totalSeconds += result->seconds[index];
+		result->allocations += allocationsAfter - allocationsBefore;
+		result->allocatedBytes += bytesAfter - bytesBefore;
+		result->calls++;
+
+		if (workload->settle) {
+			Settle(bench);
+		}
+		if ((index + 1) % kCallsPerPool == 0) {
+			ReleaseAutoreleasePool(pool);
+			pool = CreateAutoreleasePool();
+		}
+	}
+	ReleaseAutoreleasePool(pool);
+}
+
+static void MeasureRenders(Bench * bench, int family, const char * utf8Text, uint32_t renders, RenderResult * result)
+{
+	char variant[kMaxRenderTextLength];
+	uint64_t allocationsBefore, bytesBefore, allocationsAfter, bytesAfter;
+	uint64_t start, end;
+	double startTime, limit;
+	uint32_t index;
+	id pool;
+
+	memset(result, 0, sizeof(RenderResult));
+	result->utterances = renders;
+	sSetDoneCallBackProcs[family](bench, 0);
+
+	// Every utterance gets text no utterance before it had, in either family, so each one is rendered rather than
+	// found in the engine's audio cache.  The variants only differ in their digits, so they're all the same length.
+	for (index = 0; index < renders; index++) {
+		snprintf(variant, sizeof(variant), "%s %06u.", utf8Text, (unsigned)(family * renders + index));
+		if (SetText(bench, variant) != noErr) {
+			result->errors++;
+			continue;
+		}
+		limit = 10.0 + bench->byteLength * kSecondsPerCharacter;
+		bench->done = false;
+
+		pool = CreateAutoreleasePool();
+		ReadAllocations(&allocationsBefore, &bytesBefore);
+		start = mach_absolute_time();
+		startTime = bench->entry.workersCurrentTime(bench->workers);
+		if (sSpeakProcs[family](bench, index) == noErr) {
+			while (! bench->done && bench->entry.workersCurrentTime(bench->workers) - startTime < limit) {
+				bench->entry.workersRunUntil(bench->workers, bench->entry.workersCurrentTime(bench->workers) + kRenderStep, NULL);
+			}
+		}
+		else {
+			result->errors++;
+		}
+		end = mach_absolute_time();
+		ReadAllocations(&allocationsAfter, &bytesAfter);
+		ReleaseAutoreleasePool(pool);
+
+		result->wallSeconds += (double)(end - start) * sSecondsPerTick;
+		result->allocations += allocationsAfter - allocationsBefore;
+		result->allocatedBytes += bytesAfter - bytesBefore;
+		if (bench->done) {
+			result->finished++;
+			result->audioSeconds += bench->doneTime - startTime;
+		}
+	}
+	SetText(bench, utf8Text);
+}
+
+static void Settle(Bench * bench)
+{
+	// Runs whatever the last call left due on the engine's clock, without moving it on.
+	if (bench->workers) {
+		bench->entry.workersRunUntil(bench->workers, bench->entry.workersCurrentTime(bench->workers), NULL);
+	}
+}
+
+static long BufferGetRate(Bench * bench, uint32_t iteration)
+{
+	Fixed rate;
+	return bench->entry.getSpeechInfo(bench->channel, soRate, &rate);
+}
+
+static long BufferSetRate(Bench * bench, uint32_t iteration)
+{
+	Fixed rate = (Fixed)((180 + (iteration & 1)) << 16);
+	return bench->entry.setSpeechInfo(bench->channel, soRate, &rate);
+}
+
+static long BufferStatus(Bench * bench, uint32_t iteration)
+{
+	SpeechStatusInfo status;
+	return bench->entry.getSpeechInfo(bench->channel, soStatus, &status);
+}
+
+static long BufferTextToPhonemes(Bench * bench, uint32_t iteration)
+{
+	void * phonemes = NULL;
+	long phonemeLength = 0;
+	long error = bench->entry.textToPhonemes(bench->channel, bench->bytes, bench->byteLength, &phonemes, &phonemeLength);
+
+	// The caller owns the phonemes, so disposing of them is part of the call's cost.
+	if (error == noErr) {
+		free(phonemes);
+	}
+	return error;
+}
+
+static long BufferSpeak(Bench * bench, uint32_t iteration)
+{
+	return bench->entry.speakBuffer(bench->channel, bench->bytes, bench->byteLength, 0);
+}
+
+static long BufferSpeakAndStop(Bench * bench, uint32_t iteration)
+{
+	long error = bench->entry.speakBuffer(bench->channel, bench->bytes, bench->byteLength, 0);
+	if (error == noErr) {
+		error = bench->entry.stopSpeechAt(bench->channel, kImmediate);
+	}
+	return error;
+}
+
+static long BufferSetDoneCallBack(Bench * bench, uint32_t iteration)
+{
+	long error = bench->entry.setSpeechInfo(bench->channel, soRefCon, (void *)bench);
+	if (error == noErr) {
+		error = bench->entry.setSpeechInfo(bench->channel, soSpeechDoneCallBack, (void *)BenchSpeechDoneProc);
+	}
+	return error;
+}
+
+static long CFGetRate(Bench * bench, uint32_t iteration)
+{
+	CFTypeRef rate = NULL;
+	long error = bench->entry.copySpeechProperty(bench->channel, kSpeechRateProperty, &rate);
+
+	if (rate) {
+		CFRelease(rate);
+	}
+	return error;
+}
+
+static long CFSetRate(Bench * bench, uint32_t iteration)
+{
+	return bench->entry.setSpeechProperty(bench->channel, kSpeechRateProperty, bench->rates[iteration & 1]);
+}
+
+static long CFStatus(Bench * bench, uint32_t iteration)
+{
+	CFTypeRef status = NULL;
+	long error = bench->entry.copySpeechProperty(bench->channel, kSpeechStatusProperty, &status);
+
+	if (status) {
+		CFRelease(status);
+	}
+	return error;
+}
+
+static long CFTextToPhonemes(Bench * bench, uint32_t iteration)
+{
+	CFStringRef phonemes = NULL;
+	long error = bench->entry.copyPhonemesFromText(bench->channel, bench->text, &phonemes);
+
+	if (phonemes) {
+		CFRelease(phonemes);
+	}
+	return error;
+}
+
+static long CFSpeak(Bench * bench, uint32_t iteration)
+{
+	return bench->entry.speakCFString(bench->channel, bench->text, NULL);
+}
+
+static long CFSpeakAndStop(Bench * bench, uint32_t iteration)
+{
+	long error = bench->entry.speakCFString(bench->channel, bench->text, NULL);
+	if (error == noErr) {
+		error = bench->entry.stopSpeechAt(bench->channel, kImmediate);
+	}
+	return error;
+}
+
+static long CFSetDoneCallBack(Bench * bench, uint32_t iteration)
+{
+	long refCon = (long)bench;
+	long callBack = (long)BenchSpeechDoneProc;
+	CFNumberRef number;
+	long error;
+
+	number = CFNumberCreate(NULL, kCFNumberLongType, &refCon);
+	error = bench->entry.setSpeechProperty(bench->channel, kSpeechRefConProperty, number);
+	CFRelease(number);
+	if (error == noErr) {
+		number = CFNumberCreate(NULL, kCFNumberLongType, &callBack);
+		error = bench->entry.setSpeechProperty(bench->channel, kSpeechSpeechDoneCallBack, number);
+		CFRelease(number);
+	}
+	return error;
+}
+
+static void WriteCallResult(FILE * file, CallResult * result)
+{
+	uint32_t count = result->calls;
+
+	if (count == 0) {
+		fprintf(file, "null");
+		return;
+	}
+
+	// Nearest rank, in seconds.
+	qsort(result->seconds, count, sizeof(double), CompareDoubles);
+	fprintf(file, "{ \"calls\": %u, \"errors\": %u, \"meanSeconds\": %.9f, \"p50\": %.9f, \"p99\": %.9f, \"max\": %.9f, \"allocationsPerCall\": %.3f, \"bytesPerCall\": %.1f }",
+			count, result->errors, result->totalSeconds / count, result->seconds[(count * 50 + 99) / 100 - 1], result->seconds[(count * 99 + 99) / 100 - 1],
+			result->seconds[count - 1], (double)result->allocations / count, (double)result->allocatedBytes / count);
+}
+
+static void WriteRenderResult(FILE * file, const RenderResult * result)
+{
+	fprintf(file, "{ \"utterances\": %u, \"finished\": %u, \"errors\": %u, \"wallSeconds\": %.6f, \"audioSeconds\": %.6f, ",
+			result->utterances, result->finished, result->errors, result->wallSeconds, result->audioSeconds);
+	if (result->wallSeconds > 0.0) {
+		fprintf(file, "\"audioSecondsPerWallSecond\": %.1f, ", result->audioSeconds / result->wallSeconds);
+	}
+	else {
+		fprintf(file, "\"audioSecondsPerWallSecond\": null, ");
+	}
+	fprintf(file, "\"allocationsPerUtterance\": %.1f, \"bytesPerUtterance\": %.0f }",
+			(result->utterances) ? (double)result->allocations / result->utterances : 0.0, (result->utterances) ? (double)result->allocatedBytes / result->utterances : 0.0);
+}
+
+static void WriteString(FILE * file, const char * string)
+{
+	fputc('"', file);
+	for (; *string; string++) {
+		unsigned char c = (unsigned char)*string;
+		if (c == '"' || c == '\\') {
+			fprintf(file, "\\%c", c);
+		}
+		else if (c < 0x20) {
+			fprintf(file, "\\u%04x", c);
+		}
+		else {
+			fputc(c, file);
+		}
+	}
+	fputc('"', file);
+}
+
+static int CompareDoubles(const void * a, const void * b)
+{
+	double difference = *(const double *)a - *(const double *)b;
+	return (difference < 0.0) ? -1 : (difference > 0.0) ? 1 : 0;
+}
+
+static Boolean StartCountingAllocations(void)
+{
+	malloc_zone_t * zone = malloc_default_zone();
+	vm_address_t page = trunc_page((vm_address_t)zone);
+
+	// Every allocation Core Foundation and Objective-C make without a zone of their own comes from the default zone,
+	// so its functions are wrapped.  Some systems keep the zone read-only; it's left writable, since the allocator
+	// may keep state of its own on the same page.  Allocations on any thread are counted, but with the engine on a
+	// virtual clock there's little else running.
+	if (vm_protect(mach_task_self(), page, vm_page_size, false, VM_PROT_READ | VM_PROT_WRITE) != KERN_SUCCESS) {
+		return false;
+	}
+	sZoneMalloc = zone->malloc;
+	sZoneCalloc = zone->calloc;
+	sZoneValloc = zone->valloc;
+	sZoneRealloc = zone->realloc;
+	zone->malloc = CountingMalloc;
+	zone->calloc = CountingCalloc;
+	zone->valloc = CountingValloc;
+	zone->realloc = CountingRealloc;
+	return true;
+}
+
+static void ReadAllocations(uint64_t * allocations, uint64_t * allocatedBytes)
+{
+	*allocations = atomic_load_explicit(&sAllocations, memory_order_relaxed);
+	*allocatedBytes = atomic_load_explicit(&sAllocatedBytes, memory_order_relaxed);
+}
+
+static void * CountingMalloc(struct _malloc_zone_t * zone, size_t size)
+{
+	atomic_fetch_add_explicit(&sAllocations, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&sAllocatedBytes, size, memory_order_relaxed);
+	return sZoneMalloc(zone, size);
+}
+
+static void * CountingCalloc(struct _malloc_zone_t * zone, size_t count, size_t size)
+{
+	atomic_fetch_add_explicit(&sAllocations, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&sAllocatedBytes, count * size, memory_order_relaxed);
+	return sZoneCalloc(zone, count, size);
+}
+
+static void * CountingValloc(struct _malloc_zone_t * zone, size_t size)
+{
+	atomic_fetch_add_explicit(&sAllocations, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&sAllocatedBytes, size, memory_order_relaxed);
+	return sZoneValloc(zone, size);
+}
+
+static void * CountingRealloc(struct _malloc_zone_t * zone, void * pointer, size_t size)
+{
+	atomic_fetch_add_explicit(&sAllocations, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&sAllocatedBytes, size, memory_order_relaxed);
+	return sZoneRealloc(zone, pointer, size);
+}
+
+static id CreateAutoreleasePool(void)
+{
+	// The example engine is written in Objective-C, which this tool isn't, so the pool is made through the runtime.
+	Class poolClass = objc_getClass("NSAutoreleasePool");
+
+	if (poolClass == nil) {
+		return nil;
+	}
+	return objc_msgSend(objc_msgSend((id)poolClass, sel_registerName("alloc")), sel_registerName("init"));
+}
+
+static void ReleaseAutoreleasePool(id pool)
+{
+	if (pool) {
+		objc_msgSend(pool, sel_registerName("release"));
+	}
+}
+
+static pascal void BenchSpeechDoneProc(SpeechChannel inSpeechChannel, long inRefCon)
+{
+	Bench * bench = (Bench *)inRefCon;
+
+	// Called from a job the engine runs on this thread, inside workersRunUntil.
+	bench->doneTime = bench->entry.workersCurrentTime(bench->workers);
+	bench->done = true;
+}
+
+static void PrintUsage(const char * toolName)
+{
+	fprintf(stderr, "usage: %s [-n iterations] [-r renders] [-t text] [-o output] synthesizer-bundle\n", toolName);
+	fprintf(stderr, "  -n  calls of each kind to time through each family of entry points (default %d)\n", kDefaultIterations);
+	fprintf(stderr, "  -r  utterances to render to the end through each family (default %d)\n", kDefaultRenders);
+	fprintf(stderr, "  -t  text to speak and convert to phonemes\n");
+	fprintf(stderr, "  -o  write the results here instead of to standard output\n");
+}
@@ -0,0 +1,233 @@
+/*
+	main.c
+	AnimationTimelineTest
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Checks SynthAnimationTimeline against a hand-made schedule of keys and
+	sample times, and exits with a non-zero status if any check fails.  It only needs
+	the timeline and a C11 compiler, so it also builds off Mac OS X:
+
+		cc -std=c11 -ICommon AnimationTimelineTest/main.c Common/SynthAnimationTimeline.c
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#include <stdio.h>
+#include "SynthAnimationTimeline.h"
+
+#define kHoldTime		0.5
+
+static int	sChecks;
+static int	sFailures;
+
+#define CheckEqual(actual, expected)		Check(#actual, (double)(actual), (double)(expected), __LINE__)
+
+static void		Check(const char * what, double actual, double expected, int line);
+static void		CheckSample(SynthAnimationTimeline * timeline, double time, SynthViseme expectedViseme, double expectedStartTime, int line);
+static void		TestHoldExpiry(void);
+static void		TestCarriedOnStart(void);
+static void		TestRestingChange(void);
+static void		TestKeysAhead(void);
+static void		TestEngineEvents(void);
+static void		TestFullTimeline(void);
+
+int main(void)
+{
+	TestHoldExpiry();
+	TestCarriedOnStart();
+	TestRestingChange();
+	TestKeysAhead();
+	TestEngineEvents();
+	TestFullTimeline();
+	
+	printf("%d checks, %d failed\n", sChecks, sFailures);
+	return (sFailures) ? 1 : 0;
+}
+
+/*
+	A consonant or vowel is shown for the hold time after its key, then the resting shape
+	takes over, starting when the hold ran out.
+*/
+static void TestHoldExpiry(void)
+{
+	SynthAnimationTimeline * timeline;
+
+	CheckEqual(SynthAnimationTimelineCreate(8, kHoldTime, &timeline), noErr);
+	CheckEqual(SynthAnimationTimelineAddViseme(timeline, 1.0, kSynthVisemeVowel), noErr);
+	CheckSample(timeline, 1.0, kSynthVisemeVowel, 1.0, __LINE__);
+	CheckSample(timeline, 1.49, kSynthVisemeVowel, 1.0, __LINE__);
+	CheckSample(timeline, 1.5, kSynthVisemeIdle, 1.5, __LINE__);
+	CheckSample(timeline, 2.0, kSynthVisemeIdle, 1.5, __LINE__);
+	
+	// A key for the resting shape ends the hold straight away.
+	CheckEqual(SynthAnimationTimelineAddViseme(timeline, 3.0, kSynthVisemeConsonant), noErr);
+	CheckEqual(SynthAnimationTimelineAddViseme(timeline, 3.1, kSynthVisemeIdle), noErr);
+	CheckSample(timeline, 3.05, kSynthVisemeConsonant, 3.0, __LINE__);
+	CheckSample(timeline, 3.2, kSynthVisemeIdle, 3.1, __LINE__);
+	SynthAnimationTimelineDispose(timeline);
+}
+
+/*
+	A shape that carries on, through a repeated key or from one refresh to the next, keeps
+	the time it first began so multi-frame expressions don't restart.
+*/
+static void TestCarriedOnStart(void)
+{
+	SynthAnimationTimeline * timeline;
+
+	CheckEqual(SynthAnimationTimelineCreate(8, kHoldTime, &timeline), noErr);
+	CheckEqual(SynthAnimationTimelineAddViseme(timeline, 1.0, kSynthVisemeVowel), noErr);
+	CheckSample(timeline, 1.1, kSynthVisemeVowel, 1.0, __LINE__);
+	CheckEqual(SynthAnimationTimelineAddViseme(timeline, 1.2, kSynthVisemeVowel), noErr);
+	CheckSample(timeline, 1.3, kSynthVisemeVowel, 1.0, __LINE__);
+
+	// The repeated key still extends the hold.
+	CheckSample(timeline, 1.6, kSynthVisemeVowel, 1.0, __LINE__);
+	CheckSample(timeline, 1.7, kSynthVisemeIdle, 1.7, __LINE__);
+	
+	// A different shape starts afresh.
+	CheckEqual(SynthAnimationTimelineAddPhoneme(timeline, 2.0, 30), noErr);
+	CheckSample(timeline, 2.1, kSynthVisemeConsonant, 2.0, __LINE__);
+	SynthAnimationTimelineDispose(timeline);
+}
+
+/*
+	Changing the resting shape restarts it, even though nothing was keyed.
+*/
+static void TestRestingChange(void)
+{
+	SynthAnimationTimeline * timeline;
+
+	CheckEqual(SynthAnimationTimelineCreate(8, kHoldTime, &timeline), noErr);
+	CheckEqual(SynthAnimationTimelineSample(timeline, 1.0, NULL), kSynthVisemeIdle);
+	SynthAnimationTimelineSetRestingViseme(timeline, kSynthVisemeSleep);
+	CheckSample(timeline, 2.0, kSynthVisemeSleep, 2.0, __LINE__);
+	CheckSample(timeline, 2.5, kSynthVisemeSleep, 2.0, __LINE__);
+	
+	// A held shape isn't disturbed by the change, but what follows it is the new resting shape.
+	CheckEqual(SynthAnimationTimelineAddViseme(timeline, 3.0, kSynthVisemeVowel), noErr);
+	CheckSample(timeline, 3.0, kSynthVisemeVowel, 3.0, __LINE__);
+	SynthAnimationTimelineSetRestingViseme(timeline, kSynthVisemeIdle);
+	CheckSample(timeline, 3.2, kSynthVisemeVowel, 3.0, __LINE__);
+	CheckSample(timeline, 3.6, kSynthVisemeIdle, 3.5, __LINE__);
+	SynthAnimationTimelineDispose(timeline);
+}
+
+/*
+	Keys added ahead of time wait until they're due, however often the timeline is sampled.
+*/
+static void TestKeysAhead(void)
+{
+	SynthAnimationTimeline * timeline;
+
+	CheckEqual(SynthAnimationTimelineCreate(8, kHoldTime, &timeline), noErr);
+	CheckEqual(SynthAnimationTimelineAddViseme(timeline, 1.0, kSynthVisemeConsonant), noErr);
+	CheckEqual(SynthAnimationTimelineAddViseme(timeline, 2.0, kSynthVisemeVowel), noErr);
+	CheckEqual(SynthAnimationTimelineAddViseme(timeline, 2.2, kSynthVisemeConsonant), noErr);
+	CheckSample(timeline, 0.5, kSynthVisemeIdle, 0.0, __LINE__);
+	CheckSample(timeline, 1.2, kSynthVisemeConsonant, 1.0, __LINE__);
+	CheckSample(timeline, 1.9, kSynthVisemeIdle, 1.5, __LINE__);
+	CheckSample(timeline, 1.99, kSynthVisemeIdle, 1.5, __LINE__);
+	CheckSample(timeline, 2.0, kSynthVisemeVowel, 2.0, __LINE__);
+	CheckSample(timeline, 2.1, kSynthVisemeVowel, 2.0, __LINE__);
+	CheckSample(timeline, 2.2, kSynthVisemeConsonant, 2.2, __LINE__);
+	SynthAnimationTimelineDispose(timeline);
+}
+
+/*
+	Engine events are placed at the utterance's start plus their sample position; a speech
+	done event rests the mouth, and other events are left out.
+*/
+static void TestEngineEvents(void)
+{
+	SynthAnimationTimeline * timeline;
+	SynthEngineEvent event = { kSynthEnginePhonemeEvent, 0, 1, kSynthEngineSampleRate, 0, 0, 5 };
+
+	CheckEqual(SynthAnimationTimelineCreate(8, kHoldTime, &timeline), noErr);
+	CheckEqual(SynthAnimationTimelineAddEngineEvent(timeline, &event, 10.0), noErr);
+	event.kind = kSynthEngineWordEvent;
+	event.samplePosition = kSynthEngineSampleRate + kSynthEngineSampleRate / 10;
+	CheckEqual(SynthAnimationTimelineAddEngineEvent(timeline, &event, 10.0), noErr);
+	event.kind = kSynthEngineSpeechDoneEvent;
+	event.samplePosition = kSynthEngineSampleRate + kSynthEngineSampleRate / 5;
+	CheckEqual(SynthAnimationTimelineAddEngineEvent(timeline, &event, 10.0), noErr);
+	CheckSample(timeline, 10.9, kSynthVisemeIdle, 0.0, __LINE__);
+	CheckSample(timeline, 11.0, kSynthVisemeVowel, 11.0, __LINE__);
+	CheckSample(timeline, 11.15, kSynthVisemeVowel, 11.0, __LINE__);
+	CheckSample(timeline, 11.2, kSynthVisemeIdle, 11.2, __LINE__);
+	SynthAnimationTimelineDispose(timeline);
+}
+
+/*
+	A full timeline turns keys away with bufTooSmall, and takes them again once sampling has
+	made room.
+*/
+static void TestFullTimeline(void)
+{
+	SynthAnimationTimeline * timeline;
+	int keyIndex;
+
+	CheckEqual(SynthAnimationTimelineCreate(4, kHoldTime, &timeline), noErr);
+	for (keyIndex = 0; keyIndex < 4; keyIndex++) {
+		CheckEqual(SynthAnimationTimelineAddViseme(timeline, 1.0 + keyIndex, kSynthVisemeVowel), noErr);
+	}
+	CheckEqual(SynthAnimationTimelineAddViseme(timeline, 5.0, kSynthVisemeConsonant), bufTooSmall);
+	CheckSample(timeline, 1.0, kSynthVisemeVowel, 1.0, __LINE__);
+	CheckEqual(SynthAnimationTimelineAddViseme(timeline, 5.0, kSynthVisemeConsonant), noErr);
+	CheckEqual(SynthAnimationTimelineAddViseme(timeline, 6.0, kSynthVisemeConsonant), bufTooSmall);
+	CheckSample(timeline, 5.0, kSynthVisemeConsonant, 5.0, __LINE__);
+	SynthAnimationTimelineDispose(timeline);
+}
+
+static void Check(const char * what, double actual, double expected, int line)
+{
+	sChecks++;
+	if (actual < expected - 1e-9 || actual > expected + 1e-9) {
+		sFailures++;
+		fprintf(stderr, "main.c:%d: %s is %g, expected %g\n", line, what, actual, expected);
+	}
+}
+
+static void CheckSample(SynthAnimationTimeline * timeline, double time, SynthViseme expectedViseme, double expectedStartTime, int line)
+{
+	double startTime = -1.0;
+	SynthViseme viseme = SynthAnimationTimelineSample(timeline, time, &startTime);
+	
+	Check("viseme", viseme, expectedViseme, line);
+	Check("start time", startTime, expectedStartTime, line);
+}
@@ -0,0 +1,578 @@
+/*
+	main.c
+	ChannelBenchmark
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Opens more and more channels on one of the example synthesizers and speaks
+	on all of them at once, then optionally keeps opening, speaking and closing for
+	hours, and writes what it measured as JSON.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#include <ApplicationServices/ApplicationServices.h>
+#include <errno.h>
+#include <mach/mach.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include "SynthesizerSimulator.h"
+#include "SynthEngineWorkers.h"
+
+#define kDefaultLevels				"10,100,1000"
+#define kDefaultText				"The quick brown fox jumps over the lazy dog."
+#define kDefaultSynthesizer			123456789			// The CF-based example synthesizer.
+#define kDefaultSoakChannels		10
+#define kDefaultLeakThreshold		(1024.0 * 1024.0)	// Bytes an hour of resident growth after warming up.
+#define kSoakWarmUpCycles			5
+#define kMaxLevels					16
+#define kPollInterval				0.01
+#define kSecondsPerCharacter		0.5					// How long to wait for an utterance before giving up on it.
+
+// A channel being measured.  Its done callback can come on any thread, so the time is published with a release store.
+typedef struct BenchChannel {
+	SpeechChannel	channel;
+	double			startTime;
+	double			doneTime;
+	atomic_int		state;			// 0 speaking, 1 done, 2 couldn't start.
+} BenchChannel;
+
+// What one round of opening, speaking on and closing channels found.
+typedef struct RoundResult {
+	uint32_t		requested;
+	uint32_t		opened;
+	uint32_t		openFailures;		// Refused with synthOpenFailed, as the engine does past its limits.
+	long			otherOpenError;
+	double *		openLatencies;
+	double *		closeLatencies;
+	uint64_t		residentBefore;
+	uint64_t		residentOpen;
+	uint64_t		residentSpeaking;
+	uint64_t		residentAfter;
+	uint32_t		finished;
+	double			wallSeconds;
+	double			audioSeconds;
+	double			cpuSeconds;
+	Boolean			haveLateness;
+	uint64_t		latenessHistogram[kSynthEngineLatenessBuckets];
+	uint64_t		deadlineMisses;
+} RoundResult;
+
+static atomic_ulong	sWordCallbacks;
+
+static long		FindVoice(OSType synthesizer, VoiceSpec * voice);
+static long		RunRound(const VoiceSpec * voice, CFStringRef text, uint32_t channelCount, RoundResult * result);
+static void		DisposeRound(RoundResult * result);
+static Boolean	CopyLateness(SpeechChannel channel, uint64_t histogram[kSynthEngineLatenessBuckets], uint64_t * deadlineMisses);
+static void		WriteRound(FILE * file, RoundResult * result);
+static void		WritePercentiles(FILE * file, double * values, uint32_t count);
+static void		WriteLatencyPercentiles(FILE * file, const uint64_t histogram[kSynthEngineLatenessBuckets], uint64_t deadlineMisses);
+static void		WriteLimit(FILE * file, const char * name, const char * variable);
+static void		WriteString(FILE * file, const char * string);
+static double	CPUSeconds(void);
+static uint64_t	ResidentBytes(void);
+static int		CompareDoubles(const void * a, const void * b);
+static pascal void	BenchSpeechDoneProc(SpeechChannel inSpeechChannel, long inRefCon);
+static pascal void	BenchWordProc(SpeechChannel inSpeechChannel, long inRefCon, long inWordPos, short inWordLen);
+static void		PrintUsage(const char * toolName);
+
+int main(int argc, char * argv[])
+{
+	const char * levelList = kDefaultLevels;
+	const char * textString = kDefaultText;
+	const char * outputPath = NULL;
+	OSType synthesizer = kDefaultSynthesizer;
+	uint32_t levels[kMaxLevels];
+	uint32_t levelCount = 0, levelIndex;
+	uint32_t soakChannels = kDefaultSoakChannels;
+	double soakHours = 0.0;
+	double leakThreshold = kDefaultLeakThreshold;
+	CFStringRef text;
+	VoiceSpec voice;
+	FILE * file;
+	char * end;
+	long error;
+	int option;
+
+	while ((option = getopt(argc, argv, "b:c:g:k:l:m:o:s:t:")) != -1) {
+		switch (option) {
+			case 'b':
+				// The engine reads its limits from the environment when this process opens its first channel.
+				setenv(kSynthEngineMemoryBudgetVariable, optarg, 1);
+				break;
+			case 'c':
+				soakChannels = (uint32_t)strtoul(optarg, NULL, 10);
+				break;
+			case 'g':
+				leakThreshold = strtod(optarg, NULL);
+				break;
+			case 'k':
+				soakHours = strtod(optarg, NULL);
+				break;
+			case 'l':
+				levelList = optarg;
+				break;
+			case 'm':
+				setenv(kSynthEngineMaxChannelsVariable, optarg, 1);
+				break;
+			case 'o':
+				outputPath = optarg;
+				break;
+			case 's':
+				// A number, or a four-character code such as TEST.
+				synthesizer = (OSType)strtoul(optarg, &end, 10);
+				if (*end != '\0' && strlen(optarg) == 4) {
+					synthesizer = (OSType)(((uint32_t)(uint8_t)optarg[0] << 24) | ((uint32_t)(uint8_t)optarg[1] << 16) | ((uint32_t)(uint8_t)optarg[2] << 8) | (uint32_t)(uint8_t)optarg[3]);
+				}
+				else if (*end != '\0') {
+					PrintUsage(argv[0]);
+					return 1;
+				}
+				break;
+			case 't':
+				textString = optarg;
+				break;
+			default:
+				PrintUsage(argv[0]);
+				return 1;
+		}
+	}
+	while (*levelList && levelCount < kMaxLevels) {
+		uint32_t level = (uint32_t)strtoul(levelList, &end, 10);
+		if (end == levelList || level == 0 || (*end != ',' && *end != '\0')) {
+			break;
+		}
+		levels[levelCount++] = level;
+		levelList = (*end == ',') ? end + 1 : end;
+	}
+	if (optind < argc || *levelList || soakChannels == 0) {
+		PrintUsage(argv[0]);
+		return 1;
+	}
+
+	error = FindVoice(synthesizer, &voice);
+	if (error != noErr) {
+		fprintf(stderr, "%s: no voice of synthesizer %lu is installed (error %ld)\n", argv[0], (unsigned long)synthesizer, error);
+		return 1;
+	}
+	text = CFStringCreateWithCString(NULL, textString, kCFStringEncodingUTF8);
+	if (text == NULL) {
+		fprintf(stderr, "%s: the text isn't UTF-8\n", argv[0]);
+		return 1;
+	}
+	file = (outputPath) ? fopen(outputPath, "w") : stdout;
+	if (file == NULL) {
+		fprintf(stderr, "%s: couldn't write %s (%s)\n", argv[0], outputPath, strerror(errno));
+		return 1;
+	}
+
+	fprintf(file, "{\n\t\"synthesizer\": %lu,\n\t\"text\": ", (unsigned long)synthesizer);
+	WriteString(file, textString);
+	fprintf(file, ",\n");
+	WriteLimit(file, "maxChannels", kSynthEngineMaxChannelsVariable);
+	WriteLimit(file, "memoryBudget", kSynthEngineMemoryBudgetVariable);
+
+	// Ramp up: each level opens its channels, speaks on all of them at once, and closes them again.
+	fprintf(file, "\t\"levels\": [");
+	for (levelIndex = 0; levelIndex < levelCount; levelIndex++) {
+		RoundResult result;
+		error = RunRound(&voice, text, levels[levelIndex], &result);
+		if (error != noErr) {
+			fprintf(stderr, "%s: couldn't run %u channels (error %ld)\n", argv[0], levels[levelIndex], error);
+			break;
+		}
+		fprintf(file, (levelIndex > 0) ? ",\n\t\t" : "\n\t\t");
+		WriteRound(file, &result);
+		DisposeRound(&result);
+	}
+	fprintf(file, "\n\t]");
+
+	// Soak: the same round over and over, watching whether resident memory keeps growing once the engine's
+	// pools and caches have filled, which is what a leak per channel or per utterance looks like.
+	if (soakHours > 0.0) {
+		double soakEnd = CFAbsoluteTimeGetCurrent() + soakHours * 3600.0;
+		double baselineTime = 0.0, now, growth = 0.0;
+		uint64_t startResident = ResidentBytes(), baselineResident = 0, peakResident = startResident, resident = startResident;
+		uint32_t cycles = 0, incompleteCycles = 0;
+		unsigned long wordsBefore = atomic_load(&sWordCallbacks);
+
+		do {
+			RoundResult result;
+			if (RunRound(&voice, text, soakChannels, &result) != noErr) {
+				break;
+			}
+			if (result.finished < result.requested) {
+				incompleteCycles++;
+			}
+			resident = result.residentAfter;
+			DisposeRound(&result);
+			if (resident > peakResident) {
+				peakResident = resident;
+			}
+			now = CFAbsoluteTimeGetCurrent();
+			if (++cycles == kSoakWarmUpCycles) {
+				baselineResident = resident;
+				baselineTime = now;
+			}
+		} while (now < soakEnd);
+		if (cycles > kSoakWarmUpCycles && now > baselineTime) {
+			growth = ((double)resident - (double)baselineResident) * 3600.0 / (now - baselineTime);
+		}
+
+		fprintf(file, ",\n\t\"soak\": {\n\t\t\"hours\": %g,\n\t\t\"channels\": %u,\n\t\t\"cycles\": %u,\n\t\t\"incompleteCycles\": %u,\n\t\t\"wordCallbacks\": %lu,\n",
+				soakHours, soakChannels, cycles, incompleteCycles, atomic_load(&sWordCallbacks) - wordsBefore);
+		fprintf(file, "\t\t\"residentStart\": %llu,\n\t\t\"residentAfterWarmUp\": %llu,\n\t\t\"residentEnd\": %llu,\n\t\t\"residentPeak\": %llu,\n",
+				(unsigned long long)startResident, (unsigned long long)baselineResident, (unsigned long long)resident, (unsigned long long)peakResident);
+		fprintf(file, "\t\t\"residentGrowthPerHour\": %.0f,\n\t\t\"leakSuspected\": %s\n\t}", growth, (growth > leakThreshold) ? "true" : "false");
+	}
+	fprintf(file, "\n}\n");
+
+	CFRelease(text);
+	if (file != stdout && fclose(file) != 0) {
+		fprintf(stderr, "%s: couldn't write %s (%s)\n", argv[0], outputPath, strerror(errno));
+		return 1;
+	}
+	return 0;
+}
+
+static long FindVoice(OSType synthesizer, VoiceSpec * voice)
+{
+	short voiceCount, index;
+	long error = CountVoices(&voiceCount);
+
+	for (index = 1; error == noErr && index <= voiceCount; index++) {
+		error = GetIndVoice(index, voice);
+		if (error == noErr && voice->creator == synthesizer) {
+			return noErr;
+		}
+	}
+	return (error == noErr) ? voiceNotFound : error;
+}
+
+static long RunRound(const VoiceSpec * voice, CFStringRef text, uint32_t channelCount, RoundResult * result)
+{
+	BenchChannel * channels = (BenchChannel *)calloc(channelCount, sizeof(BenchChannel));
+	uint64_t histogram[kSynthEngineLatenessBuckets], deadlineMisses = 0;
+	double speakStart, deadline, cpuStart, callStart;
+	uint32_t index, bucket, pending;
+	long error;
+
+	memset(result, 0, sizeof(RoundResult));
+	result->requested = channelCount;
+	result->openLatencies = (double *)calloc(channelCount, sizeof(double));
+	result->closeLatencies = (double *)calloc(channelCount, sizeof(double));
+	if (channels == NULL || result->openLatencies == NULL || result->closeLatencies == NULL) {
+		free(channels);
+		DisposeRound(result);
+		return memFullErr;
+	}
+
+	// Open until there are enough or the engine turns us away.
+	result->residentBefore = ResidentBytes();
+	for (index = 0; index < channelCount; index++) {
+		BenchChannel * channel = &channels[result->opened];
+		callStart = CFAbsoluteTimeGetCurrent();
+		error = NewSpeechChannel((VoiceSpec *)voice, &channel->channel);
+		if (error == synthOpenFailed) {
+			result->openFailures++;
+			continue;
+		}
+		else if (error != noErr) {
+			result->otherOpenError = error;
+			continue;
+		}
+		result->openLatencies[result->opened++] = CFAbsoluteTimeGetCurrent() - callStart;
+		atomic_init(&channel->state, 0);
+		SetSpeechInfo(channel->channel, soRefCon, (Ptr)channel);
+		SetSpeechInfo(channel->channel, soSpeechDoneCallBack, BenchSpeechDoneProc);
+		SetSpeechInfo(channel->channel, soWordCallBack, BenchWordProc);
+	}
+	result->residentOpen = ResidentBytes();
+
+	// Speak on all of them at once.  The engine's lateness counters cover its scheduler as a whole, not any one channel's
+	// callbacks, so any channel will do to read them.
+	if (result->opened > 0) {
+		result->haveLateness = CopyLateness(channels[0].channel, histogram, &deadlineMisses);
+	}
+	cpuStart = CPUSeconds();
+	speakStart = CFAbsoluteTimeGetCurrent();
+	for (index = 0; index < result->opened; index++) {
+		channels[index].startTime = CFAbsoluteTimeGetCurrent();
+		if (SpeakCFString(channels[index].channel, text, NULL) != noErr) {
+			atomic_store_explicit(&channels[index].state, 2, memory_order_relaxed);
+		}
+	}
+	deadline = speakStart + 10.0 + CFStringGetLength(text) * kSecondsPerCharacter;
+	do {
+		for (pending = 0, index = 0; index < result->opened; index++) {
+			if (atomic_load_explicit(&channels[index].state, memory_order_acquire) == 0) {
+				pending++;
+			}
+		}
+		if (pending > 0) {
+			CFRunLoopRunInMode(kCFRunLoopDefaultMode, kPollInterval, false);
+		}
+	} while (pending > 0 && CFAbsoluteTimeGetCurrent() < deadline);
+	result->wallSeconds = CFAbsoluteTimeGetCurrent() - speakStart;
+	result->cpuSeconds = CPUSeconds() - cpuStart;
+	result->residentSpeaking = ResidentBytes();
+	for (index = 0; index < result->opened; index++) {
+		if (atomic_load_explicit(&channels[index].state, memory_order_acquire) == 1) {
+			result->finished++;
+			result->audioSeconds += channels[index].doneTime - channels[index].startTime;
+		}
+	}
+	if (result->haveLateness) {
+		uint64_t before[kSynthEngineLatenessBuckets];
+		uint64_t missesBefore = deadlineMisses;
+		memcpy(before, histogram, sizeof(before));
+		result->haveLateness = CopyLateness(channels[0].channel, histogram, &deadlineMisses);
+		for (bucket = 0; bucket < kSynthEngineLatenessBuckets; bucket++) {
+			result->latenessHistogram[bucket] = histogram[bucket] - before[bucket];
+		}
+		result->deadlineMisses = deadlineMisses - missesBefore;
+	}
+
+	for (index = 0; index < result->opened; index++) {
+		callStart = CFAbsoluteTimeGetCurrent();
+		DisposeSpeechChannel(channels[index].channel);
+		result->closeLatencies[index] = CFAbsoluteTimeGetCurrent() - callStart;
+	}
+	result->residentAfter = ResidentBytes();
+
+	// Disposing of a channel makes any callbacks it still owed, one that never finished included, before returning.
+	free(channels);
+	return noErr;
+}
+
+static void DisposeRound(RoundResult * result)
+{
+	free(result->openLatencies);
+	free(result->closeLatencies);
+	result->openLatencies = NULL;
+	result->closeLatencies = NULL;
+}
+
+static Boolean CopyLateness(SpeechChannel channel, uint64_t histogram[kSynthEngineLatenessBuckets], uint64_t * deadlineMisses)
+{
+	CFDictionaryRef statistics = NULL;
+	CFArrayRef buckets;
+	CFNumberRef number;
+	CFIndex index;
+	Boolean found = false;
+
+	// Only this engine keeps them, and only the CF-based property calls can fetch a dictionary.
+	if (CopySpeechProperty(channel, kSynthEngineDeadlineStatisticsProperty, (CFTypeRef *)&statistics) != noErr || statistics == NULL) {
+		return false;
+	}
+	if (CFGetTypeID(statistics) == CFDictionaryGetTypeID()) {
+		buckets = (CFArrayRef)CFDictionaryGetValue(statistics, kSynthEngineInteractiveLatenessHistogram);
+		if (buckets && CFGetTypeID(buckets) == CFArrayGetTypeID() && CFArrayGetCount(buckets) == kSynthEngineLatenessBuckets) {
+			for (index = 0; index < kSynthEngineLatenessBuckets; index++) {
+				histogram[index] = 0;
+				if ((number = (CFNumberRef)CFArrayGetValueAtIndex(buckets, index))) {
+					CFNumberGetValue(number, kCFNumberSInt64Type, &histogram[index]);
+				}
+			}
+			*deadlineMisses = 0;
+			if ((number = (CFNumberRef)CFDictionaryGetValue(statistics, kSynthEngineInteractiveDeadlineMisses))) {
+				CFNumberGetValue(number, kCFNumberSInt64Type, deadlineMisses);
+			}
+			found = true;
+		}
+	}
+	CFRelease(statistics);
+	return found;
+}
+
+static void WriteRound(FILE * file, RoundResult * result)
+{
+	fprintf(file, "{\n\t\t\t\"channels\": %u,\n\t\t\t\"opened\": %u,\n\t\t\t\"openFailures\": %u,\n\t\t\t\"otherOpenError\": %ld,\n",
+			result->requested, result->opened, result->openFailures, result->otherOpenError);
+	fprintf(file, "\t\t\t\"openLatency\": ");
+	WritePercentiles(file, result->openLatencies, result->opened);
+	fprintf(file, ",\n\t\t\t\"closeLatency\": ");
+	WritePercentiles(file, result->closeLatencies, result->opened);
+	fprintf(file, ",\n\t\t\t\"residentBytesPerChannel\": %.0f,\n", (result->opened > 0) ? ((double)result->residentOpen - (double)result->residentBefore) / result->opened : 0.0);
+	fprintf(file, "\t\t\t\"residentBefore\": %llu,\n\t\t\t\"residentOpen\": %llu,\n\t\t\t\"residentSpeaking\": %llu,\n\t\t\t\"residentAfterClose\": %llu,\n",
+			(unsigned long long)result->residentBefore, (unsigned long long)result->residentOpen, (unsigned long long)result->residentSpeaking, (unsigned long long)result->residentAfter);
+	fprintf(file, "\t\t\t\"finished\": %u,\n\t\t\t\"wallSeconds\": %.6f,\n\t\t\t\"audioSeconds\": %.6f,\n\t\t\t\"cpuSeconds\": %.6f,\n",
+			result->finished, result->wallSeconds, result->audioSeconds, result->cpuSeconds);
+	if (result->audioSeconds > 0.0) {
+		fprintf(file, "\t\t\t\"cpuSecondsPerAudioSecond\": %.6f,\n", result->cpuSeconds / result->audioSeconds);
+	}
+	else {
+		fprintf(file, "\t\t\t\"cpuSecondsPerAudioSecond\": null,\n");
+	}
+	fprintf(file, "\t\t\t\"schedulerLateness\": ");
+	if (result->haveLateness) {
+		WriteLatencyPercentiles(file, result->latenessHistogram, result->deadlineMisses);
+	}
+	else {
+		fprintf(file, "null");
+	}
+	fprintf(file, "\n\t\t}");
+}
+
+static void WritePercentiles(FILE * file, double * values, uint32_t count)
+{
+	// Nearest rank, in seconds.
+	if (count == 0) {
+		fprintf(file, "null");
+		return;
+	}
+	qsort(values, count, sizeof(double), CompareDoubles);
+	fprintf(file, "{ \"p50\": %.9f, \"p99\": %.9f, \"max\": %.9f }", values[(count * 50 + 99) / 100 - 1], values[(count * 99 + 99) / 100 - 1], values[count - 1]);
+}
+
+static void WriteLatencyPercentiles(FILE * file, const uint64_t histogram[kSynthEngineLatenessBuckets], uint64_t deadlineMisses)
+{
+	static const double fractions[] = { 0.50, 0.99, 0.999 };
+	static const char * names[] = { "p50", "p99", "p999" };
+	uint64_t total = 0, cumulative, rank;
+	uint32_t bucket, index;
+
+	// The engine counts how late its interactive timed jobs ran, on every channel, in power-of-two buckets.  That's how far
+	// its scheduler fell behind, not how long any callback took to reach the client, which can lag further still.
+	// Each percentile is the top of its bucket, so it's rounded up to a power of two microseconds; the last bucket has no top.
+	for (bucket = 0; bucket < kSynthEngineLatenessBuckets; bucket++) {
+		total += histogram[bucket];
+	}
+	fprintf(file, "{ \"jobs\": %llu, \"deadlineMisses\": %llu", (unsigned long long)total, (unsigned long long)deadlineMisses);
+	for (index = 0; index < sizeof(fractions) / sizeof(fractions[0]) && total > 0; index++) {
+		rank = (uint64_t)(fractions[index] * (double)total + 0.999999);
+		for (cumulative = 0, bucket = 0; bucket < kSynthEngineLatenessBuckets - 1; bucket++) {
+			cumulative += histogram[bucket];
+			if (cumulative >= rank) {
+				break;
+			}
+		}
+		if (bucket < kSynthEngineLatenessBuckets - 1) {
+			fprintf(file, ", \"%s\": %.6f", names[index], (double)(1ULL << bucket) * 1.0e-6);
+		}
+		else {
+			fprintf(file, ", \"%s\": null", names[index]);
+		}
+	}
+	fprintf(file, " }");
+}
+
+static void WriteLimit(FILE * file, const char * name, const char * variable)
+{
+	const char * value = getenv(variable);
+
+	if (value) {
+		fprintf(file, "\t\"%s\": %llu,\n", name, strtoull(value, NULL, 10));
+	}
+	else {
+		fprintf(file, "\t\"%s\": null,\n", name);
+	}
+}
+
+static void WriteString(FILE * file, const char * string)
+{
+	fputc('"', file);
+	for (; *string; string++) {
+		unsigned char c = (unsigned char)*string;
+		if (c == '"' || c == '\\') {
+			fprintf(file, "\\%c", c);
+		}
+		else if (c < 0x20) {
+			fprintf(file, "\\u%04x", c);
+		}
+		else {
+			fputc(c, file);
+		}
+	}
+	fputc('"', file);
+}
+
+static double CPUSeconds(void)
+{
+	struct rusage usage;
+
+	getrusage(RUSAGE_SELF, &usage);
+	return (double)usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1.0e-6 + (double)usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1.0e-6;
+}
+
+static uint64_t ResidentBytes(void)
+{
+	struct task_basic_info info;
+	mach_msg_type_number_t count = TASK_BASIC_INFO_COUNT;
+
+	if (task_info(mach_task_self(), TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) {
+		return 0;
+	}
+	return info.resident_size;
+}
+
+static int CompareDoubles(const void * a, const void * b)
+{
+	double difference = *(const double *)a - *(const double *)b;
+	return (difference < 0.0) ? -1 : (difference > 0.0) ? 1 : 0;
+}
+
+static pascal void BenchSpeechDoneProc(SpeechChannel inSpeechChannel, long inRefCon)
+{
+	BenchChannel * channel = (BenchChannel *)inRefCon;
+
+	channel->doneTime = CFAbsoluteTimeGetCurrent();
+	atomic_store_explicit(&channel->state, 1, memory_order_release);
+}
+
+static pascal void BenchWordProc(SpeechChannel inSpeechChannel, long inRefCon, long inWordPos, short inWordLen)
+{
+	atomic_fetch_add_explicit(&sWordCallbacks, 1, memory_order_relaxed);
+}
+
+static void PrintUsage(const char * toolName)
+{
+	fprintf(stderr, "usage: %s [-l levels] [-t text] [-s synthesizer] [-m channels] [-b bytes] [-k hours] [-c channels] [-g bytes] [-o output]\n", toolName);
+	fprintf(stderr, "  -l  comma-separated channel counts to ramp through (default %s)\n", kDefaultLevels);
+	fprintf(stderr, "  -t  text to speak on every channel\n");
+	fprintf(stderr, "  -s  creator of the synthesizer to use, as a number or a four-character code (default %d)\n", kDefaultSynthesizer);
+	fprintf(stderr, "  -m  limit the engine to this many open channels\n");
+	fprintf(stderr, "  -b  limit the engine to this many bytes of resident memory\n");
+	fprintf(stderr, "  -k  after the ramp, soak for this many hours\n");
+	fprintf(stderr, "  -c  channels to open in each soak cycle (default %d)\n", kDefaultSoakChannels);
+	fprintf(stderr, "  -g  resident growth per hour, in bytes, to report as a leak (default %.0f)\n", kDefaultLeakThreshold);
+	fprintf(stderr, "  -o  write the results here instead of to standard output\n");
+}
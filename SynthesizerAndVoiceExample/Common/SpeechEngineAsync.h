@@ -0,0 +1,495 @@
+/*
+	SpeechEngineAsync.h
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: A C++ layer over the engine SPI for clients that keep many utterances
+	in flight.  Speaking returns a Completion handle that can be waited on or
+	co_awaited instead of installing a speech-done callback, and word and phoneme
+	events can be pulled from an EventStream instead of being called back one at
+	a time.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#ifndef __SPEECHENGINEASYNC__
+#define __SPEECHENGINEASYNC__
+
+#include <ApplicationServices/ApplicationServices.h>
+#include "SpeechEngine.h"
+#include "SynthesizerSimulator.h"
+#include "SynthEngineEvents.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#endif
+
+#if ! _SUPPORT_SPEECH_SYNTHESIS_IN_MAC_OS_X_VERSION_10_0_THROUGH_10_4__
+// Both of this project's plug-ins export the stop call, even though SpeechEngine.h only declares it for 10.4 engines.
+extern "C" long SEStopSpeechAt(SpeechChannelIdentifier ssr, unsigned long whereToStop);
+#endif
+
+namespace SynthEngine {
+
+// A pull-style stream of the events posted by every channel attached to it.  One reader thread can
+// follow any number of channels; each event carries its channel and utterance tag.
+class EventStream {
+public:
+	explicit EventStream(uint32_t capacity = 1024) : fQueue(NULL) { fError = SynthEngineEventQueueCreate(capacity, &fQueue); }
+	~EventStream() { SynthEngineEventQueueDispose(fQueue); }
+
+	long							error() const { return fError; }
+	SynthEngineEventQueue *			queue() const { return fQueue; }
+
+	// Returns false right away when there's no event.
+	bool							tryNext(SynthEngineEvent & event) { return fQueue && SynthEngineEventQueueTryNext(fQueue, &event); }
+
+	// Waits up to timeout seconds for an event; a negative timeout waits forever.
+	bool							next(SynthEngineEvent & event, double timeout = -1.0) { return fQueue && SynthEngineEventQueueWaitNext(fQueue, &event, timeout); }
+
+	// Events the engine had to drop because the reader fell behind.
+	uint64_t						droppedCount() const { return (fQueue) ? SynthEngineEventQueueDroppedCount(fQueue) : 0; }
+
+private:
+	EventStream(const EventStream &);
+	EventStream & operator=(const EventStream &);
+
+	SynthEngineEventQueue *			fQueue;
+	long							fError;
+};
+
+#if defined(__cpp_impl_coroutine)
+// Something that runs a function later on a thread of its own choosing, such as a run loop, a dispatch queue or a pool.
+typedef std::function<void (std::function<void ()>)>	Executor;
+#endif
+
+// The outcome of one utterance: noErr when the text was finished, userCanceledErr when it was stopped or
+// replaced, or the error that kept it from starting.  Handles are cheap to copy and all share the same result.
+//
+// An utterance is completed on the thread that ends it: an engine worker when the text runs out, or the thread
+// whose speak, stop or close call on the channel ended it.  It's never completed with a lock of the engine's or of
+// the AsyncChannel's held, so whatever runs then may call into the channel.  The channel's other callbacks wait
+// for it, though, so it mustn't wait() on another utterance of the same channel.
+class Completion {
+public:
+	Completion() : fState(std::make_shared<State>()) {}
+
+	bool							isReady() const { std::lock_guard<std::mutex> guard(fState->lock); return fState->done; }
+	uint64_t						utteranceTag() const { return fState->tag; }
+
+	// Blocks until the utterance completes and returns its status.
+	long							wait() const
+	{
+		std::unique_lock<std::mutex> guard(fState->lock);
+		fState->changed.wait(guard, [this] { return fState->done; });
+		return fState->status;
+	}
+
+	// Waits up to timeout seconds.  Returns false if the utterance is still going.
+	bool							waitFor(double timeout, long * status = NULL) const
+	{
+		std::unique_lock<std::mutex> guard(fState->lock);
+		if (! fState->changed.wait_for(guard, std::chrono::duration<double>(timeout), [this] { return fState->done; })) {
+			return false;
+		}
+		if (status) {
+			*status = fState->status;
+		}
+		return true;
+	}
+
+#if defined(__cpp_impl_coroutine)
+	// co_await resumes the coroutine right on the thread that completed the utterance, so a handful of threads can
+	// drive any number of utterances.  Keep the work done there short.
+	bool							await_ready() const { return isReady(); }
+	bool							await_suspend(std::coroutine_handle<> waiter) { return Suspend(waiter, Executor()); }
+	long							await_resume() const { return fState->status; }
+
+	// co_await completion.resumeOn(executor) hands the coroutine to executor instead, once the utterance completes.
+	// One that has already completed carries on where it is.
+	class ResumeOn;
+	ResumeOn						resumeOn(const Executor & executor) const;
+#endif
+
+private:
+	friend class AsyncChannel;
+
+	struct State {
+		State() : tag(0), status(noErr), done(false) {}
+
+		std::mutex					lock;
+		std::condition_variable		changed;
+		uint64_t					tag;
+		long						status;
+		bool						done;
+#if defined(__cpp_impl_coroutine)
+		std::coroutine_handle<>		waiter;
+		Executor					executor;
+#endif
+	};
+
+#if defined(__cpp_impl_coroutine)
+	bool							Suspend(std::coroutine_handle<> waiter, const Executor & executor) const
+	{
+		std::lock_guard<std::mutex> guard(fState->lock);
+		if (fState->done) {
+			return false;
+		}
+		fState->waiter = waiter;
+		fState->executor = executor;
+		return true;
+	}
+#endif
+
+	// Only the first call has any effect.
+	void							complete(long status)
+	{
+#if defined(__cpp_impl_coroutine)
+		std::coroutine_handle<> waiter;
+		Executor executor;
+#endif
+		{
+			std::lock_guard<std::mutex> guard(fState->lock);
+			if (fState->done) {
+				return;
+			}
+			fState->status = status;
+			fState->done = true;
+#if defined(__cpp_impl_coroutine)
+			waiter = fState->waiter;
+			fState->waiter = std::coroutine_handle<>();
+			executor.swap(fState->executor);
+#endif
+		}
+		fState->changed.notify_all();
+#if defined(__cpp_impl_coroutine)
+		if (waiter && executor) {
+			executor([waiter] { waiter.resume(); });
+		}
+		else if (waiter) {
+			waiter.resume();
+		}
+#endif
+	}
+
+	std::shared_ptr<State>			fState;
+};
+
+#if defined(__cpp_impl_coroutine)
+class Completion::ResumeOn {
+public:
+	ResumeOn(const Completion & completion, const Executor & executor) : fCompletion(completion), fExecutor(executor) {}
+
+	bool							await_ready() const { return fCompletion.isReady(); }
+	bool							await_suspend(std::coroutine_handle<> waiter) { return fCompletion.Suspend(waiter, fExecutor); }
+	long							await_resume() const { return fCompletion.fState->status; }
+
+private:
+	Completion						fCompletion;
+	Executor						fExecutor;
+};
+
+inline Completion::ResumeOn		Completion::resumeOn(const Executor & executor) const { return ResumeOn(*this, executor); }
+#endif
+
+// A speech channel whose utterances complete through Completion handles.  The channel owns its refCon and
+// completion callback; the other callbacks and properties are still available through setProperty.
+class AsyncChannel {
+public:
+	AsyncChannel() : fChannel(0), fNextTag(0)
+	{
+		fError = SEOpenSpeechChannel(&fChannel);
+		if (fError == noErr) {
+			fError = SetLongProperty(kSpeechRefConProperty, (long)this);
+		}
+		if (fError == noErr) {
+			fError = SetLongProperty(kSynthEngineCompletionCallBack, (long)&AsyncChannel::CompletionProc);
+		}
+	}
+
+	~AsyncChannel()
+	{
+		if (fChannel) {
+			// Closing stops the channel, which completes its utterance while we're still here to receive it.
+			SECloseSpeechChannel(fChannel);
+		}
+		CancelPending(userCanceledErr);
+	}
+
+	long							error() const { return fError; }
+	SpeechChannelIdentifier			identifier() const { return fChannel; }
+
+	// Starts speaking text, replacing (and canceling) anything the channel is already saying.
+	Completion						speak(CFStringRef text, CFDictionaryRef options = NULL)
+	{
+		Completion completion;
+		SpeakScope speakScope(*this);
+
+		long error = fError;
+		if (error == noErr) {
+			uint64_t tag = ++fNextTag;
+			completion.fState->tag = tag;
+			{
+				std::lock_guard<std::mutex> guard(fPendingLock);
+				fPending[tag] = completion;
+			}
+
+			// The tag must be set before speaking so the engine attaches it to this utterance.  The engine
+			// may complete the previous utterance from inside the speak call, so fPendingLock isn't held here.
+			CFNumberRef tagAsCFNumber = CFNumberCreate(NULL, kCFNumberSInt64Type, &tag);
+			error = memFullErr;
+			if (tagAsCFNumber) {
+				error = SESetSpeechProperty(fChannel, kSynthEngineUtteranceTagProperty, tagAsCFNumber);
+				CFRelease(tagAsCFNumber);
+			}
+			if (error == noErr) {
+				error = SESpeakCFString(fChannel, text, options);
+			}
+			if (error != noErr) {
+				std::lock_guard<std::mutex> guard(fPendingLock);
+				fPending.erase(tag);
+			}
+		}
+		if (error != noErr) {
+			completion.complete(error);
+		}
+		return completion;
+	}
+
+	// Queues text to follow whatever the channel is saying, joined to it without a gap, with properties of its own
+	// set as it starts.  The completion is for this utterance alone, and is canceled if it's dropped before it starts.
+	Completion						enqueue(CFStringRef text, CFDictionaryRef properties = NULL)
+	{
+		Completion completion;
+		SpeakScope speakScope(*this);
+		long error = fError;
+		if (error == noErr) {
+			uint64_t tag = ++fNextTag;
+			completion.fState->tag = tag;
+			{
+				std::lock_guard<std::mutex> guard(fPendingLock);
+				fPending[tag] = completion;
+			}
+
+			// The utterance carries its tag in its own properties.  The channel's refCon has to stay ours.
+			error = memFullErr;
+			CFMutableDictionaryRef queuedProperties = (properties) ? CFDictionaryCreateMutableCopy(NULL, 0, properties) : CFDictionaryCreateMutable(NULL, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+			CFNumberRef tagAsCFNumber = CFNumberCreate(NULL, kCFNumberSInt64Type, &tag);
+			if (queuedProperties && tagAsCFNumber) {
+				CFDictionaryRemoveValue(queuedProperties, kSpeechRefConProperty);
+				CFDictionarySetValue(queuedProperties, kSynthEngineUtteranceTagProperty, tagAsCFNumber);
+				const void * keys[] = { kSynthEngineQueuedText, kSynthEngineQueuedProperties };
+				const void * values[] = { text, queuedProperties };
+				CFDictionaryRef description = CFDictionaryCreate(NULL, keys, values, 2, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+				if (description) {
+					error = SESetSpeechProperty(fChannel, kSynthEngineEnqueueUtteranceProperty, description);
+					CFRelease(description);
+				}
+			}
+			if (tagAsCFNumber) {
+				CFRelease(tagAsCFNumber);
+			}
+			if (queuedProperties) {
+				CFRelease(queuedProperties);
+			}
+			if (error != noErr) {
+				std::lock_guard<std::mutex> guard(fPendingLock);
+				fPending.erase(tag);
+			}
+		}
+		if (error != noErr) {
+			completion.complete(error);
+		}
+		return completion;
+	}
+
+	// Drops a queued utterance before it starts.  One that's already being spoken is left alone; stop that instead.
+	long							cancel(const Completion & completion)
+	{
+		uint64_t tag = completion.utteranceTag();
+		long error = memFullErr;
+		CFNumberRef tagAsCFNumber = CFNumberCreate(NULL, kCFNumberSInt64Type, &tag);
+		if (tagAsCFNumber) {
+			error = (fError == noErr) ? SESetSpeechProperty(fChannel, kSynthEngineCancelQueuedProperty, tagAsCFNumber) : fError;
+			CFRelease(tagAsCFNumber);
+		}
+		return error;
+	}
+
+	// Drops everything queued behind the utterance being spoken.
+	long							flushQueue() { return (fError == noErr) ? SESetSpeechProperty(fChannel, kSynthEngineFlushQueueProperty, kCFBooleanTrue) : fError; }
+
+	// Stops at the given boundary.  An immediate stop completes the current utterance before returning.
+	long							stop(unsigned long whereToStop = kImmediate)
+	{
+		SpeakScope speakScope(*this);
+		long error = (fError == noErr) ? SEStopSpeechAt(fChannel, whereToStop) : fError;
+		if (error == noErr && whereToStop == kImmediate) {
+			CancelPending(userCanceledErr);
+		}
+		return error;
+	}
+
+	// Attaches the channel to stream, or detaches it when stream is NULL.
+	long							useEventStream(EventStream * stream) { return SetLongProperty(kSynthEngineEventQueueProperty, (stream) ? (long)stream->queue() : 0); }
+
+	long							useVoice(VoiceSpec * voice, CFBundleRef voiceBundle) { return (fError == noErr) ? SEUseVoice(fChannel, voice, voiceBundle) : fError; }
+	long							setProperty(CFStringRef property, CFTypeRef object) { return (fError == noErr) ? SESetSpeechProperty(fChannel, property, object) : fError; }
+	long							copyProperty(CFStringRef property, CFTypeRef * object) { return (fError == noErr) ? SECopySpeechProperty(fChannel, property, object) : fError; }
+
+private:
+	AsyncChannel(const AsyncChannel &);
+	AsyncChannel & operator=(const AsyncChannel &);
+
+	// Holds fSpeakLock through a call into the engine.  The engine may complete an utterance from inside the call, on
+	// this thread; that completion is put off until the lock has been let go, so a coroutine it resumes can speak again.
+	class SpeakScope {
+	public:
+		explicit SpeakScope(AsyncChannel & channel) : fChannel(channel), fOuter(Current())
+		{
+			fChannel.fSpeakLock.lock();
+			Current() = this;
+		}
+		~SpeakScope()
+		{
+			Current() = fOuter;
+			fChannel.fSpeakLock.unlock();
+			for (std::vector<std::pair<Completion, long> >::iterator i = fDeferred.begin(); i != fDeferred.end(); ++i) {
+				i->first.complete(i->second);
+			}
+		}
+
+		// Puts off completion if this thread is in a call into channel.  Returns false if it isn't.
+		static bool					Defer(AsyncChannel * channel, const Completion & completion, long status)
+		{
+			for (SpeakScope * scope = Current(); scope; scope = scope->fOuter) {
+				if (&scope->fChannel == channel) {
+					scope->fDeferred.push_back(std::make_pair(completion, status));
+					return true;
+				}
+			}
+			return false;
+		}
+
+	private:
+		SpeakScope(const SpeakScope &);
+		SpeakScope & operator=(const SpeakScope &);
+
+		static SpeakScope *&		Current() { static thread_local SpeakScope * current = NULL; return current; }
+
+		AsyncChannel &				fChannel;
+		SpeakScope *				fOuter;
+		std::vector<std::pair<Completion, long> >	fDeferred;
+	};
+
+	long							SetLongProperty(CFStringRef property, long value)
+	{
+		long error = memFullErr;
+		if (fChannel == 0) {
+			error = fError;
+		}
+		else if (value == 0) {
+			error = SESetSpeechProperty(fChannel, property, NULL);
+		}
+		else {
+			CFNumberRef valueAsCFNumber = CFNumberCreate(NULL, kCFNumberLongType, &value);
+			if (valueAsCFNumber) {
+				error = SESetSpeechProperty(fChannel, property, valueAsCFNumber);
+				CFRelease(valueAsCFNumber);
+			}
+		}
+		return error;
+	}
+
+	void							Complete(uint64_t tag, long status)
+	{
+		Completion completion;
+		{
+			std::lock_guard<std::mutex> guard(fPendingLock);
+			std::map<uint64_t, Completion>::iterator found = fPending.find(tag);
+			if (found == fPending.end()) {
+				return;
+			}
+			completion = found->second;
+			fPending.erase(found);
+		}
+		if (! SpeakScope::Defer(this, completion, status)) {
+			completion.complete(status);
+		}
+	}
+
+	void							CancelPending(long status)
+	{
+		std::map<uint64_t, Completion> pending;
+		{
+			std::lock_guard<std::mutex> guard(fPendingLock);
+			pending.swap(fPending);
+		}
+		for (std::map<uint64_t, Completion>::iterator i = pending.begin(); i != pending.end(); ++i) {
+			if (! SpeakScope::Defer(this, i->second, status)) {
+				i->second.complete(status);
+			}
+		}
+	}
+
+	static void						CompletionProc(SpeechChannel chan, SRefCon refCon, uint64_t utteranceTag, long status)
+	{
+		(void)chan;
+		reinterpret_cast<AsyncChannel *>(refCon)->Complete(utteranceTag, status);
+	}
+
+	SpeechChannelIdentifier			fChannel;
+	long							fError;
+	uint64_t						fNextTag;
+	std::mutex						fSpeakLock;
+	std::mutex						fPendingLock;
+	std::map<uint64_t, Completion>	fPending;
+};
+
+}	// namespace SynthEngine
+
+#endif
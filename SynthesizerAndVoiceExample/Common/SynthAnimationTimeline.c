@@ -0,0 +1,251 @@
+/*
+	SynthAnimationTimeline.c
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Viseme timeline for speaking characters.  See SynthAnimationTimeline.h.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include "SynthAnimationTimeline.h"
+
+typedef struct VisemeKey {
+	double			time;
+	SynthViseme		viseme;
+} VisemeKey;
+
+// Same slot protocol as the engine event queue: a slot's sequence equals the position when
+// it's free for the producer at that position, position + 1 when it holds that key.
+typedef struct KeySlot {
+	atomic_size_t	sequence;
+	VisemeKey		key;
+} KeySlot;
+
+struct SynthAnimationTimeline {
+	KeySlot *		slots;
+	size_t			mask;
+	atomic_size_t	enqueuePosition;
+	atomic_size_t	dequeuePosition;
+	atomic_int		restingViseme;
+	double			holdTime;
+
+	// Owned by the sampling thread.
+	Boolean			hasKey;				// lastKey holds the latest key that has come due.
+	VisemeKey		lastKey;
+	SynthViseme		shownViseme;
+	SynthViseme		shownResting;
+	double			shownStartTime;
+};
+
+SynthViseme SynthAnimationVisemeForPhoneme(short phonemeOpcode)
+{
+	if (phonemeOpcode == 0 || phonemeOpcode == 1) {
+		return kSynthVisemeIdle;
+	}
+	if (phonemeOpcode >= 2 && phonemeOpcode <= 17) {
+		return kSynthVisemeVowel;
+	}
+	return kSynthVisemeConsonant;
+}
+
+long SynthAnimationTimelineCreate(uint32_t capacity, double holdTime, SynthAnimationTimeline ** outTimeline)
+{
+	SynthAnimationTimeline * timeline;
+	size_t slotCount = 2;
+	size_t slotIndex;
+
+	if (outTimeline == NULL || capacity == 0 || holdTime < 0.0) {
+		return paramErr;
+	}
+	while (slotCount < capacity) {
+		slotCount <<= 1;
+	}
+
+	timeline = (SynthAnimationTimeline *)calloc(1, sizeof(SynthAnimationTimeline));
+	if (timeline == NULL) {
+		return memFullErr;
+	}
+	timeline->slots = (KeySlot *)calloc(slotCount, sizeof(KeySlot));
+	if (timeline->slots == NULL) {
+		free(timeline);
+		return memFullErr;
+	}
+
+	timeline->mask = slotCount - 1;
+	for (slotIndex = 0; slotIndex < slotCount; slotIndex++) {
+		atomic_init(&timeline->slots[slotIndex].sequence, slotIndex);
+	}
+	atomic_init(&timeline->enqueuePosition, 0);
+	atomic_init(&timeline->dequeuePosition, 0);
+	atomic_init(&timeline->restingViseme, kSynthVisemeIdle);
+	timeline->holdTime = holdTime;
+	timeline->shownViseme = kSynthVisemeIdle;
+	timeline->shownResting = kSynthVisemeIdle;
+
+	*outTimeline = timeline;
+	return noErr;
+}
+
+void SynthAnimationTimelineDispose(SynthAnimationTimeline * timeline)
+{
+	if (timeline) {
+		free(timeline->slots);
+		free(timeline);
+	}
+}
+
+long SynthAnimationTimelineAddViseme(SynthAnimationTimeline * timeline, double time, SynthViseme viseme)
+{
+	size_t position;
+	KeySlot * slot;
+
+	if (timeline == NULL || (unsigned)viseme >= kSynthVisemeCount) {
+		return paramErr;
+	}
+
+	position = atomic_load_explicit(&timeline->enqueuePosition, memory_order_relaxed);
+	for (;;) {
+		size_t sequence;
+		slot = &timeline->slots[position & timeline->mask];
+		sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+		if (sequence == position) {
+			if (atomic_compare_exchange_weak_explicit(&timeline->enqueuePosition, &position, position + 1, memory_order_relaxed, memory_order_relaxed)) {
+				break;
+			}
+		}
+		else if (sequence < position) {
+			return bufTooSmall;
+		}
+		else {
+			position = atomic_load_explicit(&timeline->enqueuePosition, memory_order_relaxed);
+		}
+	}
+
+	slot->key.time = time;
+	slot->key.viseme = viseme;
+	atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+	return noErr;
+}
+
+long SynthAnimationTimelineAddPhoneme(SynthAnimationTimeline * timeline, double time, short phonemeOpcode)
+{
+	return SynthAnimationTimelineAddViseme(timeline, time, SynthAnimationVisemeForPhoneme(phonemeOpcode));
+}
+
+long SynthAnimationTimelineAddEngineEvent(SynthAnimationTimeline * timeline, const SynthEngineEvent * event, double utteranceStartTime)
+{
+	double time;
+
+	if (event == NULL) {
+		return paramErr;
+	}
+
+	time = utteranceStartTime + SynthEngineSamplesToSeconds(event->samplePosition);
+	switch (event->kind) {
+		case kSynthEnginePhonemeEvent:
+			return SynthAnimationTimelineAddPhoneme(timeline, time, (short)event->code);
+		case kSynthEngineSpeechDoneEvent:
+			return SynthAnimationTimelineAddViseme(timeline, time, kSynthVisemeIdle);
+		default:
+			return noErr;
+	}
+}
+
+void SynthAnimationTimelineSetRestingViseme(SynthAnimationTimeline * timeline, SynthViseme viseme)
+{
+	if (timeline && (unsigned)viseme < kSynthVisemeCount) {
+		atomic_store_explicit(&timeline->restingViseme, viseme, memory_order_relaxed);
+	}
+}
+
+SynthViseme SynthAnimationTimelineSample(SynthAnimationTimeline * timeline, double time, double * outStartTime)
+{
+	SynthViseme resting = (SynthViseme)atomic_load_explicit(&timeline->restingViseme, memory_order_relaxed);
+	SynthViseme viseme = resting;
+	double startTime = time;
+
+	// Consume the keys that have come due, leaving later ones in place.  Only the latest
+	// matters, so a burst of phonemes between two refreshes costs one pass here and no
+	// redraws beyond the one this refresh makes anyway.
+	for (;;) {
+		size_t position = atomic_load_explicit(&timeline->dequeuePosition, memory_order_relaxed);
+		KeySlot * slot = &timeline->slots[position & timeline->mask];
+
+		if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != position + 1 || slot->key.time > time) {
+			break;
+		}
+		timeline->lastKey = slot->key;
+		timeline->hasKey = true;
+		atomic_store_explicit(&timeline->dequeuePosition, position + 1, memory_order_relaxed);
+		atomic_store_explicit(&slot->sequence, position + timeline->mask + 1, memory_order_release);
+	}
+
+	if (timeline->hasKey && timeline->lastKey.viseme != kSynthVisemeIdle) {
+		if (time < timeline->lastKey.time + timeline->holdTime) {
+			viseme = timeline->lastKey.viseme;
+			startTime = timeline->lastKey.time;
+		}
+		else {
+			startTime = timeline->lastKey.time + timeline->holdTime;
+		}
+	}
+	else if (timeline->hasKey) {
+		startTime = timeline->lastKey.time;
+	}
+
+	// A shape that carries on keeps its original start, so multi-frame expressions don't
+	// restart on every refresh or on a repeated key.  A change of resting shape counts as
+	// a new start.
+	if (viseme == timeline->shownViseme && (viseme != resting || resting == timeline->shownResting)) {
+		startTime = timeline->shownStartTime;
+	}
+	else if (viseme == resting && resting != timeline->shownResting) {
+		startTime = time;
+	}
+	timeline->shownViseme = viseme;
+	timeline->shownResting = resting;
+	timeline->shownStartTime = startTime;
+
+	if (outStartTime) {
+		*outStartTime = startTime;
+	}
+	return viseme;
+}
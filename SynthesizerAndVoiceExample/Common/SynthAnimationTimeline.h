@@ -0,0 +1,105 @@
+/*
+	SynthAnimationTimeline.h
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Plans a speaking character's mouth shapes from a stream of timestamped
+	phonemes.  Producers add a key per phoneme, from any thread and ahead of time if
+	the audio position is known; the display samples the timeline once per refresh
+	and gets the shape to show then.  Nothing here depends on a run loop or a window,
+	so the timeline can be driven and checked from plain C.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#ifndef __SYNTHANIMATIONTIMELINE__
+#define __SYNTHANIMATIONTIMELINE__
+
+#include "SynthEngineEvents.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum SynthViseme {
+	kSynthVisemeSleep		= 0,
+	kSynthVisemeIdle		= 1,		// Mouth at rest between words.
+	kSynthVisemeConsonant	= 2,
+	kSynthVisemeVowel		= 3
+} SynthViseme;
+
+#define kSynthVisemeCount	4
+
+typedef struct SynthAnimationTimeline SynthAnimationTimeline;
+
+// Returns the mouth shape for a Macintalk phoneme opcode: silence and breath rest the
+// mouth, the vowels open it and everything else closes it.
+SynthViseme	SynthAnimationVisemeForPhoneme(short phonemeOpcode);
+
+// capacity is the number of keys that may be waiting to be shown, rounded up to a power of
+// two.  A consonant or vowel is held for holdTime seconds after its key unless another key
+// replaces it, then the timeline returns to its resting shape.
+long		SynthAnimationTimelineCreate(uint32_t capacity, double holdTime, SynthAnimationTimeline ** outTimeline);
+void		SynthAnimationTimelineDispose(SynthAnimationTimeline * timeline);
+
+// Adds a key that shows viseme from time onward.  Times are seconds on whatever clock the
+// caller samples with, and keys from one producer must be added in time order.  Safe to
+// call from any thread without blocking; when the timeline is full the key is dropped and
+// bufTooSmall is returned.
+long		SynthAnimationTimelineAddViseme(SynthAnimationTimeline * timeline, double time, SynthViseme viseme);
+long		SynthAnimationTimelineAddPhoneme(SynthAnimationTimeline * timeline, double time, short phonemeOpcode);
+
+// Adds a key for a phoneme or speech done event from the engine, placed at
+// utteranceStartTime plus the event's sample position.  Other events are ignored.
+long		SynthAnimationTimelineAddEngineEvent(SynthAnimationTimeline * timeline, const SynthEngineEvent * event, double utteranceStartTime);
+
+// Sets the shape shown while no consonant or vowel is held, normally kSynthVisemeIdle or
+// kSynthVisemeSleep.  Safe to call from any thread.
+void		SynthAnimationTimelineSetRestingViseme(SynthAnimationTimeline * timeline, SynthViseme viseme);
+
+// Returns the shape to show at time, consuming every key at or before it; keys after time
+// stay planned.  outStartTime, if not NULL, receives the time the returned shape began, so
+// multi-frame expressions can be stepped from it.  Only one thread may sample a timeline,
+// with non-decreasing times.
+SynthViseme	SynthAnimationTimelineSample(SynthAnimationTimeline * timeline, double time, double * outStartTime);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
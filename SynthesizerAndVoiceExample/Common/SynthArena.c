@@ -0,0 +1,316 @@
+/*
+	SynthArena.c
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Scratch memory for the speak path: an arena that hands out memory by bumping
+	a pointer and is reset between utterances, and a pool of fixed-size blocks that can be
+	returned from any thread.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include "SynthArena.h"
+
+// Every allocation starts on a boundary good enough for any type the engine uses, including vectors.
+#define kArenaAlignment			16
+#define kMinimumChunkBytes		4096
+
+#define AlignSize(size)			(((size) + kArenaAlignment - 1) & ~(size_t)(kArenaAlignment - 1))
+
+typedef struct ArenaChunk {
+	struct ArenaChunk *	next;
+	size_t				capacity;
+} ArenaChunk;
+
+// The chunk's memory follows its header, which is padded out to the alignment.
+#define kChunkHeaderBytes		AlignSize(sizeof(ArenaChunk))
+#define ChunkBytes(chunk)		((uint8_t *)(chunk) + kChunkHeaderBytes)
+
+struct SynthArena {
+	ArenaChunk *	first;
+	ArenaChunk *	current;
+	size_t			used;				// Bytes handed out from the current chunk.
+};
+
+typedef struct PoolBlock {
+	struct PoolBlock *	next;
+} PoolBlock;
+
+typedef struct PoolSlab {
+	struct PoolSlab *	next;
+} PoolSlab;
+
+struct SynthBlockPool {
+	_Atomic(PoolBlock *)	freeBlocks;
+	PoolSlab *				slabs;				// Only changed by the thread taking blocks.
+	size_t					blockBytes;
+	uint32_t				blocksPerSlab;
+};
+
+static ArenaChunk *	NewChunk(size_t capacity);
+
+long SynthArenaCreate(size_t initialBytes, SynthArena ** outArena)
+{
+	SynthArena * arena;
+
+	if (outArena == NULL) {
+		return paramErr;
+	}
+	*outArena = NULL;
+	arena = (SynthArena *)calloc(1, sizeof(SynthArena));
+	if (arena == NULL) {
+		return memFullErr;
+	}
+	arena->first = NewChunk((initialBytes > kMinimumChunkBytes) ? AlignSize(initialBytes) : kMinimumChunkBytes);
+	if (arena->first == NULL) {
+		free(arena);
+		return memFullErr;
+	}
+	arena->current = arena->first;
+	*outArena = arena;
+	return noErr;
+}
+
+void SynthArenaDispose(SynthArena * arena)
+{
+	ArenaChunk * chunk;
+
+	if (arena) {
+		while ((chunk = arena->first)) {
+			arena->first = chunk->next;
+			free(chunk);
+		}
+		free(arena);
+	}
+}
+
+void * SynthArenaAlloc(SynthArena * arena, size_t byteCount)
+{
+	ArenaChunk * chunk = arena->current;
+	size_t size;
+
+	if (byteCount > SIZE_MAX / 2) {
+		return NULL;
+	}
+	size = AlignSize(byteCount ? byteCount : 1);
+	if (arena->used + size <= chunk->capacity) {
+		arena->used += size;
+		return ChunkBytes(chunk) + arena->used - size;
+	}
+
+	// Move on to the chunk after this one, left from before a rewind or reset, if it's big enough.  Otherwise put a
+	// new one in front of it, twice the size of this one so a long utterance needs only a few.
+	if (chunk->next == NULL || chunk->next->capacity < size) {
+		ArenaChunk * newChunk = NewChunk((size > chunk->capacity * 2) ? size : chunk->capacity * 2);
+		if (newChunk == NULL) {
+			return NULL;
+		}
+		newChunk->next = chunk->next;
+		chunk->next = newChunk;
+	}
+	arena->current = chunk->next;
+	arena->used = size;
+	return ChunkBytes(arena->current);
+}
+
+void * SynthArenaCalloc(SynthArena * arena, size_t count, size_t size)
+{
+	void * bytes;
+
+	if (size && count > SIZE_MAX / size) {
+		return NULL;
+	}
+	bytes = SynthArenaAlloc(arena, count * size);
+	if (bytes) {
+		memset(bytes, 0, count * size);
+	}
+	return bytes;
+}
+
+SynthArenaMark SynthArenaGetMark(const SynthArena * arena)
+{
+	SynthArenaMark mark;
+
+	mark.chunk = arena->current;
+	mark.used = arena->used;
+	return mark;
+}
+
+void SynthArenaRewind(SynthArena * arena, SynthArenaMark mark)
+{
+	// The chunks after the mark's stay on the list, ready for the next allocation that needs them.
+	arena->current = (ArenaChunk *)mark.chunk;
+	arena->used = mark.used;
+}
+
+void SynthArenaReset(SynthArena * arena)
+{
+	ArenaChunk * chunk;
+	ArenaChunk * combined;
+	size_t totalCapacity = 0;
+
+	// If the last utterance spilled into more than one chunk, trade them for one that holds it all.  Failing that,
+	// keep what there is; it still works, just with a walk along the list.
+	if (arena->first->next) {
+		for (chunk = arena->first; chunk; chunk = chunk->next) {
+			totalCapacity += chunk->capacity;
+		}
+		combined = NewChunk(totalCapacity);
+		if (combined) {
+			while ((chunk = arena->first)) {
+				arena->first = chunk->next;
+				free(chunk);
+			}
+			arena->first = combined;
+		}
+	}
+	arena->current = arena->first;
+	arena->used = 0;
+}
+
+void * SynthScratchAlloc(SynthArena * arena, size_t byteCount)
+{
+	return (arena) ? SynthArenaAlloc(arena, byteCount) : malloc(byteCount ? byteCount : 1);
+}
+
+void * SynthScratchCalloc(SynthArena * arena, size_t count, size_t size)
+{
+	return (arena) ? SynthArenaCalloc(arena, count, size) : calloc(count ? count : 1, size ? size : 1);
+}
+
+void SynthScratchFree(SynthArena * arena, void * bytes)
+{
+	// Memory from an arena goes back when the arena is rewound or reset.
+	if (arena == NULL) {
+		free(bytes);
+	}
+}
+
+long SynthBlockPoolCreate(size_t blockBytes, uint32_t blocksPerSlab, SynthBlockPool ** outPool)
+{
+	SynthBlockPool * pool;
+
+	if (outPool == NULL || blockBytes == 0 || blockBytes > SIZE_MAX / 2 || blocksPerSlab == 0) {
+		return paramErr;
+	}
+	pool = (SynthBlockPool *)calloc(1, sizeof(SynthBlockPool));
+	if (pool == NULL) {
+		*outPool = NULL;
+		return memFullErr;
+	}
+	atomic_init(&pool->freeBlocks, NULL);
+	pool->blockBytes = AlignSize((blockBytes > sizeof(PoolBlock)) ? blockBytes : sizeof(PoolBlock));
+	pool->blocksPerSlab = blocksPerSlab;
+	*outPool = pool;
+	return noErr;
+}
+
+void SynthBlockPoolDispose(SynthBlockPool * pool)
+{
+	PoolSlab * slab;
+
+	if (pool) {
+		while ((slab = pool->slabs)) {
+			pool->slabs = slab->next;
+			free(slab);
+		}
+		free(pool);
+	}
+}
+
+void * SynthBlockPoolGet(SynthBlockPool * pool)
+{
+	PoolBlock * block = atomic_load_explicit(&pool->freeBlocks, memory_order_acquire);
+	PoolSlab * slab;
+	uint8_t * blocks;
+	uint32_t index;
+
+	// Only one thread takes blocks, so the block at the top can't be taken and put back between reading its next
+	// and swapping it off; anything put back meanwhile just makes the swap fail and go round again.
+	while (block && ! atomic_compare_exchange_weak_explicit(&pool->freeBlocks, &block, block->next, memory_order_acquire, memory_order_acquire)) {
+	}
+	if (block) {
+		return block;
+	}
+
+	// The pool's empty, so make another slab, keep its first block and put back the rest.
+	if (pool->blocksPerSlab > (SIZE_MAX - kChunkHeaderBytes) / pool->blockBytes) {
+		return NULL;
+	}
+	slab = (PoolSlab *)malloc(kChunkHeaderBytes + pool->blockBytes * pool->blocksPerSlab);
+	if (slab == NULL) {
+		return NULL;
+	}
+	slab->next = pool->slabs;
+	pool->slabs = slab;
+	blocks = (uint8_t *)slab + kChunkHeaderBytes;
+	for (index = 1; index < pool->blocksPerSlab; index++) {
+		SynthBlockPoolPut(pool, blocks + index * pool->blockBytes);
+	}
+	return blocks;
+}
+
+void SynthBlockPoolPut(SynthBlockPool * pool, void * block)
+{
+	PoolBlock * freeBlock = (PoolBlock *)block;
+
+	if (freeBlock) {
+		freeBlock->next = atomic_load_explicit(&pool->freeBlocks, memory_order_relaxed);
+		while (! atomic_compare_exchange_weak_explicit(&pool->freeBlocks, &freeBlock->next, freeBlock, memory_order_release, memory_order_relaxed)) {
+		}
+	}
+}
+
+static ArenaChunk * NewChunk(size_t capacity)
+{
+	ArenaChunk * chunk;
+
+	if (capacity > SIZE_MAX - kChunkHeaderBytes) {
+		return NULL;
+	}
+	chunk = (ArenaChunk *)malloc(kChunkHeaderBytes + capacity);
+	if (chunk) {
+		chunk->next = NULL;
+		chunk->capacity = capacity;
+	}
+	return chunk;
+}
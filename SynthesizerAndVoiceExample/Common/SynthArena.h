@@ -0,0 +1,100 @@
+/*
+	SynthArena.h
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Scratch memory for the speak path: an arena that hands out memory by bumping
+	a pointer and is reset between utterances, and a pool of fixed-size blocks that can be
+	returned from any thread.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#ifndef __SYNTHARENA__
+#define __SYNTHARENA__
+
+#include <stdlib.h>
+#include "SynthEngineBase.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// An arena is used by one thread at a time.  Its chunks are kept when it's reset, and a reset that finds the last
+// utterance needed more than one chunk replaces them with one big enough for all of it, so once a channel has spoken
+// a long utterance, shorter ones never call malloc at all.
+typedef struct SynthArena SynthArena;
+
+// Where an arena was, so memory used for one step can be given back without giving back what came before it.
+typedef struct SynthArenaMark {
+	void *		chunk;
+	size_t		used;
+} SynthArenaMark;
+
+long		SynthArenaCreate(size_t initialBytes, SynthArena ** outArena);
+void		SynthArenaDispose(SynthArena * arena);
+
+// Memory aligned for any type, or NULL if there's none to be had.  It lasts until the arena is reset or rewound past it.
+void *		SynthArenaAlloc(SynthArena * arena, size_t byteCount);
+void *		SynthArenaCalloc(SynthArena * arena, size_t count, size_t size);
+
+SynthArenaMark	SynthArenaGetMark(const SynthArena * arena);
+void		SynthArenaRewind(SynthArena * arena, SynthArenaMark mark);
+void		SynthArenaReset(SynthArena * arena);
+
+// Scratch memory from an arena if there is one, else from malloc, for code that can run either way.
+void *		SynthScratchAlloc(SynthArena * arena, size_t byteCount);
+void *		SynthScratchCalloc(SynthArena * arena, size_t count, size_t size);
+void		SynthScratchFree(SynthArena * arena, void * bytes);
+
+// A pool of blocks of one size.  Blocks are taken by one thread at a time, which the caller arranges, and may be put
+// back from any thread without a lock.  New blocks are made a slab at a time, and stay with the pool until it's
+// disposed of, by which time every block must have been put back.
+typedef struct SynthBlockPool SynthBlockPool;
+
+long		SynthBlockPoolCreate(size_t blockBytes, uint32_t blocksPerSlab, SynthBlockPool ** outPool);
+void		SynthBlockPoolDispose(SynthBlockPool * pool);
+
+void *		SynthBlockPoolGet(SynthBlockPool * pool);
+void		SynthBlockPoolPut(SynthBlockPool * pool, void * block);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
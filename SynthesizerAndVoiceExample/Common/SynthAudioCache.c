@@ -0,0 +1,759 @@
+/*
+	SynthAudioCache.c
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Two-tier cache of rendered utterances.  See SynthAudioCache.h.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "SynthAudioCache.h"
+
+#define kBlockMagic				0x53415543		// 'SAUC'
+#define kBlockVersion			2
+#define kFileSuffix				".utterance"
+#define kFileNameLength			(16 + sizeof(kFileSuffix) - 1)
+#define kBucketCount			1024
+
+// A rendered utterance is stored as this header followed by its events, word ends, sentence ends and
+// audio, the same way in memory and on disk, so a mapped file can be used in place.
+typedef struct BlockHeader {
+	uint32_t				magic;
+	uint32_t				version;
+	SynthAudioCacheKey		key;
+	uint64_t				totalSamples;
+	uint64_t				audioBytes;
+	uint32_t				audioFormat;
+	uint32_t				eventCount;
+	uint32_t				wordCount;
+	uint32_t				sentenceCount;
+} BlockHeader;
+
+// Memory entries hold the utterance; disk entries only know the hash that names their file until it's mapped.
+typedef struct CacheEntry {
+	struct CacheEntry *			nextInBucket;
+	struct CacheEntry *			newer;
+	struct CacheEntry *			older;
+	uint64_t					keyHash;
+	SynthRenderedUtterance *	utterance;
+	size_t						byteSize;
+} CacheEntry;
+
+typedef struct CacheTier {
+	CacheEntry *				buckets[kBucketCount];
+	CacheEntry *				newest;
+	CacheEntry *				oldest;
+	uint32_t					entryCount;
+	size_t						byteCount;
+	size_t						capacityBytes;
+} CacheTier;
+
+struct SynthAudioCache {
+	pthread_mutex_t				lock;
+	CacheTier					memory;
+	CacheTier					disk;
+	char *						directory;
+	uint64_t					memoryHits;
+	uint64_t					diskHits;
+	uint64_t					misses;
+	uint64_t					spills;
+	uint64_t					evictions;
+};
+
+typedef struct DiskFile {
+	uint64_t					keyHash;
+	size_t						byteSize;
+	time_t						modificationTime;
+} DiskFile;
+
+static pthread_mutex_t			sSharedLock = PTHREAD_MUTEX_INITIALIZER;
+static SynthAudioCache *		sSharedCache = NULL;
+static Boolean					sSharedCreationAttempted = false;
+static Boolean					sSharedConfigured = false;
+static size_t					sSharedMemoryBytes = kSynthAudioCacheDefaultMemoryBytes;
+static size_t					sSharedDiskBytes = kSynthAudioCacheDefaultDiskBytes;
+static char *					sSharedDirectory = NULL;
+
+static size_t		Align8(size_t size);
+static uint64_t		KeyHash(const SynthAudioCacheKey * key);
+static long			UtteranceFromBlock(void * block, size_t blockSize, Boolean isMapped, const SynthAudioCacheKey * expectedKey, SynthRenderedUtterance ** outUtterance);
+static long			MapUtterance(const char * directory, uint64_t keyHash, const SynthAudioCacheKey * key, SynthRenderedUtterance ** outUtterance);
+static long			WriteUtterance(const char * directory, uint64_t keyHash, const SynthRenderedUtterance * utterance);
+static void			MakeFilePath(const char * directory, uint64_t keyHash, const char * suffix, char * path, size_t pathSize);
+static void			RemoveFile(const char * directory, uint64_t keyHash);
+static void			ScanDirectory(SynthAudioCache * cache);
+static int			CompareModificationTimes(const void * a, const void * b);
+static CacheEntry *	TierFind(CacheTier * tier, uint64_t keyHash);
+static void			TierAdd(CacheTier * tier, CacheEntry * entry);
+static void			TierMakeNewest(CacheTier * tier, CacheEntry * entry);
+static void			TierUnlink(CacheTier * tier, CacheEntry * entry);
+static void			AddToDisk(SynthAudioCache * cache, uint64_t keyHash, size_t byteSize);
+
+long SynthRenderedUtteranceCreate(const SynthAudioCacheKey * key, const void * audio, size_t audioBytes, const SynthTimelineEvent * events, uint32_t eventCount, const SynthBoundaryIndex * boundaries, SynthRenderedUtterance ** outUtterance)
+{
+	size_t eventsOffset, wordsOffset, sentencesOffset, audioOffset, blockSize;
+	BlockHeader * header;
+	uint8_t * block;
+	long error;
+
+	if (key == NULL || boundaries == NULL || outUtterance == NULL || (audioBytes > 0 && audio == NULL) || (eventCount > 0 && events == NULL)) {
+		return paramErr;
+	}
+	*outUtterance = NULL;
+
+	eventsOffset = Align8(sizeof(BlockHeader));
+	wordsOffset = eventsOffset + Align8(eventCount * sizeof(SynthTimelineEvent));
+	sentencesOffset = wordsOffset + Align8(boundaries->wordCount * sizeof(uint64_t));
+	audioOffset = sentencesOffset + Align8(boundaries->sentenceCount * sizeof(uint64_t));
+	blockSize = audioOffset + audioBytes;
+
+	block = (uint8_t *)calloc(1, blockSize);
+	if (block == NULL) {
+		return memFullErr;
+	}
+
+	header = (BlockHeader *)block;
+	header->magic = kBlockMagic;
+	header->version = kBlockVersion;
+	header->key = *key;
+	header->totalSamples = boundaries->totalSamples;
+	header->audioBytes = audioBytes;
+	header->audioFormat = key->audioFormat;
+	header->eventCount = eventCount;
+	header->wordCount = boundaries->wordCount;
+	header->sentenceCount = boundaries->sentenceCount;
+	if (eventCount > 0) {
+		memcpy(block + eventsOffset, events, eventCount * sizeof(SynthTimelineEvent));
+	}
+	if (boundaries->wordCount > 0) {
+		memcpy(block + wordsOffset, boundaries->wordEnds, boundaries->wordCount * sizeof(uint64_t));
+	}
+	if (boundaries->sentenceCount > 0) {
+		memcpy(block + sentencesOffset, boundaries->sentenceEnds, boundaries->sentenceCount * sizeof(uint64_t));
+	}
+	if (audioBytes > 0) {
+		memcpy(block + audioOffset, audio, audioBytes);
+	}
+
+	error = UtteranceFromBlock(block, blockSize, false, key, outUtterance);
+	if (error != noErr) {
+		free(block);
+	}
+	return error;
+}
+
+SynthRenderedUtterance * SynthRenderedUtteranceRetain(SynthRenderedUtterance * utterance)
+{
+	if (utterance) {
+		atomic_fetch_add_explicit(&utterance->referenceCount, 1, memory_order_relaxed);
+	}
+	return utterance;
+}
+
+void SynthRenderedUtteranceRelease(SynthRenderedUtterance * utterance)
+{
+	if (utterance && atomic_fetch_sub_explicit(&utterance->referenceCount, 1, memory_order_acq_rel) == 1) {
+		if (utterance->isMapped) {
+			munmap(utterance->block, utterance->blockSize);
+		}
+		else {
+			free(utterance->block);
+		}
+		free(utterance);
+	}
+}
+
+long SynthAudioCacheCreate(size_t memoryBytes, const char * directory, size_t diskBytes, SynthAudioCache ** outCache)
+{
+	SynthAudioCache * cache;
+
+	if (outCache == NULL || memoryBytes == 0) {
+		return paramErr;
+	}
+	*outCache = NULL;
+
+	if (directory && mkdir(directory, 0755) != 0) {
+		struct stat directoryInfo;
+		if (stat(directory, &directoryInfo) != 0 || ! S_ISDIR(directoryInfo.st_mode)) {
+			return paramErr;
+		}
+	}
+
+	cache = (SynthAudioCache *)calloc(1, sizeof(SynthAudioCache));
+	if (cache == NULL) {
+		return memFullErr;
+	}
+	if (directory) {
+		cache->directory = strdup(directory);
+		if (cache->directory == NULL) {
+			free(cache);
+			return memFullErr;
+		}
+	}
+	cache->memory.capacityBytes = memoryBytes;
+	cache->disk.capacityBytes = (directory) ? diskBytes : 0;
+	pthread_mutex_init(&cache->lock, NULL);
+
+	if (cache->directory) {
+		ScanDirectory(cache);
+	}
+
+	*outCache = cache;
+	return noErr;
+}
+
+void SynthAudioCacheDispose(SynthAudioCache * cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	// The files stay behind for the next run.
+	while (cache->memory.oldest) {
+		CacheEntry * entry = cache->memory.oldest;
+		TierUnlink(&cache->memory, entry);
+		SynthRenderedUtteranceRelease(entry->utterance);
+		free(entry);
+	}
+	while (cache->disk.oldest) {
+		CacheEntry * entry = cache->disk.oldest;
+		TierUnlink(&cache->disk, entry);
+		free(entry);
+	}
+	pthread_mutex_destroy(&cache->lock);
+	free(cache->directory);
+	free(cache);
+}
+
+SynthAudioCache * SynthAudioCacheShared(void)
+{
+	pthread_mutex_lock(&sSharedLock);
+	if (! sSharedCreationAttempted) {
+		const char * directory = sSharedDirectory;
+		size_t memoryBytes = sSharedMemoryBytes;
+		size_t diskBytes = sSharedDiskBytes;
+
+		if (! sSharedConfigured) {
+			const char * bytesString;
+			directory = getenv(kSynthAudioCacheDirectoryVariable);
+			if ((bytesString = getenv(kSynthAudioCacheMemoryBytesVariable)) && strtoul(bytesString, NULL, 10) > 0) {
+				memoryBytes = (size_t)strtoul(bytesString, NULL, 10);
+			}
+			if ((bytesString = getenv(kSynthAudioCacheDiskBytesVariable)) && strtoul(bytesString, NULL, 10) > 0) {
+				diskBytes = (size_t)strtoul(bytesString, NULL, 10);
+			}
+		}
+
+		// Without configuration or a directory in the environment the cache stays off.
+		if (sSharedConfigured || directory) {
+			SynthAudioCacheCreate(memoryBytes, directory, diskBytes, &sSharedCache);
+		}
+		sSharedCreationAttempted = true;
+	}
+	pthread_mutex_unlock(&sSharedLock);
+
+	return sSharedCache;
+}
+
+long SynthAudioCacheConfigureShared(size_t memoryBytes, const char * directory, size_t diskBytes)
+{
+	long error = noErr;
+
+	if (memoryBytes == 0) {
+		return paramErr;
+	}
+
+	pthread_mutex_lock(&sSharedLock);
+	if (sSharedCreationAttempted) {
+		// The shared cache has already been set up with its own settings.
+		error = synthNotReady;
+	}
+	else {
+		free(sSharedDirectory);
+		sSharedDirectory = (directory) ? strdup(directory) : NULL;
+		if (directory && sSharedDirectory == NULL) {
+			error = memFullErr;
+		}
+		else {
+			sSharedMemoryBytes = memoryBytes;
+			sSharedDiskBytes = diskBytes;
+			sSharedConfigured = true;
+		}
+	}
+	pthread_mutex_unlock(&sSharedLock);
+
+	return error;
+}
+
+Boolean SynthAudioCacheCopyUtterance(SynthAudioCache * cache, const SynthAudioCacheKey * key, SynthRenderedUtterance ** outUtterance)
+{
+	uint64_t keyHash = KeyHash(key);
+	SynthRenderedUtterance * utterance = NULL;
+	Boolean onDisk = false;
+	CacheEntry * entry;
+
+	*outUtterance = NULL;
+
+	pthread_mutex_lock(&cache->lock);
+	entry = TierFind(&cache->memory, keyHash);
+	if (entry && memcmp(&((const BlockHeader *)entry->utterance->block)->key, key, sizeof(SynthAudioCacheKey)) == 0) {
+		TierMakeNewest(&cache->memory, entry);
+		utterance = SynthRenderedUtteranceRetain(entry->utterance);
+		cache->memoryHits++;
+	}
+	else if ((entry = TierFind(&cache->disk, keyHash)) != NULL) {
+		TierMakeNewest(&cache->disk, entry);
+		onDisk = true;
+	}
+	else {
+		cache->misses++;
+	}
+	pthread_mutex_unlock(&cache->lock);
+
+	if (onDisk) {
+		// Map the file outside the lock; the pages are read in as playback reaches them.
+		Boolean mapped = (MapUtterance(cache->directory, keyHash, key, &utterance) == noErr);
+
+		pthread_mutex_lock(&cache->lock);
+		if (mapped) {
+			cache->diskHits++;
+		}
+		else {
+			// The file is gone, damaged, or belongs to a different key with the same hash.
+			entry = TierFind(&cache->disk, keyHash);
+			if (entry) {
+				TierUnlink(&cache->disk, entry);
+				free(entry);
+			}
+			cache->misses++;
+		}
+		pthread_mutex_unlock(&cache->lock);
+	}
+
+	*outUtterance = utterance;
+	return (utterance != NULL);
+}
+
+long SynthAudioCacheAddUtterance(SynthAudioCache * cache, const SynthAudioCacheKey * key, SynthRenderedUtterance * utterance)
+{
+	uint64_t keyHash = KeyHash(key);
+	CacheEntry * spilled = NULL;
+	CacheEntry * entry;
+
+	if (utterance == NULL || utterance->isMapped || utterance->blockSize > cache->memory.capacityBytes) {
+		return paramErr;
+	}
+
+	entry = (CacheEntry *)calloc(1, sizeof(CacheEntry));
+	if (entry == NULL) {
+		return memFullErr;
+	}
+	entry->keyHash = keyHash;
+	entry->utterance = SynthRenderedUtteranceRetain(utterance);
+	entry->byteSize = utterance->blockSize;
+
+	pthread_mutex_lock(&cache->lock);
+	if (TierFind(&cache->memory, keyHash)) {
+		// Another channel rendered the same utterance first.
+		pthread_mutex_unlock(&cache->lock);
+		SynthRenderedUtteranceRelease(entry->utterance);
+		free(entry);
+		return noErr;
+	}
+	TierAdd(&cache->memory, entry);
+
+	// Make room by moving the least recently used entries out of memory.
+	while (cache->memory.byteCount > cache->memory.capacityBytes && cache->memory.oldest != entry) {
+		CacheEntry * oldest = cache->memory.oldest;
+		TierUnlink(&cache->memory, oldest);
+		oldest->nextInBucket = spilled;
+		spilled = oldest;
+	}
+	pthread_mutex_unlock(&cache->lock);
+
+	// Write the spilled entries without holding the lock.
+	while (spilled) {
+		CacheEntry * next = spilled->nextInBucket;
+		if (cache->directory && spilled->byteSize <= cache->disk.capacityBytes && WriteUtterance(cache->directory, spilled->keyHash, spilled->utterance) == noErr) {
+			AddToDisk(cache, spilled->keyHash, spilled->byteSize);
+		}
+		SynthRenderedUtteranceRelease(spilled->utterance);
+		free(spilled);
+		spilled = next;
+	}
+
+	return noErr;
+}
+
+void SynthAudioCacheGetStatistics(SynthAudioCache * cache, SynthAudioCacheStatistics * statistics)
+{
+	pthread_mutex_lock(&cache->lock);
+	statistics->memoryHits = cache->memoryHits;
+	statistics->diskHits = cache->diskHits;
+	statistics->misses = cache->misses;
+	statistics->spills = cache->spills;
+	statistics->evictions = cache->evictions;
+	statistics->memoryEntryCount = cache->memory.entryCount;
+	statistics->diskEntryCount = cache->disk.entryCount;
+	statistics->memoryBytes = cache->memory.byteCount;
+	statistics->diskBytes = cache->disk.byteCount;
+	pthread_mutex_unlock(&cache->lock);
+}
+
+static size_t Align8(size_t size)
+{
+	return (size + 7) & ~(size_t)7;
+}
+
+static uint64_t KeyHash(const SynthAudioCacheKey * key)
+{
+	const uint8_t * bytes = (const uint8_t *)key;
+	uint64_t hash = 14695981039346656037ULL;
+	size_t byteIndex;
+
+	for (byteIndex = 0; byteIndex < sizeof(SynthAudioCacheKey); byteIndex++) {
+		hash ^= bytes[byteIndex];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static long UtteranceFromBlock(void * block, size_t blockSize, Boolean isMapped, const SynthAudioCacheKey * expectedKey, SynthRenderedUtterance ** outUtterance)
+{
+	const BlockHeader * header = (const BlockHeader *)block;
+	SynthRenderedUtterance * utterance;
+	size_t eventsOffset, wordsOffset, sentencesOffset, audioOffset;
+
+	// Check everything about a block read from disk before trusting its counts.
+	if (blockSize < sizeof(BlockHeader) || header->magic != kBlockMagic || header->version != kBlockVersion
+		|| memcmp(&header->key, expectedKey, sizeof(SynthAudioCacheKey)) != 0) {
+		return badDictFormat;
+	}
+	eventsOffset = Align8(sizeof(BlockHeader));
+	wordsOffset = eventsOffset + Align8((size_t)header->eventCount * sizeof(SynthTimelineEvent));
+	sentencesOffset = wordsOffset + Align8((size_t)header->wordCount * sizeof(uint64_t));
+	audioOffset = sentencesOffset + Align8((size_t)header->sentenceCount * sizeof(uint64_t));
+	if (audioOffset > blockSize || header->audioBytes != blockSize - audioOffset) {
+		return badDictFormat;
+	}
+
+	utterance = (SynthRenderedUtterance *)calloc(1, sizeof(SynthRenderedUtterance));
+	if (utterance == NULL) {
+		return memFullErr;
+	}
+	atomic_init(&utterance->referenceCount, 1);
+	utterance->audio = (const uint8_t *)block + audioOffset;
+	utterance->audioBytes = (size_t)header->audioBytes;
+	utterance->audioFormat = header->audioFormat;
+	utterance->events = (const SynthTimelineEvent *)((const uint8_t *)block + eventsOffset);
+	utterance->eventCount = header->eventCount;
+	utterance->wordEnds = (const uint64_t *)((const uint8_t *)block + wordsOffset);
+	utterance->wordCount = header->wordCount;
+	utterance->sentenceEnds = (const uint64_t *)((const uint8_t *)block + sentencesOffset);
+	utterance->sentenceCount = header->sentenceCount;
+	utterance->totalSamples = header->totalSamples;
+	utterance->block = block;
+	utterance->blockSize = blockSize;
+	utterance->isMapped = isMapped;
+
+	*outUtterance = utterance;
+	return noErr;
+}
+
+static long MapUtterance(const char * directory, uint64_t keyHash, const SynthAudioCacheKey * key, SynthRenderedUtterance ** outUtterance)
+{
+	char path[PATH_MAX];
+	struct stat fileInfo;
+	void * block;
+	long error;
+	int file;
+
+	MakeFilePath(directory, keyHash, "", path, sizeof(path));
+	file = open(path, O_RDONLY);
+	if (file < 0) {
+		return fnfErr;
+	}
+	if (fstat(file, &fileInfo) != 0 || fileInfo.st_size < (off_t)sizeof(BlockHeader)) {
+		close(file);
+		return badDictFormat;
+	}
+	block = mmap(NULL, (size_t)fileInfo.st_size, PROT_READ, MAP_SHARED, file, 0);
+	close(file);
+	if (block == MAP_FAILED) {
+		return memFullErr;
+	}
+
+	error = UtteranceFromBlock(block, (size_t)fileInfo.st_size, true, key, outUtterance);
+	if (error != noErr) {
+		munmap(block, (size_t)fileInfo.st_size);
+	}
+	return error;
+}
+
+static long WriteUtterance(const char * directory, uint64_t keyHash, const SynthRenderedUtterance * utterance)
+{
+	char temporaryPath[PATH_MAX];
+	char path[PATH_MAX];
+	const uint8_t * bytes = (const uint8_t *)utterance->block;
+	size_t bytesLeft = utterance->blockSize;
+	int file;
+
+	// Write under a temporary name and rename, so a reader never maps a partly written file.
+	MakeFilePath(directory, keyHash, ".partial", temporaryPath, sizeof(temporaryPath));
+	MakeFilePath(directory, keyHash, "", path, sizeof(path));
+	file = open(temporaryPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (file < 0) {
+		return ioErr;
+	}
+	while (bytesLeft > 0) {
+		ssize_t written = write(file, bytes, bytesLeft);
+		if (written <= 0) {
+			close(file);
+			unlink(temporaryPath);
+			return ioErr;
+		}
+		bytes += written;
+		bytesLeft -= (size_t)written;
+	}
+	if (close(file) != 0 || rename(temporaryPath, path) != 0) {
+		unlink(temporaryPath);
+		return ioErr;
+	}
+	return noErr;
+}
+
+static void MakeFilePath(const char * directory, uint64_t keyHash, const char * suffix, char * path, size_t pathSize)
+{
+	snprintf(path, pathSize, "%s/%016llx%s%s", directory, (unsigned long long)keyHash, kFileSuffix, suffix);
+}
+
+static void RemoveFile(const char * directory, uint64_t keyHash)
+{
+	char path[PATH_MAX];
+
+	// Readers that already mapped the file keep their pages.
+	MakeFilePath(directory, keyHash, "", path, sizeof(path));
+	unlink(path);
+}
+
+static void ScanDirectory(SynthAudioCache * cache)
+{
+	DiskFile * files = NULL;
+	size_t fileCount = 0;
+	size_t fileCapacity = 0;
+	size_t fileIndex;
+	struct dirent * item;
+	DIR * directory;
+
+	directory = opendir(cache->directory);
+	if (directory == NULL) {
+		return;
+	}
+	while ((item = readdir(directory)) != NULL) {
+		char path[PATH_MAX];
+		struct stat fileInfo;
+		char * end;
+		uint64_t keyHash;
+
+		if (strlen(item->d_name) != kFileNameLength || strcmp(item->d_name + 16, kFileSuffix) != 0) {
+			continue;
+		}
+		keyHash = strtoull(item->d_name, &end, 16);
+		snprintf(path, sizeof(path), "%s/%s", cache->directory, item->d_name);
+		if (end != item->d_name + 16 || stat(path, &fileInfo) != 0) {
+			continue;
+		}
+		if (fileCount == fileCapacity) {
+			size_t newCapacity = (fileCapacity) ? fileCapacity * 2 : 64;
+			DiskFile * newFiles = (DiskFile *)realloc(files, newCapacity * sizeof(DiskFile));
+			if (newFiles == NULL) {
+				break;
+			}
+			files = newFiles;
+			fileCapacity = newCapacity;
+		}
+		files[fileCount].keyHash = keyHash;
+		files[fileCount].byteSize = (size_t)fileInfo.st_size;
+		files[fileCount].modificationTime = fileInfo.st_mtime;
+		fileCount++;
+	}
+	closedir(directory);
+
+	// Oldest first, so the most recently written files end up as the most recently used.
+	if (fileCount > 0) {
+		qsort(files, fileCount, sizeof(DiskFile), CompareModificationTimes);
+	}
+	for (fileIndex = 0; fileIndex < fileCount; fileIndex++) {
+		AddToDisk(cache, files[fileIndex].keyHash, files[fileIndex].byteSize);
+	}
+	free(files);
+}
+
+static int CompareModificationTimes(const void * a, const void * b)
+{
+	time_t timeA = ((const DiskFile *)a)->modificationTime;
+	time_t timeB = ((const DiskFile *)b)->modificationTime;
+	return (timeA < timeB) ? -1 : (timeA > timeB) ? 1 : 0;
+}
+
+static CacheEntry * TierFind(CacheTier * tier, uint64_t keyHash)
+{
+	CacheEntry * entry = tier->buckets[keyHash % kBucketCount];
+
+	while (entry && entry->keyHash != keyHash) {
+		entry = entry->nextInBucket;
+	}
+	return entry;
+}
+
+static void TierAdd(CacheTier * tier, CacheEntry * entry)
+{
+	entry->nextInBucket = tier->buckets[entry->keyHash % kBucketCount];
+	tier->buckets[entry->keyHash % kBucketCount] = entry;
+
+	entry->newer = NULL;
+	entry->older = tier->newest;
+	if (tier->newest) {
+		tier->newest->newer = entry;
+	}
+	tier->newest = entry;
+	if (tier->oldest == NULL) {
+		tier->oldest = entry;
+	}
+	tier->entryCount++;
+	tier->byteCount += entry->byteSize;
+}
+
+static void TierMakeNewest(CacheTier * tier, CacheEntry * entry)
+{
+	if (tier->newest == entry) {
+		return;
+	}
+
+	// It isn't the newest, so it has a newer neighbor.
+	entry->newer->older = entry->older;
+	if (entry->older) {
+		entry->older->newer = entry->newer;
+	}
+	else {
+		tier->oldest = entry->newer;
+	}
+
+	entry->newer = NULL;
+	entry->older = tier->newest;
+	tier->newest->newer = entry;
+	tier->newest = entry;
+}
+
+static void TierUnlink(CacheTier * tier, CacheEntry * entry)
+{
+	CacheEntry ** link = &tier->buckets[entry->keyHash % kBucketCount];
+
+	while (*link && *link != entry) {
+		link = &(*link)->nextInBucket;
+	}
+	if (*link) {
+		*link = entry->nextInBucket;
+	}
+
+	if (entry->newer) {
+		entry->newer->older = entry->older;
+	}
+	else {
+		tier->newest = entry->older;
+	}
+	if (entry->older) {
+		entry->older->newer = entry->newer;
+	}
+	else {
+		tier->oldest = entry->newer;
+	}
+
+	tier->entryCount--;
+	tier->byteCount -= entry->byteSize;
+}
+
+static void AddToDisk(SynthAudioCache * cache, uint64_t keyHash, size_t byteSize)
+{
+	CacheEntry * evicted = NULL;
+	CacheEntry * entry;
+
+	pthread_mutex_lock(&cache->lock);
+	entry = TierFind(&cache->disk, keyHash);
+	if (entry) {
+		// The file was just rewritten with the same contents.
+		TierMakeNewest(&cache->disk, entry);
+		entry = NULL;
+	}
+	else {
+		entry = (CacheEntry *)calloc(1, sizeof(CacheEntry));
+		if (entry) {
+			entry->keyHash = keyHash;
+			entry->byteSize = byteSize;
+			TierAdd(&cache->disk, entry);
+			cache->spills++;
+		}
+	}
+
+	while (cache->disk.byteCount > cache->disk.capacityBytes && cache->disk.oldest) {
+		CacheEntry * oldest = cache->disk.oldest;
+		TierUnlink(&cache->disk, oldest);
+		oldest->nextInBucket = evicted;
+		evicted = oldest;
+		cache->evictions++;
+	}
+	pthread_mutex_unlock(&cache->lock);
+
+	while (evicted) {
+		CacheEntry * next = evicted->nextInBucket;
+		RemoveFile(cache->directory, evicted->keyHash);
+		free(evicted);
+		evicted = next;
+	}
+}
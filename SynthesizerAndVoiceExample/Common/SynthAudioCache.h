@@ -0,0 +1,152 @@
+/*
+	SynthAudioCache.h
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: An optional cache of fully rendered utterances: the audio together with
+	the timeline of word and phoneme events and the word and sentence boundaries,
+	so speaking the same prompt again can replay it without synthesizing anything.
+	Entries are addressed by a hash of everything that affects the output.  Recent
+	entries stay in memory; older ones are spilled to files that are mapped back
+	in when they're needed, and both tiers are capped and evicted least recently
+	used first.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#ifndef __SYNTHAUDIOCACHE__
+#define __SYNTHAUDIOCACHE__
+
+#include <stdatomic.h>
+#include "SynthEngineBase.h"
+#include "SynthBoundaryIndex.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Environment variables that turn on the shared cache.  The directory is required; the sizes default below.
+#define kSynthAudioCacheDirectoryVariable		"SYNTH_ENGINE_AUDIO_CACHE_DIRECTORY"
+#define kSynthAudioCacheMemoryBytesVariable		"SYNTH_ENGINE_AUDIO_CACHE_MEMORY_BYTES"
+#define kSynthAudioCacheDiskBytesVariable		"SYNTH_ENGINE_AUDIO_CACHE_DISK_BYTES"
+
+#define kSynthAudioCacheDefaultMemoryBytes		(16 * 1024 * 1024)
+#define kSynthAudioCacheDefaultDiskBytes		(256 * 1024 * 1024)
+
+// Everything that affects the rendered output.  Compared bytewise, so always clear it before filling it in.
+typedef struct SynthAudioCacheKey {
+	uint64_t	voice;				// Voice creator in the high 32 bits, voice id in the low.
+	uint64_t	textHash;			// SynthTextHash of the text as the client passed it.
+	float		rate;
+	float		pitchBase;
+	float		pitchMod;
+	float		volume;
+	uint32_t	audioFormat;		// Four-character code of the format of the audio bytes.
+	uint32_t	textModes;			// The SynthTextNormalize modes the text was read with.
+} SynthAudioCacheKey;
+
+// An event of the utterance and the sample at which it's delivered.
+typedef struct SynthTimelineEvent {
+	uint64_t	samplePosition;
+	uint32_t	kind;				// A SynthTextEventKind.
+	uint32_t	characterOffset;	// In the text as the client passed it.
+	uint32_t	length;
+	int32_t		phonemeCode;
+} SynthTimelineEvent;
+
+// A rendered utterance.  Immutable and reference counted; its arrays point into memory owned by the
+// cache or into a mapped file, and stay valid until the last reference is released.
+typedef struct SynthRenderedUtterance {
+	atomic_uint						referenceCount;
+	const void *					audio;
+	size_t							audioBytes;
+	uint32_t						audioFormat;
+	const SynthTimelineEvent *		events;
+	uint32_t						eventCount;
+	const uint64_t *				wordEnds;
+	uint32_t						wordCount;
+	const uint64_t *				sentenceEnds;
+	uint32_t						sentenceCount;
+	uint64_t						totalSamples;
+	void *							block;				// The storage the arrays point into.
+	size_t							blockSize;
+	Boolean							isMapped;
+} SynthRenderedUtterance;
+
+typedef struct SynthAudioCacheStatistics {
+	uint64_t	memoryHits;
+	uint64_t	diskHits;
+	uint64_t	misses;
+	uint64_t	spills;				// Entries written to disk to make room in memory.
+	uint64_t	evictions;			// Entries dropped from disk to make room there.
+	uint32_t	memoryEntryCount;
+	uint32_t	diskEntryCount;
+	size_t		memoryBytes;
+	size_t		diskBytes;
+} SynthAudioCacheStatistics;
+
+typedef struct SynthAudioCache SynthAudioCache;
+
+// Copies audio, events and boundaries into a single block, laid out as it's stored on disk.
+long		SynthRenderedUtteranceCreate(const SynthAudioCacheKey * key, const void * audio, size_t audioBytes, const SynthTimelineEvent * events, uint32_t eventCount, const SynthBoundaryIndex * boundaries, SynthRenderedUtterance ** outUtterance);
+SynthRenderedUtterance *	SynthRenderedUtteranceRetain(SynthRenderedUtterance * utterance);
+void		SynthRenderedUtteranceRelease(SynthRenderedUtterance * utterance);
+
+// directory may be NULL for a memory-only cache.  Files already in directory are picked up, so
+// the disk tier survives from one run to the next.
+long		SynthAudioCacheCreate(size_t memoryBytes, const char * directory, size_t diskBytes, SynthAudioCache ** outCache);
+void		SynthAudioCacheDispose(SynthAudioCache * cache);
+
+// The cache shared by every channel, or NULL when it isn't turned on.  It's created on first use from
+// the settings passed to SynthAudioCacheConfigureShared, else from the environment variables above.
+SynthAudioCache *	SynthAudioCacheShared(void);
+long		SynthAudioCacheConfigureShared(size_t memoryBytes, const char * directory, size_t diskBytes);
+
+// Passes back the cached utterance for key, retained, or returns false if there isn't one.
+Boolean		SynthAudioCacheCopyUtterance(SynthAudioCache * cache, const SynthAudioCacheKey * key, SynthRenderedUtterance ** outUtterance);
+
+// Adds an utterance made by SynthRenderedUtteranceCreate with the same key.  The cache takes its own reference.
+long		SynthAudioCacheAddUtterance(SynthAudioCache * cache, const SynthAudioCacheKey * key, SynthRenderedUtterance * utterance);
+
+void		SynthAudioCacheGetStatistics(SynthAudioCache * cache, SynthAudioCacheStatistics * statistics);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,291 @@
+/*
+	SynthBoundaryIndex.c
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Word and sentence boundary index used to schedule stops and pauses
+	at exact sample positions.  See SynthBoundaryIndex.h.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#include <stdlib.h>
+#include "SynthBoundaryIndex.h"
+
+static long AppendPosition(uint64_t ** positions, uint32_t * count, uint32_t * capacity, uint64_t samplePosition);
+static uint64_t FirstPositionAtOrAfter(const uint64_t * positions, uint32_t count, uint64_t samplePosition, uint64_t notFound);
+
+void SynthBoundaryIndexInit(SynthBoundaryIndex * index)
+{
+	index->wordEnds = NULL;
+	index->sentenceEnds = NULL;
+	index->wordCount = 0;
+	index->sentenceCount = 0;
+	index->wordCapacity = 0;
+	index->sentenceCapacity = 0;
+	index->totalSamples = 0;
+}
+
+void SynthBoundaryIndexReset(SynthBoundaryIndex * index)
+{
+	// Keep the storage around for the next utterance.
+	index->wordCount = 0;
+	index->sentenceCount = 0;
+	index->totalSamples = 0;
+}
+
+void SynthBoundaryIndexDispose(SynthBoundaryIndex * index)
+{
+	free(index->wordEnds);
+	free(index->sentenceEnds);
+	SynthBoundaryIndexInit(index);
+}
+
+long SynthBoundaryIndexAddWordEnd(SynthBoundaryIndex * index, uint64_t samplePosition)
+{
+	long error = AppendPosition(&index->wordEnds, &index->wordCount, &index->wordCapacity, samplePosition);
+	if (error == noErr && samplePosition > index->totalSamples) {
+		index->totalSamples = samplePosition;
+	}
+	return error;
+}
+
+long SynthBoundaryIndexAddSentenceEnd(SynthBoundaryIndex * index, uint64_t samplePosition)
+{
+	long error = AppendPosition(&index->sentenceEnds, &index->sentenceCount, &index->sentenceCapacity, samplePosition);
+	if (error == noErr && samplePosition > index->totalSamples) {
+		index->totalSamples = samplePosition;
+	}
+	return error;
+}
+
+long SynthBoundaryIndexBuildFromText(SynthBoundaryIndex * index, const UniChar * text, long length, uint32_t samplesPerCharacter)
+{
+	long error = noErr;
+	long charIndex = 0;
+	Boolean inWord = false;
+	Boolean sawSentencePunctuation = false;
+
+	if (length < 0 || (length > 0 && text == NULL)) {
+		return paramErr;
+	}
+
+	SynthBoundaryIndexReset(index);
+
+	// One pass over the text.  A word ends at the first non-word character after a run of word
+	// characters; a sentence ends at the first white space after terminal punctuation.
+	while (error == noErr && charIndex < length) {
+		UniChar c = text[charIndex];
+
+		if (SynthBoundaryIsWordCharacter(c)) {
+			if (sawSentencePunctuation && ! inWord) {
+				// Something like "3.14" or "e.g." - the punctuation wasn't the end of a sentence.
+				sawSentencePunctuation = false;
+			}
+			inWord = true;
+		}
+		else {
+			if (inWord) {
+				error = SynthBoundaryIndexAddWordEnd(index, (uint64_t)charIndex * samplesPerCharacter);
+				inWord = false;
+			}
+			if (c == '.' || c == '!' || c == '?') {
+				sawSentencePunctuation = true;
+			}
+			else if (SynthBoundaryIsWhiteSpace(c) && sawSentencePunctuation) {
+				error = SynthBoundaryIndexAddSentenceEnd(index, (uint64_t)charIndex * samplesPerCharacter);
+				sawSentencePunctuation = false;
+			}
+		}
+		charIndex++;
+	}
+
+	if (error == noErr) {
+		uint64_t endPosition = (uint64_t)length * samplesPerCharacter;
+		if (inWord) {
+			error = SynthBoundaryIndexAddWordEnd(index, endPosition);
+		}
+		if (error == noErr && (index->sentenceCount == 0 || index->sentenceEnds[index->sentenceCount - 1] < endPosition)) {
+			error = SynthBoundaryIndexAddSentenceEnd(index, endPosition);
+		}
+		index->totalSamples = endPosition;
+	}
+
+	return error;
+}
+
+uint64_t SynthBoundaryIndexNextBoundary(const SynthBoundaryIndex * index, uint64_t samplePosition, uint32_t where)
+{
+	uint64_t boundary = samplePosition;
+
+	switch (where) {
+
+		case kEndOfWord:
+			boundary = FirstPositionAtOrAfter(index->wordEnds, index->wordCount, samplePosition, index->totalSamples);
+			break;
+
+		case kEndOfSentence:
+			boundary = FirstPositionAtOrAfter(index->sentenceEnds, index->sentenceCount, samplePosition, index->totalSamples);
+			break;
+
+		case kImmediate:
+		default:
+			break;
+	}
+
+	// Past the end of the utterance there's nothing left to wait for.
+	if (boundary < samplePosition) {
+		boundary = samplePosition;
+	}
+
+	return boundary;
+}
+
+long SynthBoundaryIndexSchedule(const SynthBoundaryIndex * index, uint64_t currentPosition, uint32_t where, Boolean isPause, SynthBoundarySchedule * schedule)
+{
+	if (schedule == NULL || (where != kImmediate && where != kEndOfWord && where != kEndOfSentence)) {
+		return paramErr;
+	}
+
+	schedule->where = where;
+	schedule->isPause = isPause;
+	schedule->isPending = true;
+
+	if (where == kImmediate) {
+		// Immediate requests still get the fade so they don't click; it starts right away.
+		schedule->fadeStart = currentPosition;
+		schedule->target = currentPosition + kSynthBoundaryFadeSamples;
+	}
+	else {
+		schedule->target = SynthBoundaryIndexNextBoundary(index, currentPosition, where);
+		schedule->fadeStart = (schedule->target >= currentPosition + kSynthBoundaryFadeSamples) ? schedule->target - kSynthBoundaryFadeSamples : currentPosition;
+	}
+
+	return noErr;
+}
+
+float SynthBoundaryScheduleGain(const SynthBoundarySchedule * schedule, uint64_t samplePosition)
+{
+	float gain = 1.0f;
+
+	if (schedule->isPending && samplePosition >= schedule->fadeStart) {
+		if (samplePosition >= schedule->target) {
+			gain = 0.0f;
+		}
+		else {
+			gain = (float)(schedule->target - samplePosition) / (float)(schedule->target - schedule->fadeStart);
+		}
+	}
+
+	return gain;
+}
+
+void SynthBoundaryScheduleApplyFade(const SynthBoundarySchedule * schedule, float * samples, uint32_t count, uint64_t firstPosition)
+{
+	uint32_t sampleIndex;
+
+	if (! schedule->isPending || firstPosition + count <= schedule->fadeStart) {
+		return;
+	}
+
+	// Start at the first sample inside the ramp; everything before it is untouched.
+	sampleIndex = (firstPosition < schedule->fadeStart) ? (uint32_t)(schedule->fadeStart - firstPosition) : 0;
+	if (firstPosition + sampleIndex < schedule->target) {
+		float rampLength = (float)(schedule->target - schedule->fadeStart);
+		float gain = (float)(schedule->target - (firstPosition + sampleIndex)) / rampLength;
+		float step = 1.0f / rampLength;
+		while (sampleIndex < count && firstPosition + sampleIndex < schedule->target) {
+			samples[sampleIndex++] *= gain;
+			gain -= step;
+		}
+	}
+	while (sampleIndex < count) {
+		samples[sampleIndex++] = 0.0f;
+	}
+}
+
+
+static long AppendPosition(uint64_t ** positions, uint32_t * count, uint32_t * capacity, uint64_t samplePosition)
+{
+	if (*count > 0 && (*positions)[*count - 1] > samplePosition) {
+		return paramErr;
+	}
+
+	if (*count == *capacity) {
+		uint32_t newCapacity = (*capacity) ? *capacity * 2 : 64;
+		uint64_t * newPositions = (uint64_t *)realloc(*positions, newCapacity * sizeof(uint64_t));
+		if (newPositions == NULL) {
+			return memFullErr;
+		}
+		*positions = newPositions;
+		*capacity = newCapacity;
+	}
+
+	(*positions)[(*count)++] = samplePosition;
+	return noErr;
+}
+
+static uint64_t FirstPositionAtOrAfter(const uint64_t * positions, uint32_t count, uint64_t samplePosition, uint64_t notFound)
+{
+	uint32_t low = 0;
+	uint32_t high = count;
+
+	while (low < high) {
+		uint32_t middle = low + (high - low) / 2;
+		if (positions[middle] < samplePosition) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+
+	return (low < count) ? positions[low] : notFound;
+}
+
+Boolean SynthBoundaryIsWordCharacter(UniChar c)
+{
+	// Treat everything outside ASCII as part of a word; the front end is responsible for
+	// proper Unicode word breaking.
+	return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '\'' || (c >= 0x80 && ! SynthBoundaryIsWhiteSpace(c));
+}
+
+Boolean SynthBoundaryIsWhiteSpace(UniChar c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == 0x00A0 || c == 0x2028 || c == 0x2029;
+}
@@ -0,0 +1,117 @@
+/*
+	SynthBoundaryIndex.h
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: The boundary index records, for one utterance, the audio sample
+	positions at which each word and each sentence ends.  It is built once when
+	the utterance starts so that SEStopSpeechAt and SEPauseSpeechAt can find the
+	next kEndOfWord or kEndOfSentence boundary with a binary search instead of
+	re-scanning the text, and so the stop can be scheduled for an exact sample.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#ifndef __SYNTHBOUNDARYINDEX__
+#define __SYNTHBOUNDARYINDEX__
+
+#include "SynthEngineBase.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Length of the gain ramp applied before a stop or pause takes effect (10 ms).
+#define kSynthBoundaryFadeSamples	(kSynthEngineSampleRate / 100)
+
+typedef struct SynthBoundaryIndex {
+	uint64_t *	wordEnds;			// Sample position just past the end of each word, ascending.
+	uint64_t *	sentenceEnds;		// Sample position just past the end of each sentence, ascending.
+	uint32_t	wordCount;
+	uint32_t	sentenceCount;
+	uint32_t	wordCapacity;
+	uint32_t	sentenceCapacity;
+	uint64_t	totalSamples;		// Length of the whole utterance.
+} SynthBoundaryIndex;
+
+// A stop or pause that has been requested but not yet reached.
+typedef struct SynthBoundarySchedule {
+	uint64_t	fadeStart;			// First sample of the fade-out ramp.
+	uint64_t	target;				// Sample at which output is silent and the action takes effect.
+	uint32_t	where;				// kImmediate, kEndOfWord or kEndOfSentence, as passed by the client.
+	Boolean		isPause;			// true for SEPauseSpeechAt, false for SEStopSpeechAt.
+	Boolean		isPending;
+} SynthBoundarySchedule;
+
+void		SynthBoundaryIndexInit(SynthBoundaryIndex * index);
+void		SynthBoundaryIndexReset(SynthBoundaryIndex * index);
+void		SynthBoundaryIndexDispose(SynthBoundaryIndex * index);
+
+// Boundaries must be added in ascending order.  A back end that knows the real duration of each
+// word calls these while it lays out the utterance.
+long		SynthBoundaryIndexAddWordEnd(SynthBoundaryIndex * index, uint64_t samplePosition);
+long		SynthBoundaryIndexAddSentenceEnd(SynthBoundaryIndex * index, uint64_t samplePosition);
+
+// Builds the index for text spoken at a constant rate of samplesPerCharacter.  Words are runs of
+// letters and digits; a sentence ends after a run of '.', '!' or '?' that is followed by white space
+// or the end of the text.  The final word and sentence always end at the end of the text.
+long		SynthBoundaryIndexBuildFromText(SynthBoundaryIndex * index, const UniChar * text, long length, uint32_t samplesPerCharacter);
+
+// The character classes BuildFromText uses, for front ends that need to agree with it.
+Boolean		SynthBoundaryIsWordCharacter(UniChar c);
+Boolean		SynthBoundaryIsWhiteSpace(UniChar c);
+
+// Returns the first boundary of the given kind at or after samplePosition, or totalSamples if
+// there is none.  kImmediate returns samplePosition itself.
+uint64_t	SynthBoundaryIndexNextBoundary(const SynthBoundaryIndex * index, uint64_t samplePosition, uint32_t where);
+
+// Fills in schedule for a stop or pause requested while output is at currentPosition.
+long		SynthBoundaryIndexSchedule(const SynthBoundaryIndex * index, uint64_t currentPosition, uint32_t where, Boolean isPause, SynthBoundarySchedule * schedule);
+
+// Gain in the range 0.0 - 1.0 to apply at samplePosition for a pending schedule.
+float		SynthBoundaryScheduleGain(const SynthBoundarySchedule * schedule, uint64_t samplePosition);
+
+// Applies the fade of a pending schedule to a block of samples whose first sample is at
+// firstPosition.  Samples at or after the target are zeroed.
+void		SynthBoundaryScheduleApplyFade(const SynthBoundarySchedule * schedule, float * samples, uint32_t count, uint64_t firstPosition);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
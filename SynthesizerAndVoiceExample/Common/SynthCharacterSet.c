@@ -0,0 +1,218 @@
+/*
+	SynthCharacterSet.c
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Two-level character bitmap.  See SynthCharacterSet.h.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "SynthCharacterSet.h"
+
+#define kWordsPerBlock			4
+#define kHighSurrogatePage		0xD8
+#define kLastSurrogatePage		0xDF
+
+// Each 16-bit lane of a word holding four UTF-16 code units, whatever the byte order.
+#define kUnitHighBytes			0xFF00FF00FF00FF00ULL
+#define kUnitLowBytes			0x0100010001000100ULL
+
+static long		SetRange(SynthCharacterSet * set, uint32_t first, uint32_t last);
+static long		MakePageWritable(SynthCharacterSet * set, uint32_t page);
+
+long SynthCharacterSetCreate(const SynthVoiceCharacterRange * ranges, uint32_t rangeCount, SynthCharacterSet ** outSet)
+{
+	SynthCharacterSet * set;
+	uint32_t rangeIndex;
+	long error = noErr;
+
+	if (outSet == NULL || (ranges == NULL && rangeCount > 0)) {
+		return paramErr;
+	}
+	*outSet = NULL;
+
+	set = (SynthCharacterSet *)calloc(1, sizeof(SynthCharacterSet));
+	if (set == NULL) {
+		return memFullErr;
+	}
+	set->blocks = (uint64_t *)malloc(2 * kWordsPerBlock * sizeof(uint64_t));
+	if (set->blocks == NULL) {
+		free(set);
+		return memFullErr;
+	}
+	memset(set->blocks + kSynthCharacterSetEmptyBlock * kWordsPerBlock, 0x00, kWordsPerBlock * sizeof(uint64_t));
+	memset(set->blocks + kSynthCharacterSetFullBlock * kWordsPerBlock, 0xFF, kWordsPerBlock * sizeof(uint64_t));
+	set->blockCount = 2;
+	atomic_init(&set->referenceCount, 1);
+
+	for (rangeIndex = 0; rangeIndex < rangeCount && error == noErr; rangeIndex++) {
+		uint32_t first = ranges[rangeIndex].first;
+		uint32_t last = ranges[rangeIndex].last;
+		if (first <= last && first < kSynthCharacterSetPageCount << 8) {
+			if (last >= kSynthCharacterSetPageCount << 8) {
+				last = (kSynthCharacterSetPageCount << 8) - 1;
+			}
+			error = SetRange(set, first, last);
+		}
+	}
+
+	if (error != noErr) {
+		SynthCharacterSetRelease(set);
+		return error;
+	}
+	*outSet = set;
+	return noErr;
+}
+
+SynthCharacterSet * SynthCharacterSetRetain(SynthCharacterSet * set)
+{
+	if (set) {
+		atomic_fetch_add_explicit(&set->referenceCount, 1, memory_order_relaxed);
+	}
+	return set;
+}
+
+void SynthCharacterSetRelease(SynthCharacterSet * set)
+{
+	if (set && atomic_fetch_sub_explicit(&set->referenceCount, 1, memory_order_acq_rel) == 1) {
+		free(set->blocks);
+		free(set);
+	}
+}
+
+uint32_t SynthCharacterSetFindFirstMissing(const SynthCharacterSet * set, const UniChar * text, uint32_t length)
+{
+	const uint16_t * pages = set->pages;
+	const uint64_t * blocks = set->blocks;
+	uint32_t offset = 0;
+
+	while (offset < length) {
+
+		// Text is mostly runs of one script, so take four code units at a time while they all fall in the same
+		// page: one page lookup covers them, and a page entirely in the set needs no bit tests at all.
+		while (offset + 4 <= length) {
+			uint64_t units;
+			uint32_t page = text[offset] >> 8;
+			memcpy(&units, text + offset, sizeof(units));
+			if ((units & kUnitHighBytes) != page * kUnitLowBytes || (page >= kHighSurrogatePage && page <= kLastSurrogatePage)) {
+				break;
+			}
+			if (pages[page] != kSynthCharacterSetFullBlock) {
+				const uint64_t * block = blocks + ((size_t)pages[page] << 2);
+				uint32_t unitIndex;
+				for (unitIndex = 0; unitIndex < 4; unitIndex++) {
+					uint32_t low = text[offset + unitIndex] & 0xFF;
+					if (((block[low >> 6] >> (low & 63)) & 1) == 0) {
+						return offset + unitIndex;
+					}
+				}
+			}
+			offset += 4;
+		}
+		if (offset >= length) {
+			break;
+		}
+
+		// One character the slow way: a page boundary, a surrogate pair or the tail of the text.
+		{
+			uint32_t character = text[offset];
+			uint32_t unitCount = 1;
+			if (character >= 0xD800 && character <= 0xDBFF && offset + 1 < length && text[offset + 1] >= 0xDC00 && text[offset + 1] <= 0xDFFF) {
+				character = 0x10000 + ((character - 0xD800) << 10) + (text[offset + 1] - 0xDC00);
+				unitCount = 2;
+			}
+			if (! SynthCharacterSetContains(set, character)) {
+				return offset;
+			}
+			offset += unitCount;
+		}
+	}
+	return length;
+}
+
+static long SetRange(SynthCharacterSet * set, uint32_t first, uint32_t last)
+{
+	uint32_t page;
+
+	for (page = first >> 8; page <= last >> 8; page++) {
+		uint32_t pageFirst = page << 8;
+		uint32_t pageLast = pageFirst + 0xFF;
+		uint32_t character, stop;
+		uint64_t * block;
+		long error;
+
+		if (set->pages[page] == kSynthCharacterSetFullBlock) {
+			continue;
+		}
+		if (first <= pageFirst && last >= pageLast) {
+			set->pages[page] = kSynthCharacterSetFullBlock;
+			continue;
+		}
+		error = MakePageWritable(set, page);
+		if (error != noErr) {
+			return error;
+		}
+		block = set->blocks + ((size_t)set->pages[page] << 2);
+		stop = last < pageLast ? last : pageLast;
+		for (character = first > pageFirst ? first : pageFirst; character <= stop; character++) {
+			block[(character >> 6) & 3] |= (uint64_t)1 << (character & 63);
+		}
+	}
+	return noErr;
+}
+
+// Gives a page that shares the empty block a block of its own.
+static long MakePageWritable(SynthCharacterSet * set, uint32_t page)
+{
+	uint64_t * blocks;
+
+	if (set->pages[page] != kSynthCharacterSetEmptyBlock) {
+		return noErr;
+	}
+	blocks = (uint64_t *)realloc(set->blocks, (size_t)(set->blockCount + 1) * kWordsPerBlock * sizeof(uint64_t));
+	if (blocks == NULL) {
+		return memFullErr;
+	}
+	set->blocks = blocks;
+	memset(blocks + (size_t)set->blockCount * kWordsPerBlock, 0, kWordsPerBlock * sizeof(uint64_t));
+	set->pages[page] = (uint16_t)set->blockCount++;
+	return noErr;
+}
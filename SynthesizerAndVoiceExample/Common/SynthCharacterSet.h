@@ -0,0 +1,98 @@
+/*
+	SynthCharacterSet.h
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Two-level bitmap of the characters a voice supports or spells out, compiled
+	from the UnicodeCharBegin/UnicodeCharEnd ranges in its VoiceAttributes.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#ifndef __SYNTHCHARACTERSET__
+#define __SYNTHCHARACTERSET__
+
+#include <stdatomic.h>
+#include "SynthEngineBase.h"
+#include "SynthVoiceIndex.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Every code point up to U+10FFFF, in pages of 256.  Each page maps to a 256-bit block; pages that are
+// entirely in or entirely out of the set share the two constant blocks, so a voice that supports a few
+// scripts costs a few kilobytes.
+#define kSynthCharacterSetPageCount			0x1100
+#define kSynthCharacterSetEmptyBlock		0
+#define kSynthCharacterSetFullBlock			1
+
+// Laid out here so SynthCharacterSetContains can be inlined; treat it as opaque otherwise.
+typedef struct SynthCharacterSet {
+	atomic_uint		referenceCount;
+	uint32_t		blockCount;
+	uint64_t *		blocks;									// blockCount blocks of four words.
+	uint16_t		pages[kSynthCharacterSetPageCount];		// Block of each page.
+} SynthCharacterSet;
+
+// Compiles the inclusive ranges into a set with one reference.  Ranges may overlap and come in any order;
+// the parts beyond U+10FFFF are ignored.
+long		SynthCharacterSetCreate(const SynthVoiceCharacterRange * ranges, uint32_t rangeCount, SynthCharacterSet ** outSet);
+SynthCharacterSet *	SynthCharacterSetRetain(SynthCharacterSet * set);
+void		SynthCharacterSetRelease(SynthCharacterSet * set);
+
+static inline Boolean SynthCharacterSetContains(const SynthCharacterSet * set, uint32_t character)
+{
+	const uint64_t * block;
+
+	if (character >= kSynthCharacterSetPageCount << 8) {
+		return false;
+	}
+	block = set->blocks + ((size_t)set->pages[character >> 8] << 2);
+	return (Boolean)((block[(character >> 6) & 3] >> (character & 63)) & 1);
+}
+
+// Returns the offset of the first character of the UTF-16 text that isn't in the set, or length if they all
+// are.  Surrogate pairs are looked up as the character they encode, and unpaired surrogates as themselves.
+uint32_t	SynthCharacterSetFindFirstMissing(const SynthCharacterSet * set, const UniChar * text, uint32_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
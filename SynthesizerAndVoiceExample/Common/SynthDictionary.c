@@ -0,0 +1,347 @@
+/*
+	SynthDictionary.c
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Compiled pronunciation dictionaries, and the slot a channel publishes its
+	dictionary through so it can be replaced while the channel is speaking.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include "SynthDictionary.h"
+#include "SynthTextAnalysis.h"
+#include "SynthPhonemeCache.h"
+
+typedef struct DictionaryEntry {
+	uint32_t	spellingOffset;
+	uint32_t	spellingLength;
+	uint32_t	codeOffset;
+	uint32_t	codeCount;
+} DictionaryEntry;
+
+// Entries sorted by spelling, folded to lower case, with the spellings and opcodes in pools after them.
+struct SynthDictionary {
+	atomic_uint			referenceCount;
+	uint64_t			generation;
+	uint32_t			entryCount;
+	DictionaryEntry *	entries;
+	UniChar *			spellings;
+	uint8_t *			codes;
+};
+
+// An entry on its way into a new dictionary, from the base or from the client.  order says which wins a tie.
+typedef struct PendingEntry {
+	const UniChar *	spelling;
+	uint32_t		spellingLength;
+	Boolean			isFolded;
+	const uint8_t *	codes;
+	uint32_t		codeCount;
+	uint32_t		order;
+} PendingEntry;
+
+static UniChar		FoldCharacter(UniChar c);
+static int			CompareSpellings(const UniChar * a, uint32_t aLength, Boolean aIsFolded, const UniChar * b, uint32_t bLength, Boolean bIsFolded);
+static int			ComparePendingEntries(const void * a, const void * b);
+static void			PublishLocked(SynthDictionarySlot * slot, SynthDictionary * dictionary);
+
+long SynthDictionaryCreate(const SynthDictionary * base, const SynthDictionaryEntry * entries, uint32_t entryCount, SynthDictionary ** outDictionary)
+{
+	uint32_t baseCount = (base) ? base->entryCount : 0;
+	uint32_t pendingCount = baseCount + entryCount;
+	PendingEntry * pending;
+	uint8_t * parsedCodes;
+	size_t spellingTotal = 0, codeTotal = 0, phonemesTotal = 0;
+	uint32_t index, keptCount;
+	SynthDictionary * dictionary;
+	long error = noErr;
+
+	if (outDictionary == NULL || (entries == NULL && entryCount > 0)) {
+		return paramErr;
+	}
+	*outDictionary = NULL;
+	for (index = 0; index < entryCount; index++) {
+		if (entries[index].spelling == NULL || entries[index].spellingLength <= 0 || entries[index].spellingLength > UINT16_MAX
+				|| entries[index].phonemes == NULL || entries[index].phonemesLength <= 0 || entries[index].phonemesLength > UINT16_MAX) {
+			return badDictFormat;
+		}
+		phonemesTotal += (size_t)entries[index].phonemesLength;
+	}
+
+	pending = (PendingEntry *)malloc((pendingCount ? pendingCount : 1) * sizeof(PendingEntry));
+	parsedCodes = (uint8_t *)malloc(phonemesTotal ? phonemesTotal : 1);
+	if (pending == NULL || parsedCodes == NULL) {
+		free(pending);
+		free(parsedCodes);
+		return memFullErr;
+	}
+
+	// The base's entries come first, then the new ones in the order given, so the latest of any spelling has the highest order.
+	for (index = 0; index < baseCount; index++) {
+		const DictionaryEntry * entry = &base->entries[index];
+		pending[index].spelling = base->spellings + entry->spellingOffset;
+		pending[index].spellingLength = entry->spellingLength;
+		pending[index].isFolded = true;
+		pending[index].codes = base->codes + entry->codeOffset;
+		pending[index].codeCount = entry->codeCount;
+		pending[index].order = index;
+	}
+	phonemesTotal = 0;
+	for (index = 0; index < entryCount && error == noErr; index++) {
+		PendingEntry * entry = &pending[baseCount + index];
+		entry->spelling = entries[index].spelling;
+		entry->spellingLength = (uint32_t)entries[index].spellingLength;
+		entry->isFolded = false;
+		entry->codes = parsedCodes + phonemesTotal;
+		entry->order = baseCount + index;
+		error = SynthTextParsePhonemes(entries[index].phonemes, entries[index].phonemesLength, parsedCodes + phonemesTotal, &entry->codeCount);
+		if (error == noErr && entry->codeCount == 0) {
+			error = badDictFormat;
+		}
+		phonemesTotal += entry->codeCount;
+	}
+
+	// Sorted by spelling, and within a spelling latest first, so the first of each run is the one to keep.
+	if (error == noErr) {
+		qsort(pending, pendingCount, sizeof(PendingEntry), ComparePendingEntries);
+		keptCount = 0;
+		for (index = 0; index < pendingCount; index++) {
+			if (keptCount == 0 || CompareSpellings(pending[keptCount - 1].spelling, pending[keptCount - 1].spellingLength, pending[keptCount - 1].isFolded,
+					pending[index].spelling, pending[index].spellingLength, pending[index].isFolded) != 0) {
+				pending[keptCount++] = pending[index];
+				spellingTotal += pending[index].spellingLength;
+				codeTotal += pending[index].codeCount;
+			}
+		}
+
+		dictionary = (SynthDictionary *)malloc(sizeof(SynthDictionary) + keptCount * sizeof(DictionaryEntry) + spellingTotal * sizeof(UniChar) + codeTotal);
+		if (dictionary == NULL) {
+			error = memFullErr;
+		}
+	}
+	if (error == noErr) {
+		uint32_t spellingOffset = 0, codeOffset = 0, charIndex;
+
+		atomic_init(&dictionary->referenceCount, 1);
+		dictionary->generation = SynthPhonemeCacheNewDictionaryGeneration();
+		dictionary->entryCount = keptCount;
+		dictionary->entries = (DictionaryEntry *)(dictionary + 1);
+		dictionary->spellings = (UniChar *)(dictionary->entries + keptCount);
+		dictionary->codes = (uint8_t *)(dictionary->spellings + spellingTotal);
+		for (index = 0; index < keptCount; index++) {
+			DictionaryEntry * entry = &dictionary->entries[index];
+			entry->spellingOffset = spellingOffset;
+			entry->spellingLength = pending[index].spellingLength;
+			entry->codeOffset = codeOffset;
+			entry->codeCount = pending[index].codeCount;
+			for (charIndex = 0; charIndex < entry->spellingLength; charIndex++) {
+				dictionary->spellings[spellingOffset + charIndex] = FoldCharacter(pending[index].spelling[charIndex]);
+			}
+			memcpy(dictionary->codes + codeOffset, pending[index].codes, entry->codeCount);
+			spellingOffset += entry->spellingLength;
+			codeOffset += entry->codeCount;
+		}
+		*outDictionary = dictionary;
+	}
+
+	free(pending);
+	free(parsedCodes);
+	return error;
+}
+
+SynthDictionary * SynthDictionaryRetain(SynthDictionary * dictionary)
+{
+	if (dictionary) {
+		atomic_fetch_add_explicit(&dictionary->referenceCount, 1, memory_order_relaxed);
+	}
+	return dictionary;
+}
+
+void SynthDictionaryRelease(SynthDictionary * dictionary)
+{
+	if (dictionary && atomic_fetch_sub_explicit(&dictionary->referenceCount, 1, memory_order_acq_rel) == 1) {
+
+		// Nothing can ask for this generation again, so its analyses go with it.
+		if (SynthPhonemeCacheShared()) {
+			SynthPhonemeCacheRemoveGeneration(SynthPhonemeCacheShared(), dictionary->generation);
+		}
+		free(dictionary);
+	}
+}
+
+uint64_t SynthDictionaryGeneration(const SynthDictionary * dictionary)
+{
+	return (dictionary) ? dictionary->generation : kSynthNoDictionaryGeneration;
+}
+
+uint32_t SynthDictionaryEntryCount(const SynthDictionary * dictionary)
+{
+	return (dictionary) ? dictionary->entryCount : 0;
+}
+
+Boolean SynthDictionaryLookup(const SynthDictionary * dictionary, const UniChar * word, long length, const uint8_t ** outCodes, uint32_t * outCodeCount)
+{
+	uint32_t low = 0, high;
+
+	if (dictionary == NULL || length <= 0 || length > UINT16_MAX) {
+		return false;
+	}
+	high = dictionary->entryCount;
+	while (low < high) {
+		uint32_t middle = low + (high - low) / 2;
+		const DictionaryEntry * entry = &dictionary->entries[middle];
+		int comparison = CompareSpellings(dictionary->spellings + entry->spellingOffset, entry->spellingLength, true, word, (uint32_t)length, false);
+		if (comparison == 0) {
+			*outCodes = dictionary->codes + entry->codeOffset;
+			*outCodeCount = entry->codeCount;
+			return true;
+		}
+		if (comparison < 0) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	return false;
+}
+
+void SynthDictionarySlotInit(SynthDictionarySlot * slot)
+{
+	atomic_init(&slot->current, NULL);
+	atomic_init(&slot->epoch, 0);
+	atomic_init(&slot->readers[0], 0);
+	atomic_init(&slot->readers[1], 0);
+	pthread_mutex_init(&slot->publishMutex, NULL);
+}
+
+void SynthDictionarySlotDispose(SynthDictionarySlot * slot)
+{
+	SynthDictionaryRelease(atomic_exchange(&slot->current, NULL));
+	pthread_mutex_destroy(&slot->publishMutex);
+}
+
+SynthDictionary * SynthDictionarySlotCopy(SynthDictionarySlot * slot)
+{
+	SynthDictionary * dictionary;
+	unsigned int epoch;
+
+	// Counted in the epoch that's still current once we're counted, so a publisher that moves past it waits for us.
+	// If it moved on before then, it may already have stopped waiting, so start over in the new one.
+	for (;;) {
+		epoch = atomic_load(&slot->epoch);
+		atomic_fetch_add(&slot->readers[epoch & 1], 1);
+		if (atomic_load(&slot->epoch) == epoch) {
+			break;
+		}
+		atomic_fetch_sub(&slot->readers[epoch & 1], 1);
+	}
+	dictionary = SynthDictionaryRetain(atomic_load(&slot->current));
+	atomic_fetch_sub(&slot->readers[epoch & 1], 1);
+	return dictionary;
+}
+
+long SynthDictionarySlotAddEntries(SynthDictionarySlot * slot, const SynthDictionaryEntry * entries, uint32_t entryCount)
+{
+	SynthDictionary * dictionary;
+	long error;
+
+	// Only publishers change the slot, and they take turns, so the current dictionary can be read without the epochs.
+	pthread_mutex_lock(&slot->publishMutex);
+	error = SynthDictionaryCreate(atomic_load(&slot->current), entries, entryCount, &dictionary);
+	if (error == noErr) {
+		PublishLocked(slot, dictionary);
+		SynthDictionaryRelease(dictionary);
+	}
+	pthread_mutex_unlock(&slot->publishMutex);
+	return error;
+}
+
+void SynthDictionarySlotPublish(SynthDictionarySlot * slot, SynthDictionary * dictionary)
+{
+	pthread_mutex_lock(&slot->publishMutex);
+	PublishLocked(slot, dictionary);
+	pthread_mutex_unlock(&slot->publishMutex);
+}
+
+static void PublishLocked(SynthDictionarySlot * slot, SynthDictionary * dictionary)
+{
+	SynthDictionary * oldDictionary = atomic_exchange(&slot->current, SynthDictionaryRetain(dictionary));
+	unsigned int epoch = atomic_fetch_add(&slot->epoch, 1);
+
+	// Readers counted in the old epoch may have read the old dictionary but not yet retained it.  Taking a reference
+	// is a few instructions, so this wait is short; nobody counted in the new epoch can see the old dictionary.
+	while (atomic_load(&slot->readers[epoch & 1]) != 0) {
+		sched_yield();
+	}
+	SynthDictionaryRelease(oldDictionary);
+}
+
+static UniChar FoldCharacter(UniChar c)
+{
+	return (c >= 'A' && c <= 'Z') ? (UniChar)(c - 'A' + 'a') : c;
+}
+
+static int CompareSpellings(const UniChar * a, uint32_t aLength, Boolean aIsFolded, const UniChar * b, uint32_t bLength, Boolean bIsFolded)
+{
+	uint32_t charIndex;
+
+	for (charIndex = 0; charIndex < aLength && charIndex < bLength; charIndex++) {
+		UniChar aChar = (aIsFolded) ? a[charIndex] : FoldCharacter(a[charIndex]);
+		UniChar bChar = (bIsFolded) ? b[charIndex] : FoldCharacter(b[charIndex]);
+		if (aChar != bChar) {
+			return (aChar < bChar) ? -1 : 1;
+		}
+	}
+	return (aLength < bLength) ? -1 : (aLength > bLength) ? 1 : 0;
+}
+
+static int ComparePendingEntries(const void * a, const void * b)
+{
+	const PendingEntry * entryA = (const PendingEntry *)a;
+	const PendingEntry * entryB = (const PendingEntry *)b;
+	int comparison = CompareSpellings(entryA->spelling, entryA->spellingLength, entryA->isFolded, entryB->spelling, entryB->spellingLength, entryB->isFolded);
+
+	if (comparison != 0) {
+		return comparison;
+	}
+	return (entryA->order > entryB->order) ? -1 : (entryA->order < entryB->order) ? 1 : 0;
+}
@@ -0,0 +1,113 @@
+/*
+	SynthDictionary.h
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Compiled pronunciation dictionaries, and the slot a channel publishes its
+	dictionary through so it can be replaced while the channel is speaking.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#ifndef __SYNTHDICTIONARY__
+#define __SYNTHDICTIONARY__
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "SynthEngineBase.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// One pronunciation as the client gives it: the word, and its phonemes as MacinTalk symbols, like "_tAXm1EYtOW".
+typedef struct SynthDictionaryEntry {
+	const UniChar *	spelling;
+	long			spellingLength;
+	const UniChar *	phonemes;
+	long			phonemesLength;
+} SynthDictionaryEntry;
+
+// A dictionary never changes once it's made; a change makes a new one.  Each has its own generation, under which
+// the phoneme cache keeps the analyses made with it, and when the last reference to it goes, so do they.
+typedef struct SynthDictionary SynthDictionary;
+
+// Makes a dictionary with one reference holding the entries of base, if there is one, and then the new entries,
+// which replace any of base's with the same spelling; of two new entries with the same spelling, the later wins.
+// Spellings match without regard to case.  Fails with badDictFormat if an entry has no spelling or phonemes, or
+// phonemes that aren't MacinTalk symbols.
+long		SynthDictionaryCreate(const SynthDictionary * base, const SynthDictionaryEntry * entries, uint32_t entryCount, SynthDictionary ** outDictionary);
+SynthDictionary *	SynthDictionaryRetain(SynthDictionary * dictionary);
+void		SynthDictionaryRelease(SynthDictionary * dictionary);
+
+// kSynthNoDictionaryGeneration for NULL.
+uint64_t	SynthDictionaryGeneration(const SynthDictionary * dictionary);
+uint32_t	SynthDictionaryEntryCount(const SynthDictionary * dictionary);
+
+// Finds the word, passing back its phoneme opcodes, which last as long as the dictionary.
+Boolean		SynthDictionaryLookup(const SynthDictionary * dictionary, const UniChar * word, long length, const uint8_t ** outCodes, uint32_t * outCodeCount);
+
+// Where a channel's current dictionary is published.  Taking a reference to the current dictionary never waits:
+// a reader announces itself in the count for the current epoch, and a publisher, having swapped in the new
+// dictionary, moves to the next epoch and waits for the old epoch's readers to finish taking their references
+// before it drops the slot's own reference to the old dictionary.  Readers that already have the old one keep
+// it, and it goes away when the last of them is done with it.
+typedef struct SynthDictionarySlot {
+	_Atomic(SynthDictionary *)	current;
+	atomic_uint					epoch;
+	atomic_uint					readers[2];			// Readers in the middle of taking a reference, by epoch parity.
+	pthread_mutex_t				publishMutex;		// Publishers take turns; readers never touch it.
+} SynthDictionarySlot;
+
+void		SynthDictionarySlotInit(SynthDictionarySlot * slot);
+void		SynthDictionarySlotDispose(SynthDictionarySlot * slot);
+
+// The current dictionary with a reference the caller must release, or NULL if there's none.
+SynthDictionary *	SynthDictionarySlotCopy(SynthDictionarySlot * slot);
+
+// Makes a dictionary of the current one's entries plus the new ones and publishes it.
+long		SynthDictionarySlotAddEntries(SynthDictionarySlot * slot, const SynthDictionaryEntry * entries, uint32_t entryCount);
+
+// Publishes dictionary, which may be NULL, taking a reference to it.
+void		SynthDictionarySlotPublish(SynthDictionarySlot * slot, SynthDictionary * dictionary);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,104 @@
+/*
+	SynthEngineBase.h
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Definitions shared by the portable parts of the example synthesis
+	engine.  Everything declared here, and in the SynthEngine and SynthBoundary
+	files that include it, compiles with a plain C99 compiler on Mac OS X and on
+	other POSIX systems, so the engine core can be exercised without Cocoa.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#ifndef __SYNTHENGINEBASE__
+#define __SYNTHENGINEBASE__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__APPLE__)
+#include <ApplicationServices/ApplicationServices.h>
+#else
+#include <stdbool.h>
+
+// Off Mac OS X the Speech Synthesis Manager headers aren't available, so define the
+// types, result codes and constants the engine core uses with the same values.
+typedef unsigned char	Boolean;
+typedef uint16_t		UniChar;
+
+enum {
+	noErr				= 0,
+	ioErr				= -36,
+	fnfErr				= -43,
+	paramErr			= -50,
+	userCanceledErr		= -128,
+	memFullErr			= -108,
+	siUnknownInfoType	= -231,
+	noSynthFound		= -240,
+	synthOpenFailed		= -241,
+	synthNotReady		= -242,
+	bufTooSmall			= -243,
+	voiceNotFound		= -244,
+	badDictFormat		= -246
+};
+
+enum {
+	kImmediate			= 0,
+	kEndOfWord			= 1,
+	kEndOfSentence		= 2
+};
+
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// All sample positions reported by the engine core are in frames of mono audio at this rate.
+#define kSynthEngineSampleRate		22050
+
+// Converts between seconds and sample positions at kSynthEngineSampleRate.
+#define SynthEngineSecondsToSamples(seconds)	((uint64_t)((seconds) * kSynthEngineSampleRate + 0.5))
+#define SynthEngineSamplesToSeconds(samples)	((double)(samples) / (double)kSynthEngineSampleRate)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
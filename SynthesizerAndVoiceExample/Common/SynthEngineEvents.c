@@ -0,0 +1,230 @@
+/*
+	SynthEngineEvents.c
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Bounded multi-producer event queue.  See SynthEngineEvents.h.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "SynthEngineEvents.h"
+
+// Each slot's sequence number says whose turn it is: equal to the position when it's free for
+// the producer at that position, position + 1 when it holds that producer's event.
+typedef struct EventSlot {
+	atomic_size_t		sequence;
+	SynthEngineEvent	event;
+} EventSlot;
+
+struct SynthEngineEventQueue {
+	EventSlot *			slots;
+	size_t				mask;
+	atomic_size_t		enqueuePosition;
+	atomic_size_t		dequeuePosition;
+	atomic_ullong		droppedCount;
+
+	// Only used to put readers to sleep; posting takes the lock only when someone is waiting.
+	atomic_uint			waitingReaders;
+	pthread_mutex_t		lock;
+	pthread_cond_t		available;
+};
+
+long SynthEngineEventQueueCreate(uint32_t capacity, SynthEngineEventQueue ** outQueue)
+{
+	SynthEngineEventQueue * queue;
+	size_t slotCount = 2;
+	size_t slotIndex;
+
+	if (outQueue == NULL || capacity == 0) {
+		return paramErr;
+	}
+	while (slotCount < capacity) {
+		slotCount <<= 1;
+	}
+
+	queue = (SynthEngineEventQueue *)calloc(1, sizeof(SynthEngineEventQueue));
+	if (queue == NULL) {
+		return memFullErr;
+	}
+	queue->slots = (EventSlot *)calloc(slotCount, sizeof(EventSlot));
+	if (queue->slots == NULL) {
+		free(queue);
+		return memFullErr;
+	}
+
+	queue->mask = slotCount - 1;
+	for (slotIndex = 0; slotIndex < slotCount; slotIndex++) {
+		atomic_init(&queue->slots[slotIndex].sequence, slotIndex);
+	}
+	atomic_init(&queue->enqueuePosition, 0);
+	atomic_init(&queue->dequeuePosition, 0);
+	atomic_init(&queue->droppedCount, 0);
+	atomic_init(&queue->waitingReaders, 0);
+	pthread_mutex_init(&queue->lock, NULL);
+	pthread_cond_init(&queue->available, NULL);
+
+	*outQueue = queue;
+	return noErr;
+}
+
+void SynthEngineEventQueueDispose(SynthEngineEventQueue * queue)
+{
+	if (queue) {
+		pthread_cond_destroy(&queue->available);
+		pthread_mutex_destroy(&queue->lock);
+		free(queue->slots);
+		free(queue);
+	}
+}
+
+long SynthEngineEventQueuePost(SynthEngineEventQueue * queue, const SynthEngineEvent * event)
+{
+	size_t position = atomic_load_explicit(&queue->enqueuePosition, memory_order_relaxed);
+	EventSlot * slot;
+
+	for (;;) {
+		size_t sequence;
+		slot = &queue->slots[position & queue->mask];
+		sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+		if (sequence == position) {
+			if (atomic_compare_exchange_weak_explicit(&queue->enqueuePosition, &position, position + 1, memory_order_relaxed, memory_order_relaxed)) {
+				break;
+			}
+		}
+		else if (sequence < position) {
+			// The reader hasn't freed this slot yet: the queue is full.
+			atomic_fetch_add_explicit(&queue->droppedCount, 1, memory_order_relaxed);
+			return bufTooSmall;
+		}
+		else {
+			position = atomic_load_explicit(&queue->enqueuePosition, memory_order_relaxed);
+		}
+	}
+
+	slot->event = *event;
+	atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+
+	if (atomic_load(&queue->waitingReaders) > 0) {
+		pthread_mutex_lock(&queue->lock);
+		pthread_cond_broadcast(&queue->available);
+		pthread_mutex_unlock(&queue->lock);
+	}
+
+	return noErr;
+}
+
+Boolean SynthEngineEventQueueTryNext(SynthEngineEventQueue * queue, SynthEngineEvent * event)
+{
+	size_t position = atomic_load_explicit(&queue->dequeuePosition, memory_order_relaxed);
+	EventSlot * slot;
+
+	for (;;) {
+		size_t sequence;
+		slot = &queue->slots[position & queue->mask];
+		sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+		if (sequence == position + 1) {
+			if (atomic_compare_exchange_weak_explicit(&queue->dequeuePosition, &position, position + 1, memory_order_relaxed, memory_order_relaxed)) {
+				break;
+			}
+		}
+		else if (sequence < position + 1) {
+			return false;
+		}
+		else {
+			position = atomic_load_explicit(&queue->dequeuePosition, memory_order_relaxed);
+		}
+	}
+
+	*event = slot->event;
+	atomic_store_explicit(&slot->sequence, position + queue->mask + 1, memory_order_release);
+	return true;
+}
+
+Boolean SynthEngineEventQueueWaitNext(SynthEngineEventQueue * queue, SynthEngineEvent * event, double timeout)
+{
+	struct timespec deadline;
+	Boolean found = SynthEngineEventQueueTryNext(queue, event);
+
+	if (found || timeout == 0.0) {
+		return found;
+	}
+
+	if (timeout > 0.0) {
+		struct timeval now;
+		gettimeofday(&now, NULL);
+		deadline.tv_sec = now.tv_sec + (time_t)timeout;
+		deadline.tv_nsec = now.tv_usec * 1000 + (long)((timeout - (double)(time_t)timeout) * 1.0e9);
+		if (deadline.tv_nsec >= 1000000000) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000;
+		}
+	}
+
+	pthread_mutex_lock(&queue->lock);
+	atomic_fetch_add(&queue->waitingReaders, 1);
+	for (;;) {
+		// Checked after announcing ourselves, so a post either sees us waiting or we see its event.
+		found = SynthEngineEventQueueTryNext(queue, event);
+		if (found) {
+			break;
+		}
+		if (timeout > 0.0) {
+			if (pthread_cond_timedwait(&queue->available, &queue->lock, &deadline) != 0) {
+				found = SynthEngineEventQueueTryNext(queue, event);
+				break;
+			}
+		}
+		else {
+			pthread_cond_wait(&queue->available, &queue->lock);
+		}
+	}
+	atomic_fetch_sub(&queue->waitingReaders, 1);
+	pthread_mutex_unlock(&queue->lock);
+
+	return found;
+}
+
+uint64_t SynthEngineEventQueueDroppedCount(SynthEngineEventQueue * queue)
+{
+	return atomic_load_explicit(&queue->droppedCount, memory_order_relaxed);
+}
@@ -0,0 +1,100 @@
+/*
+	SynthEngineEvents.h
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: A bounded queue of speech events (words, phonemes, completion) that
+	the engine fills as it speaks and clients drain when they're ready.  Any
+	number of channels may post to the same queue, so one thread can follow the
+	progress of many utterances without a callback per event.  Posting never
+	blocks; readers can poll or wait.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#ifndef __SYNTHENGINEEVENTS__
+#define __SYNTHENGINEEVENTS__
+
+#include "SynthEngineBase.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum SynthEngineEventKind {
+	kSynthEngineWordEvent			= 1,		// characterOffset and length give the word's range in the text.
+	kSynthEnginePhonemeEvent		= 2,		// code is the phoneme opcode.
+	kSynthEngineSyncEvent			= 3,		// code is the sync command's message.
+	kSynthEngineErrorEvent			= 4,		// code is the error, characterOffset where it occurred.
+	kSynthEngineSpeechDoneEvent		= 5			// code is noErr when the text was finished, userCanceledErr when it was stopped.
+} SynthEngineEventKind;
+
+typedef struct SynthEngineEvent {
+	uint32_t	kind;
+	long		channel;			// SpeechChannelIdentifier of the channel that posted the event.
+	uint64_t	utteranceTag;		// Tag the client gave the utterance, see kSynthEngineUtteranceTagProperty.
+	uint64_t	samplePosition;		// Audio position of the event within the utterance.
+	long		characterOffset;
+	long		length;
+	long		code;
+} SynthEngineEvent;
+
+typedef struct SynthEngineEventQueue SynthEngineEventQueue;
+
+// capacity is rounded up to a power of two.
+long		SynthEngineEventQueueCreate(uint32_t capacity, SynthEngineEventQueue ** outQueue);
+void		SynthEngineEventQueueDispose(SynthEngineEventQueue * queue);
+
+// Adds an event without blocking.  When the queue is full the event is dropped, counted, and
+// bufTooSmall is returned.
+long		SynthEngineEventQueuePost(SynthEngineEventQueue * queue, const SynthEngineEvent * event);
+
+// Removes the oldest event.  Returns false right away if there is none.
+Boolean		SynthEngineEventQueueTryNext(SynthEngineEventQueue * queue, SynthEngineEvent * event);
+
+// Removes the oldest event, waiting up to timeout seconds for one (a negative timeout waits forever).
+Boolean		SynthEngineEventQueueWaitNext(SynthEngineEventQueue * queue, SynthEngineEvent * event, double timeout);
+
+// Number of events dropped because the queue was full.
+uint64_t	SynthEngineEventQueueDroppedCount(SynthEngineEventQueue * queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
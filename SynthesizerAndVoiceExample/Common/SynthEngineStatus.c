@@ -0,0 +1,150 @@
+/*
+	SynthEngineStatus.c
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Lock-free publication of a channel's speaking status.  See
+	SynthEngineStatus.h.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#include <sched.h>
+#include "SynthEngineStatus.h"
+
+enum {
+	kStatusFlagBusy		= 1 << 0,
+	kStatusFlagPaused	= 1 << 1
+};
+
+static void BeginWrite(SynthEngineStatus * status);
+static void EndWrite(SynthEngineStatus * status);
+
+void SynthEngineStatusInit(SynthEngineStatus * status)
+{
+	atomic_init(&status->sequence, 0);
+	atomic_init(&status->flags, 0);
+	atomic_init(&status->charactersLeft, 0);
+	atomic_init(&status->characterOffset, 0);
+	atomic_init(&status->phonemeCode, 0);
+	atomic_init(&status->samplePosition, 0);
+}
+
+void SynthEngineStatusPublish(SynthEngineStatus * status, const SynthEngineStatusSnapshot * snapshot)
+{
+	BeginWrite(status);
+	atomic_store_explicit(&status->flags, (snapshot->outputBusy ? kStatusFlagBusy : 0) | (snapshot->outputPaused ? kStatusFlagPaused : 0), memory_order_relaxed);
+	atomic_store_explicit(&status->charactersLeft, snapshot->charactersLeft, memory_order_relaxed);
+	atomic_store_explicit(&status->characterOffset, snapshot->characterOffset, memory_order_relaxed);
+	atomic_store_explicit(&status->phonemeCode, snapshot->phonemeCode, memory_order_relaxed);
+	atomic_store_explicit(&status->samplePosition, snapshot->samplePosition, memory_order_relaxed);
+	EndWrite(status);
+}
+
+void SynthEngineStatusPublishProgress(SynthEngineStatus * status, long characterOffset, long charactersLeft, short phonemeCode, uint64_t samplePosition)
+{
+	BeginWrite(status);
+	atomic_store_explicit(&status->charactersLeft, charactersLeft, memory_order_relaxed);
+	atomic_store_explicit(&status->characterOffset, characterOffset, memory_order_relaxed);
+	atomic_store_explicit(&status->phonemeCode, phonemeCode, memory_order_relaxed);
+	atomic_store_explicit(&status->samplePosition, samplePosition, memory_order_relaxed);
+	EndWrite(status);
+}
+
+void SynthEngineStatusPublishState(SynthEngineStatus * status, Boolean outputBusy, Boolean outputPaused)
+{
+	BeginWrite(status);
+	atomic_store_explicit(&status->flags, (outputBusy ? kStatusFlagBusy : 0) | (outputPaused ? kStatusFlagPaused : 0), memory_order_relaxed);
+	if (! outputBusy && ! outputPaused) {
+		// An idle channel has nothing left to say.
+		atomic_store_explicit(&status->charactersLeft, 0, memory_order_relaxed);
+		atomic_store_explicit(&status->phonemeCode, 0, memory_order_relaxed);
+	}
+	EndWrite(status);
+}
+
+void SynthEngineStatusRead(const SynthEngineStatus * status, SynthEngineStatusSnapshot * snapshot)
+{
+	SynthEngineStatus * mutableStatus = (SynthEngineStatus *)status;
+	unsigned int before, after;
+	int flags;
+
+	do {
+		before = atomic_load_explicit(&mutableStatus->sequence, memory_order_acquire);
+		while (before & 1) {
+			// A writer is in the middle of an update; it only has a handful of stores left to do.
+			sched_yield();
+			before = atomic_load_explicit(&mutableStatus->sequence, memory_order_acquire);
+		}
+
+		flags = atomic_load_explicit(&mutableStatus->flags, memory_order_relaxed);
+		snapshot->charactersLeft = atomic_load_explicit(&mutableStatus->charactersLeft, memory_order_relaxed);
+		snapshot->characterOffset = atomic_load_explicit(&mutableStatus->characterOffset, memory_order_relaxed);
+		snapshot->phonemeCode = (short)atomic_load_explicit(&mutableStatus->phonemeCode, memory_order_relaxed);
+		snapshot->samplePosition = atomic_load_explicit(&mutableStatus->samplePosition, memory_order_relaxed);
+
+		atomic_thread_fence(memory_order_acquire);
+		after = atomic_load_explicit(&mutableStatus->sequence, memory_order_relaxed);
+	} while (before != after);
+
+	snapshot->outputBusy = (flags & kStatusFlagBusy) != 0;
+	snapshot->outputPaused = (flags & kStatusFlagPaused) != 0;
+}
+
+
+static void BeginWrite(SynthEngineStatus * status)
+{
+	// Claim the status by moving the sequence from even to odd.  Writers on the same channel are
+	// rare (the renderer and an occasional stop or pause) so contention here is momentary.
+	unsigned int sequence = atomic_load_explicit(&status->sequence, memory_order_relaxed);
+	for (;;) {
+		if ((sequence & 1) == 0 && atomic_compare_exchange_weak_explicit(&status->sequence, &sequence, sequence + 1, memory_order_acquire, memory_order_relaxed)) {
+			break;
+		}
+		if (sequence & 1) {
+			sched_yield();
+			sequence = atomic_load_explicit(&status->sequence, memory_order_relaxed);
+		}
+	}
+	atomic_thread_fence(memory_order_release);
+}
+
+static void EndWrite(SynthEngineStatus * status)
+{
+	atomic_fetch_add_explicit(&status->sequence, 1, memory_order_release);
+}
@@ -0,0 +1,97 @@
+/*
+	SynthEngineStatus.h
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Per-channel speaking status shared between the thread that renders
+	speech and the threads that ask about it.  The renderer publishes its
+	progress with a sequence counter and atomic fields, and readers take a
+	consistent snapshot without ever blocking the renderer.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#ifndef __SYNTHENGINESTATUS__
+#define __SYNTHENGINESTATUS__
+
+#include <stdatomic.h>
+#include "SynthEngineBase.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct SynthEngineStatusSnapshot {
+	Boolean		outputBusy;
+	Boolean		outputPaused;
+	long		charactersLeft;		// Characters of the current text not yet spoken.
+	long		characterOffset;	// Offset of the character being spoken.
+	short		phonemeCode;		// Opcode of the phoneme being spoken, 0 when silent.
+	uint64_t	samplePosition;		// Audio position within the current utterance.
+} SynthEngineStatusSnapshot;
+
+// Every field is written inside an odd sequence number and read between two equal even ones.
+typedef struct SynthEngineStatus {
+	atomic_uint			sequence;
+	atomic_int			flags;
+	atomic_long			charactersLeft;
+	atomic_long			characterOffset;
+	atomic_int			phonemeCode;
+	atomic_ullong		samplePosition;
+} SynthEngineStatus;
+
+void	SynthEngineStatusInit(SynthEngineStatus * status);
+
+// Publishes a complete new status.  Writers never wait for readers.
+void	SynthEngineStatusPublish(SynthEngineStatus * status, const SynthEngineStatusSnapshot * snapshot);
+
+// Publishes the progress fields of a busy channel, leaving busy and paused as they are.  This is
+// the call the renderer makes for every phoneme.
+void	SynthEngineStatusPublishProgress(SynthEngineStatus * status, long characterOffset, long charactersLeft, short phonemeCode, uint64_t samplePosition);
+
+// Publishes a change of busy or paused state, leaving the progress fields as they are.
+void	SynthEngineStatusPublishState(SynthEngineStatus * status, Boolean outputBusy, Boolean outputPaused);
+
+// Copies a consistent view of the status, retrying if a write was in progress.
+void	SynthEngineStatusRead(const SynthEngineStatus * status, SynthEngineStatusSnapshot * snapshot);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,845 @@
+/*
+	SynthEngineWorkers.c
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Work-stealing worker pool used to run speech channels.  See
+	SynthEngineWorkers.h.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+#include "SynthEngineWorkers.h"
+
+typedef struct SynthEngineJob {
+	SynthEngineJobProc	proc;
+	void *				context;
+	double				dueTime;		// 0 for jobs that weren't timed.
+	SynthEnginePriority	priority;
+} SynthEngineJob;
+
+// Ring buffer of jobs.  The owning worker pushes and pops at the tail; thieves take from the head.
+typedef struct WorkerQueue {
+	pthread_mutex_t		lock;
+	SynthEngineJob *	jobs;
+	uint32_t			capacity;
+	uint32_t			head;
+	uint32_t			count;
+} WorkerQueue;
+
+typedef struct TimedJob {
+	double				dueTime;
+	uint64_t			order;			// Keeps jobs due at the same time in submission order.
+	SynthEngineJob		job;
+} TimedJob;
+
+typedef struct WorkerThread {
+	SynthEngineWorkers *	workers;
+	uint32_t				index;
+	pthread_t				thread;
+} WorkerThread;
+
+struct SynthEngineWorkers {
+	uint32_t			workerCount;
+	uint32_t			bulkWorkerLimit;
+	WorkerThread *		threads;
+	WorkerQueue *		queues;			// kSynthEnginePriorityCount queues per worker, interactive first.
+	atomic_uint			nextQueue;
+	atomic_long			queuedJobs[kSynthEnginePriorityCount];
+	atomic_uint			runningBulkJobs;
+
+	atomic_ullong		jobsRun[kSynthEnginePriorityCount];
+	atomic_ullong		deadlineMisses[kSynthEnginePriorityCount];
+	atomic_ullong		worstLatenessNanoseconds[kSynthEnginePriorityCount];
+	atomic_ullong		latenessHistogram[kSynthEnginePriorityCount][kSynthEngineLatenessBuckets];
+
+	// Protects the timed jobs, the sleeping count and shutdown.
+	pthread_mutex_t		lock;
+	pthread_cond_t		wakeup;
+	TimedJob *			timedJobs;		// Binary min-heap on (dueTime, order).
+	uint32_t			timedJobCount;
+	uint32_t			timedJobCapacity;
+	uint64_t			timedJobOrder;
+	uint32_t			sleepingWorkers;
+	Boolean				shuttingDown;
+
+	// A virtual pool has one set of queues and no threads.  Its clock is a double kept as its
+	// bit pattern, so it reads back exactly what was stored.
+	Boolean				isVirtual;
+	Boolean				isRunning;		// Someone is in SynthEngineWorkersRunUntil.
+	atomic_ullong		virtualTimeBits;
+};
+
+static pthread_key_t		sCurrentWorkerKey;
+static pthread_once_t		sCurrentWorkerKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_mutex_t		sSharedLock = PTHREAD_MUTEX_INITIALIZER;
+static SynthEngineWorkers *	sSharedWorkers = NULL;
+static uint32_t				sSharedWorkerCount = 0;
+static Boolean				sSharedIsVirtual = false;
+static double				sSharedStartTime = 0.0;
+
+static long		AllocateWorkers(uint32_t workerCount, SynthEngineWorkers ** outWorkers);
+static void *	WorkerMain(void * argument);
+static Boolean	TakeJob(SynthEngineWorkers * workers, uint32_t workerIndex, SynthEngineJob * job);
+static Boolean	TakeJobWithPriority(SynthEngineWorkers * workers, uint32_t workerIndex, SynthEnginePriority priority, SynthEngineJob * job);
+static Boolean	ClaimBulkWorker(SynthEngineWorkers * workers);
+static Boolean	HasRunnableJobs(SynthEngineWorkers * workers);
+static void		RecordJob(SynthEngineWorkers * workers, const SynthEngineJob * job);
+static WorkerQueue * QueueFor(SynthEngineWorkers * workers, uint32_t workerIndex, SynthEnginePriority priority);
+static long		QueuePush(WorkerQueue * queue, SynthEngineJob job);
+static Boolean	QueuePopTail(WorkerQueue * queue, SynthEngineJob * job);
+static Boolean	QueuePopHead(WorkerQueue * queue, Boolean mayWait, SynthEngineJob * job);
+static Boolean	TimedJobIsEarlier(const TimedJob * a, const TimedJob * b);
+static void		TimedJobsPush(SynthEngineWorkers * workers, TimedJob timedJob);
+static TimedJob	TimedJobsPop(SynthEngineWorkers * workers);
+static double	MonotonicTime(void);
+static double	VirtualTime(const SynthEngineWorkers * workers);
+static void		SetVirtualTime(SynthEngineWorkers * workers, double time);
+static void		MakeCurrentWorkerKey(void);
+static uint32_t	DefaultWorkerCount(void);
+
+long SynthEngineWorkersCreate(uint32_t workerCount, SynthEngineWorkers ** outWorkers)
+{
+	SynthEngineWorkers * workers;
+	uint32_t workerIndex;
+	long error;
+
+	if (outWorkers == NULL) {
+		return paramErr;
+	}
+	*outWorkers = NULL;
+
+	pthread_once(&sCurrentWorkerKeyOnce, MakeCurrentWorkerKey);
+
+	if (workerCount == 0) {
+		workerCount = DefaultWorkerCount();
+	}
+
+	// With a single worker, a long bulk render would leave interactive speech nowhere to run until it finished, so the
+	// reserved workers come on top of the one bulk work gets, even on a single processor.
+	if (workerCount < kSynthEngineMinimumWorkerCount) {
+		workerCount = kSynthEngineMinimumWorkerCount;
+	}
+
+	error = AllocateWorkers(workerCount, &workers);
+	if (error != noErr) {
+		return error;
+	}
+
+	for (workerIndex = 0; workerIndex < workerCount && error == noErr; workerIndex++) {
+		workers->threads[workerIndex].workers = workers;
+		workers->threads[workerIndex].index = workerIndex;
+		if (pthread_create(&workers->threads[workerIndex].thread, NULL, WorkerMain, &workers->threads[workerIndex]) != 0) {
+			// Run with however many threads we did get, as long as there are enough to keep the reserved ones.
+			workers->workerCount = workerIndex;
+			error = (workerIndex >= kSynthEngineMinimumWorkerCount) ? noErr : memFullErr;
+			break;
+		}
+	}
+
+	// Bulk work gets every worker but the reserved ones.
+	workers->bulkWorkerLimit = workers->workerCount - kSynthEngineReservedInteractiveWorkers;
+
+	if (error == noErr) {
+		*outWorkers = workers;
+	}
+	else {
+		SynthEngineWorkersDispose(workers);
+	}
+
+	return error;
+}
+
+long SynthEngineWorkersCreateVirtual(double startTime, SynthEngineWorkers ** outWorkers)
+{
+	SynthEngineWorkers * workers;
+	long error;
+
+	if (outWorkers == NULL) {
+		return paramErr;
+	}
+	*outWorkers = NULL;
+
+	pthread_once(&sCurrentWorkerKeyOnce, MakeCurrentWorkerKey);
+
+	error = AllocateWorkers(1, &workers);
+	if (error == noErr) {
+		workers->isVirtual = true;
+		workers->bulkWorkerLimit = 1;
+		SetVirtualTime(workers, startTime);
+		*outWorkers = workers;
+	}
+
+	return error;
+}
+
+void SynthEngineWorkersDispose(SynthEngineWorkers * workers)
+{
+	uint32_t workerIndex;
+
+	if (workers == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&workers->lock);
+	workers->shuttingDown = true;
+	pthread_cond_broadcast(&workers->wakeup);
+	pthread_mutex_unlock(&workers->lock);
+
+	if (! workers->isVirtual) {
+		for (workerIndex = 0; workerIndex < workers->workerCount; workerIndex++) {
+			pthread_join(workers->threads[workerIndex].thread, NULL);
+		}
+	}
+	for (workerIndex = 0; workerIndex < workers->workerCount * kSynthEnginePriorityCount; workerIndex++) {
+		pthread_mutex_destroy(&workers->queues[workerIndex].lock);
+		free(workers->queues[workerIndex].jobs);
+	}
+
+	pthread_cond_destroy(&workers->wakeup);
+	pthread_mutex_destroy(&workers->lock);
+	free(workers->timedJobs);
+	free(workers->queues);
+	free(workers->threads);
+	free(workers);
+}
+
+SynthEngineWorkers * SynthEngineWorkersShared(void)
+{
+	pthread_mutex_lock(&sSharedLock);
+	if (sSharedWorkers == NULL) {
+		uint32_t workerCount = sSharedWorkerCount;
+		const char * virtualString = getenv(kSynthEngineVirtualClockVariable);
+		if (sSharedIsVirtual || (virtualString && strcmp(virtualString, "1") == 0)) {
+			SynthEngineWorkersCreateVirtual(sSharedStartTime, &sSharedWorkers);
+		}
+		else {
+			if (workerCount == 0) {
+				const char * countString = getenv(kSynthEngineWorkerCountVariable);
+				if (countString) {
+					workerCount = (uint32_t)strtoul(countString, NULL, 10);
+				}
+			}
+			SynthEngineWorkersCreate(workerCount, &sSharedWorkers);
+		}
+	}
+	pthread_mutex_unlock(&sSharedLock);
+
+	return sSharedWorkers;
+}
+
+long SynthEngineWorkersSetSharedCount(uint32_t workerCount)
+{
+	long error = noErr;
+
+	pthread_mutex_lock(&sSharedLock);
+	if (sSharedWorkers) {
+		// The shared pool is already running with its own count.
+		error = synthNotReady;
+	}
+	else {
+		sSharedWorkerCount = workerCount;
+	}
+	pthread_mutex_unlock(&sSharedLock);
+
+	return error;
+}
+
+long SynthEngineWorkersSetSharedVirtual(double startTime)
+{
+	long error = noErr;
+
+	pthread_mutex_lock(&sSharedLock);
+	if (sSharedWorkers) {
+		error = synthNotReady;
+	}
+	else {
+		sSharedIsVirtual = true;
+		sSharedStartTime = startTime;
+	}
+	pthread_mutex_unlock(&sSharedLock);
+
+	return error;
+}
+
+uint32_t SynthEngineWorkersCount(const SynthEngineWorkers * workers)
+{
+	return workers->workerCount;
+}
+
+long SynthEngineWorkersSubmit(SynthEngineWorkers * workers, SynthEnginePriority priority, SynthEngineJobProc proc, void * context)
+{
+	WorkerThread * currentWorker;
+	uint32_t queueIndex;
+	SynthEngineJob job;
+	long error;
+
+	if (workers == NULL || proc == NULL || priority >= kSynthEnginePriorityCount) {
+		return paramErr;
+	}
+
+	job.proc = proc;
+	job.context = context;
+	job.dueTime = 0.0;
+	job.priority = priority;
+
+	currentWorker = (WorkerThread *)pthread_getspecific(sCurrentWorkerKey);
+	if (currentWorker && currentWorker->workers == workers) {
+		queueIndex = currentWorker->index;
+	}
+	else {
+		queueIndex = atomic_fetch_add_explicit(&workers->nextQueue, 1, memory_order_relaxed) % workers->workerCount;
+	}
+
+	error = QueuePush(QueueFor(workers, queueIndex, priority), job);
+	if (error == noErr) {
+		atomic_fetch_add_explicit(&workers->queuedJobs[priority], 1, memory_order_release);
+
+		// Taking the lock orders this against a worker that has just found nothing to do and is about to sleep.
+		pthread_mutex_lock(&workers->lock);
+		if (workers->sleepingWorkers > 0) {
+			pthread_cond_signal(&workers->wakeup);
+		}
+		pthread_mutex_unlock(&workers->lock);
+	}
+
+	return error;
+}
+
+long SynthEngineWorkersSubmitAt(SynthEngineWorkers * workers, SynthEnginePriority priority, double dueTime, SynthEngineJobProc proc, void * context)
+{
+	TimedJob timedJob;
+
+	if (workers == NULL || proc == NULL || priority >= kSynthEnginePriorityCount) {
+		return paramErr;
+	}
+
+	timedJob.dueTime = dueTime;
+	timedJob.job.proc = proc;
+	timedJob.job.context = context;
+	timedJob.job.dueTime = dueTime;
+	timedJob.job.priority = priority;
+
+	pthread_mutex_lock(&workers->lock);
+	if (workers->timedJobCount == workers->timedJobCapacity) {
+		uint32_t newCapacity = (workers->timedJobCapacity) ? workers->timedJobCapacity * 2 : 64;
+		TimedJob * newTimedJobs = (TimedJob *)realloc(workers->timedJobs, newCapacity * sizeof(TimedJob));
+		if (newTimedJobs == NULL) {
+			pthread_mutex_unlock(&workers->lock);
+			return memFullErr;
+		}
+		workers->timedJobs = newTimedJobs;
+		workers->timedJobCapacity = newCapacity;
+	}
+	timedJob.order = workers->timedJobOrder++;
+	TimedJobsPush(workers, timedJob);
+
+	// A sleeping worker may need to wake up earlier than it planned to.
+	if (workers->sleepingWorkers > 0) {
+		pthread_cond_signal(&workers->wakeup);
+	}
+	pthread_mutex_unlock(&workers->lock);
+
+	return noErr;
+}
+
+void SynthEngineWorkersGetStatistics(SynthEngineWorkers * workers, SynthEngineWorkerStatistics * statistics)
+{
+	uint32_t priority, bucket;
+
+	for (priority = 0; priority < kSynthEnginePriorityCount; priority++) {
+		statistics->jobsRun[priority] = atomic_load_explicit(&workers->jobsRun[priority], memory_order_relaxed);
+		statistics->deadlineMisses[priority] = atomic_load_explicit(&workers->deadlineMisses[priority], memory_order_relaxed);
+		statistics->worstLateness[priority] = (double)atomic_load_explicit(&workers->worstLatenessNanoseconds[priority], memory_order_relaxed) * 1.0e-9;
+		for (bucket = 0; bucket < kSynthEngineLatenessBuckets; bucket++) {
+			statistics->latenessHistogram[priority][bucket] = atomic_load_explicit(&workers->latenessHistogram[priority][bucket], memory_order_relaxed);
+		}
+	}
+}
+
+double SynthEngineWorkersCurrentTime(const SynthEngineWorkers * workers)
+{
+	return (workers->isVirtual) ? VirtualTime(workers) : MonotonicTime();
+}
+
+Boolean SynthEngineWorkersIsVirtual(const SynthEngineWorkers * workers)
+{
+	return workers->isVirtual;
+}
+
+long SynthEngineWorkersRunUntil(SynthEngineWorkers * workers, double time, uint64_t * outJobsRun)
+{
+	uint64_t jobsRun = 0;
+	SynthEngineJob job;
+	uint32_t priority;
+
+	if (workers == NULL || ! workers->isVirtual) {
+		return paramErr;
+	}
+
+	pthread_mutex_lock(&workers->lock);
+	if (workers->isRunning) {
+		pthread_mutex_unlock(&workers->lock);
+		return synthNotReady;
+	}
+	workers->isRunning = true;
+	pthread_mutex_unlock(&workers->lock);
+
+	for (;;) {
+		Boolean found = false;
+
+		// Everything runnable now goes first, oldest first.
+		for (priority = 0; priority < kSynthEnginePriorityCount && ! found; priority++) {
+			if (QueuePopHead(QueueFor(workers, 0, (SynthEnginePriority)priority), true, &job)) {
+				atomic_fetch_sub_explicit(&workers->queuedJobs[priority], 1, memory_order_relaxed);
+				found = true;
+			}
+		}
+		if (found) {
+			RecordJob(workers, &job);
+			(*job.proc)(job.context);
+			jobsRun++;
+			continue;
+		}
+
+		// Then move the clock to the next timed job and queue everything due at that moment.
+		pthread_mutex_lock(&workers->lock);
+		if (workers->timedJobCount > 0 && workers->timedJobs[0].dueTime <= time) {
+			double now = VirtualTime(workers);
+			if (workers->timedJobs[0].dueTime > now) {
+				now = workers->timedJobs[0].dueTime;
+				SetVirtualTime(workers, now);
+			}
+			while (workers->timedJobCount > 0 && workers->timedJobs[0].dueTime <= now) {
+				TimedJob timedJob = TimedJobsPop(workers);
+				if (QueuePush(QueueFor(workers, 0, timedJob.job.priority), timedJob.job) == noErr) {
+					atomic_fetch_add_explicit(&workers->queuedJobs[timedJob.job.priority], 1, memory_order_release);
+				}
+			}
+			pthread_mutex_unlock(&workers->lock);
+			continue;
+		}
+
+		if (isfinite(time) && time > VirtualTime(workers)) {
+			SetVirtualTime(workers, time);
+		}
+		workers->isRunning = false;
+		pthread_mutex_unlock(&workers->lock);
+		break;
+	}
+
+	if (outJobsRun) {
+		*outJobsRun = jobsRun;
+	}
+	return noErr;
+}
+
+
+static long AllocateWorkers(uint32_t workerCount, SynthEngineWorkers ** outWorkers)
+{
+	SynthEngineWorkers * workers;
+	uint32_t queueIndex, priority, bucket;
+
+	workers = (SynthEngineWorkers *)calloc(1, sizeof(SynthEngineWorkers));
+	if (workers == NULL) {
+		return memFullErr;
+	}
+	workers->workerCount = workerCount;
+	workers->threads = (WorkerThread *)calloc(workerCount, sizeof(WorkerThread));
+	workers->queues = (WorkerQueue *)calloc(workerCount * kSynthEnginePriorityCount, sizeof(WorkerQueue));
+	if (workers->threads == NULL || workers->queues == NULL) {
+		free(workers->threads);
+		free(workers->queues);
+		free(workers);
+		return memFullErr;
+	}
+	atomic_init(&workers->nextQueue, 0);
+	atomic_init(&workers->runningBulkJobs, 0);
+	for (priority = 0; priority < kSynthEnginePriorityCount; priority++) {
+		atomic_init(&workers->queuedJobs[priority], 0);
+		atomic_init(&workers->jobsRun[priority], 0);
+		atomic_init(&workers->deadlineMisses[priority], 0);
+		atomic_init(&workers->worstLatenessNanoseconds[priority], 0);
+		for (bucket = 0; bucket < kSynthEngineLatenessBuckets; bucket++) {
+			atomic_init(&workers->latenessHistogram[priority][bucket], 0);
+		}
+	}
+	atomic_init(&workers->virtualTimeBits, 0);
+	pthread_mutex_init(&workers->lock, NULL);
+	pthread_cond_init(&workers->wakeup, NULL);
+	for (queueIndex = 0; queueIndex < workerCount * kSynthEnginePriorityCount; queueIndex++) {
+		pthread_mutex_init(&workers->queues[queueIndex].lock, NULL);
+	}
+
+	*outWorkers = workers;
+	return noErr;
+}
+
+static void * WorkerMain(void * argument)
+{
+	WorkerThread * self = (WorkerThread *)argument;
+	SynthEngineWorkers * workers = self->workers;
+	SynthEngineJob job;
+
+	pthread_setspecific(sCurrentWorkerKey, self);
+
+	for (;;) {
+		if (TakeJob(workers, self->index, &job)) {
+			RecordJob(workers, &job);
+			(*job.proc)(job.context);
+
+			if (job.priority == kSynthEnginePriorityBulk) {
+				// A bulk slot has opened up; wake someone if bulk work was waiting for one.
+				atomic_fetch_sub_explicit(&workers->runningBulkJobs, 1, memory_order_release);
+				if (atomic_load_explicit(&workers->queuedJobs[kSynthEnginePriorityBulk], memory_order_acquire) > 0) {
+					pthread_mutex_lock(&workers->lock);
+					if (workers->sleepingWorkers > 0) {
+						pthread_cond_signal(&workers->wakeup);
+					}
+					pthread_mutex_unlock(&workers->lock);
+				}
+			}
+			continue;
+		}
+
+		pthread_mutex_lock(&workers->lock);
+
+		if (workers->shuttingDown) {
+			pthread_mutex_unlock(&workers->lock);
+			break;
+		}
+
+		// Move every timed job that has come due onto this worker's queue.  If there are several,
+		// other workers will steal them.
+		if (workers->timedJobCount > 0 && workers->timedJobs[0].dueTime <= MonotonicTime()) {
+			double now = MonotonicTime();
+			while (workers->timedJobCount > 0 && workers->timedJobs[0].dueTime <= now) {
+				TimedJob timedJob = TimedJobsPop(workers);
+				if (QueuePush(QueueFor(workers, self->index, timedJob.job.priority), timedJob.job) == noErr) {
+					atomic_fetch_add_explicit(&workers->queuedJobs[timedJob.job.priority], 1, memory_order_release);
+				}
+			}
+			pthread_mutex_unlock(&workers->lock);
+			continue;
+		}
+
+		// Nothing this worker may run.  Sleep until work is submitted, a bulk slot frees up, or the
+		// earliest timed job is due.
+		if (! HasRunnableJobs(workers)) {
+			workers->sleepingWorkers++;
+			if (workers->timedJobCount > 0) {
+				double delay = workers->timedJobs[0].dueTime - MonotonicTime();
+				struct timeval now;
+				struct timespec deadline;
+
+				// The job may have come due since HasRunnableJobs looked; a negative delay would make tv_nsec
+				// negative, which pthread_cond_timedwait rejects straight away, over and over.
+				if (delay < 0.0) {
+					delay = 0.0;
+				}
+				gettimeofday(&now, NULL);
+				deadline.tv_sec = now.tv_sec + (time_t)delay;
+				deadline.tv_nsec = now.tv_usec * 1000 + (long)((delay - (double)(time_t)delay) * 1.0e9);
+				if (deadline.tv_nsec >= 1000000000) {
+					deadline.tv_sec++;
+					deadline.tv_nsec -= 1000000000;
+				}
+				pthread_cond_timedwait(&workers->wakeup, &workers->lock, &deadline);
+			}
+			else {
+				pthread_cond_wait(&workers->wakeup, &workers->lock);
+			}
+			workers->sleepingWorkers--;
+		}
+
+		pthread_mutex_unlock(&workers->lock);
+	}
+
+	return NULL;
+}
+
+static Boolean TakeJob(SynthEngineWorkers * workers, uint32_t workerIndex, SynthEngineJob * job)
+{
+	// Interactive work always goes first, from anywhere in the pool.
+	if (atomic_load_explicit(&workers->queuedJobs[kSynthEnginePriorityInteractive], memory_order_acquire) > 0 && TakeJobWithPriority(workers, workerIndex, kSynthEnginePriorityInteractive, job)) {
+		return true;
+	}
+
+	// Bulk work only runs on workers that aren't being held back for interactive channels.
+	if (atomic_load_explicit(&workers->queuedJobs[kSynthEnginePriorityBulk], memory_order_acquire) > 0 && ClaimBulkWorker(workers)) {
+		if (TakeJobWithPriority(workers, workerIndex, kSynthEnginePriorityBulk, job)) {
+			return true;
+		}
+		atomic_fetch_sub_explicit(&workers->runningBulkJobs, 1, memory_order_release);
+	}
+
+	return false;
+}
+
+static Boolean TakeJobWithPriority(SynthEngineWorkers * workers, uint32_t workerIndex, SynthEnginePriority priority, SynthEngineJob * job)
+{
+	uint32_t offset;
+
+	if (QueuePopTail(QueueFor(workers, workerIndex, priority), job)) {
+		atomic_fetch_sub_explicit(&workers->queuedJobs[priority], 1, memory_order_relaxed);
+		return true;
+	}
+
+	// Our own queue is empty; steal the oldest job from the first other worker that has one.
+	for (offset = 1; offset < workers->workerCount; offset++) {
+		if (QueuePopHead(QueueFor(workers, (workerIndex + offset) % workers->workerCount, priority), false, job)) {
+			atomic_fetch_sub_explicit(&workers->queuedJobs[priority], 1, memory_order_relaxed);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static Boolean ClaimBulkWorker(SynthEngineWorkers * workers)
+{
+	unsigned int running = atomic_load_explicit(&workers->runningBulkJobs, memory_order_relaxed);
+
+	while (running < workers->bulkWorkerLimit) {
+		if (atomic_compare_exchange_weak_explicit(&workers->runningBulkJobs, &running, running + 1, memory_order_acquire, memory_order_relaxed)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static Boolean HasRunnableJobs(SynthEngineWorkers * workers)
+{
+	return atomic_load_explicit(&workers->queuedJobs[kSynthEnginePriorityInteractive], memory_order_acquire) > 0
+		|| (atomic_load_explicit(&workers->queuedJobs[kSynthEnginePriorityBulk], memory_order_acquire) > 0
+			&& atomic_load_explicit(&workers->runningBulkJobs, memory_order_acquire) < workers->bulkWorkerLimit);
+}
+
+static void RecordJob(SynthEngineWorkers * workers, const SynthEngineJob * job)
+{
+	atomic_fetch_add_explicit(&workers->jobsRun[job->priority], 1, memory_order_relaxed);
+
+	if (job->dueTime > 0.0) {
+		double lateness = SynthEngineWorkersCurrentTime(workers) - job->dueTime;
+		unsigned long long latenessMicroseconds = (lateness > 0.0) ? (unsigned long long)(lateness * 1.0e6) : 0;
+		uint32_t bucket = 0;
+
+		while (latenessMicroseconds && bucket < kSynthEngineLatenessBuckets - 1) {
+			latenessMicroseconds >>= 1;
+			bucket++;
+		}
+		atomic_fetch_add_explicit(&workers->latenessHistogram[job->priority][bucket], 1, memory_order_relaxed);
+
+		if (lateness > 0.0) {
+			unsigned long long latenessNanoseconds = (unsigned long long)(lateness * 1.0e9);
+			unsigned long long worst = atomic_load_explicit(&workers->worstLatenessNanoseconds[job->priority], memory_order_relaxed);
+			while (latenessNanoseconds > worst && ! atomic_compare_exchange_weak_explicit(&workers->worstLatenessNanoseconds[job->priority], &worst, latenessNanoseconds, memory_order_relaxed, memory_order_relaxed)) {
+			}
+
+			// Only interactive work has a real-time deadline; bulk work is done when it's done.
+			if (job->priority == kSynthEnginePriorityInteractive && lateness > kSynthEngineInteractiveDeadline) {
+				atomic_fetch_add_explicit(&workers->deadlineMisses[job->priority], 1, memory_order_relaxed);
+			}
+		}
+	}
+}
+
+static WorkerQueue * QueueFor(SynthEngineWorkers * workers, uint32_t workerIndex, SynthEnginePriority priority)
+{
+	return &workers->queues[workerIndex * kSynthEnginePriorityCount + priority];
+}
+
+static long QueuePush(WorkerQueue * queue, SynthEngineJob job)
+{
+	long error = noErr;
+
+	pthread_mutex_lock(&queue->lock);
+	if (queue->count == queue->capacity) {
+		uint32_t newCapacity = (queue->capacity) ? queue->capacity * 2 : 64;
+		SynthEngineJob * newJobs = (SynthEngineJob *)malloc(newCapacity * sizeof(SynthEngineJob));
+		if (newJobs) {
+			uint32_t jobIndex;
+			for (jobIndex = 0; jobIndex < queue->count; jobIndex++) {
+				newJobs[jobIndex] = queue->jobs[(queue->head + jobIndex) % queue->capacity];
+			}
+			free(queue->jobs);
+			queue->jobs = newJobs;
+			queue->capacity = newCapacity;
+			queue->head = 0;
+		}
+		else {
+			error = memFullErr;
+		}
+	}
+	if (error == noErr) {
+		queue->jobs[(queue->head + queue->count) % queue->capacity] = job;
+		queue->count++;
+	}
+	pthread_mutex_unlock(&queue->lock);
+
+	return error;
+}
+
+static Boolean QueuePopTail(WorkerQueue * queue, SynthEngineJob * job)
+{
+	Boolean found = false;
+
+	pthread_mutex_lock(&queue->lock);
+	if (queue->count > 0) {
+		queue->count--;
+		*job = queue->jobs[(queue->head + queue->count) % queue->capacity];
+		found = true;
+	}
+	pthread_mutex_unlock(&queue->lock);
+
+	return found;
+}
+
+static Boolean QueuePopHead(WorkerQueue * queue, Boolean mayWait, SynthEngineJob * job)
+{
+	Boolean found = false;
+
+	// Thieves don't wait on a queue its owner is using; there are other places to look.
+	if ((mayWait) ? pthread_mutex_lock(&queue->lock) == 0 : pthread_mutex_trylock(&queue->lock) == 0) {
+		if (queue->count > 0) {
+			*job = queue->jobs[queue->head];
+			queue->head = (queue->head + 1) % queue->capacity;
+			queue->count--;
+			found = true;
+		}
+		pthread_mutex_unlock(&queue->lock);
+	}
+
+	return found;
+}
+
+static Boolean TimedJobIsEarlier(const TimedJob * a, const TimedJob * b)
+{
+	return a->dueTime < b->dueTime || (a->dueTime == b->dueTime && a->order < b->order);
+}
+
+static void TimedJobsPush(SynthEngineWorkers * workers, TimedJob timedJob)
+{
+	uint32_t childIndex = workers->timedJobCount++;
+
+	while (childIndex > 0) {
+		uint32_t parentIndex = (childIndex - 1) / 2;
+		if (! TimedJobIsEarlier(&timedJob, &workers->timedJobs[parentIndex])) {
+			break;
+		}
+		workers->timedJobs[childIndex] = workers->timedJobs[parentIndex];
+		childIndex = parentIndex;
+	}
+	workers->timedJobs[childIndex] = timedJob;
+}
+
+static TimedJob TimedJobsPop(SynthEngineWorkers * workers)
+{
+	TimedJob earliest = workers->timedJobs[0];
+	TimedJob last = workers->timedJobs[--workers->timedJobCount];
+	uint32_t parentIndex = 0;
+
+	for (;;) {
+		uint32_t childIndex = parentIndex * 2 + 1;
+		if (childIndex >= workers->timedJobCount) {
+			break;
+		}
+		if (childIndex + 1 < workers->timedJobCount && TimedJobIsEarlier(&workers->timedJobs[childIndex + 1], &workers->timedJobs[childIndex])) {
+			childIndex++;
+		}
+		if (! TimedJobIsEarlier(&workers->timedJobs[childIndex], &last)) {
+			break;
+		}
+		workers->timedJobs[parentIndex] = workers->timedJobs[childIndex];
+		parentIndex = childIndex;
+	}
+	if (workers->timedJobCount > 0) {
+		workers->timedJobs[parentIndex] = last;
+	}
+
+	return earliest;
+}
+
+static double MonotonicTime(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + (double)now.tv_nsec * 1.0e-9;
+}
+
+static double VirtualTime(const SynthEngineWorkers * workers)
+{
+	unsigned long long bits = atomic_load_explicit(&((SynthEngineWorkers *)workers)->virtualTimeBits, memory_order_acquire);
+	double time;
+	memcpy(&time, &bits, sizeof(time));
+	return time;
+}
+
+static void SetVirtualTime(SynthEngineWorkers * workers, double time)
+{
+	unsigned long long bits;
+	memcpy(&bits, &time, sizeof(bits));
+	atomic_store_explicit(&workers->virtualTimeBits, bits, memory_order_release);
+}
+
+static void MakeCurrentWorkerKey(void)
+{
+	pthread_key_create(&sCurrentWorkerKey, NULL);
+}
+
+static uint32_t DefaultWorkerCount(void)
+{
+	long processorCount = sysconf(_SC_NPROCESSORS_ONLN);
+	uint32_t workerCount = kSynthEngineDefaultWorkerCount;
+
+	if (processorCount > 0 && (uint32_t)processorCount < workerCount) {
+		workerCount = (uint32_t)processorCount;
+	}
+
+	return workerCount;
+}
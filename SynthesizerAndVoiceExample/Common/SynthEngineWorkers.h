@@ -0,0 +1,159 @@
+/*
+	SynthEngineWorkers.h
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: A small pool of worker threads owned by the engine.  Speech channels
+	schedule their synthesis, event dispatch and output work here instead of on
+	the run loop of whichever thread started speaking, so speech keeps going when
+	the host's main thread is busy, and in hosts that have no run loop at all.
+	Each worker keeps its own queues of jobs; idle workers steal from the others.
+	Interactive jobs always run before bulk jobs, and bulk jobs are never allowed
+	to occupy every worker, so interactive channels keep meeting their deadlines
+	while bulk renders use whatever capacity is left.
+
+	A pool can instead run on a virtual clock, with no threads of its own.  Its
+	jobs run on whichever thread calls SynthEngineWorkersRunUntil, one at a time
+	in due order, and its clock only moves when that call moves it.  A test
+	harness can then speak an utterance in the time it takes to compute it, and
+	get the same callbacks in the same order with the same timestamps every run.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#ifndef __SYNTHENGINEWORKERS__
+#define __SYNTHENGINEWORKERS__
+
+#include "SynthEngineBase.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Used when no worker count has been configured; the count is further limited to the number of processors.
+#define kSynthEngineDefaultWorkerCount		4
+
+// Environment variable that overrides the worker count of the shared pool.
+#define kSynthEngineWorkerCountVariable		"SYNTH_ENGINE_WORKER_COUNT"
+
+// Environment variable that, when set to 1, makes the shared pool run on a virtual clock starting at 0.
+#define kSynthEngineVirtualClockVariable	"SYNTH_ENGINE_VIRTUAL_CLOCK"
+
+// Interactive timed jobs that start more than this long after they were due count as deadline misses.
+// It's the length of one output buffer, so a late job means an audible gap.
+#define kSynthEngineInteractiveDeadline		0.010
+
+// Number of workers that bulk jobs may never occupy.  A pool of threads always has at least one worker more than this,
+// however few were asked for or however few processors there are, so a bulk render can never hold up interactive speech.
+#define kSynthEngineReservedInteractiveWorkers	1
+#define kSynthEngineMinimumWorkerCount		(kSynthEngineReservedInteractiveWorkers + 1)
+
+typedef enum SynthEnginePriority {
+	kSynthEnginePriorityInteractive		= 0,		// Speech someone is listening to as it's produced.
+	kSynthEnginePriorityBulk			= 1,		// Offline renders, such as speaking to a file.
+	kSynthEnginePriorityCount			= 2
+} SynthEnginePriority;
+
+// Timed jobs are counted by how late they ran in buckets of powers of two microseconds: bucket 0 for less than a
+// microsecond, bucket n for at least 2^(n-1) and less than 2^n, and the last bucket for anything later than that.
+#define kSynthEngineLatenessBuckets			24
+
+typedef struct SynthEngineWorkerStatistics {
+	uint64_t	jobsRun[kSynthEnginePriorityCount];
+	uint64_t	deadlineMisses[kSynthEnginePriorityCount];
+	double		worstLateness[kSynthEnginePriorityCount];		// Seconds past due of the latest timed job.
+	uint64_t	latenessHistogram[kSynthEnginePriorityCount][kSynthEngineLatenessBuckets];
+} SynthEngineWorkerStatistics;
+
+typedef struct SynthEngineWorkers SynthEngineWorkers;
+typedef void (*SynthEngineJobProc)(void * context);
+
+// Creates a pool with workerCount threads, or the default count when workerCount is 0, but never fewer than
+// kSynthEngineMinimumWorkerCount.
+long		SynthEngineWorkersCreate(uint32_t workerCount, SynthEngineWorkers ** outWorkers);
+
+// Creates a pool with no threads whose clock starts at startTime and only advances in
+// SynthEngineWorkersRunUntil.
+long		SynthEngineWorkersCreateVirtual(double startTime, SynthEngineWorkers ** outWorkers);
+
+// Stops the workers and waits for them to exit.  Jobs that haven't started are discarded
+// without being called, so contexts must not depend on them running.
+void		SynthEngineWorkersDispose(SynthEngineWorkers * workers);
+
+// The pool shared by every channel in the process.  It's created on first use with the count
+// passed to SynthEngineWorkersSetSharedCount, else the count in kSynthEngineWorkerCountVariable,
+// else the default.  It's a virtual pool instead if SynthEngineWorkersSetSharedVirtual was
+// called first, or kSynthEngineVirtualClockVariable is set.
+SynthEngineWorkers *	SynthEngineWorkersShared(void);
+long		SynthEngineWorkersSetSharedCount(uint32_t workerCount);
+long		SynthEngineWorkersSetSharedVirtual(double startTime);
+
+uint32_t	SynthEngineWorkersCount(const SynthEngineWorkers * workers);
+
+// Runs proc(context) on a worker as soon as one is free.  Jobs submitted from a worker go on
+// that worker's own queue, so a channel that keeps rescheduling itself stays on a warm thread
+// unless another worker runs out of work and steals it.
+long		SynthEngineWorkersSubmit(SynthEngineWorkers * workers, SynthEnginePriority priority, SynthEngineJobProc proc, void * context);
+
+// Runs proc(context) once the pool's clock reaches dueTime.
+long		SynthEngineWorkersSubmitAt(SynthEngineWorkers * workers, SynthEnginePriority priority, double dueTime, SynthEngineJobProc proc, void * context);
+
+// Counters of jobs run and deadlines missed since the pool was created.
+void		SynthEngineWorkersGetStatistics(SynthEngineWorkers * workers, SynthEngineWorkerStatistics * statistics);
+
+// The pool's clock, in seconds.  It's monotonic and unrelated to the time of day.
+double		SynthEngineWorkersCurrentTime(const SynthEngineWorkers * workers);
+
+Boolean		SynthEngineWorkersIsVirtual(const SynthEngineWorkers * workers);
+
+// Runs a virtual pool's jobs on the calling thread until none is due at or before time.
+// Runnable jobs go first, interactive before bulk and each in submission order; then the clock
+// jumps to the earliest timed job, and those due then are queued in (due time, submission) order
+// and run the same way.  WorkersClockTest checks this order against a known-good log.
+// The clock ends at time, or where the last job ran when time is HUGE_VAL, which runs until
+// no jobs are left.  outJobsRun may be NULL.  Only one thread may run a pool at a time, and
+// runs are only reproducible if jobs are submitted from that thread or from the jobs
+// themselves.  Returns paramErr for a threaded pool and synthNotReady when called from
+// inside a job.
+long		SynthEngineWorkersRunUntil(SynthEngineWorkers * workers, double time, uint64_t * outJobsRun);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
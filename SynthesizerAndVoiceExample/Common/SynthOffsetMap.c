@@ -0,0 +1,200 @@
+/*
+	SynthOffsetMap.c
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: See SynthOffsetMap.h.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "SynthOffsetMap.h"
+
+static uint32_t	SequenceLength(const uint8_t * bytes, uint32_t remaining);
+static uint32_t	FindFirstNonASCII(const uint8_t * bytes, uint32_t byteLength);
+
+long SynthOffsetMapCreate(const void * bytes, uint32_t byteLength, SynthOffsetMap ** outMap)
+{
+	const uint8_t * text = (const uint8_t *)bytes;
+	SynthOffsetMap * map;
+	uint32_t byteOffset, characterOffset, characterLength, sequenceLength, index;
+	uint32_t characterBlockCount, byteBlockCount;
+	size_t size;
+
+	if (outMap == NULL || (byteLength > 0 && bytes == NULL) || byteLength >= UINT32_MAX - kSynthOffsetMapBlockLength) {
+		return paramErr;
+	}
+	*outMap = NULL;
+
+	// Text that's all ASCII, or isn't UTF-8, has a character for every byte and needs no blocks.
+	byteOffset = FindFirstNonASCII(text, byteLength);
+	characterLength = byteOffset;
+	while (byteOffset < byteLength) {
+		sequenceLength = SequenceLength(text + byteOffset, byteLength - byteOffset);
+		if (sequenceLength == 0) {
+			break;
+		}
+		byteOffset += sequenceLength;
+		characterLength += (sequenceLength == 4) ? 2 : 1;
+	}
+	if (characterLength == byteLength || byteOffset < byteLength) {
+		map = (SynthOffsetMap *)calloc(1, sizeof(SynthOffsetMap));
+		if (map == NULL) {
+			return memFullErr;
+		}
+		map->encoding = kSynthMacRomanEncoding;
+		map->byteLength = byteLength;
+		map->characterLength = byteLength;
+		*outMap = map;
+		return noErr;
+	}
+
+	// Both directions in one block of memory, the offsets before the deltas to keep them aligned.
+	characterBlockCount = (characterLength >> kSynthOffsetMapBlockShift) + 1;
+	byteBlockCount = (byteLength >> kSynthOffsetMapBlockShift) + 1;
+	size = sizeof(SynthOffsetMap) + (characterBlockCount + byteBlockCount) * sizeof(uint32_t) + (characterLength + 1) + (byteLength + 1);
+	map = (SynthOffsetMap *)malloc(size);
+	if (map == NULL) {
+		return memFullErr;
+	}
+	map->encoding = kSynthUTF8Encoding;
+	map->byteLength = byteLength;
+	map->characterLength = characterLength;
+	map->characterBlocks = (uint32_t *)(map + 1);
+	map->byteBlocks = map->characterBlocks + characterBlockCount;
+	map->characterDeltas = (uint8_t *)(map->byteBlocks + byteBlockCount);
+	map->byteDeltas = map->characterDeltas + characterLength + 1;
+
+	// Every byte of a sequence maps to its first character, and both characters of a surrogate pair to its first byte.
+	// A block's offsets grow by at most three bytes a character or one character a byte, so the deltas fit.
+	characterOffset = 0;
+	byteOffset = 0;
+	while (byteOffset <= byteLength) {
+		uint32_t characterCount;
+		sequenceLength = (byteOffset < byteLength) ? SequenceLength(text + byteOffset, byteLength - byteOffset) : 1;
+		characterCount = (sequenceLength == 4) ? 2 : 1;
+		for (index = 0; index < characterCount; index++, characterOffset++) {
+			if ((characterOffset & (kSynthOffsetMapBlockLength - 1)) == 0) {
+				map->characterBlocks[characterOffset >> kSynthOffsetMapBlockShift] = byteOffset;
+			}
+			map->characterDeltas[characterOffset] = (uint8_t)(byteOffset - map->characterBlocks[characterOffset >> kSynthOffsetMapBlockShift]);
+		}
+		for (index = 0; index < sequenceLength; index++) {
+			uint32_t position = byteOffset + index;
+			if ((position & (kSynthOffsetMapBlockLength - 1)) == 0) {
+				map->byteBlocks[position >> kSynthOffsetMapBlockShift] = characterOffset - characterCount;
+			}
+			map->byteDeltas[position] = (uint8_t)(characterOffset - characterCount - map->byteBlocks[position >> kSynthOffsetMapBlockShift]);
+		}
+		byteOffset += sequenceLength;
+	}
+
+	*outMap = map;
+	return noErr;
+}
+
+void SynthOffsetMapDispose(SynthOffsetMap * map)
+{
+	free(map);
+}
+
+// Returns the length of the well-formed UTF-8 sequence at bytes, or 0 if there isn't one.
+static uint32_t SequenceLength(const uint8_t * bytes, uint32_t remaining)
+{
+	uint8_t lead = bytes[0];
+	uint8_t low = 0x80, high = 0xBF;
+	uint32_t length, index;
+
+	if (lead < 0x80) {
+		return 1;
+	}
+	if (lead >= 0xC2 && lead <= 0xDF) {
+		length = 2;
+	}
+	else if (lead >= 0xE0 && lead <= 0xEF) {
+		length = 3;
+		if (lead == 0xE0) {
+			low = 0xA0;			// Overlong.
+		}
+		else if (lead == 0xED) {
+			high = 0x9F;		// Surrogates.
+		}
+	}
+	else if (lead >= 0xF0 && lead <= 0xF4) {
+		length = 4;
+		if (lead == 0xF0) {
+			low = 0x90;			// Overlong.
+		}
+		else if (lead == 0xF4) {
+			high = 0x8F;		// Past U+10FFFF.
+		}
+	}
+	else {
+		return 0;
+	}
+	if (remaining < length || bytes[1] < low || bytes[1] > high) {
+		return 0;
+	}
+	for (index = 2; index < length; index++) {
+		if (bytes[index] < 0x80 || bytes[index] > 0xBF) {
+			return 0;
+		}
+	}
+	return length;
+}
+
+// ASCII is checked eight bytes at a time.
+static uint32_t FindFirstNonASCII(const uint8_t * bytes, uint32_t byteLength)
+{
+	uint32_t offset = 0;
+	uint64_t word;
+
+	while (offset + sizeof(word) <= byteLength) {
+		memcpy(&word, bytes + offset, sizeof(word));
+		if (word & 0x8080808080808080ULL) {
+			break;
+		}
+		offset += sizeof(word);
+	}
+	while (offset < byteLength && bytes[offset] < 0x80) {
+		offset++;
+	}
+	return offset;
+}
@@ -0,0 +1,112 @@
+/*
+	SynthOffsetMap.h
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Maps between byte offsets in the text a legacy client passes and offsets in
+	its UTF-16 characters, in constant time either way.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#ifndef __SYNTHOFFSETMAP__
+#define __SYNTHOFFSETMAP__
+
+#include "SynthEngineBase.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// How a buffer of text is read.  One that's valid UTF-8 and uses more than ASCII is UTF-8; any other is Mac Roman,
+// as the buffer calls have always taken it, with one character to the byte.
+typedef enum SynthByteEncoding {
+	kSynthMacRomanEncoding			= 0,
+	kSynthUTF8Encoding				= 1
+} SynthByteEncoding;
+
+// Offsets are kept in blocks of kSynthOffsetMapBlockLength: the offset at the start of each block in full, and for
+// every position its distance from there in a byte.  Where each byte is a character there are no blocks at all.
+#define kSynthOffsetMapBlockShift		6
+#define kSynthOffsetMapBlockLength		(1 << kSynthOffsetMapBlockShift)
+
+// Laid out here so the lookups can be inlined; treat it as opaque otherwise.
+typedef struct SynthOffsetMap {
+	uint32_t		encoding;
+	uint32_t		byteLength;
+	uint32_t		characterLength;		// In UTF-16 characters.
+	uint32_t *		characterBlocks;		// Byte offset of the first character of each block, or NULL.
+	uint8_t *		characterDeltas;		// characterLength + 1 entries.
+	uint32_t *		byteBlocks;				// Character offset of the first byte of each block.
+	uint8_t *		byteDeltas;				// byteLength + 1 entries.
+} SynthOffsetMap;
+
+// Reads the buffer once to choose its encoding and map it.  Doesn't keep bytes.
+long		SynthOffsetMapCreate(const void * bytes, uint32_t byteLength, SynthOffsetMap ** outMap);
+void		SynthOffsetMapDispose(SynthOffsetMap * map);
+
+// The byte offset at which the character containing the UTF-16 character at characterOffset begins.  Offsets past
+// the end map to the end.
+static inline uint32_t SynthOffsetMapByteOffset(const SynthOffsetMap * map, uint32_t characterOffset)
+{
+	if (characterOffset > map->characterLength) {
+		characterOffset = map->characterLength;
+	}
+	if (map->characterBlocks == NULL) {
+		return characterOffset;
+	}
+	return map->characterBlocks[characterOffset >> kSynthOffsetMapBlockShift] + map->characterDeltas[characterOffset];
+}
+
+// The UTF-16 offset of the character the byte at byteOffset is part of.
+static inline uint32_t SynthOffsetMapCharacterOffset(const SynthOffsetMap * map, uint32_t byteOffset)
+{
+	if (byteOffset > map->byteLength) {
+		byteOffset = map->byteLength;
+	}
+	if (map->byteBlocks == NULL) {
+		return byteOffset;
+	}
+	return map->byteBlocks[byteOffset >> kSynthOffsetMapBlockShift] + map->byteDeltas[byteOffset];
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,400 @@
+/*
+	SynthPhonemeCache.c
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Sharded LRU cache of text analyses.  See SynthPhonemeCache.h.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include "SynthPhonemeCache.h"
+
+// Expected size of an entry, used to pick the number of hash buckets.
+#define kTypicalEntryBytes		512
+#define kMinimumBucketCount		64
+
+typedef struct CacheEntry {
+	struct CacheEntry *		nextInBucket;
+	struct CacheEntry *		newer;
+	struct CacheEntry *		older;
+	uint64_t				keyHash;
+	uint64_t				voice;
+	uint64_t				dictionaryGeneration;
+	UniChar *				text;				// The normalized text, to tell apart texts whose hashes collide.
+	long					length;
+	SynthTextAnalysis *		analysis;
+	size_t					byteSize;
+} CacheEntry;
+
+typedef struct CacheShard {
+	pthread_mutex_t			lock;
+	CacheEntry **			buckets;
+	uint32_t				bucketMask;
+	CacheEntry *			newest;
+	CacheEntry *			oldest;
+	uint32_t				entryCount;
+	size_t					byteCount;
+	size_t					capacityBytes;
+	uint64_t				hits;
+	uint64_t				misses;
+	uint64_t				evictions;
+} CacheShard;
+
+struct SynthPhonemeCache {
+	CacheShard				shards[kSynthPhonemeCacheShardCount];
+};
+
+static pthread_mutex_t		sSharedLock = PTHREAD_MUTEX_INITIALIZER;
+static SynthPhonemeCache *	sSharedCache = NULL;
+static atomic_ullong		sLastDictionaryGeneration = kSynthNoDictionaryGeneration;
+
+static uint64_t		KeyHash(uint64_t textHash, uint64_t voice, uint64_t dictionaryGeneration);
+static CacheShard *	ShardFor(SynthPhonemeCache * cache, uint64_t keyHash);
+static CacheEntry *	FindEntry(CacheShard * shard, uint64_t keyHash, const UniChar * text, long length, uint64_t voice, uint64_t dictionaryGeneration);
+static void			MakeNewest(CacheShard * shard, CacheEntry * entry);
+static void			Unlink(CacheShard * shard, CacheEntry * entry);
+static void			DisposeEntry(CacheEntry * entry);
+
+long SynthPhonemeCacheCreate(size_t capacityBytes, SynthPhonemeCache ** outCache)
+{
+	SynthPhonemeCache * cache;
+	uint32_t bucketCount = kMinimumBucketCount;
+	uint32_t shardIndex;
+
+	if (outCache == NULL || capacityBytes == 0) {
+		return paramErr;
+	}
+	*outCache = NULL;
+
+	cache = (SynthPhonemeCache *)calloc(1, sizeof(SynthPhonemeCache));
+	if (cache == NULL) {
+		return memFullErr;
+	}
+
+	while (bucketCount < capacityBytes / kSynthPhonemeCacheShardCount / kTypicalEntryBytes && bucketCount < (1U << 24)) {
+		bucketCount <<= 1;
+	}
+	for (shardIndex = 0; shardIndex < kSynthPhonemeCacheShardCount; shardIndex++) {
+		CacheShard * shard = &cache->shards[shardIndex];
+		shard->buckets = (CacheEntry **)calloc(bucketCount, sizeof(CacheEntry *));
+		if (shard->buckets == NULL) {
+			SynthPhonemeCacheDispose(cache);
+			return memFullErr;
+		}
+		shard->bucketMask = bucketCount - 1;
+		shard->capacityBytes = capacityBytes / kSynthPhonemeCacheShardCount;
+		pthread_mutex_init(&shard->lock, NULL);
+	}
+
+	*outCache = cache;
+	return noErr;
+}
+
+void SynthPhonemeCacheDispose(SynthPhonemeCache * cache)
+{
+	uint32_t shardIndex;
+
+	if (cache == NULL) {
+		return;
+	}
+	for (shardIndex = 0; shardIndex < kSynthPhonemeCacheShardCount; shardIndex++) {
+		CacheShard * shard = &cache->shards[shardIndex];
+		if (shard->buckets) {
+			while (shard->oldest) {
+				CacheEntry * entry = shard->oldest;
+				Unlink(shard, entry);
+				DisposeEntry(entry);
+			}
+			free(shard->buckets);
+			pthread_mutex_destroy(&shard->lock);
+		}
+	}
+	free(cache);
+}
+
+SynthPhonemeCache * SynthPhonemeCacheShared(void)
+{
+	pthread_mutex_lock(&sSharedLock);
+	if (sSharedCache == NULL) {
+		size_t capacityBytes = kSynthPhonemeCacheDefaultBytes;
+		const char * bytesString = getenv(kSynthPhonemeCacheBytesVariable);
+		if (bytesString && strtoul(bytesString, NULL, 10) > 0) {
+			capacityBytes = (size_t)strtoul(bytesString, NULL, 10);
+		}
+		SynthPhonemeCacheCreate(capacityBytes, &sSharedCache);
+	}
+	pthread_mutex_unlock(&sSharedLock);
+
+	return sSharedCache;
+}
+
+uint64_t SynthPhonemeCacheNewDictionaryGeneration(void)
+{
+	return atomic_fetch_add_explicit(&sLastDictionaryGeneration, 1, memory_order_relaxed) + 1;
+}
+
+long SynthPhonemeCacheCopyAnalysis(SynthPhonemeCache * cache, const UniChar * normalized, long length, uint64_t voice, const SynthDictionary * dictionary, SynthTextAnalysis ** outAnalysis)
+{
+	uint64_t dictionaryGeneration = SynthDictionaryGeneration(dictionary);
+	SynthTextAnalysis * analysis = NULL;
+	CacheEntry * entry;
+	CacheShard * shard;
+	uint64_t keyHash;
+	long error;
+
+	if (outAnalysis == NULL || length < 0 || (length > 0 && normalized == NULL)) {
+		return paramErr;
+	}
+	*outAnalysis = NULL;
+
+	keyHash = KeyHash(SynthTextHash(normalized, length), voice, dictionaryGeneration);
+	shard = ShardFor(cache, keyHash);
+
+	pthread_mutex_lock(&shard->lock);
+	entry = FindEntry(shard, keyHash, normalized, length, voice, dictionaryGeneration);
+	if (entry) {
+		shard->hits++;
+		MakeNewest(shard, entry);
+		analysis = SynthTextAnalysisRetain(entry->analysis);
+	}
+	else {
+		shard->misses++;
+	}
+	pthread_mutex_unlock(&shard->lock);
+
+	if (analysis) {
+		*outAnalysis = analysis;
+		return noErr;
+	}
+
+	// Analyze without holding the shard, so a long text doesn't hold up the other channels.
+	error = SynthTextAnalyze(normalized, length, dictionary, &analysis);
+	if (error != noErr) {
+		return error;
+	}
+
+	pthread_mutex_lock(&shard->lock);
+	entry = FindEntry(shard, keyHash, normalized, length, voice, dictionaryGeneration);
+	if (entry) {
+		// Another channel analyzed the same text in the meantime; share its result.
+		MakeNewest(shard, entry);
+		SynthTextAnalysisRelease(analysis);
+		analysis = SynthTextAnalysisRetain(entry->analysis);
+	}
+	else {
+		size_t byteSize = sizeof(CacheEntry) + length * sizeof(UniChar) + analysis->byteSize;
+		if (byteSize <= shard->capacityBytes) {
+			entry = (CacheEntry *)calloc(1, sizeof(CacheEntry));
+			if (entry) {
+				entry->text = (UniChar *)malloc((length ? length : 1) * sizeof(UniChar));
+				if (entry->text == NULL) {
+					free(entry);
+					entry = NULL;
+				}
+			}
+			if (entry) {
+				memcpy(entry->text, normalized, length * sizeof(UniChar));
+				entry->keyHash = keyHash;
+				entry->voice = voice;
+				entry->dictionaryGeneration = dictionaryGeneration;
+				entry->length = length;
+				entry->analysis = SynthTextAnalysisRetain(analysis);
+				entry->byteSize = byteSize;
+
+				entry->nextInBucket = shard->buckets[keyHash & shard->bucketMask];
+				shard->buckets[keyHash & shard->bucketMask] = entry;
+				MakeNewest(shard, entry);
+				shard->entryCount++;
+				shard->byteCount += byteSize;
+
+				while (shard->byteCount > shard->capacityBytes && shard->oldest != entry) {
+					CacheEntry * oldest = shard->oldest;
+					Unlink(shard, oldest);
+					DisposeEntry(oldest);
+					shard->evictions++;
+				}
+			}
+		}
+	}
+	pthread_mutex_unlock(&shard->lock);
+
+	*outAnalysis = analysis;
+	return noErr;
+}
+
+void SynthPhonemeCacheRemoveGeneration(SynthPhonemeCache * cache, uint64_t dictionaryGeneration)
+{
+	uint32_t shardIndex;
+
+	// Entries without a dictionary are shared by every such channel, so they're never removed here.
+	if (dictionaryGeneration == kSynthNoDictionaryGeneration) {
+		return;
+	}
+	for (shardIndex = 0; shardIndex < kSynthPhonemeCacheShardCount; shardIndex++) {
+		CacheShard * shard = &cache->shards[shardIndex];
+		CacheEntry * entry;
+
+		pthread_mutex_lock(&shard->lock);
+		entry = shard->newest;
+		while (entry) {
+			CacheEntry * older = entry->older;
+			if (entry->dictionaryGeneration == dictionaryGeneration) {
+				Unlink(shard, entry);
+				DisposeEntry(entry);
+			}
+			entry = older;
+		}
+		pthread_mutex_unlock(&shard->lock);
+	}
+}
+
+void SynthPhonemeCacheGetStatistics(SynthPhonemeCache * cache, SynthPhonemeCacheStatistics * statistics)
+{
+	uint32_t shardIndex;
+
+	memset(statistics, 0, sizeof(SynthPhonemeCacheStatistics));
+	for (shardIndex = 0; shardIndex < kSynthPhonemeCacheShardCount; shardIndex++) {
+		CacheShard * shard = &cache->shards[shardIndex];
+		pthread_mutex_lock(&shard->lock);
+		statistics->hits += shard->hits;
+		statistics->misses += shard->misses;
+		statistics->evictions += shard->evictions;
+		statistics->entryCount += shard->entryCount;
+		statistics->byteCount += shard->byteCount;
+		pthread_mutex_unlock(&shard->lock);
+	}
+}
+
+static uint64_t KeyHash(uint64_t textHash, uint64_t voice, uint64_t dictionaryGeneration)
+{
+	// Mix the parts so the shard (from the top bits) and the bucket (from the bottom bits) both depend on all of them.
+	uint64_t hash = textHash ^ (voice * 0x9E3779B97F4A7C15ULL) ^ (dictionaryGeneration * 0xC2B2AE3D27D4EB4FULL);
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDULL;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+static CacheShard * ShardFor(SynthPhonemeCache * cache, uint64_t keyHash)
+{
+	return &cache->shards[(keyHash >> 60) % kSynthPhonemeCacheShardCount];
+}
+
+static CacheEntry * FindEntry(CacheShard * shard, uint64_t keyHash, const UniChar * text, long length, uint64_t voice, uint64_t dictionaryGeneration)
+{
+	CacheEntry * entry = shard->buckets[keyHash & shard->bucketMask];
+
+	while (entry) {
+		if (entry->keyHash == keyHash && entry->voice == voice && entry->dictionaryGeneration == dictionaryGeneration
+			&& entry->length == length && memcmp(entry->text, text, length * sizeof(UniChar)) == 0) {
+			break;
+		}
+		entry = entry->nextInBucket;
+	}
+	return entry;
+}
+
+static void MakeNewest(CacheShard * shard, CacheEntry * entry)
+{
+	if (shard->newest == entry) {
+		return;
+	}
+
+	// Take the entry out of the list if it's in it...
+	if (entry->newer) {
+		entry->newer->older = entry->older;
+	}
+	if (entry->older) {
+		entry->older->newer = entry->newer;
+	}
+	if (shard->oldest == entry) {
+		shard->oldest = entry->newer;
+	}
+
+	// ...and put it at the front.
+	entry->newer = NULL;
+	entry->older = shard->newest;
+	if (shard->newest) {
+		shard->newest->newer = entry;
+	}
+	shard->newest = entry;
+	if (shard->oldest == NULL) {
+		shard->oldest = entry;
+	}
+}
+
+static void Unlink(CacheShard * shard, CacheEntry * entry)
+{
+	CacheEntry ** link = &shard->buckets[entry->keyHash & shard->bucketMask];
+
+	while (*link && *link != entry) {
+		link = &(*link)->nextInBucket;
+	}
+	if (*link) {
+		*link = entry->nextInBucket;
+	}
+
+	if (entry->newer) {
+		entry->newer->older = entry->older;
+	}
+	else {
+		shard->newest = entry->older;
+	}
+	if (entry->older) {
+		entry->older->newer = entry->newer;
+	}
+	else {
+		shard->oldest = entry->newer;
+	}
+
+	shard->entryCount--;
+	shard->byteCount -= entry->byteSize;
+}
+
+static void DisposeEntry(CacheEntry * entry)
+{
+	// Channels still speaking the text keep their own reference to the analysis.
+	SynthTextAnalysisRelease(entry->analysis);
+	free(entry->text);
+	free(entry);
+}
@@ -0,0 +1,102 @@
+/*
+	SynthPhonemeCache.h
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: A bounded cache of text analyses shared by every channel, so text that
+	is spoken again skips the front end.  Entries are keyed by the hash of the
+	normalized text, the voice and the dictionary generation of the channel, and
+	the cache is split into independently locked shards that each evict their
+	least recently used entries.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#ifndef __SYNTHPHONEMECACHE__
+#define __SYNTHPHONEMECACHE__
+
+#include "SynthEngineBase.h"
+#include "SynthTextAnalysis.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Memory the shared cache may hold, unless overridden by kSynthPhonemeCacheBytesVariable.
+#define kSynthPhonemeCacheDefaultBytes		(4 * 1024 * 1024)
+#define kSynthPhonemeCacheBytesVariable		"SYNTH_ENGINE_PHONEME_CACHE_BYTES"
+
+#define kSynthPhonemeCacheShardCount		16
+
+// The generation of a channel with no pronunciation dictionary.
+#define kSynthNoDictionaryGeneration		0
+
+typedef struct SynthPhonemeCacheStatistics {
+	uint64_t	hits;
+	uint64_t	misses;
+	uint64_t	evictions;
+	uint32_t	entryCount;
+	size_t		byteCount;
+} SynthPhonemeCacheStatistics;
+
+typedef struct SynthPhonemeCache SynthPhonemeCache;
+
+long		SynthPhonemeCacheCreate(size_t capacityBytes, SynthPhonemeCache ** outCache);
+void		SynthPhonemeCacheDispose(SynthPhonemeCache * cache);
+
+// The cache shared by every channel in the process, created on first use.
+SynthPhonemeCache *	SynthPhonemeCacheShared(void);
+
+// Returns a new generation, different from every other one in the process, for a new pronunciation dictionary.
+uint64_t	SynthPhonemeCacheNewDictionaryGeneration(void);
+
+// Passes back the analysis of normalized text for the given voice and pronunciation dictionary, which may be
+// NULL, analyzing it and adding it to the cache under the dictionary's generation if it isn't there.  The
+// caller must release the analysis.
+long		SynthPhonemeCacheCopyAnalysis(SynthPhonemeCache * cache, const UniChar * normalized, long length, uint64_t voice, const SynthDictionary * dictionary, SynthTextAnalysis ** outAnalysis);
+
+// Drops every entry made with a dictionary generation that's no longer in use.
+void		SynthPhonemeCacheRemoveGeneration(SynthPhonemeCache * cache, uint64_t dictionaryGeneration);
+
+void		SynthPhonemeCacheGetStatistics(SynthPhonemeCache * cache, SynthPhonemeCacheStatistics * statistics);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,340 @@
+/*
+	SynthPhonemeExport.c
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Converts text of any length to phonemes a sentence-aligned chunk at a
+	time, optionally on several threads, writing the phonemes in order as they're made
+	so memory stays the same however much text there is.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "SynthPhonemeExport.h"
+#include "SynthArena.h"
+#include "SynthTextAnalysis.h"
+#include "SynthTextNormalizer.h"
+
+// Where a chunk is on its way through an export.  Chunks are read, converted and written in the order of the text.
+enum {
+	kSynthExportChunkFree			= 0,
+	kSynthExportChunkRead			= 1,		// Waiting for a thread to convert it.
+	kSynthExportChunkConverting		= 2,
+	kSynthExportChunkConverted		= 3			// Waiting to be written.
+};
+
+typedef struct SynthExportChunk {
+	int						state;
+	UniChar *				text;
+	long					length;
+	SynthArena *			arena;				// For the normalized text, reset for each chunk.
+	SynthTextAnalysis *		analysis;
+	long					error;
+} SynthExportChunk;
+
+typedef struct SynthExport {
+	SynthPhonemeExportOptions	options;
+	SynthExportChunk *		chunks;
+	uint32_t				chunkCount;
+	uint64_t				readCount;
+	uint64_t				convertCount;
+	uint64_t				writeCount;
+	pthread_mutex_t			mutex;
+	pthread_cond_t			condition;
+	Boolean					isStopping;
+
+	// Only touched on the calling thread: text read past the end of the last chunk, held for the next one.
+	UniChar *				pending;
+	long					pendingLength;
+	Boolean					readerEnded;
+	Boolean					wroteAny;
+} SynthExport;
+
+static void *	ConvertChunks(void * refCon);
+static void		ConvertChunk(SynthExport * export, SynthExportChunk * chunk);
+static long		ReadChunk(SynthExport * export, SynthPhonemeExportReadProcPtr readProc, void * refCon, SynthExportChunk * chunk);
+static long		WriteChunk(SynthExport * export, SynthPhonemeExportWriteProcPtr writeProc, void * refCon, SynthExportChunk * chunk);
+static long		FindChunkEnd(const UniChar * text, long length);
+
+long SynthPhonemeExport(SynthPhonemeExportReadProcPtr readProc, void * readRefCon, SynthPhonemeExportWriteProcPtr writeProc, void * writeRefCon, const SynthPhonemeExportOptions * options)
+{
+	SynthExport export;
+	pthread_t threads[kSynthPhonemeExportMaxThreads];
+	uint32_t threadCount = 0, index;
+	long error = noErr;
+
+	if (readProc == NULL || writeProc == NULL) {
+		return paramErr;
+	}
+	memset(&export, 0, sizeof(export));
+	if (options) {
+		export.options = *options;
+	}
+	if (export.options.chunkLength == 0) {
+		export.options.chunkLength = kSynthPhonemeExportDefaultChunkLength;
+	}
+	if (export.options.threadCount > kSynthPhonemeExportMaxThreads) {
+		export.options.threadCount = kSynthPhonemeExportMaxThreads;
+	}
+
+	// With threads, two chunks apiece keeps each busy while the one before it is written.  Without, one will do.
+	export.chunkCount = (export.options.threadCount > 1) ? 2 * export.options.threadCount : 1;
+	export.chunks = (SynthExportChunk *)calloc(export.chunkCount, sizeof(SynthExportChunk));
+	export.pending = (UniChar *)malloc(export.options.chunkLength * sizeof(UniChar));
+	if (export.chunks == NULL || export.pending == NULL) {
+		error = memFullErr;
+	}
+	for (index = 0; error == noErr && index < export.chunkCount; index++) {
+		export.chunks[index].text = (UniChar *)malloc(export.options.chunkLength * sizeof(UniChar));
+		if (export.chunks[index].text == NULL) {
+			error = memFullErr;
+		}
+		else {
+			error = SynthArenaCreate(0, &export.chunks[index].arena);
+		}
+	}
+	pthread_mutex_init(&export.mutex, NULL);
+	pthread_cond_init(&export.condition, NULL);
+
+	if (error == noErr && export.options.threadCount > 1) {
+		for (; threadCount < export.options.threadCount; threadCount++) {
+			if (pthread_create(&threads[threadCount], NULL, ConvertChunks, &export) != 0) {
+				break;
+			}
+		}
+	}
+
+	pthread_mutex_lock(&export.mutex);
+	while (error == noErr) {
+		SynthExportChunk * chunk = &export.chunks[export.writeCount % export.chunkCount];
+
+		// Write the chunk that's next in the text as soon as it's converted, then give the chunk back to be read into.
+		if (export.writeCount < export.readCount && chunk->state == kSynthExportChunkConverted) {
+			pthread_mutex_unlock(&export.mutex);
+			error = WriteChunk(&export, writeProc, writeRefCon, chunk);
+			pthread_mutex_lock(&export.mutex);
+			chunk->state = kSynthExportChunkFree;
+			export.writeCount++;
+		}
+
+		// Without threads of its own, the export converts each chunk as it's read.
+		else if (threadCount == 0 && export.convertCount < export.readCount) {
+			chunk = &export.chunks[export.convertCount++ % export.chunkCount];
+			pthread_mutex_unlock(&export.mutex);
+			ConvertChunk(&export, chunk);
+			pthread_mutex_lock(&export.mutex);
+			chunk->state = kSynthExportChunkConverted;
+		}
+		else if ((! export.readerEnded || export.pendingLength > 0) && export.readCount - export.writeCount < export.chunkCount) {
+			chunk = &export.chunks[export.readCount % export.chunkCount];
+			pthread_mutex_unlock(&export.mutex);
+			error = ReadChunk(&export, readProc, readRefCon, chunk);
+			pthread_mutex_lock(&export.mutex);
+			if (error == noErr && chunk->length > 0) {
+				chunk->state = kSynthExportChunkRead;
+				export.readCount++;
+				pthread_cond_broadcast(&export.condition);
+			}
+		}
+		else if (export.readerEnded && export.pendingLength == 0 && export.writeCount == export.readCount) {
+			break;
+		}
+		else {
+			pthread_cond_wait(&export.condition, &export.mutex);
+		}
+	}
+	export.isStopping = true;
+	pthread_cond_broadcast(&export.condition);
+	pthread_mutex_unlock(&export.mutex);
+
+	for (index = 0; index < threadCount; index++) {
+		pthread_join(threads[index], NULL);
+	}
+	pthread_cond_destroy(&export.condition);
+	pthread_mutex_destroy(&export.mutex);
+	if (export.chunks) {
+		for (index = 0; index < export.chunkCount; index++) {
+			SynthTextAnalysisRelease(export.chunks[index].analysis);
+			SynthArenaDispose(export.chunks[index].arena);
+			free(export.chunks[index].text);
+		}
+		free(export.chunks);
+	}
+	free(export.pending);
+	return error;
+}
+
+static void * ConvertChunks(void * refCon)
+{
+	SynthExport * export = (SynthExport *)refCon;
+	SynthExportChunk * chunk;
+
+	// Chunks are taken in the order they were read, though they may be finished out of it.
+	pthread_mutex_lock(&export->mutex);
+	while (! export->isStopping) {
+		if (export->convertCount < export->readCount) {
+			chunk = &export->chunks[export->convertCount++ % export->chunkCount];
+			chunk->state = kSynthExportChunkConverting;
+			pthread_mutex_unlock(&export->mutex);
+			ConvertChunk(export, chunk);
+			pthread_mutex_lock(&export->mutex);
+			chunk->state = kSynthExportChunkConverted;
+			pthread_cond_broadcast(&export->condition);
+		}
+		else {
+			pthread_cond_wait(&export->condition, &export->mutex);
+		}
+	}
+	pthread_mutex_unlock(&export->mutex);
+	return NULL;
+}
+
+static void ConvertChunk(SynthExport * export, SynthExportChunk * chunk)
+{
+	SynthNormalizedText normalized;
+
+	SynthArenaReset(chunk->arena);
+	chunk->analysis = NULL;
+	chunk->error = SynthTextNormalize(chunk->text, chunk->length, export->options.textModes, chunk->arena, &normalized);
+	if (chunk->error == noErr) {
+		chunk->error = SynthTextAnalyze(normalized.characters, normalized.length, export->options.dictionary, &chunk->analysis);
+	}
+}
+
+static long ReadChunk(SynthExport * export, SynthPhonemeExportReadProcPtr readProc, void * refCon, SynthExportChunk * chunk)
+{
+	long capacity = export->options.chunkLength;
+	long count, end;
+	long error;
+
+	// Top up what was held over from the last chunk, so a chunk is only short at the end of the text.
+	chunk->length = 0;
+	while (! export->readerEnded && export->pendingLength < capacity) {
+		count = 0;
+		error = (*readProc)(refCon, export->pending + export->pendingLength, capacity - export->pendingLength, &count);
+		if (error != noErr) {
+			return error;
+		}
+		if (count > capacity - export->pendingLength) {
+			return paramErr;
+		}
+		if (count <= 0) {
+			export->readerEnded = true;
+		}
+		else {
+			export->pendingLength += count;
+		}
+	}
+	end = (export->readerEnded) ? export->pendingLength : FindChunkEnd(export->pending, export->pendingLength);
+	memcpy(chunk->text, export->pending, end * sizeof(UniChar));
+	chunk->length = end;
+	export->pendingLength -= end;
+	memmove(export->pending, export->pending + end, export->pendingLength * sizeof(UniChar));
+	return noErr;
+}
+
+static long WriteChunk(SynthExport * export, SynthPhonemeExportWriteProcPtr writeProc, void * refCon, SynthExportChunk * chunk)
+{
+	static const UniChar space = ' ';
+	SynthTextAnalysis * analysis = chunk->analysis;
+	long error = chunk->error;
+
+	// Each chunk's phonemes are separated from the last as the words within a chunk are.
+	chunk->analysis = NULL;
+	if (error == noErr && analysis->phonemeLength > 0) {
+		if (export->wroteAny) {
+			error = (*writeProc)(refCon, &space, 1);
+		}
+		if (error == noErr) {
+			error = (*writeProc)(refCon, analysis->phonemes, analysis->phonemeLength);
+		}
+		export->wroteAny = true;
+	}
+	SynthTextAnalysisRelease(analysis);
+	return error;
+}
+
+static inline Boolean IsSpace(UniChar c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+// How much of text makes a chunk: up to the white space after its last sentence, or failing that after its last
+// word, but never in the middle of an embedded command, which has to be read whole.
+static long FindChunkEnd(const UniChar * text, long length)
+{
+	long sentenceEnd = 0, wordEnd = 0, index, before;
+	Boolean inCommand = false;
+
+	for (index = 0; index < length; index++) {
+		UniChar c = text[index];
+		if (c == '[' && index + 1 < length && text[index + 1] == '[') {
+			inCommand = true;
+			index++;
+		}
+		else if (c == ']' && index + 1 < length && text[index + 1] == ']') {
+			inCommand = false;
+			index++;
+		}
+		else if (! inCommand && IsSpace(c) && index > 0 && ! IsSpace(text[index - 1])) {
+			wordEnd = index + 1;
+
+			// Closing quotes and parentheses can come after the punctuation that ends a sentence.
+			for (before = index - 1; before > 0 && (text[before] == '"' || text[before] == '\'' || text[before] == ')' || text[before] == 0x2019 || text[before] == 0x201D); before--) {
+			}
+			if (c == '\n' || c == '\r' || text[before] == '.' || text[before] == '!' || text[before] == '?') {
+				sentenceEnd = index + 1;
+			}
+		}
+	}
+	if (sentenceEnd > 0) {
+		return sentenceEnd;
+	}
+	if (wordEnd > 0) {
+		return wordEnd;
+	}
+
+	// A single word as long as a chunk is cut, though not between the halves of a surrogate pair.
+	if (length > 1 && text[length - 1] >= 0xD800 && text[length - 1] <= 0xDBFF) {
+		return length - 1;
+	}
+	return length;
+}
@@ -0,0 +1,88 @@
+/*
+	SynthPhonemeExport.h
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Converts text of any length to phonemes a sentence-aligned chunk at a
+	time, optionally on several threads, writing the phonemes in order as they're made
+	so memory stays the same however much text there is.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#ifndef __SYNTHPHONEMEEXPORT__
+#define __SYNTHPHONEMEEXPORT__
+
+#include "SynthEngineBase.h"
+#include "SynthDictionary.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Text is taken in chunks of at most this many characters, each ending after a sentence where there is one.
+#define kSynthPhonemeExportDefaultChunkLength		4096
+
+// Most threads an export will convert on.
+#define kSynthPhonemeExportMaxThreads				16
+
+// Fills characters with up to capacity more characters of the text, passing back how many; zero means the text has
+// ended.  A result other than noErr ends the export with it.
+typedef long (*SynthPhonemeExportReadProcPtr)(void * refCon, UniChar * characters, long capacity, long * outLength);
+
+// Takes the next phonemes, as MacinTalk symbols like SECopyPhonemesFromText's, which go on from where the last
+// ones left off.  A result other than noErr ends the export with it.
+typedef long (*SynthPhonemeExportWriteProcPtr)(void * refCon, const UniChar * phonemes, long length);
+
+typedef struct SynthPhonemeExportOptions {
+	uint32_t			textModes;			// kSynthTextLiteralNumbers and kSynthTextLiteralCharacters.
+	SynthDictionary *	dictionary;			// Pronunciations to use, or NULL.
+	uint32_t			threadCount;		// 0 or 1 converts on the calling thread.
+	uint32_t			chunkLength;		// 0 for kSynthPhonemeExportDefaultChunkLength.
+} SynthPhonemeExportOptions;
+
+// Reads the text through readProc and writes its phonemes through writeProc, a chunk at a time.  Both are only
+// called on the calling thread, and the phonemes come out in the order of the text whatever the threads.  Memory
+// held is a few chunks for each thread.  options may be NULL for the defaults.
+long		SynthPhonemeExport(SynthPhonemeExportReadProcPtr readProc, void * readRefCon, SynthPhonemeExportWriteProcPtr writeProc, void * writeRefCon, const SynthPhonemeExportOptions * options);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
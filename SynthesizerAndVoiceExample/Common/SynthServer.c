@@ -0,0 +1,598 @@
+/*
+	SynthServer.c
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: The synthesis server: holds the voices and renders for every plug-in
+	that connects to it, so voice data is loaded once per machine rather than once per process.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "SynthServer.h"
+#include "SynthArena.h"
+#include "SynthPhonemeCache.h"
+#include "SynthTextNormalizer.h"
+#include "SynthUtteranceRenderer.h"
+
+#define kSynthServerAcceptInterval		200			// Milliseconds between checks for a stop while waiting for a connection.
+#define kSynthServerRingWait			50000		// Nanoseconds to wait for the client to make room in a ring.
+#define kSynthServerRingTimeout			2.0			// Seconds a render waits for room before giving up on the client.
+#define kSynthServerMaxProperties		16
+#define kSynthServerMaxPathLength		1024
+
+// A voice's unit inventory, opened once and shared by every connection speaking with it.
+typedef struct SynthServerVoice {
+	struct SynthServerVoice *	next;
+	char *						path;
+	SynthUnitInventory *		inventory;
+	uint32_t					useCount;
+} SynthServerVoice;
+
+typedef struct SynthServerConnection {
+	struct SynthServerConnection *	next;
+	SynthServer *			server;
+	int						socket;
+	void *					shared;
+	size_t					sharedSize;
+	SynthSharedRing *		audioRing;
+	SynthSharedRing *		eventRing;
+	SynthServerVoice *		voice;
+	uint64_t				voiceKey;				// Voice creator in the high 32 bits, voice id in the low.
+	SynthArena *			arena;					// Scratch memory for one request at a time.
+	uint32_t				textModes;				// How the client's number and character modes say to read text.
+	uint32_t				propertyCount;
+	uint32_t				propertySelectors[kSynthServerMaxProperties];
+	double					propertyValues[kSynthServerMaxProperties];
+} SynthServerConnection;
+
+struct SynthServer {
+	int						listenSocket;
+	char					socketPath[sizeof(((struct sockaddr_un *)0)->sun_path)];
+	atomic_bool				isStopping;
+	pthread_mutex_t			mutex;
+	pthread_cond_t			connectionsDone;
+	SynthServerConnection *	connections;
+	SynthServerVoice *		voices;
+	uint32_t				sharedMemoryCount;
+};
+
+static void *	ServeConnection(void * context);
+static long		HandleHello(SynthServerConnection * connection, const SynthServerRequest * request);
+static long		HandleUseVoice(SynthServerConnection * connection, const SynthServerRequest * request, const char * path);
+static long		HandleRender(SynthServerConnection * connection, const SynthServerRequest * request, const UniChar * text, long length, SynthServerReply * reply);
+static long		CopyAnalysis(SynthServerConnection * connection, const UniChar * text, long length, SynthNormalizedText * outNormalized, SynthTextAnalysis ** outAnalysis);
+static long		WriteToRing(SynthServerConnection * connection, SynthSharedRing * ring, const void * bytes, size_t count, uint32_t granularity);
+static void		ReleaseVoice(SynthServer * server, SynthServerVoice * voice);
+static void		DisposeConnection(SynthServerConnection * connection);
+
+long SynthServerCreate(const char * socketPath, SynthServer ** outServer)
+{
+	struct sockaddr_un address;
+	SynthServer * server;
+
+	if (socketPath == NULL || outServer == NULL || strlen(socketPath) >= sizeof(address.sun_path)) {
+		return paramErr;
+	}
+	*outServer = NULL;
+	server = (SynthServer *)calloc(1, sizeof(SynthServer));
+	if (server == NULL) {
+		return memFullErr;
+	}
+	snprintf(server->socketPath, sizeof(server->socketPath), "%s", socketPath);
+	atomic_init(&server->isStopping, false);
+	pthread_mutex_init(&server->mutex, NULL);
+	pthread_cond_init(&server->connectionsDone, NULL);
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	snprintf(address.sun_path, sizeof(address.sun_path), "%s", socketPath);
+	unlink(socketPath);
+	server->listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (server->listenSocket < 0 || bind(server->listenSocket, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(server->listenSocket, SOMAXCONN) != 0) {
+		if (server->listenSocket >= 0) {
+			close(server->listenSocket);
+		}
+		pthread_cond_destroy(&server->connectionsDone);
+		pthread_mutex_destroy(&server->mutex);
+		free(server);
+		return ioErr;
+	}
+	*outServer = server;
+	return noErr;
+}
+
+long SynthServerRun(SynthServer * server)
+{
+	struct pollfd waiting;
+	pthread_t thread;
+	int connectionSocket;
+
+	while (! atomic_load(&server->isStopping)) {
+		waiting.fd = server->listenSocket;
+		waiting.events = POLLIN;
+		if (poll(&waiting, 1, kSynthServerAcceptInterval) <= 0) {
+			continue;
+		}
+		connectionSocket = accept(server->listenSocket, NULL, NULL);
+		if (connectionSocket < 0) {
+			continue;
+		}
+#ifdef SO_NOSIGPIPE
+		int noSignal = 1;
+		setsockopt(connectionSocket, SOL_SOCKET, SO_NOSIGPIPE, &noSignal, sizeof(noSignal));
+#endif
+
+		SynthServerConnection * connection = (SynthServerConnection *)calloc(1, sizeof(SynthServerConnection));
+		if (connection == NULL || SynthArenaCreate(0, &connection->arena) != noErr) {
+			free(connection);
+			close(connectionSocket);
+			continue;
+		}
+		connection->server = server;
+		connection->socket = connectionSocket;
+
+		// Listed before its thread starts, so a stop can always find it.
+		pthread_mutex_lock(&server->mutex);
+		connection->next = server->connections;
+		server->connections = connection;
+		pthread_mutex_unlock(&server->mutex);
+		if (pthread_create(&thread, NULL, ServeConnection, connection) == 0) {
+			pthread_detach(thread);
+		}
+		else {
+			DisposeConnection(connection);
+		}
+	}
+	return noErr;
+}
+
+void SynthServerStop(SynthServer * server)
+{
+	atomic_store(&server->isStopping, true);
+}
+
+void SynthServerDispose(SynthServer * server)
+{
+	SynthServerConnection * connection;
+
+	if (server == NULL) {
+		return;
+	}
+
+	// Shutting the sockets down wakes each connection's thread, which then disposes of its connection.
+	pthread_mutex_lock(&server->mutex);
+	for (connection = server->connections; connection; connection = connection->next) {
+		shutdown(connection->socket, SHUT_RDWR);
+	}
+	while (server->connections) {
+		pthread_cond_wait(&server->connectionsDone, &server->mutex);
+	}
+	pthread_mutex_unlock(&server->mutex);
+
+	close(server->listenSocket);
+	unlink(server->socketPath);
+	pthread_cond_destroy(&server->connectionsDone);
+	pthread_mutex_destroy(&server->mutex);
+	free(server);
+}
+
+static void * ServeConnection(void * context)
+{
+	SynthServerConnection * connection = (SynthServerConnection *)context;
+	SynthServerRequest request;
+	SynthServerReply reply;
+	void * payload = NULL;
+	size_t payloadCapacity = 0;
+	uint32_t index;
+	long error;
+
+	while (SynthServerReceive(connection->socket, &request, sizeof(request), NULL) == noErr) {
+		if (request.payloadLength > kSynthServerMaxPayloadLength) {
+			break;
+		}
+		if (request.payloadLength + sizeof(UniChar) > payloadCapacity) {
+			void * newPayload = realloc(payload, request.payloadLength + sizeof(UniChar));
+			if (newPayload == NULL) {
+				break;
+			}
+			payload = newPayload;
+			payloadCapacity = request.payloadLength + sizeof(UniChar);
+		}
+		if (request.payloadLength > 0 && SynthServerReceive(connection->socket, payload, request.payloadLength, NULL) != noErr) {
+			break;
+		}
+		memset((char *)payload + request.payloadLength, 0, sizeof(UniChar));
+
+		memset(&reply, 0, sizeof(reply));
+		switch (request.command) {
+			case kSynthServerHelloCommand:
+				// Replies itself, since the reply carries the shared memory.
+				error = HandleHello(connection, &request);
+				if (error == noErr) {
+					continue;
+				}
+				reply.status = (int32_t)error;
+				break;
+
+			case kSynthServerUseVoiceCommand:
+				reply.status = (int32_t)HandleUseVoice(connection, &request, (const char *)payload);
+				break;
+
+			case kSynthServerSetPropertyCommand:
+				for (index = 0; index < connection->propertyCount && connection->propertySelectors[index] != request.selector; index++) {
+				}
+				if (request.selector == kSynthServerNumberModeSelector || request.selector == kSynthServerCharacterModeSelector) {
+					uint32_t mode = (request.selector == kSynthServerNumberModeSelector) ? kSynthTextLiteralNumbers : kSynthTextLiteralCharacters;
+					connection->textModes = (request.value != 0.0) ? (connection->textModes | mode) : (connection->textModes & ~mode);
+				}
+				if (index < kSynthServerMaxProperties) {
+					connection->propertySelectors[index] = request.selector;
+					connection->propertyValues[index] = request.value;
+					if (index == connection->propertyCount) {
+						connection->propertyCount++;
+					}
+				}
+				else {
+					reply.status = (int32_t)memFullErr;
+				}
+				break;
+
+			case kSynthServerGetPropertyCommand:
+				reply.status = (int32_t)siUnknownInfoType;
+				for (index = 0; index < connection->propertyCount; index++) {
+					if (connection->propertySelectors[index] == request.selector) {
+						reply.status = (int32_t)noErr;
+						reply.value = connection->propertyValues[index];
+					}
+				}
+				break;
+
+			case kSynthServerRenderCommand:
+				reply.status = (int32_t)HandleRender(connection, &request, (const UniChar *)payload, request.payloadLength / sizeof(UniChar), &reply);
+				break;
+
+			case kSynthServerCopyPhonemesCommand: {
+				SynthTextAnalysis * analysis = NULL;
+				reply.status = (int32_t)CopyAnalysis(connection, (const UniChar *)payload, request.payloadLength / sizeof(UniChar), NULL, &analysis);
+				if (reply.status == noErr) {
+					reply.payloadLength = (uint32_t)(analysis->phonemeLength * sizeof(UniChar));
+					error = SynthServerSend(connection->socket, &reply, sizeof(reply), analysis->phonemes, reply.payloadLength, -1);
+					SynthTextAnalysisRelease(analysis);
+					if (error != noErr) {
+						goto done;
+					}
+					continue;
+				}
+				break;
+			}
+
+			case kSynthServerPingCommand:
+				break;
+
+			default:
+				reply.status = (int32_t)paramErr;
+				break;
+		}
+		if (SynthServerSend(connection->socket, &reply, sizeof(reply), NULL, 0, -1) != noErr) {
+			break;
+		}
+	}
+
+done:
+	free(payload);
+	DisposeConnection(connection);
+	return NULL;
+}
+
+static long HandleHello(SynthServerConnection * connection, const SynthServerRequest * request)
+{
+	SynthServer * server = connection->server;
+	SynthServerSharedHeader * header;
+	SynthServerReply reply;
+	char name[64];
+	int descriptor;
+	long error;
+
+	if (request->argument != kSynthServerProtocolVersion) {
+		return paramErr;
+	}
+	if (connection->shared) {
+		return paramErr;
+	}
+
+	// The memory is only ever reached through the descriptor, so its name is gone again before anyone else can open it.
+	pthread_mutex_lock(&server->mutex);
+	snprintf(name, sizeof(name), "/SynthServer.%ld.%u", (long)getpid(), server->sharedMemoryCount++);
+	pthread_mutex_unlock(&server->mutex);
+	descriptor = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (descriptor < 0) {
+		return ioErr;
+	}
+	shm_unlink(name);
+
+	connection->sharedSize = sizeof(SynthServerSharedHeader) + SynthSharedRingSize(kSynthServerAudioRingCapacity) + SynthSharedRingSize(kSynthServerEventRingCapacity);
+	if (ftruncate(descriptor, connection->sharedSize) != 0) {
+		close(descriptor);
+		return ioErr;
+	}
+	connection->shared = mmap(NULL, connection->sharedSize, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+	if (connection->shared == MAP_FAILED) {
+		connection->shared = NULL;
+		close(descriptor);
+		return memFullErr;
+	}
+
+	header = (SynthServerSharedHeader *)connection->shared;
+	header->magic = kSynthServerMagic;
+	header->version = kSynthServerProtocolVersion;
+	header->audioRingOffset = sizeof(SynthServerSharedHeader);
+	header->eventRingOffset = header->audioRingOffset + (uint32_t)SynthSharedRingSize(kSynthServerAudioRingCapacity);
+	header->size = (uint32_t)connection->sharedSize;
+	connection->audioRing = (SynthSharedRing *)((char *)connection->shared + header->audioRingOffset);
+	connection->eventRing = (SynthSharedRing *)((char *)connection->shared + header->eventRingOffset);
+	SynthSharedRingInit(connection->audioRing, kSynthServerAudioRingCapacity);
+	SynthSharedRingInit(connection->eventRing, kSynthServerEventRingCapacity);
+
+	memset(&reply, 0, sizeof(reply));
+	reply.value = connection->sharedSize;
+	error = SynthServerSend(connection->socket, &reply, sizeof(reply), NULL, 0, descriptor);
+	close(descriptor);
+	return error;
+}
+
+static long HandleUseVoice(SynthServerConnection * connection, const SynthServerRequest * request, const char * path)
+{
+	SynthServer * server = connection->server;
+	SynthServerVoice * voice = NULL;
+	long error = noErr;
+
+	// A voice without an inventory is spoken with the client's example sound, so there's nothing to load.
+	if (request->payloadLength > 0 && path[0] != '\0') {
+		if (request->payloadLength > kSynthServerMaxPathLength) {
+			return paramErr;
+		}
+		pthread_mutex_lock(&server->mutex);
+		for (voice = server->voices; voice && strcmp(voice->path, path) != 0; voice = voice->next) {
+		}
+		if (voice == NULL) {
+			voice = (SynthServerVoice *)calloc(1, sizeof(SynthServerVoice));
+			if (voice) {
+				voice->path = strdup(path);
+			}
+			if (voice == NULL || voice->path == NULL) {
+				error = memFullErr;
+			}
+			else if (SynthUnitInventoryOpen(path, &voice->inventory) == noErr) {
+				SynthUnitInventoryPrefetch(voice->inventory);
+			}
+			if (error == noErr) {
+				voice->next = server->voices;
+				server->voices = voice;
+			}
+			else if (voice) {
+				free(voice);
+				voice = NULL;
+			}
+		}
+		if (voice) {
+			voice->useCount++;
+		}
+		pthread_mutex_unlock(&server->mutex);
+	}
+	if (error == noErr) {
+		ReleaseVoice(server, connection->voice);
+		connection->voice = voice;
+		connection->voiceKey = ((uint64_t)request->selector << 32) | request->argument;
+	}
+	return error;
+}
+
+static long HandleRender(SynthServerConnection * connection, const SynthServerRequest * request, const UniChar * text, long length, SynthServerReply * reply)
+{
+	SynthNormalizedText normalized;
+	SynthTextAnalysis * analysis = NULL;
+	SynthRenderedUtterance * utterance = NULL;
+	SynthTimelineEvent * boundaryEvents = NULL;
+	SynthAudioCacheKey key;
+	uint32_t index, boundaryCount;
+	long error;
+
+	if (connection->shared == NULL) {
+		return paramErr;
+	}
+	SynthArenaReset(connection->arena);
+
+	// Rendered just as the plug-in would render it itself, except that there's no example sound to fall back on.
+	memset(&key, 0, sizeof(key));
+	key.textModes = connection->textModes;
+	error = CopyAnalysis(connection, text, length, &normalized, &analysis);
+	if (error == noErr) {
+		error = SynthUtteranceRender(analysis, normalized.originalOffsets, (connection->voice) ? connection->voice->inventory : NULL, request->argument, NULL, 0, &key, connection->arena, &utterance);
+	}
+
+	// The events go first, then the boundaries as events of their own kinds, then the audio.
+	if (error == noErr) {
+		error = WriteToRing(connection, connection->eventRing, utterance->events, utterance->eventCount * sizeof(SynthTimelineEvent), sizeof(SynthTimelineEvent));
+	}
+	if (error == noErr) {
+		boundaryCount = utterance->wordCount + utterance->sentenceCount;
+		boundaryEvents = (SynthTimelineEvent *)SynthArenaCalloc(connection->arena, boundaryCount, sizeof(SynthTimelineEvent));
+		if (boundaryEvents == NULL) {
+			error = memFullErr;
+		}
+	}
+	if (error == noErr) {
+		for (index = 0; index < utterance->wordCount; index++) {
+			boundaryEvents[index].kind = kSynthServerWordEndEvent;
+			boundaryEvents[index].samplePosition = utterance->wordEnds[index];
+		}
+		for (index = 0; index < utterance->sentenceCount; index++) {
+			boundaryEvents[utterance->wordCount + index].kind = kSynthServerSentenceEndEvent;
+			boundaryEvents[utterance->wordCount + index].samplePosition = utterance->sentenceEnds[index];
+		}
+		error = WriteToRing(connection, connection->eventRing, boundaryEvents, boundaryCount * sizeof(SynthTimelineEvent), sizeof(SynthTimelineEvent));
+	}
+	if (error == noErr && utterance->audio) {
+		error = WriteToRing(connection, connection->audioRing, utterance->audio, utterance->audioBytes, 1);
+	}
+	if (error == noErr) {
+		reply->value = (double)utterance->totalSamples;
+	}
+
+	SynthRenderedUtteranceRelease(utterance);
+	SynthTextAnalysisRelease(analysis);
+	return error;
+}
+
+// If outNormalized isn't NULL it gets the normalized text, in the connection's arena until the next request.
+static long CopyAnalysis(SynthServerConnection * connection, const UniChar * text, long length, SynthNormalizedText * outNormalized, SynthTextAnalysis ** outAnalysis)
+{
+	SynthArenaMark mark = SynthArenaGetMark(connection->arena);
+	SynthPhonemeCache * cache = SynthPhonemeCacheShared();
+	SynthNormalizedText normalized;
+	long error;
+
+	// Clients with their own pronunciation dictionaries render for themselves, so every analysis here can be shared.
+	*outAnalysis = NULL;
+	error = SynthTextNormalize(text, length, connection->textModes, connection->arena, &normalized);
+	if (error == noErr) {
+		if (cache) {
+			error = SynthPhonemeCacheCopyAnalysis(cache, normalized.characters, normalized.length, connection->voiceKey, NULL, outAnalysis);
+		}
+		else {
+			error = SynthTextAnalyze(normalized.characters, normalized.length, NULL, outAnalysis);
+		}
+	}
+	if (error == noErr && outNormalized) {
+		*outNormalized = normalized;
+	}
+	else {
+		SynthArenaRewind(connection->arena, mark);
+	}
+	return error;
+}
+
+static long WriteToRing(SynthServerConnection * connection, SynthSharedRing * ring, const void * bytes, size_t count, uint32_t granularity)
+{
+	struct timespec pause = { 0, kSynthServerRingWait };
+	double waited = 0.0;
+	uint32_t chunk;
+
+	// The client drains the rings while it waits for the reply.  One that stops draining is given up on.
+	while (count > 0) {
+		chunk = SynthSharedRingWritable(ring);
+		chunk -= chunk % granularity;
+		if (chunk > count) {
+			chunk = (uint32_t)count;
+		}
+		if (chunk == 0) {
+			if (atomic_load(&connection->server->isStopping) || waited > kSynthServerRingTimeout) {
+				return ioErr;
+			}
+			nanosleep(&pause, NULL);
+			waited += pause.tv_nsec / 1e9;
+			continue;
+		}
+		SynthSharedRingWrite(ring, bytes, chunk);
+		bytes = (const char *)bytes + chunk;
+		count -= chunk;
+		waited = 0.0;
+	}
+	return noErr;
+}
+
+static void ReleaseVoice(SynthServer * server, SynthServerVoice * voice)
+{
+	SynthServerVoice ** link;
+
+	if (voice == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&server->mutex);
+	if (--voice->useCount == 0) {
+		for (link = &server->voices; *link != voice; link = &(*link)->next) {
+		}
+		*link = voice->next;
+	}
+	else {
+		voice = NULL;
+	}
+	pthread_mutex_unlock(&server->mutex);
+
+	// The last connection using a voice unmaps it.
+	if (voice) {
+		SynthUnitInventoryRelease(voice->inventory);
+		free(voice->path);
+		free(voice);
+	}
+}
+
+static void DisposeConnection(SynthServerConnection * connection)
+{
+	SynthServer * server = connection->server;
+	SynthServerConnection ** link;
+
+	ReleaseVoice(server, connection->voice);
+	if (connection->shared) {
+		munmap(connection->shared, connection->sharedSize);
+	}
+	SynthArenaDispose(connection->arena);
+
+	// Closed only once it's off the list, so a stop never shuts down a descriptor that's been reused.
+	pthread_mutex_lock(&server->mutex);
+	for (link = &server->connections; *link != connection; link = &(*link)->next) {
+	}
+	*link = connection->next;
+	close(connection->socket);
+	pthread_cond_broadcast(&server->connectionsDone);
+	pthread_mutex_unlock(&server->mutex);
+	free(connection);
+}
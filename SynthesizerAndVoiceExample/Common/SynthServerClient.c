@@ -0,0 +1,394 @@
+/*
+	SynthServerClient.c
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: The plug-in's side of a connection to the synthesis server.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "SynthServerClient.h"
+
+#define kSynthServerDrainInterval		1			// Milliseconds between drains of the rings while a render is streaming in.
+
+struct SynthServerChannel {
+	int						socket;
+	pthread_mutex_t			mutex;
+	void *					shared;
+	size_t					sharedSize;
+	SynthSharedRing *		audioRing;
+	SynthSharedRing *		eventRing;
+};
+
+// Bytes drained from a ring, in a block that grows as they come in.
+typedef struct SynthServerBuffer {
+	uint8_t *	bytes;
+	size_t		length;
+	size_t		capacity;
+} SynthServerBuffer;
+
+static long		Call(SynthServerChannel * channel, const SynthServerRequest * request, const void * payload, SynthServerReply * reply);
+static long		Drain(SynthSharedRing * ring, SynthServerBuffer * buffer, long error);
+
+const char * SynthServerGetSocketPath(void)
+{
+	const char * path = getenv(kSynthServerSocketVariable);
+	return (path && path[0] != '\0') ? path : NULL;
+}
+
+long SynthServerChannelCreate(const char * socketPath, SynthServerChannel ** outChannel)
+{
+	struct sockaddr_un address;
+	SynthServerChannel * channel;
+	SynthServerRequest request;
+	SynthServerReply reply;
+	const SynthServerSharedHeader * header;
+	int descriptor = -1;
+	long error;
+
+	if (socketPath == NULL || outChannel == NULL || strlen(socketPath) >= sizeof(address.sun_path)) {
+		return paramErr;
+	}
+	*outChannel = NULL;
+	channel = (SynthServerChannel *)calloc(1, sizeof(SynthServerChannel));
+	if (channel == NULL) {
+		return memFullErr;
+	}
+	pthread_mutex_init(&channel->mutex, NULL);
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, socketPath);
+	channel->socket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (channel->socket < 0 || connect(channel->socket, (struct sockaddr *)&address, sizeof(address)) != 0) {
+		error = noSynthFound;
+		goto fail;
+	}
+#ifdef SO_NOSIGPIPE
+	int noSignal = 1;
+	setsockopt(channel->socket, SOL_SOCKET, SO_NOSIGPIPE, &noSignal, sizeof(noSignal));
+#endif
+
+	// The reply to the hello brings the memory the rings live in.
+	memset(&request, 0, sizeof(request));
+	request.command = kSynthServerHelloCommand;
+	request.argument = kSynthServerProtocolVersion;
+	error = SynthServerSend(channel->socket, &request, sizeof(request), NULL, 0, -1);
+	if (error == noErr) {
+		error = SynthServerReceive(channel->socket, &reply, sizeof(reply), &descriptor);
+	}
+	if (error == noErr && (reply.status != noErr || descriptor < 0)) {
+		error = (reply.status != noErr) ? reply.status : synthOpenFailed;
+	}
+	if (error != noErr) {
+		goto fail;
+	}
+	channel->sharedSize = (size_t)reply.value;
+	channel->shared = mmap(NULL, channel->sharedSize, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+	close(descriptor);
+	if (channel->shared == MAP_FAILED) {
+		channel->shared = NULL;
+		error = memFullErr;
+		goto fail;
+	}
+	header = (const SynthServerSharedHeader *)channel->shared;
+	if (channel->sharedSize < sizeof(SynthServerSharedHeader) || header->magic != kSynthServerMagic || header->version != kSynthServerProtocolVersion || header->size != channel->sharedSize) {
+		error = synthOpenFailed;
+		goto fail;
+	}
+	channel->audioRing = (SynthSharedRing *)((char *)channel->shared + header->audioRingOffset);
+	channel->eventRing = (SynthSharedRing *)((char *)channel->shared + header->eventRingOffset);
+
+	*outChannel = channel;
+	return noErr;
+
+fail:
+	SynthServerChannelDispose(channel);
+	return error;
+}
+
+void SynthServerChannelDispose(SynthServerChannel * channel)
+{
+	if (channel == NULL) {
+		return;
+	}
+
+	// The server drops the connection's voice when the socket closes.
+	if (channel->shared) {
+		munmap(channel->shared, channel->sharedSize);
+	}
+	if (channel->socket >= 0) {
+		close(channel->socket);
+	}
+	pthread_mutex_destroy(&channel->mutex);
+	free(channel);
+}
+
+long SynthServerChannelUseVoice(SynthServerChannel * channel, uint32_t creator, uint32_t id, const char * inventoryPath)
+{
+	SynthServerRequest request;
+	SynthServerReply reply;
+
+	memset(&request, 0, sizeof(request));
+	request.command = kSynthServerUseVoiceCommand;
+	request.selector = creator;
+	request.argument = id;
+	request.payloadLength = (inventoryPath) ? (uint32_t)strlen(inventoryPath) + 1 : 0;
+	return Call(channel, &request, inventoryPath, &reply);
+}
+
+long SynthServerChannelSetProperty(SynthServerChannel * channel, uint32_t selector, double value)
+{
+	SynthServerRequest request;
+	SynthServerReply reply;
+
+	memset(&request, 0, sizeof(request));
+	request.command = kSynthServerSetPropertyCommand;
+	request.selector = selector;
+	request.value = value;
+	return Call(channel, &request, NULL, &reply);
+}
+
+long SynthServerChannelGetProperty(SynthServerChannel * channel, uint32_t selector, double * outValue)
+{
+	SynthServerRequest request;
+	SynthServerReply reply;
+	long error;
+
+	memset(&request, 0, sizeof(request));
+	request.command = kSynthServerGetPropertyCommand;
+	request.selector = selector;
+	error = Call(channel, &request, NULL, &reply);
+	if (error == noErr) {
+		*outValue = reply.value;
+	}
+	return error;
+}
+
+long SynthServerChannelRender(SynthServerChannel * channel, const UniChar * text, long length, uint32_t samplesPerCharacter, const void * fallbackAudio, size_t fallbackAudioBytes, const SynthAudioCacheKey * key, SynthRenderedUtterance ** outUtterance)
+{
+	SynthServerBuffer audio = { NULL, 0, 0 };
+	SynthServerBuffer events = { NULL, 0, 0 };
+	SynthServerRequest request;
+	SynthServerReply reply;
+	SynthBoundaryIndex boundaries;
+	struct pollfd waiting;
+	uint32_t index, eventCount, timelineEventCount;
+	long error, drainError = noErr;
+
+	if (text == NULL || key == NULL || outUtterance == NULL || length < 0 || (size_t)length * sizeof(UniChar) > kSynthServerMaxPayloadLength) {
+		return paramErr;
+	}
+	*outUtterance = NULL;
+	memset(&request, 0, sizeof(request));
+	request.command = kSynthServerRenderCommand;
+	request.argument = samplesPerCharacter;
+	request.payloadLength = (uint32_t)(length * sizeof(UniChar));
+
+	// Keep the rings drained while the server renders, so an utterance longer than they hold streams through them.
+	// The reply comes after the last of the utterance went into the rings, so they're drained once more after it.
+	pthread_mutex_lock(&channel->mutex);
+	error = SynthServerSend(channel->socket, &request, sizeof(request), text, request.payloadLength, -1);
+	while (error == noErr) {
+		drainError = Drain(channel->eventRing, &events, drainError);
+		drainError = Drain(channel->audioRing, &audio, drainError);
+		waiting.fd = channel->socket;
+		waiting.events = POLLIN;
+		if (poll(&waiting, 1, kSynthServerDrainInterval) > 0) {
+			error = SynthServerReceive(channel->socket, &reply, sizeof(reply), NULL);
+			drainError = Drain(channel->eventRing, &events, drainError);
+			drainError = Drain(channel->audioRing, &audio, drainError);
+			break;
+		}
+	}
+	pthread_mutex_unlock(&channel->mutex);
+	if (error == noErr) {
+		error = (reply.status != noErr) ? reply.status : drainError;
+	}
+
+	// Boundaries come back as events of their own kinds; move them into an index, and the other events up behind each other.
+	SynthBoundaryIndexInit(&boundaries);
+	if (error == noErr) {
+		SynthTimelineEvent * timelineEvents = (SynthTimelineEvent *)events.bytes;
+		eventCount = (uint32_t)(events.length / sizeof(SynthTimelineEvent));
+		for (index = 0, timelineEventCount = 0; index < eventCount && error == noErr; index++) {
+			if (timelineEvents[index].kind == kSynthServerWordEndEvent) {
+				error = SynthBoundaryIndexAddWordEnd(&boundaries, timelineEvents[index].samplePosition);
+			}
+			else if (timelineEvents[index].kind == kSynthServerSentenceEndEvent) {
+				error = SynthBoundaryIndexAddSentenceEnd(&boundaries, timelineEvents[index].samplePosition);
+			}
+			else {
+				timelineEvents[timelineEventCount++] = timelineEvents[index];
+			}
+		}
+		boundaries.totalSamples = (uint64_t)reply.value;
+		if (error == noErr) {
+			if (audio.length > 0) {
+				error = SynthRenderedUtteranceCreate(key, audio.bytes, audio.length, timelineEvents, timelineEventCount, &boundaries, outUtterance);
+			}
+			else {
+				error = SynthRenderedUtteranceCreate(key, fallbackAudio, fallbackAudioBytes, timelineEvents, timelineEventCount, &boundaries, outUtterance);
+			}
+		}
+	}
+
+	SynthBoundaryIndexDispose(&boundaries);
+	free(audio.bytes);
+	free(events.bytes);
+	return error;
+}
+
+long SynthServerChannelCopyPhonemes(SynthServerChannel * channel, const UniChar * text, long length, UniChar ** outPhonemes, long * outPhonemeLength)
+{
+	SynthServerRequest request;
+	SynthServerReply reply;
+	UniChar * phonemes = NULL;
+	long error;
+
+	if (text == NULL || outPhonemes == NULL || outPhonemeLength == NULL || length < 0 || (size_t)length * sizeof(UniChar) > kSynthServerMaxPayloadLength) {
+		return paramErr;
+	}
+	*outPhonemes = NULL;
+	*outPhonemeLength = 0;
+	memset(&request, 0, sizeof(request));
+	request.command = kSynthServerCopyPhonemesCommand;
+	request.payloadLength = (uint32_t)(length * sizeof(UniChar));
+
+	// The reply's payload is read here rather than by Call, which only knows replies without one.
+	pthread_mutex_lock(&channel->mutex);
+	error = SynthServerSend(channel->socket, &request, sizeof(request), text, request.payloadLength, -1);
+	if (error == noErr) {
+		error = SynthServerReceive(channel->socket, &reply, sizeof(reply), NULL);
+	}
+	if (error == noErr && reply.payloadLength > kSynthServerMaxPayloadLength) {
+		error = ioErr;
+	}
+	if (error == noErr) {
+		phonemes = (UniChar *)malloc(reply.payloadLength ? reply.payloadLength : 1);
+		if (phonemes == NULL) {
+			error = memFullErr;
+		}
+		else if (reply.payloadLength > 0) {
+			error = SynthServerReceive(channel->socket, phonemes, reply.payloadLength, NULL);
+		}
+	}
+	if (error != noErr) {
+		// Whatever is left of the reply would be taken for the next one, so the connection is done for.
+		shutdown(channel->socket, SHUT_RDWR);
+	}
+	pthread_mutex_unlock(&channel->mutex);
+
+	if (error == noErr && reply.status != noErr) {
+		error = reply.status;
+	}
+	if (error == noErr) {
+		*outPhonemes = phonemes;
+		*outPhonemeLength = reply.payloadLength / sizeof(UniChar);
+	}
+	else {
+		free(phonemes);
+	}
+	return error;
+}
+
+long SynthServerChannelPing(SynthServerChannel * channel)
+{
+	SynthServerRequest request;
+	SynthServerReply reply;
+
+	memset(&request, 0, sizeof(request));
+	request.command = kSynthServerPingCommand;
+	return Call(channel, &request, NULL, &reply);
+}
+
+static long Call(SynthServerChannel * channel, const SynthServerRequest * request, const void * payload, SynthServerReply * reply)
+{
+	long error;
+
+	pthread_mutex_lock(&channel->mutex);
+	error = SynthServerSend(channel->socket, request, sizeof(SynthServerRequest), payload, request->payloadLength, -1);
+	if (error == noErr) {
+		error = SynthServerReceive(channel->socket, reply, sizeof(SynthServerReply), NULL);
+	}
+	pthread_mutex_unlock(&channel->mutex);
+	return (error == noErr) ? reply->status : error;
+}
+
+static long Drain(SynthSharedRing * ring, SynthServerBuffer * buffer, long error)
+{
+	uint32_t count = SynthSharedRingReadable(ring);
+	uint8_t discard[4096];
+
+	// Once the bytes can't be kept they're still read, so the server isn't left waiting for room.
+	if (error != noErr) {
+		while (count > 0) {
+			uint32_t chunk = (count < sizeof(discard)) ? count : sizeof(discard);
+			SynthSharedRingRead(ring, discard, chunk);
+			count -= chunk;
+		}
+		return error;
+	}
+	if (count == 0) {
+		return noErr;
+	}
+	if (buffer->length + count > buffer->capacity) {
+		size_t capacity = (buffer->capacity) ? buffer->capacity * 2 : 64 * 1024;
+		while (capacity < buffer->length + count) {
+			capacity *= 2;
+		}
+		uint8_t * bytes = (uint8_t *)realloc(buffer->bytes, capacity);
+		if (bytes == NULL) {
+			return memFullErr;
+		}
+		buffer->bytes = bytes;
+		buffer->capacity = capacity;
+	}
+	SynthSharedRingRead(ring, buffer->bytes + buffer->length, count);
+	buffer->length += count;
+	return noErr;
+}
@@ -0,0 +1,83 @@
+/*
+	SynthServerClient.h
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: The plug-in's side of a connection to the synthesis server.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#ifndef __SYNTHSERVERCLIENT__
+#define __SYNTHSERVERCLIENT__
+
+#include "SynthServerProtocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// One speech channel's connection.  Calls on a connection are serialized, so any thread may make them.
+typedef struct SynthServerChannel SynthServerChannel;
+
+// The socket named by the SYNTH_ENGINE_SERVER_SOCKET environment variable, or NULL if server mode is off.
+const char *	SynthServerGetSocketPath(void);
+
+long		SynthServerChannelCreate(const char * socketPath, SynthServerChannel ** outChannel);
+void		SynthServerChannelDispose(SynthServerChannel * channel);
+
+// inventoryPath is the voice's unit inventory, or NULL for a voice without one.
+long		SynthServerChannelUseVoice(SynthServerChannel * channel, uint32_t creator, uint32_t id, const char * inventoryPath);
+long		SynthServerChannelSetProperty(SynthServerChannel * channel, uint32_t selector, double value);
+long		SynthServerChannelGetProperty(SynthServerChannel * channel, uint32_t selector, double * outValue);
+
+// Renders text as SynthUtteranceRender would, with the voice the server has for the channel.  The audio and events
+// stream back through shared memory; fallbackAudio is used if the voice has no inventory.
+long		SynthServerChannelRender(SynthServerChannel * channel, const UniChar * text, long length, uint32_t samplesPerCharacter, const void * fallbackAudio, size_t fallbackAudioBytes, const SynthAudioCacheKey * key, SynthRenderedUtterance ** outUtterance);
+
+// Passes back the phonemes of text in a block the caller frees.
+long		SynthServerChannelCopyPhonemes(SynthServerChannel * channel, const UniChar * text, long length, UniChar ** outPhonemes, long * outPhonemeLength);
+
+// A round trip that does nothing, for measuring the connection.
+long		SynthServerChannelPing(SynthServerChannel * channel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
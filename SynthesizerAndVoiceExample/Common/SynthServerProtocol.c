@@ -0,0 +1,151 @@
+/*
+	SynthServerProtocol.c
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Sending and receiving the messages between the plug-in and the synthesis server.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "SynthServerProtocol.h"
+
+// Where there's no MSG_NOSIGNAL, the sockets are set up with SO_NOSIGPIPE instead.
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL	0
+#endif
+
+long SynthServerSend(int socket, const void * message, size_t messageSize, const void * payload, size_t payloadLength, int descriptor)
+{
+	union {
+		struct cmsghdr	header;
+		char			space[CMSG_SPACE(sizeof(int))];
+	} control;
+	struct iovec pieces[2];
+	struct msghdr header;
+	ssize_t sent;
+
+	pieces[0].iov_base = (void *)message;
+	pieces[0].iov_len = messageSize;
+	pieces[1].iov_base = (void *)payload;
+	pieces[1].iov_len = (payload) ? payloadLength : 0;
+	memset(&header, 0, sizeof(header));
+	header.msg_iov = pieces;
+	header.msg_iovlen = 2;
+	if (descriptor >= 0) {
+		memset(&control, 0, sizeof(control));
+		header.msg_control = control.space;
+		header.msg_controllen = sizeof(control.space);
+		CMSG_FIRSTHDR(&header)->cmsg_level = SOL_SOCKET;
+		CMSG_FIRSTHDR(&header)->cmsg_type = SCM_RIGHTS;
+		CMSG_FIRSTHDR(&header)->cmsg_len = CMSG_LEN(sizeof(int));
+		memcpy(CMSG_DATA(CMSG_FIRSTHDR(&header)), &descriptor, sizeof(int));
+	}
+
+	// Almost always one call; a large payload may take more, and only the first carries the descriptor.
+	while (header.msg_iovlen > 0) {
+		sent = sendmsg(socket, &header, MSG_NOSIGNAL);
+		if (sent < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return ioErr;
+		}
+		header.msg_control = NULL;
+		header.msg_controllen = 0;
+		while (header.msg_iovlen > 0 && (size_t)sent >= header.msg_iov[0].iov_len) {
+			sent -= header.msg_iov[0].iov_len;
+			header.msg_iov++;
+			header.msg_iovlen--;
+		}
+		if (header.msg_iovlen > 0) {
+			header.msg_iov[0].iov_base = (char *)header.msg_iov[0].iov_base + sent;
+			header.msg_iov[0].iov_len -= sent;
+		}
+	}
+	return noErr;
+}
+
+long SynthServerReceive(int socket, void * bytes, size_t byteCount, int * outDescriptor)
+{
+	union {
+		struct cmsghdr	header;
+		char			space[CMSG_SPACE(sizeof(int))];
+	} control;
+	struct iovec piece;
+	struct msghdr header;
+	struct cmsghdr * item;
+	ssize_t received;
+
+	if (outDescriptor) {
+		*outDescriptor = -1;
+	}
+	while (byteCount > 0) {
+		piece.iov_base = bytes;
+		piece.iov_len = byteCount;
+		memset(&header, 0, sizeof(header));
+		header.msg_iov = &piece;
+		header.msg_iovlen = 1;
+		if (outDescriptor && *outDescriptor < 0) {
+			header.msg_control = control.space;
+			header.msg_controllen = sizeof(control.space);
+		}
+		received = recvmsg(socket, &header, 0);
+		if (received < 0 && errno == EINTR) {
+			continue;
+		}
+		if (received <= 0) {
+			return ioErr;
+		}
+		if (header.msg_controllen > 0) {
+			for (item = CMSG_FIRSTHDR(&header); item; item = CMSG_NXTHDR(&header, item)) {
+				if (item->cmsg_level == SOL_SOCKET && item->cmsg_type == SCM_RIGHTS) {
+					memcpy(outDescriptor, CMSG_DATA(item), sizeof(int));
+				}
+			}
+		}
+		bytes = (char *)bytes + received;
+		byteCount -= received;
+	}
+	return noErr;
+}
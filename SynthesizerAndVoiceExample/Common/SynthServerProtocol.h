@@ -0,0 +1,125 @@
+/*
+	SynthServerProtocol.h
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Messages between the plug-in and the synthesis server, and the layout of
+	the memory they share.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#ifndef __SYNTHSERVERPROTOCOL__
+#define __SYNTHSERVERPROTOCOL__
+
+#include "SynthEngineBase.h"
+#include "SynthAudioCache.h"
+#include "SynthSharedRing.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Setting this environment variable to the server's socket path puts the plug-in in server mode.
+#define kSynthServerSocketVariable			"SYNTH_ENGINE_SERVER_SOCKET"
+#define kSynthServerDefaultSocketPath		"/tmp/SynthesisServer.socket"
+
+#define kSynthServerMagic					0x53535256		// 'SSRV'
+#define kSynthServerProtocolVersion			1
+#define kSynthServerAudioRingCapacity		(256 * 1024)
+#define kSynthServerEventRingCapacity		(64 * 1024)
+#define kSynthServerMaxPayloadLength		(16 * 1024 * 1024)
+
+// Each connection to the server is one speech channel.  Requests and replies go over the socket; the audio
+// and events of a render come back through the rings in the memory shared when the connection is opened.
+enum {
+	kSynthServerHelloCommand			= 1,		// The reply carries the descriptor of the shared memory.
+	kSynthServerUseVoiceCommand			= 2,		// selector is the voice creator, argument its id, payload the UTF-8 bundle path.
+	kSynthServerSetPropertyCommand		= 3,		// selector is the property's four-character code.
+	kSynthServerGetPropertyCommand		= 4,
+	kSynthServerRenderCommand			= 5,		// payload is UTF-16 text.  Replies once the last of it is in the rings.
+	kSynthServerCopyPhonemesCommand		= 6,		// payload is UTF-16 text, the reply's payload its UTF-16 phonemes.
+	kSynthServerPingCommand				= 7
+};
+
+// Properties the server acts on rather than just keeping.  The number and character modes are sent as 1 for
+// kSpeechModeLiteral and 0 for kSpeechModeNormal.
+#define kSynthServerNumberModeSelector		0x6E6D6272		// 'nmbr'
+#define kSynthServerCharacterModeSelector	0x63686172		// 'char'
+
+typedef struct SynthServerRequest {
+	uint32_t	command;
+	uint32_t	selector;
+	uint32_t	argument;
+	uint32_t	payloadLength;		// Bytes that follow the request.
+	double		value;
+} SynthServerRequest;
+
+typedef struct SynthServerReply {
+	int32_t		status;
+	uint32_t	payloadLength;		// Bytes that follow the reply.
+	double		value;				// The property's value, or the rendered utterance's length in samples.
+} SynthServerReply;
+
+// At the start of the shared memory, followed by the two rings.
+typedef struct SynthServerSharedHeader {
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	audioRingOffset;
+	uint32_t	eventRingOffset;
+	uint32_t	size;
+	uint32_t	reserved[11];
+} SynthServerSharedHeader;
+
+// A render's events come back as SynthTimelineEvents, with these kinds added for its boundaries.
+enum {
+	kSynthServerWordEndEvent			= 16,		// samplePosition is the end of a word.
+	kSynthServerSentenceEndEvent		= 17		// samplePosition is the end of a sentence.
+};
+
+// Sends a request or reply and the payload that follows it in one message, with descriptor attached if it isn't -1.
+long		SynthServerSend(int socket, const void * message, size_t messageSize, const void * payload, size_t payloadLength, int descriptor);
+
+// Receives exactly byteCount bytes.  If outDescriptor isn't NULL it gets a descriptor attached to them, or -1.
+long		SynthServerReceive(int socket, void * bytes, size_t byteCount, int * outDescriptor);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,105 @@
+/*
+	SynthSharedRing.c
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Shared-memory byte ring.  See SynthSharedRing.h.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#include <string.h>
+#include "SynthSharedRing.h"
+
+size_t SynthSharedRingSize(uint32_t capacity)
+{
+	return sizeof(SynthSharedRing) + capacity;
+}
+
+void SynthSharedRingInit(SynthSharedRing * ring, uint32_t capacity)
+{
+	memset(ring, 0, sizeof(SynthSharedRing));
+	ring->capacity = capacity;
+	atomic_init(&ring->writePosition, 0);
+	atomic_init(&ring->readPosition, 0);
+}
+
+uint32_t SynthSharedRingReadable(SynthSharedRing * ring)
+{
+	return atomic_load_explicit(&ring->writePosition, memory_order_acquire) - atomic_load_explicit(&ring->readPosition, memory_order_relaxed);
+}
+
+uint32_t SynthSharedRingWritable(SynthSharedRing * ring)
+{
+	return ring->capacity - (atomic_load_explicit(&ring->writePosition, memory_order_relaxed) - atomic_load_explicit(&ring->readPosition, memory_order_acquire));
+}
+
+Boolean SynthSharedRingWrite(SynthSharedRing * ring, const void * bytes, uint32_t count)
+{
+	uint32_t position = atomic_load_explicit(&ring->writePosition, memory_order_relaxed);
+	uint32_t offset, firstPart;
+
+	if (count > SynthSharedRingWritable(ring)) {
+		return false;
+	}
+
+	// Copy in up to two pieces, around the end of the buffer, then publish the bytes.
+	offset = position & (ring->capacity - 1);
+	firstPart = (count < ring->capacity - offset) ? count : ring->capacity - offset;
+	memcpy(ring->bytes + offset, bytes, firstPart);
+	memcpy(ring->bytes, (const uint8_t *)bytes + firstPart, count - firstPart);
+	atomic_store_explicit(&ring->writePosition, position + count, memory_order_release);
+	return true;
+}
+
+Boolean SynthSharedRingRead(SynthSharedRing * ring, void * bytes, uint32_t count)
+{
+	uint32_t position = atomic_load_explicit(&ring->readPosition, memory_order_relaxed);
+	uint32_t offset, firstPart;
+
+	if (count > SynthSharedRingReadable(ring)) {
+		return false;
+	}
+
+	offset = position & (ring->capacity - 1);
+	firstPart = (count < ring->capacity - offset) ? count : ring->capacity - offset;
+	memcpy(bytes, ring->bytes + offset, firstPart);
+	memcpy((uint8_t *)bytes + firstPart, ring->bytes, count - firstPart);
+	atomic_store_explicit(&ring->readPosition, position + count, memory_order_release);
+	return true;
+}
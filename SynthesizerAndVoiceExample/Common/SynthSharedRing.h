@@ -0,0 +1,84 @@
+/*
+	SynthSharedRing.h
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Single-producer, single-consumer byte ring that can live in memory shared
+	between processes.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#ifndef __SYNTHSHAREDRING__
+#define __SYNTHSHAREDRING__
+
+#include <stdatomic.h>
+#include "SynthEngineBase.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The positions count bytes ever written and read, wrapping at 2^32; they're 32 bits so they stay lock free
+// for 32-bit clients.  Each sits on its own cache line so the two sides don't share one.
+typedef struct SynthSharedRing {
+	uint32_t		capacity;			// A power of two.
+	uint32_t		reserved[15];
+	atomic_uint		writePosition;
+	uint32_t		writePadding[15];
+	atomic_uint		readPosition;
+	uint32_t		readPadding[15];
+	uint8_t			bytes[];
+} SynthSharedRing;
+
+// Bytes needed for a ring with the given capacity, which must be a power of two.
+size_t		SynthSharedRingSize(uint32_t capacity);
+void		SynthSharedRingInit(SynthSharedRing * ring, uint32_t capacity);
+
+uint32_t	SynthSharedRingReadable(SynthSharedRing * ring);
+uint32_t	SynthSharedRingWritable(SynthSharedRing * ring);
+
+// Write or read all count bytes, or nothing if there isn't the data or room for all of them.
+Boolean		SynthSharedRingWrite(SynthSharedRing * ring, const void * bytes, uint32_t count);
+Boolean		SynthSharedRingRead(SynthSharedRing * ring, void * bytes, uint32_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
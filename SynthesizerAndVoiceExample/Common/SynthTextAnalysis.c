@@ -0,0 +1,296 @@
+/*
+	SynthTextAnalysis.c
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Simulated front end.  See SynthTextAnalysis.h.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "SynthTextAnalysis.h"
+
+// The MacinTalk phoneme symbols, indexed by opcode.
+static const char * const sPhonemeSymbols[] = {
+	"%", "@", "AE", "EY", "AO", "AX", "IY", "EH", "IH", "AY", "IX", "AA", "UW", "UH", "UX", "OW", "AW", "OY",
+	"b", "C", "d", "D", "f", "g", "h", "J", "k", "l", "m", "n", "N", "p", "r", "s", "S", "t", "T", "v", "w", "y", "z", "Z"
+};
+
+// Opcode spoken for each letter, a through z.  A real front end would use a pronunciation dictionary
+// and letter-to-sound rules; spelling the word out is enough to exercise everything downstream.
+static const int8_t sLetterPhonemes[26] = {
+	2, 18, 26, 20, 7, 22, 23, 24, 8, 25, 26, 27, 28, 29, 11, 31, 26, 32, 33, 35, 5, 37, 38, 26, 39, 40
+};
+
+#define kSilencePhoneme		0
+#define kSchwaPhoneme		5
+
+#define kPhonemeSymbolCount	(sizeof(sPhonemeSymbols) / sizeof(sPhonemeSymbols[0]))
+
+static int32_t PhonemeForCharacter(UniChar c);
+static void		AppendPhonemeEvent(SynthTextAnalysis * analysis, long charIndex, int32_t phonemeCode);
+static void		AppendPhonemeSymbol(SynthTextAnalysis * analysis, int32_t phonemeCode);
+
+uint64_t SynthTextHash(const UniChar * text, long length)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	long charIndex;
+
+	for (charIndex = 0; charIndex < length; charIndex++) {
+		hash ^= (uint64_t)(text[charIndex] & 0xFF);
+		hash *= 1099511628211ULL;
+		hash ^= (uint64_t)(text[charIndex] >> 8);
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+long SynthTextAnalyze(const UniChar * normalized, long length, const SynthDictionary * dictionary, SynthTextAnalysis ** outAnalysis)
+{
+	SynthTextAnalysis * analysis;
+	long phonemeCapacity = 3 * length + 1;
+	long charIndex = 0;
+	long error;
+
+	if (outAnalysis == NULL || length < 0 || (length > 0 && normalized == NULL) || length > (long)(UINT32_MAX / 3)) {
+		return paramErr;
+	}
+	*outAnalysis = NULL;
+
+	analysis = (SynthTextAnalysis *)calloc(1, sizeof(SynthTextAnalysis));
+	if (analysis == NULL) {
+		return memFullErr;
+	}
+	atomic_init(&analysis->referenceCount, 1);
+	SynthBoundaryIndexInit(&analysis->boundaries);
+	analysis->textLength = length;
+
+	// Every character yields at most a word event and a phoneme event, and at most two symbols and a space.
+	analysis->events = (SynthTextEvent *)malloc((2 * length + 1) * sizeof(SynthTextEvent));
+	analysis->phonemes = (UniChar *)malloc(phonemeCapacity * sizeof(UniChar));
+	if (analysis->events == NULL || analysis->phonemes == NULL) {
+		SynthTextAnalysisRelease(analysis);
+		return memFullErr;
+	}
+
+	while (charIndex < length) {
+		UniChar c = normalized[charIndex];
+
+		if (c == '[' && charIndex + 1 < length && normalized[charIndex + 1] == '[') {
+			SynthTextEvent * event = &analysis->events[analysis->eventCount++];
+			event->kind = kSynthTextEmbeddedCommandEvent;
+			event->characterOffset = (uint32_t)charIndex;
+			event->length = 2;
+			event->phonemeCode = kSilencePhoneme;
+			charIndex += 2;
+		}
+		else if (SynthBoundaryIsWordCharacter(c)) {
+			SynthTextEvent * wordEvent = &analysis->events[analysis->eventCount++];
+			const uint8_t * codes;
+			uint32_t codeCount;
+			long wordEnd = charIndex;
+			while (wordEnd < length && SynthBoundaryIsWordCharacter(normalized[wordEnd])) {
+				wordEnd++;
+			}
+			wordEvent->kind = kSynthTextWordEvent;
+			wordEvent->characterOffset = (uint32_t)charIndex;
+			wordEvent->length = (uint32_t)(wordEnd - charIndex);
+			wordEvent->phonemeCode = kSilencePhoneme;
+
+			if (analysis->phonemeLength > 0) {
+				analysis->phonemes[analysis->phonemeLength++] = ' ';
+			}
+			if (SynthDictionaryLookup(dictionary, normalized + charIndex, wordEnd - charIndex, &codes, &codeCount)) {
+				long wordStart = charIndex;
+				uint32_t codeIndex, previousCode = UINT32_MAX;
+
+				// The whole pronunciation goes into the phonemes, which may need more room than the word's spelling would.
+				long needed = analysis->phonemeLength + 2 * (long)codeCount + 3 * (length - wordEnd) + 1;
+				if (needed > phonemeCapacity) {
+					UniChar * phonemes = (UniChar *)realloc(analysis->phonemes, needed * sizeof(UniChar));
+					if (phonemes == NULL) {
+						SynthTextAnalysisRelease(analysis);
+						return memFullErr;
+					}
+					analysis->phonemes = phonemes;
+					phonemeCapacity = needed;
+				}
+				for (codeIndex = 0; codeIndex < codeCount; codeIndex++) {
+					AppendPhonemeSymbol(analysis, codes[codeIndex]);
+				}
+
+				// But each character speaks one phoneme at most, so the sound spreads the pronunciation over the word:
+				// a character starts each phoneme, and a pronunciation longer than the word is spoken in part.
+				for (; charIndex < wordEnd; charIndex++) {
+					codeIndex = (uint32_t)((uint64_t)(charIndex - wordStart) * codeCount / (uint64_t)(wordEnd - wordStart));
+					if (codeIndex != previousCode) {
+						AppendPhonemeEvent(analysis, charIndex, codes[codeIndex]);
+						previousCode = codeIndex;
+					}
+				}
+			}
+			else {
+				for (; charIndex < wordEnd; charIndex++) {
+					int32_t phonemeCode = PhonemeForCharacter(normalized[charIndex]);
+					AppendPhonemeEvent(analysis, charIndex, phonemeCode);
+					AppendPhonemeSymbol(analysis, phonemeCode);
+				}
+			}
+		}
+		else {
+			charIndex++;
+		}
+	}
+
+	error = SynthBoundaryIndexBuildFromText(&analysis->boundaries, normalized, length, 1);
+	if (error != noErr) {
+		SynthTextAnalysisRelease(analysis);
+		return error;
+	}
+
+	// The analysis may stay cached for a long time, so give back what the worst case didn't use.
+	if (analysis->eventCount > 0) {
+		SynthTextEvent * events = (SynthTextEvent *)realloc(analysis->events, analysis->eventCount * sizeof(SynthTextEvent));
+		if (events) {
+			analysis->events = events;
+		}
+	}
+	if (analysis->phonemeLength > 0) {
+		UniChar * phonemes = (UniChar *)realloc(analysis->phonemes, analysis->phonemeLength * sizeof(UniChar));
+		if (phonemes) {
+			analysis->phonemes = phonemes;
+		}
+	}
+
+	analysis->byteSize = sizeof(SynthTextAnalysis) + analysis->eventCount * sizeof(SynthTextEvent) + analysis->phonemeLength * sizeof(UniChar)
+						+ (analysis->boundaries.wordCapacity + analysis->boundaries.sentenceCapacity) * sizeof(uint64_t);
+	*outAnalysis = analysis;
+	return noErr;
+}
+
+SynthTextAnalysis * SynthTextAnalysisRetain(SynthTextAnalysis * analysis)
+{
+	if (analysis) {
+		atomic_fetch_add_explicit(&analysis->referenceCount, 1, memory_order_relaxed);
+	}
+	return analysis;
+}
+
+void SynthTextAnalysisRelease(SynthTextAnalysis * analysis)
+{
+	if (analysis && atomic_fetch_sub_explicit(&analysis->referenceCount, 1, memory_order_acq_rel) == 1) {
+		SynthBoundaryIndexDispose(&analysis->boundaries);
+		free(analysis->phonemes);
+		free(analysis->events);
+		free(analysis);
+	}
+}
+
+long SynthTextParsePhonemes(const UniChar * symbols, long length, uint8_t * codes, uint32_t * outCodeCount)
+{
+	long charIndex = 0;
+	uint32_t codeCount = 0;
+	uint32_t code;
+
+	if (symbols == NULL || codes == NULL || outCodeCount == NULL || length < 0) {
+		return paramErr;
+	}
+	while (charIndex < length) {
+		UniChar c = symbols[charIndex];
+		uint32_t matchLength = 0;
+
+		// Stress, syllable and prosody marks don't change which phonemes are spoken.
+		if (! ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '%' || c == '@')) {
+			charIndex++;
+			continue;
+		}
+
+		// Symbols are one or two characters, and a two-character one may start with a one-character one, so take the longest.
+		for (code = 0; code < kPhonemeSymbolCount; code++) {
+			const char * symbol = sPhonemeSymbols[code];
+			uint32_t symbolLength = (uint32_t)strlen(symbol);
+			if (symbolLength > matchLength && charIndex + symbolLength <= length && symbols[charIndex] == (UniChar)symbol[0]
+					&& (symbolLength == 1 || symbols[charIndex + 1] == (UniChar)symbol[1])) {
+				codes[codeCount] = (uint8_t)code;
+				matchLength = symbolLength;
+			}
+		}
+		if (matchLength == 0) {
+			return badDictFormat;
+		}
+		codeCount++;
+		charIndex += matchLength;
+	}
+	*outCodeCount = codeCount;
+	return noErr;
+}
+
+static void AppendPhonemeEvent(SynthTextAnalysis * analysis, long charIndex, int32_t phonemeCode)
+{
+	if (phonemeCode != kSilencePhoneme) {
+		SynthTextEvent * event = &analysis->events[analysis->eventCount++];
+		event->kind = kSynthTextPhonemeEvent;
+		event->characterOffset = (uint32_t)charIndex;
+		event->length = 1;
+		event->phonemeCode = phonemeCode;
+	}
+}
+
+static void AppendPhonemeSymbol(SynthTextAnalysis * analysis, int32_t phonemeCode)
+{
+	const char * symbol = sPhonemeSymbols[phonemeCode];
+
+	if (phonemeCode != kSilencePhoneme) {
+		while (*symbol) {
+			analysis->phonemes[analysis->phonemeLength++] = (UniChar)*symbol++;
+		}
+	}
+}
+
+static int32_t PhonemeForCharacter(UniChar c)
+{
+	if (c >= 'A' && c <= 'Z') {
+		return sLetterPhonemes[c - 'A'];
+	}
+	if (c >= 'a' && c <= 'z') {
+		return sLetterPhonemes[c - 'a'];
+	}
+	return (c == '\'') ? kSilencePhoneme : kSchwaPhoneme;
+}
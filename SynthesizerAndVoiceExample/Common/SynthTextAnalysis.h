@@ -0,0 +1,103 @@
+/*
+	SynthTextAnalysis.h
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: The engine's front end: normalizes text and turns it into the phonemes,
+	word and phoneme events and boundaries that speaking it produces.  An analysis
+	is immutable once built and reference counted, so it can be shared between
+	channels through the phoneme cache.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#ifndef __SYNTHTEXTANALYSIS__
+#define __SYNTHTEXTANALYSIS__
+
+#include <stdatomic.h>
+#include "SynthEngineBase.h"
+#include "SynthBoundaryIndex.h"
+#include "SynthDictionary.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum SynthTextEventKind {
+	kSynthTextWordEvent					= 1,		// characterOffset and length give the word.
+	kSynthTextPhonemeEvent				= 2,		// phonemeCode is spoken for the character at characterOffset.
+	kSynthTextEmbeddedCommandEvent		= 3			// An embedded command ("[[") begins at characterOffset.
+} SynthTextEventKind;
+
+typedef struct SynthTextEvent {
+	uint32_t	kind;
+	uint32_t	characterOffset;		// In the normalized text.
+	uint32_t	length;
+	int32_t		phonemeCode;
+} SynthTextEvent;
+
+typedef struct SynthTextAnalysis {
+	atomic_uint				referenceCount;
+	UniChar *				phonemes;			// Phoneme symbols for the whole text, as SECopyPhonemesFromText returns them.
+	long					phonemeLength;
+	SynthTextEvent *		events;				// In speaking order.
+	uint32_t				eventCount;
+	SynthBoundaryIndex		boundaries;			// Word and sentence ends, in characters of the normalized text.
+	long					textLength;			// Length of the normalized text.
+	size_t					byteSize;			// Memory held by the analysis, for cache accounting.
+} SynthTextAnalysis;
+
+// 64-bit FNV-1a hash of a run of characters.
+uint64_t	SynthTextHash(const UniChar * text, long length);
+
+// Analyzes normalized text, saying the words in dictionary, if there is one, as it says to.  The analysis is
+// returned with a reference count of one.
+long		SynthTextAnalyze(const UniChar * normalized, long length, const SynthDictionary * dictionary, SynthTextAnalysis ** outAnalysis);
+
+// Reads phonemes written as MacinTalk symbols into opcodes, skipping stress, syllable and other marks.  codes must
+// have room for length opcodes.  Fails with badDictFormat on anything else.
+long		SynthTextParsePhonemes(const UniChar * symbols, long length, uint8_t * codes, uint32_t * outCodeCount);
+
+SynthTextAnalysis *	SynthTextAnalysisRetain(SynthTextAnalysis * analysis);
+void		SynthTextAnalysisRelease(SynthTextAnalysis * analysis);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,978 @@
+/*
+	SynthTextNormalizer.c
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: See SynthTextNormalizer.h.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "SynthTextNormalizer.h"
+#include "SynthBoundaryIndex.h"
+
+// What the normalizer does with each ASCII character.  Everything else is copied unless it's white space or a
+// currency sign.
+enum {
+	kCopiedClass		= 0,
+	kLetterClass		= 1,		// Copied, but may end an abbreviation or an ordinal.
+	kSpaceClass			= 2,
+	kDigitClass			= 3,
+	kPeriodClass		= 4,		// May end an abbreviation.
+	kCurrencyClass		= 5,
+	kSymbolClass		= 6			// Said as a word.
+};
+
+#define C	kCopiedClass
+#define L	kLetterClass
+#define W	kSpaceClass
+#define D	kDigitClass
+#define P	kPeriodClass
+#define M	kCurrencyClass
+#define S	kSymbolClass
+
+static const uint8_t sCharacterClasses[128] = {
+	C, C, C, C, C, C, C, C, C, W, W, C, C, W, C, C,		// \t \n \r
+	C, C, C, C, C, C, C, C, C, C, C, C, C, C, C, C,
+	W, C, C, S, M, S, S, C, C, C, C, S, C, C, P, C,		//   ! " # $ % & ' ( ) * + , - . /
+	D, D, D, D, D, D, D, D, D, D, C, C, C, S, C, C,		// 0-9 : ; < = > ?
+	S, L, L, L, L, L, L, L, L, L, L, L, L, L, L, L,		// @ A-O
+	L, L, L, L, L, L, L, L, L, L, L, C, C, C, C, C,		// P-Z [ \ ] ^ _
+	C, L, L, L, L, L, L, L, L, L, L, L, L, L, L, L,		// ` a-o
+	L, L, L, L, L, L, L, L, L, L, L, C, C, C, C, C		// p-z { | } ~ DEL
+};
+
+#undef C
+#undef L
+#undef W
+#undef D
+#undef P
+#undef M
+#undef S
+
+#define kPoundSign		0x00A3
+#define kEuroSign		0x20AC
+
+// The most digits read as one number; longer runs are read digit by digit.
+#define kMaxCardinalDigits		15
+
+static const char * const sOnes[20] = {
+	"zero", "one", "two", "three", "four", "five", "six", "seven", "eight", "nine", "ten",
+	"eleven", "twelve", "thirteen", "fourteen", "fifteen", "sixteen", "seventeen", "eighteen", "nineteen"
+};
+
+static const char * const sTens[10] = {
+	"", "", "twenty", "thirty", "forty", "fifty", "sixty", "seventy", "eighty", "ninety"
+};
+
+static const char * const sScales[5] = { "", "thousand", "million", "billion", "trillion" };
+
+static const char * const sMonths[12] = {
+	"January", "February", "March", "April", "May", "June", "July", "August", "September", "October", "November", "December"
+};
+
+// Cardinals whose ordinals don't just add "th".
+static const char * const sIrregularOrdinals[][2] = {
+	{ "one", "first" }, { "two", "second" }, { "three", "third" }, { "five", "fifth" },
+	{ "eight", "eighth" }, { "nine", "ninth" }, { "twelve", "twelfth" }
+};
+
+// The currency signs, with the words for their units and hundredths.
+typedef struct Currency {
+	UniChar			sign;
+	const char *	unit;
+	const char *	units;
+	const char *	hundredth;
+	const char *	hundredths;
+} Currency;
+
+static const Currency sCurrencies[] = {
+	{ '$', "dollar", "dollars", "cent", "cents" },
+	{ kPoundSign, "pound", "pounds", "penny", "pence" },
+	{ kEuroSign, "euro", "euros", "cent", "cents" }
+};
+
+// Abbreviations, matched with their case, and whether one can also end a sentence, in which case it keeps its
+// period when a capital letter follows.
+typedef struct Abbreviation {
+	const char *	abbreviation;
+	const char *	expansion;
+	Boolean			canEndSentence;
+} Abbreviation;
+
+static const Abbreviation sAbbreviations[] = {
+	{ "Dr", "Doctor", false }, { "Mr", "Mister", false }, { "Mrs", "Missus", false }, { "Ms", "Miz", false },
+	{ "Prof", "Professor", false }, { "St", "Saint", false }, { "Mt", "Mount", false }, { "Jr", "Junior", true },
+	{ "Sr", "Senior", true }, { "vs", "versus", false }, { "etc", "et cetera", true }, { "approx", "approximately", false },
+	{ "Ave", "Avenue", true }, { "Blvd", "Boulevard", true }, { "Inc", "Incorporated", true }, { "Ltd", "Limited", true },
+	{ "No", "Number", false }, { "Jan", "January", true }, { "Feb", "February", true }, { "Aug", "August", true },
+	{ "Sept", "September", true }, { "Oct", "October", true }, { "Nov", "November", true }, { "Dec", "December", true }
+};
+
+#define kMaxAbbreviationLength	6
+
+// Names for the ASCII punctuation when characters are spelled out, indexed from '!'.
+static const char * const sPunctuationNames['~' - '!' + 1] = {
+	"exclamation point", "quote", "number sign", "dollar sign", "percent", "ampersand", "apostrophe", "open paren",
+	"close paren", "star", "plus", "comma", "dash", "period", "slash",
+	NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+	"colon", "semicolon", "less than", "equals", "greater than", "question mark", "at",
+	NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+	NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+	"open bracket", "backslash", "close bracket", "caret", "underscore", "back quote",
+	NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+	NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+	"open brace", "vertical bar", "close brace", "tilde"
+};
+
+// The output as it's made, and the token being written.
+typedef struct Normalizer {
+	SynthNormalizedText *	out;
+	const UniChar *			text;
+	long					length;
+	uint32_t				modes;
+	long					tokenStart;				// Where in the normalized text the current token begins.
+	Boolean					separateNext;			// A letter or digit after the last token needs a space first.
+	Boolean					failed;
+} Normalizer;
+
+static long		Reserve(Normalizer * normalizer, long extra);
+static Boolean	ReserveToken(Normalizer * normalizer);
+static void		AppendSpace(Normalizer * normalizer, long sourceOffset);
+static void		AppendCopied(Normalizer * normalizer, long start, long end);
+static void		BeginToken(Normalizer * normalizer, long sourceOffset);
+static void		EndToken(Normalizer * normalizer, uint32_t kind, long sourceStart, long sourceEnd);
+static void		AppendASCII(Normalizer * normalizer, const char * string);
+static void		AppendWord(Normalizer * normalizer, const char * word);
+static void		AppendUnderThousand(Normalizer * normalizer, uint32_t value);
+static void		AppendCardinal(Normalizer * normalizer, uint64_t value);
+static void		MakeLastWordOrdinal(Normalizer * normalizer);
+static void		AppendYear(Normalizer * normalizer, uint32_t year);
+static void		AppendDigits(Normalizer * normalizer, long start, long end);
+static Boolean	AppendInteger(Normalizer * normalizer, long start, long end, uint64_t * outValue);
+static long		ScanCopyable(const UniChar * text, long position, long length);
+static long		ScanDigits(const UniChar * text, long position, long length);
+static long		ParseDate(const UniChar * text, long position, long length, uint32_t * outMonth, uint32_t * outDay, uint32_t * outYear);
+static long		ExpandNumber(Normalizer * normalizer, long position);
+static Boolean	ExpandAbbreviation(Normalizer * normalizer, long position, long * outEnd);
+static long		SpellCharacter(Normalizer * normalizer, long position);
+
+static inline Boolean IsDigit(UniChar c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static inline Boolean IsLetter(UniChar c)
+{
+	return c < 0x80 && sCharacterClasses[c] == kLetterClass;
+}
+
+static inline const Currency * CurrencyForSign(UniChar c)
+{
+	uint32_t index;
+
+	for (index = 0; index < sizeof(sCurrencies) / sizeof(sCurrencies[0]); index++) {
+		if (sCurrencies[index].sign == c) {
+			return &sCurrencies[index];
+		}
+	}
+	return NULL;
+}
+
+long SynthTextNormalize(const UniChar * text, long length, uint32_t modes, SynthArena * arena, SynthNormalizedText * outText)
+{
+	Normalizer normalizer;
+	long position = 0;
+	long spaceOffset = 0;
+	Boolean pendingSpace = false;
+
+	if (outText == NULL) {
+		return paramErr;
+	}
+	memset(outText, 0, sizeof(SynthNormalizedText));
+	if (length < 0 || (length > 0 && text == NULL) || length > (long)(UINT32_MAX / 4)) {
+		return paramErr;
+	}
+
+	// Most text comes through a little longer than it went in.
+	outText->arena = arena;
+	outText->capacity = length + length / 8 + 32;
+	outText->tokenCapacity = (uint32_t)(length / 16 + 8);
+	outText->characters = (UniChar *)SynthScratchAlloc(arena, outText->capacity * sizeof(UniChar));
+	outText->originalOffsets = (uint32_t *)SynthScratchAlloc(arena, (outText->capacity + 1) * sizeof(uint32_t));
+	outText->tokens = (SynthTextToken *)SynthScratchAlloc(arena, outText->tokenCapacity * sizeof(SynthTextToken));
+	if (outText->characters == NULL || outText->originalOffsets == NULL || outText->tokens == NULL) {
+		SynthNormalizedTextDispose(outText);
+		return memFullErr;
+	}
+
+	memset(&normalizer, 0, sizeof(normalizer));
+	normalizer.out = outText;
+	normalizer.text = text;
+	normalizer.length = length;
+	normalizer.modes = modes;
+
+	while (position < length && ! normalizer.failed) {
+		UniChar c = text[position];
+		uint8_t characterClass = (c < 0x80) ? sCharacterClasses[c] : kCopiedClass;
+
+		if (c >= 0x80) {
+			if (SynthBoundaryIsWhiteSpace(c)) {
+				characterClass = kSpaceClass;
+			}
+			else if (CurrencyForSign(c)) {
+				characterClass = kCurrencyClass;
+			}
+		}
+
+		// A run of white space becomes one space, unless it's at either end or a copied space already stands for it.
+		if (characterClass == kSpaceClass) {
+			if (! pendingSpace && outText->length > 0 && outText->characters[outText->length - 1] != ' ') {
+				pendingSpace = true;
+				spaceOffset = position;
+			}
+			position++;
+			continue;
+		}
+		if (pendingSpace) {
+			AppendSpace(&normalizer, spaceOffset);
+			pendingSpace = false;
+		}
+
+		if (modes & kSynthTextLiteralCharacters) {
+			position = SpellCharacter(&normalizer, position);
+			continue;
+		}
+		switch (characterClass) {
+			case kDigitClass:
+				position = ExpandNumber(&normalizer, position);
+				break;
+			case kCurrencyClass:
+				if (position + 1 < length && IsDigit(text[position + 1])) {
+					position = ExpandNumber(&normalizer, position);
+				}
+				else {
+					AppendCopied(&normalizer, position, position + 1);
+					position++;
+				}
+				break;
+			case kPeriodClass:
+				if (! ExpandAbbreviation(&normalizer, position, &position)) {
+					AppendCopied(&normalizer, position, position + 1);
+					position++;
+				}
+				break;
+			case kSymbolClass:
+				BeginToken(&normalizer, position);
+				AppendWord(&normalizer, (c == '&') ? "and" : sPunctuationNames[c - '!']);
+				EndToken(&normalizer, kSynthTextSymbolToken, position, position + 1);
+				position++;
+				break;
+			default: {
+				long end = ScanCopyable(text, position, length);
+				if (end == position) {
+					end = position + 1;
+				}
+				AppendCopied(&normalizer, position, end);
+				position = end;
+				break;
+			}
+		}
+	}
+	if (normalizer.failed) {
+		SynthNormalizedTextDispose(outText);
+		return memFullErr;
+	}
+
+	// A space copied just before trailing white space that isn't ASCII is all that can be left at the end.
+	if (outText->length > 0 && outText->characters[outText->length - 1] == ' ') {
+		SynthTextToken * last = &outText->tokens[outText->tokenCount - 1];
+		outText->length--;
+		if (last->offset + last->length > outText->length) {
+			last->length--;
+			last->sourceLength--;
+		}
+	}
+	outText->originalOffsets[outText->length] = (outText->length > 0) ? outText->originalOffsets[outText->length - 1] + 1 : 0;
+	return noErr;
+}
+
+void SynthNormalizedTextDispose(SynthNormalizedText * normalizedText)
+{
+	if (normalizedText) {
+		SynthScratchFree(normalizedText->arena, normalizedText->characters);
+		SynthScratchFree(normalizedText->arena, normalizedText->originalOffsets);
+		SynthScratchFree(normalizedText->arena, normalizedText->tokens);
+		memset(normalizedText, 0, sizeof(SynthNormalizedText));
+	}
+}
+
+static long Reserve(Normalizer * normalizer, long extra)
+{
+	SynthNormalizedText * out = normalizer->out;
+	UniChar * characters;
+	uint32_t * originalOffsets;
+	long capacity;
+
+	if (out->length + extra <= out->capacity) {
+		return noErr;
+	}
+	capacity = out->capacity * 2;
+	if (capacity < out->length + extra) {
+		capacity = out->length + extra;
+	}
+	characters = (UniChar *)SynthScratchAlloc(out->arena, capacity * sizeof(UniChar));
+	originalOffsets = (uint32_t *)SynthScratchAlloc(out->arena, (capacity + 1) * sizeof(uint32_t));
+	if (characters == NULL || originalOffsets == NULL || capacity > (long)UINT32_MAX) {
+		SynthScratchFree(out->arena, characters);
+		SynthScratchFree(out->arena, originalOffsets);
+		normalizer->failed = true;
+		return memFullErr;
+	}
+	memcpy(characters, out->characters, out->length * sizeof(UniChar));
+	memcpy(originalOffsets, out->originalOffsets, out->length * sizeof(uint32_t));
+	SynthScratchFree(out->arena, out->characters);
+	SynthScratchFree(out->arena, out->originalOffsets);
+	out->characters = characters;
+	out->originalOffsets = originalOffsets;
+	out->capacity = capacity;
+	return noErr;
+}
+
+static Boolean ReserveToken(Normalizer * normalizer)
+{
+	SynthNormalizedText * out = normalizer->out;
+	SynthTextToken * tokens;
+
+	if (out->tokenCount < out->tokenCapacity) {
+		return true;
+	}
+	tokens = (SynthTextToken *)SynthScratchAlloc(out->arena, out->tokenCapacity * 2 * sizeof(SynthTextToken));
+	if (tokens == NULL) {
+		normalizer->failed = true;
+		return false;
+	}
+	memcpy(tokens, out->tokens, out->tokenCount * sizeof(SynthTextToken));
+	SynthScratchFree(out->arena, out->tokens);
+	out->tokens = tokens;
+	out->tokenCapacity *= 2;
+	return true;
+}
+
+// Spaces between tokens belong to none of them.
+static void AppendSpace(Normalizer * normalizer, long sourceOffset)
+{
+	SynthNormalizedText * out = normalizer->out;
+
+	if (Reserve(normalizer, 1) == noErr) {
+		out->characters[out->length] = ' ';
+		out->originalOffsets[out->length] = (uint32_t)sourceOffset;
+		out->length++;
+	}
+	normalizer->separateNext = false;
+}
+
+// Copies text from start to end, extending the last token if it was copied from just before.
+static void AppendCopied(Normalizer * normalizer, long start, long end)
+{
+	SynthNormalizedText * out = normalizer->out;
+	const UniChar * text = normalizer->text;
+	long count = end - start;
+	uint32_t * offsets;
+	long index;
+
+	if (normalizer->separateNext && (IsDigit(text[start]) || IsLetter(text[start]) || text[start] >= 0x80)) {
+		AppendSpace(normalizer, start);
+	}
+	normalizer->separateNext = false;
+	if (Reserve(normalizer, count) != noErr) {
+		return;
+	}
+
+	memcpy(out->characters + out->length, text + start, count * sizeof(UniChar));
+	offsets = out->originalOffsets + out->length;
+	for (index = 0; index < count; index++) {
+		offsets[index] = (uint32_t)(start + index);
+	}
+
+	if (out->tokenCount > 0) {
+		SynthTextToken * last = &out->tokens[out->tokenCount - 1];
+		if (last->kind == kSynthTextCopiedToken && last->sourceOffset + last->sourceLength == (uint32_t)start && last->offset + last->length == (uint32_t)out->length) {
+			last->sourceLength += (uint32_t)count;
+			last->length += (uint32_t)count;
+			out->length += count;
+			return;
+		}
+	}
+	if (ReserveToken(normalizer)) {
+		SynthTextToken * token = &out->tokens[out->tokenCount++];
+		token->kind = kSynthTextCopiedToken;
+		token->sourceOffset = (uint32_t)start;
+		token->sourceLength = (uint32_t)count;
+		token->offset = (uint32_t)out->length;
+		token->length = (uint32_t)count;
+	}
+	out->length += count;
+}
+
+// Words of an expansion are kept apart from whatever comes before them.
+static void BeginToken(Normalizer * normalizer, long sourceOffset)
+{
+	SynthNormalizedText * out = normalizer->out;
+
+	if (out->length > 0 && out->characters[out->length - 1] != ' ') {
+		AppendSpace(normalizer, sourceOffset);
+	}
+	normalizer->tokenStart = out->length;
+}
+
+static void EndToken(Normalizer * normalizer, uint32_t kind, long sourceStart, long sourceEnd)
+{
+	SynthNormalizedText * out = normalizer->out;
+	uint64_t sourceLength = (uint64_t)(sourceEnd - sourceStart);
+	uint64_t length = (uint64_t)(out->length - normalizer->tokenStart);
+	uint32_t * offsets = out->originalOffsets + normalizer->tokenStart;
+	uint64_t index;
+
+	if (normalizer->failed || length == 0) {
+		return;
+	}
+
+	// The expansion is spread evenly over what it stands for, ending on its last character, so that highlighting
+	// the words of the expansion highlights the text they came from.
+	for (index = 0; index < length; index++) {
+		offsets[index] = (uint32_t)(sourceStart + index * sourceLength / length);
+	}
+	offsets[length - 1] = (uint32_t)(sourceEnd - 1);
+
+	if (ReserveToken(normalizer)) {
+		SynthTextToken * token = &out->tokens[out->tokenCount++];
+		token->kind = kind;
+		token->sourceOffset = (uint32_t)sourceStart;
+		token->sourceLength = (uint32_t)sourceLength;
+		token->offset = (uint32_t)normalizer->tokenStart;
+		token->length = (uint32_t)length;
+	}
+	normalizer->separateNext = true;
+}
+
+static void AppendASCII(Normalizer * normalizer, const char * string)
+{
+	SynthNormalizedText * out = normalizer->out;
+	long count = (long)strlen(string);
+	long index;
+
+	if (Reserve(normalizer, count) == noErr) {
+		for (index = 0; index < count; index++) {
+			out->characters[out->length + index] = (UniChar)(unsigned char)string[index];
+		}
+		out->length += count;
+	}
+}
+
+// Appends a word of the current token, after a space if it isn't the first.
+static void AppendWord(Normalizer * normalizer, const char * word)
+{
+	if (normalizer->out->length > normalizer->tokenStart) {
+		AppendASCII(normalizer, " ");
+	}
+	AppendASCII(normalizer, word);
+}
+
+static void AppendUnderThousand(Normalizer * normalizer, uint32_t value)
+{
+	uint32_t remainder = value % 100;
+
+	if (value >= 100) {
+		AppendWord(normalizer, sOnes[value / 100]);
+		AppendWord(normalizer, "hundred");
+	}
+	if (remainder >= 20) {
+		AppendWord(normalizer, sTens[remainder / 10]);
+		if (remainder % 10) {
+			AppendWord(normalizer, sOnes[remainder % 10]);
+		}
+	}
+	else if (remainder > 0) {
+		AppendWord(normalizer, sOnes[remainder]);
+	}
+}
+
+static void AppendCardinal(Normalizer * normalizer, uint64_t value)
+{
+	uint32_t groups[5];
+	int groupCount = 0;
+
+	if (value == 0) {
+		AppendWord(normalizer, sOnes[0]);
+		return;
+	}
+	while (value > 0 && groupCount < 5) {
+		groups[groupCount++] = (uint32_t)(value % 1000);
+		value /= 1000;
+	}
+	while (groupCount-- > 0) {
+		if (groups[groupCount]) {
+			AppendUnderThousand(normalizer, groups[groupCount]);
+			if (groupCount > 0) {
+				AppendWord(normalizer, sScales[groupCount]);
+			}
+		}
+	}
+}
+
+// Turns the cardinal just appended into an ordinal: "twenty one" into "twenty first".
+static void MakeLastWordOrdinal(Normalizer * normalizer)
+{
+	SynthNormalizedText * out = normalizer->out;
+	long wordStart = out->length;
+	char word[16];
+	long wordLength;
+	uint32_t index;
+
+	while (wordStart > normalizer->tokenStart && out->characters[wordStart - 1] != ' ') {
+		wordStart--;
+	}
+	wordLength = out->length - wordStart;
+	if (wordLength == 0 || wordLength >= (long)sizeof(word)) {
+		return;
+	}
+	for (index = 0; index < wordLength; index++) {
+		word[index] = (char)out->characters[wordStart + index];
+	}
+	word[wordLength] = 0;
+
+	for (index = 0; index < sizeof(sIrregularOrdinals) / sizeof(sIrregularOrdinals[0]); index++) {
+		if (strcmp(word, sIrregularOrdinals[index][0]) == 0) {
+			out->length = wordStart;
+			AppendASCII(normalizer, sIrregularOrdinals[index][1]);
+			return;
+		}
+	}
+	if (word[wordLength - 1] == 'y') {
+		out->length--;
+		AppendASCII(normalizer, "ieth");
+	}
+	else {
+		AppendASCII(normalizer, "th");
+	}
+}
+
+// Years are read in pairs of digits, "nineteen seventy six", except in the first decade of a millennium.
+static void AppendYear(Normalizer * normalizer, uint32_t year)
+{
+	uint32_t century = year / 100;
+	uint32_t remainder = year % 100;
+
+	if (year < 1000 || year > 9999 || (century % 10 == 0 && remainder < 10)) {
+		AppendCardinal(normalizer, year);
+		return;
+	}
+	AppendUnderThousand(normalizer, century);
+	if (remainder == 0) {
+		AppendWord(normalizer, "hundred");
+	}
+	else {
+		if (remainder < 10) {
+			AppendWord(normalizer, "oh");
+		}
+		AppendUnderThousand(normalizer, remainder);
+	}
+}
+
+// Reads the digits from start to end one at a time, skipping anything else.
+static void AppendDigits(Normalizer * normalizer, long start, long end)
+{
+	const UniChar * text = normalizer->text;
+	long position;
+
+	for (position = start; position < end; position++) {
+		if (IsDigit(text[position])) {
+			AppendWord(normalizer, sOnes[text[position] - '0']);
+		}
+	}
+}
+
+// Reads the digits from start to end, skipping the commas between groups, as one number unless numbers are read
+// literally or there are too many of them.  Returns whether it was read as a number, and if so, its value.
+static Boolean AppendInteger(Normalizer * normalizer, long start, long end, uint64_t * outValue)
+{
+	const UniChar * text = normalizer->text;
+	uint64_t value = 0;
+	long digitCount = 0;
+	long position;
+
+	for (position = start; position < end; position++) {
+		if (IsDigit(text[position])) {
+			value = value * 10 + (text[position] - '0');
+			digitCount++;
+			if (digitCount > kMaxCardinalDigits) {
+				break;
+			}
+		}
+	}
+	if ((normalizer->modes & kSynthTextLiteralNumbers) || digitCount > kMaxCardinalDigits || (digitCount > 1 && text[start] == '0')) {
+		AppendDigits(normalizer, start, end);
+		return false;
+	}
+	AppendCardinal(normalizer, value);
+	*outValue = value;
+	return true;
+}
+
+// Returns the end of the run starting at position that can be copied as it is: anything but white space, digits,
+// currency signs, periods and symbols, with single spaces between words.
+static long ScanCopyable(const UniChar * text, long position, long length)
+{
+#if defined(__SSE2__)
+	const __m128i ascii = _mm_set1_epi16(0x7E);
+	const __m128i printable = _mm_set1_epi16(0x20);
+	const __m128i afterSpace = _mm_set1_epi16(0x21);
+	const __m128i space = _mm_set1_epi16(' ');
+	const __m128i beforeZero = _mm_set1_epi16('0' - 1);
+	const __m128i afterNine = _mm_set1_epi16('9' + 1);
+	const __m128i period = _mm_set1_epi16('.');
+	const __m128i dollar = _mm_set1_epi16('$');
+	const __m128i percent = _mm_set1_epi16('%');
+	const __m128i ampersand = _mm_set1_epi16('&');
+	const __m128i numberSign = _mm_set1_epi16('#');
+	const __m128i at = _mm_set1_epi16('@');
+	const __m128i plus = _mm_set1_epi16('+');
+	const __m128i equals = _mm_set1_epi16('=');
+	const __m128i zero = _mm_setzero_si128();
+#endif
+
+	while (position < length) {
+#if defined(__SSE2__)
+		// Eight characters at a time while they're all plain ASCII, reading one past them to see what follows a space.
+		while (position + 9 <= length) {
+			__m128i characters = _mm_loadu_si128((const __m128i *)(text + position));
+			__m128i next = _mm_loadu_si128((const __m128i *)(text + position + 1));
+			__m128i stop = _mm_or_si128(_mm_subs_epu16(characters, ascii), _mm_subs_epu16(printable, characters));
+			stop = _mm_or_si128(stop, _mm_and_si128(_mm_cmpgt_epi16(characters, beforeZero), _mm_cmplt_epi16(characters, afterNine)));
+			stop = _mm_or_si128(stop, _mm_and_si128(_mm_cmpeq_epi16(characters, space), _mm_cmpgt_epi16(_mm_subs_epu16(afterSpace, next), zero)));
+			stop = _mm_or_si128(stop, _mm_or_si128(_mm_cmpeq_epi16(characters, period), _mm_cmpeq_epi16(characters, dollar)));
+			stop = _mm_or_si128(stop, _mm_or_si128(_mm_cmpeq_epi16(characters, percent), _mm_cmpeq_epi16(characters, ampersand)));
+			stop = _mm_or_si128(stop, _mm_or_si128(_mm_cmpeq_epi16(characters, numberSign), _mm_cmpeq_epi16(characters, at)));
+			stop = _mm_or_si128(stop, _mm_or_si128(_mm_cmpeq_epi16(characters, plus), _mm_cmpeq_epi16(characters, equals)));
+			int mask = _mm_movemask_epi8(_mm_cmpeq_epi16(stop, zero)) ^ 0xFFFF;
+			if (mask == 0) {
+				position += 8;
+			}
+			else {
+				position += __builtin_ctz(mask) / 2;
+				break;
+			}
+		}
+		if (position >= length) {
+			break;
+		}
+#endif
+		// One at a time, through the class table.
+		UniChar c = text[position];
+		if (c < 0x80) {
+			uint8_t characterClass = sCharacterClasses[c];
+			if (characterClass == kSpaceClass) {
+				if (c != ' ' || position + 1 >= length || SynthBoundaryIsWhiteSpace(text[position + 1])) {
+					break;
+				}
+			}
+			else if (characterClass != kCopiedClass && characterClass != kLetterClass) {
+				break;
+			}
+		}
+		else if (SynthBoundaryIsWhiteSpace(c) || CurrencyForSign(c)) {
+			break;
+		}
+		position++;
+	}
+	return position;
+}
+
+static long ScanDigits(const UniChar * text, long position, long length)
+{
+	while (position < length && IsDigit(text[position])) {
+		position++;
+	}
+	return position;
+}
+
+// Reads a date written month/day/year or year-month-day with a four digit year, returning where it ends, or
+// position if there isn't one.
+static long ParseDate(const UniChar * text, long position, long length, uint32_t * outMonth, uint32_t * outDay, uint32_t * outYear)
+{
+	long fields[3][2];
+	uint32_t values[3];
+	UniChar separator = 0;
+	long end = position;
+	int field;
+
+	for (field = 0; field < 3; field++) {
+		long fieldEnd = ScanDigits(text, end, length);
+		if (fieldEnd == end || fieldEnd - end > 4) {
+			return position;
+		}
+		fields[field][0] = end;
+		fields[field][1] = fieldEnd;
+		values[field] = 0;
+		for (; end < fieldEnd; end++) {
+			values[field] = values[field] * 10 + (text[end] - '0');
+		}
+		if (field < 2) {
+			if (end >= length || (text[end] != '/' && text[end] != '-') || (separator && text[end] != separator)) {
+				return position;
+			}
+			separator = text[end++];
+		}
+	}
+	if (end < length && (IsDigit(text[end]) || IsLetter(text[end]) || text[end] == separator)) {
+		return position;
+	}
+
+	if (separator == '/' && fields[0][1] - fields[0][0] <= 2 && fields[1][1] - fields[1][0] <= 2 && fields[2][1] - fields[2][0] == 4) {
+		*outMonth = values[0];
+		*outDay = values[1];
+		*outYear = values[2];
+	}
+	else if (separator == '-' && fields[0][1] - fields[0][0] == 4 && fields[1][1] - fields[1][0] == 2 && fields[2][1] - fields[2][0] == 2) {
+		*outYear = values[0];
+		*outMonth = values[1];
+		*outDay = values[2];
+	}
+	else {
+		return position;
+	}
+	if (*outMonth < 1 || *outMonth > 12 || *outDay < 1 || *outDay > 31) {
+		return position;
+	}
+	return end;
+}
+
+// Reads the number, amount of money, percentage, ordinal or date starting at position, returning where it ends.
+static long ExpandNumber(Normalizer * normalizer, long position)
+{
+	const UniChar * text = normalizer->text;
+	long length = normalizer->length;
+	Boolean isLiteral = (normalizer->modes & kSynthTextLiteralNumbers) != 0;
+	const Currency * currency = CurrencyForSign(text[position]);
+	long start = position;
+	long integerStart, integerEnd, fractionStart = 0, fractionEnd = 0;
+	uint32_t kind = kSynthTextNumberToken;
+	uint32_t month, day, year;
+	uint64_t value = 0;
+	Boolean isWhole;
+
+	if (currency) {
+		position++;
+	}
+	else if (! isLiteral) {
+		long end = ParseDate(text, position, length, &month, &day, &year);
+		if (end > position) {
+			BeginToken(normalizer, start);
+			AppendWord(normalizer, sMonths[month - 1]);
+			AppendCardinal(normalizer, day);
+			MakeLastWordOrdinal(normalizer);
+			AppendASCII(normalizer, ",");
+			AppendYear(normalizer, year);
+			EndToken(normalizer, kSynthTextDateToken, start, end);
+			return end;
+		}
+	}
+
+	// The whole part, with commas between groups of three digits, then any fraction.
+	integerStart = position;
+	position = ScanDigits(text, position, length);
+	if (position - integerStart <= 3) {
+		while (position + 3 < length && text[position] == ',' && IsDigit(text[position + 1]) && IsDigit(text[position + 2]) && IsDigit(text[position + 3])
+				&& (position + 4 >= length || ! IsDigit(text[position + 4]))) {
+			position += 4;
+		}
+	}
+	integerEnd = position;
+	if (position + 1 < length && text[position] == '.' && IsDigit(text[position + 1])) {
+		fractionStart = position + 1;
+		position = fractionEnd = ScanDigits(text, fractionStart, length);
+	}
+
+	if (currency) {
+		kind = kSynthTextCurrencyToken;
+	}
+	else if (position < length && text[position] == '%') {
+		kind = kSynthTextPercentToken;
+	}
+	else if (! isLiteral && fractionStart == 0 && position + 1 < length && (position + 2 >= length || ! IsLetter(text[position + 2]))) {
+		UniChar first = text[position] | 0x20;
+		UniChar second = text[position + 1] | 0x20;
+		if ((first == 's' && second == 't') || (first == 'n' && second == 'd') || (first == 'r' && second == 'd') || (first == 't' && second == 'h')) {
+			kind = kSynthTextOrdinalToken;
+		}
+	}
+
+	BeginToken(normalizer, start);
+	if (kind == kSynthTextCurrencyToken && fractionEnd - fractionStart == 2) {
+		// Whole units and hundredths: "three dollars and fifty cents".
+		uint32_t hundredths = (text[fractionStart] - '0') * 10 + (text[fractionStart + 1] - '0');
+		Boolean hasUnits = ! (hundredths > 0 && integerEnd - integerStart == 1 && text[integerStart] == '0');
+		if (hasUnits) {
+			isWhole = AppendInteger(normalizer, integerStart, integerEnd, &value);
+			AppendWord(normalizer, (isWhole && value == 1) ? currency->unit : currency->units);
+		}
+		if (hundredths > 0) {
+			if (hasUnits) {
+				AppendWord(normalizer, "and");
+			}
+			if (isLiteral) {
+				AppendDigits(normalizer, fractionStart, fractionEnd);
+			}
+			else {
+				AppendCardinal(normalizer, hundredths);
+			}
+			AppendWord(normalizer, (hundredths == 1) ? currency->hundredth : currency->hundredths);
+		}
+	}
+	else {
+		isWhole = AppendInteger(normalizer, integerStart, integerEnd, &value);
+		if (fractionStart) {
+			AppendWord(normalizer, "point");
+			AppendDigits(normalizer, fractionStart, fractionEnd);
+		}
+		if (kind == kSynthTextCurrencyToken) {
+			AppendWord(normalizer, (isWhole && value == 1 && fractionStart == 0) ? currency->unit : currency->units);
+		}
+		else if (kind == kSynthTextPercentToken) {
+			AppendWord(normalizer, "percent");
+			position++;
+		}
+		else if (kind == kSynthTextOrdinalToken) {
+			if (isWhole) {
+				MakeLastWordOrdinal(normalizer);
+			}
+			position += 2;
+		}
+	}
+	EndToken(normalizer, kind, start, position);
+	return position;
+}
+
+// Expands the abbreviation, if there is one, that the period at position ends.  The abbreviation itself has just
+// been copied, so it's taken back out of the normalized text.
+static Boolean ExpandAbbreviation(Normalizer * normalizer, long position, long * outEnd)
+{
+	SynthNormalizedText * out = normalizer->out;
+	const UniChar * text = normalizer->text;
+	SynthTextToken * last;
+	long wordStart = position;
+	long wordLength, next;
+	uint32_t index, characterIndex;
+
+	while (wordStart > 0 && IsLetter(text[wordStart - 1])) {
+		wordStart--;
+	}
+	wordLength = position - wordStart;
+	if (wordLength == 0 || wordLength > kMaxAbbreviationLength || (wordStart > 0 && (IsDigit(text[wordStart - 1]) || text[wordStart - 1] == '.'))) {
+		return false;
+	}
+	if (out->tokenCount == 0) {
+		return false;
+	}
+	last = &out->tokens[out->tokenCount - 1];
+	if (last->kind != kSynthTextCopiedToken || last->sourceOffset > (uint32_t)wordStart || last->sourceOffset + last->sourceLength != (uint32_t)position
+			|| last->offset + last->length != (uint32_t)out->length) {
+		return false;
+	}
+
+	for (index = 0; index < sizeof(sAbbreviations) / sizeof(sAbbreviations[0]); index++) {
+		const char * abbreviation = sAbbreviations[index].abbreviation;
+		for (characterIndex = 0; characterIndex < wordLength && abbreviation[characterIndex] == text[wordStart + characterIndex]; characterIndex++) {
+		}
+		if (characterIndex == wordLength && abbreviation[characterIndex] == 0) {
+			break;
+		}
+	}
+	if (index == sizeof(sAbbreviations) / sizeof(sAbbreviations[0])) {
+		return false;
+	}
+
+	// Take the copied word back, and the token with it if that was all there was to it.
+	out->length -= wordLength;
+	last->length -= (uint32_t)wordLength;
+	last->sourceLength -= (uint32_t)wordLength;
+	if (last->length == 0) {
+		out->tokenCount--;
+	}
+	normalizer->separateNext = false;
+
+	BeginToken(normalizer, wordStart);
+	AppendASCII(normalizer, sAbbreviations[index].expansion);
+	EndToken(normalizer, kSynthTextAbbreviationToken, wordStart, position + 1);
+
+	// One that can end a sentence keeps its period when what follows looks like the next sentence, or nothing does.
+	if (sAbbreviations[index].canEndSentence) {
+		for (next = position + 1; next < normalizer->length && SynthBoundaryIsWhiteSpace(text[next]); next++) {
+		}
+		if (next == normalizer->length || (next > position + 1 && text[next] >= 'A' && text[next] <= 'Z')) {
+			AppendCopied(normalizer, position, position + 1);
+		}
+	}
+	*outEnd = position + 1;
+	return true;
+}
+
+// Spells out the character at position for literal character mode, returning where the next one starts.
+static long SpellCharacter(Normalizer * normalizer, long position)
+{
+	UniChar c = normalizer->text[position];
+
+	BeginToken(normalizer, position);
+	if (IsDigit(c)) {
+		AppendWord(normalizer, sOnes[c - '0']);
+	}
+	else if (c >= '!' && c <= '~' && sPunctuationNames[c - '!']) {
+		AppendWord(normalizer, sPunctuationNames[c - '!']);
+	}
+	else if (Reserve(normalizer, 1) == noErr) {
+		normalizer->out->characters[normalizer->out->length++] = c;
+	}
+	EndToken(normalizer, kSynthTextSpelledToken, position, position + 1);
+	return position + 1;
+}
@@ -0,0 +1,109 @@
+/*
+	SynthTextNormalizer.h
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: The front end every utterance and phoneme dump goes through: it collapses
+	white space and says numbers, dates, money, percentages and abbreviations as words, or
+	spells them out when the channel's number and character modes are literal.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#ifndef __SYNTHTEXTNORMALIZER__
+#define __SYNTHTEXTNORMALIZER__
+
+#include "SynthEngineBase.h"
+#include "SynthArena.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// How the channel's kSpeechNumberModeProperty and kSpeechCharacterModeProperty say text is to be read.  Zero is
+// kSpeechModeNormal for both.
+enum {
+	kSynthTextLiteralNumbers			= 1 << 0,		// Numbers are read digit by digit.
+	kSynthTextLiteralCharacters			= 1 << 1		// Everything is spelled out, punctuation included.
+};
+
+typedef enum SynthTextTokenKind {
+	kSynthTextCopiedToken				= 1,		// Passed through as it was, one character for one.
+	kSynthTextNumberToken				= 2,
+	kSynthTextOrdinalToken				= 3,		// "21st"
+	kSynthTextCurrencyToken				= 4,		// "$3.50"
+	kSynthTextPercentToken				= 5,
+	kSynthTextDateToken					= 6,		// "7/4/1976" or "1976-07-04"
+	kSynthTextAbbreviationToken			= 7,
+	kSynthTextSymbolToken				= 8,		// "&", "+", "@" and the like said as words.
+	kSynthTextSpelledToken				= 9			// A character spelled out in literal character mode.
+} SynthTextTokenKind;
+
+// A run of the text as the client passed it and what it became.  Tokens are in order, and cover the normalized text
+// except for the single spaces that stand in for runs of white space between them.
+typedef struct SynthTextToken {
+	uint32_t	kind;
+	uint32_t	sourceOffset;		// In the text as the client passed it.
+	uint32_t	sourceLength;
+	uint32_t	offset;				// In the normalized text.
+	uint32_t	length;
+} SynthTextToken;
+
+typedef struct SynthNormalizedText {
+	UniChar *			characters;
+	long				length;
+	uint32_t *			originalOffsets;	// length + 1 entries: the offset in the text as the client passed it of each
+											// character, never decreasing, then the offset just past the last one used.
+	SynthTextToken *	tokens;
+	uint32_t			tokenCount;
+	SynthArena *		arena;				// Where the arrays came from, or NULL if from malloc.
+	long				capacity;
+	uint32_t			tokenCapacity;
+} SynthNormalizedText;
+
+// Normalizes text for analysis as modes say.  Runs of white space become a single space and leading and trailing
+// white space is dropped.  The arrays of outText come from arena, if it isn't NULL, and are good until it's rewound
+// past this call; otherwise SynthNormalizedTextDispose frees them.
+long		SynthTextNormalize(const UniChar * text, long length, uint32_t modes, SynthArena * arena, SynthNormalizedText * outText);
+void		SynthNormalizedTextDispose(SynthNormalizedText * normalizedText);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
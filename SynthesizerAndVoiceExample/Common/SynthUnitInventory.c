@@ -0,0 +1,677 @@
+/*
+	SynthUnitInventory.c
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Unit inventory files, unit selection and concatenation.  See SynthUnitInventory.h.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "SynthUnitInventory.h"
+
+#define kInventoryMagic			0x53554E49		// 'SUNI'
+#define kInventoryVersion		1
+#define kArrayAlignment			64				// Each array starts on its own cache line.
+#define kMaxCandidates			64				// Units compared for one phoneme, at most.
+
+// The file is this header followed by the index arrays and the samples, all in native byte order.
+// The units are sorted by phoneme, then left and right context, so the units for a phoneme are the
+// range phonemeFirst[phoneme] up to phonemeFirst[phoneme + 1], and that range is sorted by context key.
+typedef struct InventoryHeader {
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	sampleRate;
+	uint32_t	unitCount;
+	uint32_t	crossfadeSamples;
+	uint32_t	pauseSamples;
+	uint64_t	sampleCount;
+	uint64_t	phonemeFirstOffset;		// uint32_t [kSynthUnitPhonemeCount + 1]
+	uint64_t	contextKeysOffset;		// uint16_t [unitCount], left context << 8 | right context
+	uint64_t	startPitchesOffset;		// uint16_t [unitCount]
+	uint64_t	endPitchesOffset;		// uint16_t [unitCount]
+	uint64_t	sampleOffsetsOffset;	// uint32_t [unitCount]
+	uint64_t	sampleLengthsOffset;	// uint32_t [unitCount]
+	uint64_t	samplesOffset;			// int16_t [sampleCount]
+} InventoryHeader;
+
+struct SynthUnitInventory {
+	SynthUnitInventory *	next;
+	unsigned int			referenceCount;
+	char *					path;
+	void *					mapping;
+	size_t					mappingSize;
+	const InventoryHeader *	header;
+	const uint32_t *		phonemeFirst;
+	const uint16_t *		contextKeys;
+	const uint16_t *		startPitches;
+	const uint16_t *		endPitches;
+	const uint32_t *		sampleOffsets;
+	const uint32_t *		sampleLengths;
+	const int16_t *			samples;
+	float *					crossfadeRamp;
+};
+
+static pthread_mutex_t			sInventoriesLock = PTHREAD_MUTEX_INITIALIZER;
+static SynthUnitInventory *		sInventories = NULL;
+
+static int			CompareUnits(const void * a, const void * b);
+static uint64_t		AlignOffset(uint64_t offset);
+static long			WriteBytes(FILE * file, const void * bytes, size_t byteCount);
+static long			PadTo(FILE * file, uint64_t offset);
+static long			MapInventory(const char * path, SynthUnitInventory * inventory);
+static uint32_t		LowerBound(const uint16_t * keys, uint32_t first, uint32_t last, uint16_t key);
+static void			Crossfade(int16_t * restrict output, const int16_t * restrict incoming, const float * restrict ramp, uint32_t count);
+static void			PutBigEndian16(uint8_t * bytes, uint16_t value);
+static void			PutBigEndian32(uint8_t * bytes, uint32_t value);
+static void			PutExtended80(uint8_t * bytes, uint32_t value);
+
+long SynthUnitInventoryWrite(const char * path, uint32_t sampleRate, uint32_t crossfadeSamples, uint32_t pauseSamples, const SynthUnitDescription * units, uint32_t unitCount, const int16_t * samples, uint64_t sampleCount)
+{
+	SynthUnitDescription * sortedUnits;
+	uint32_t phonemeFirst[kSynthUnitPhonemeCount + 1];
+	InventoryHeader header;
+	uint32_t unitIndex;
+	long error = noErr;
+	FILE * file;
+
+	if (path == NULL || sampleRate == 0 || (unitCount > 0 && (units == NULL || samples == NULL))) {
+		return paramErr;
+	}
+	for (unitIndex = 0; unitIndex < unitCount; unitIndex++) {
+		if ((uint64_t)units[unitIndex].sampleOffset + units[unitIndex].sampleLength > sampleCount) {
+			return paramErr;
+		}
+	}
+
+	sortedUnits = (SynthUnitDescription *)malloc((unitCount ? unitCount : 1) * sizeof(SynthUnitDescription));
+	if (sortedUnits == NULL) {
+		return memFullErr;
+	}
+	if (unitCount > 0) {
+		memcpy(sortedUnits, units, unitCount * sizeof(SynthUnitDescription));
+		qsort(sortedUnits, unitCount, sizeof(SynthUnitDescription), CompareUnits);
+	}
+
+	memset(phonemeFirst, 0, sizeof(phonemeFirst));
+	for (unitIndex = 0; unitIndex < unitCount; unitIndex++) {
+		phonemeFirst[sortedUnits[unitIndex].phoneme + 1]++;
+	}
+	for (unitIndex = 1; unitIndex <= kSynthUnitPhonemeCount; unitIndex++) {
+		phonemeFirst[unitIndex] += phonemeFirst[unitIndex - 1];
+	}
+
+	memset(&header, 0, sizeof(header));
+	header.magic = kInventoryMagic;
+	header.version = kInventoryVersion;
+	header.sampleRate = sampleRate;
+	header.unitCount = unitCount;
+	header.crossfadeSamples = crossfadeSamples;
+	header.pauseSamples = pauseSamples;
+	header.sampleCount = sampleCount;
+	header.phonemeFirstOffset = AlignOffset(sizeof(InventoryHeader));
+	header.contextKeysOffset = AlignOffset(header.phonemeFirstOffset + sizeof(phonemeFirst));
+	header.startPitchesOffset = AlignOffset(header.contextKeysOffset + unitCount * sizeof(uint16_t));
+	header.endPitchesOffset = AlignOffset(header.startPitchesOffset + unitCount * sizeof(uint16_t));
+	header.sampleOffsetsOffset = AlignOffset(header.endPitchesOffset + unitCount * sizeof(uint16_t));
+	header.sampleLengthsOffset = AlignOffset(header.sampleOffsetsOffset + unitCount * sizeof(uint32_t));
+	header.samplesOffset = AlignOffset(header.sampleLengthsOffset + unitCount * sizeof(uint32_t));
+
+	file = fopen(path, "wb");
+	if (file == NULL) {
+		free(sortedUnits);
+		return ioErr;
+	}
+
+	// Write each array in turn, padded out to its offset.
+	error = WriteBytes(file, &header, sizeof(header));
+	if (error == noErr && (error = PadTo(file, header.phonemeFirstOffset)) == noErr) {
+		error = WriteBytes(file, phonemeFirst, sizeof(phonemeFirst));
+	}
+	if (error == noErr) {
+		error = PadTo(file, header.contextKeysOffset);
+	}
+	for (unitIndex = 0; unitIndex < unitCount && error == noErr; unitIndex++) {
+		uint16_t key = (uint16_t)(sortedUnits[unitIndex].leftContext << 8 | sortedUnits[unitIndex].rightContext);
+		error = WriteBytes(file, &key, sizeof(key));
+	}
+	if (error == noErr) {
+		error = PadTo(file, header.startPitchesOffset);
+	}
+	for (unitIndex = 0; unitIndex < unitCount && error == noErr; unitIndex++) {
+		error = WriteBytes(file, &sortedUnits[unitIndex].startPitch, sizeof(uint16_t));
+	}
+	if (error == noErr) {
+		error = PadTo(file, header.endPitchesOffset);
+	}
+	for (unitIndex = 0; unitIndex < unitCount && error == noErr; unitIndex++) {
+		error = WriteBytes(file, &sortedUnits[unitIndex].endPitch, sizeof(uint16_t));
+	}
+	if (error == noErr) {
+		error = PadTo(file, header.sampleOffsetsOffset);
+	}
+	for (unitIndex = 0; unitIndex < unitCount && error == noErr; unitIndex++) {
+		error = WriteBytes(file, &sortedUnits[unitIndex].sampleOffset, sizeof(uint32_t));
+	}
+	if (error == noErr) {
+		error = PadTo(file, header.sampleLengthsOffset);
+	}
+	for (unitIndex = 0; unitIndex < unitCount && error == noErr; unitIndex++) {
+		error = WriteBytes(file, &sortedUnits[unitIndex].sampleLength, sizeof(uint32_t));
+	}
+	if (error == noErr && (error = PadTo(file, header.samplesOffset)) == noErr) {
+		error = WriteBytes(file, samples, (size_t)sampleCount * sizeof(int16_t));
+	}
+
+	if (fclose(file) != 0 && error == noErr) {
+		error = ioErr;
+	}
+	if (error != noErr) {
+		unlink(path);
+	}
+	free(sortedUnits);
+	return error;
+}
+
+long SynthUnitInventoryOpen(const char * path, SynthUnitInventory ** outInventory)
+{
+	SynthUnitInventory * inventory;
+	long error = noErr;
+
+	if (path == NULL || outInventory == NULL) {
+		return paramErr;
+	}
+	*outInventory = NULL;
+
+	// Every channel speaking with the voice shares one mapping.
+	pthread_mutex_lock(&sInventoriesLock);
+	for (inventory = sInventories; inventory; inventory = inventory->next) {
+		if (strcmp(inventory->path, path) == 0) {
+			inventory->referenceCount++;
+			break;
+		}
+	}
+	if (inventory == NULL) {
+		inventory = (SynthUnitInventory *)calloc(1, sizeof(SynthUnitInventory));
+		if (inventory == NULL) {
+			error = memFullErr;
+		}
+		else {
+			error = MapInventory(path, inventory);
+			if (error == noErr) {
+				inventory->referenceCount = 1;
+				inventory->next = sInventories;
+				sInventories = inventory;
+			}
+			else {
+				free(inventory);
+				inventory = NULL;
+			}
+		}
+	}
+	pthread_mutex_unlock(&sInventoriesLock);
+
+	*outInventory = inventory;
+	return error;
+}
+
+SynthUnitInventory * SynthUnitInventoryRetain(SynthUnitInventory * inventory)
+{
+	if (inventory) {
+		pthread_mutex_lock(&sInventoriesLock);
+		inventory->referenceCount++;
+		pthread_mutex_unlock(&sInventoriesLock);
+	}
+	return inventory;
+}
+
+void SynthUnitInventoryRelease(SynthUnitInventory * inventory)
+{
+	Boolean isLast = false;
+
+	if (inventory == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&sInventoriesLock);
+	if (--inventory->referenceCount == 0) {
+		SynthUnitInventory ** link = &sInventories;
+		while (*link != inventory) {
+			link = &(*link)->next;
+		}
+		*link = inventory->next;
+		isLast = true;
+	}
+	pthread_mutex_unlock(&sInventoriesLock);
+
+	if (isLast) {
+		munmap(inventory->mapping, inventory->mappingSize);
+		free(inventory->crossfadeRamp);
+		free(inventory->path);
+		free(inventory);
+	}
+}
+
+uint32_t SynthUnitInventorySampleRate(const SynthUnitInventory * inventory)
+{
+	return inventory->header->sampleRate;
+}
+
+void SynthUnitInventoryPrefetch(const SynthUnitInventory * inventory)
+{
+	const volatile uint8_t * bytes = (const volatile uint8_t *)inventory->mapping;
+	long pageSize = sysconf(_SC_PAGESIZE);
+	size_t offset;
+
+	// Ask for the whole file, then touch every page so the reads happen here rather than in the first render.
+	madvise(inventory->mapping, inventory->mappingSize, MADV_WILLNEED);
+	if (pageSize <= 0) {
+		pageSize = 4096;
+	}
+	for (offset = 0; offset < inventory->mappingSize; offset += (size_t)pageSize) {
+		(void)bytes[offset];
+	}
+}
+
+long SynthUnitInventorySelect(const SynthUnitInventory * inventory, const uint8_t * phonemes, uint32_t phonemeCount, int32_t * unitIndexes)
+{
+	int32_t previousUnit = -1;
+	uint32_t phonemeIndex;
+
+	if (inventory == NULL || (phonemeCount > 0 && (phonemes == NULL || unitIndexes == NULL))) {
+		return paramErr;
+	}
+
+	for (phonemeIndex = 0; phonemeIndex < phonemeCount; phonemeIndex++) {
+		uint8_t phoneme = phonemes[phonemeIndex];
+		uint8_t left = (phonemeIndex > 0) ? phonemes[phonemeIndex - 1] : kSynthUnitSilencePhoneme;
+		uint8_t right = (phonemeIndex + 1 < phonemeCount) ? phonemes[phonemeIndex + 1] : kSynthUnitSilencePhoneme;
+		uint32_t first = inventory->phonemeFirst[phoneme];
+		uint32_t last = inventory->phonemeFirst[phoneme + 1];
+		int32_t bestUnit = -1;
+
+		if (first < last) {
+		
+			// Narrow the candidates to the units recorded between the same neighbors, else after the same left
+			// neighbor, else take any unit of the phoneme.
+			uint16_t key = (uint16_t)(left << 8 | right);
+			uint32_t leftFirst = LowerBound(inventory->contextKeys, first, last, (uint16_t)(left << 8));
+			uint32_t leftLast = (left == 0xFF) ? last : LowerBound(inventory->contextKeys, leftFirst, last, (uint16_t)((left + 1) << 8));
+			uint32_t exactFirst = LowerBound(inventory->contextKeys, leftFirst, leftLast, key);
+			uint32_t exactLast = (right == 0xFF) ? leftLast : LowerBound(inventory->contextKeys, exactFirst, leftLast, (uint16_t)(key + 1));
+			uint32_t candidate;
+			int bestCost = INT32_MAX;
+
+			if (exactFirst < exactLast) {
+				first = exactFirst;
+				last = exactLast;
+			}
+			else if (leftFirst < leftLast) {
+				first = leftFirst;
+				last = leftLast;
+			}
+			if (last - first > kMaxCandidates) {
+				last = first + kMaxCandidates;
+			}
+
+			// The join cost is only the pitch jump from the previous unit, so one pass over one array picks the unit.
+			bestUnit = (int32_t)first;
+			if (previousUnit >= 0) {
+				int previousPitch = inventory->endPitches[previousUnit];
+				for (candidate = first; candidate < last; candidate++) {
+					int cost = abs((int)inventory->startPitches[candidate] - previousPitch);
+					if (cost < bestCost) {
+						bestCost = cost;
+						bestUnit = (int32_t)candidate;
+					}
+				}
+			}
+		}
+
+		unitIndexes[phonemeIndex] = bestUnit;
+		previousUnit = bestUnit;
+	}
+
+	return noErr;
+}
+
+long SynthUnitInventoryRender(const SynthUnitInventory * inventory, const uint8_t * phonemes, uint32_t phonemeCount, SynthArena * arena, SynthUnitRendering * rendering)
+{
+	const InventoryHeader * header;
+	int32_t * unitIndexes;
+	uint64_t maximumSamples = 0;
+	uint64_t cursor = 0;
+	uint32_t previousLength = 0;
+	uint32_t phonemeIndex;
+	long error;
+
+	if (inventory == NULL || rendering == NULL) {
+		return paramErr;
+	}
+	header = inventory->header;
+	memset(rendering, 0, sizeof(SynthUnitRendering));
+	rendering->arena = arena;
+
+	unitIndexes = (int32_t *)SynthScratchAlloc(arena, (phonemeCount ? phonemeCount : 1) * sizeof(int32_t));
+	if (unitIndexes == NULL) {
+		return memFullErr;
+	}
+	error = SynthUnitInventorySelect(inventory, phonemes, phonemeCount, unitIndexes);
+	if (error != noErr) {
+		SynthScratchFree(arena, unitIndexes);
+		return error;
+	}
+
+	for (phonemeIndex = 0; phonemeIndex < phonemeCount; phonemeIndex++) {
+		maximumSamples += (unitIndexes[phonemeIndex] >= 0) ? inventory->sampleLengths[unitIndexes[phonemeIndex]] : header->pauseSamples;
+	}
+	rendering->samples = (int16_t *)SynthScratchCalloc(arena, (size_t)(maximumSamples ? maximumSamples : 1), sizeof(int16_t));
+	rendering->phonemeStarts = (uint64_t *)SynthScratchAlloc(arena, (phonemeCount + 1) * sizeof(uint64_t));
+	if (rendering->samples == NULL || rendering->phonemeStarts == NULL) {
+		SynthScratchFree(arena, unitIndexes);
+		SynthUnitRenderingDispose(rendering);
+		return memFullErr;
+	}
+
+	for (phonemeIndex = 0; phonemeIndex < phonemeCount; phonemeIndex++) {
+		int32_t unit = unitIndexes[phonemeIndex];
+		if (unit < 0) {
+			// No unit for it, so leave a pause; the samples are already zero.
+			rendering->phonemeStarts[phonemeIndex] = cursor;
+			cursor += header->pauseSamples;
+			previousLength = 0;
+		}
+		else {
+			const int16_t * unitSamples = inventory->samples + inventory->sampleOffsets[unit];
+			uint32_t length = inventory->sampleLengths[unit];
+			uint32_t overlap = header->crossfadeSamples;
+			uint64_t start;
+
+			// Units only overlap where both are long enough to fade over the whole overlap.
+			if (overlap > length || overlap > previousLength) {
+				overlap = 0;
+			}
+			start = cursor - overlap;
+			Crossfade(rendering->samples + start, unitSamples, inventory->crossfadeRamp, overlap);
+			memcpy(rendering->samples + start + overlap, unitSamples + overlap, (length - overlap) * sizeof(int16_t));
+
+			rendering->phonemeStarts[phonemeIndex] = start;
+			cursor = start + length;
+			previousLength = length;
+		}
+	}
+	rendering->phonemeStarts[phonemeCount] = cursor;
+	rendering->phonemeCount = phonemeCount;
+	rendering->sampleCount = cursor;
+	rendering->sampleRate = header->sampleRate;
+
+	SynthScratchFree(arena, unitIndexes);
+	return noErr;
+}
+
+void SynthUnitRenderingDispose(SynthUnitRendering * rendering)
+{
+	if (rendering) {
+		SynthScratchFree(rendering->arena, rendering->samples);
+		SynthScratchFree(rendering->arena, rendering->phonemeStarts);
+		memset(rendering, 0, sizeof(SynthUnitRendering));
+	}
+}
+
+long SynthUnitRenderingCopyAIFF(const SynthUnitRendering * rendering, SynthArena * arena, void ** outBytes, size_t * outByteCount)
+{
+	size_t dataBytes = (size_t)rendering->sampleCount * sizeof(int16_t);
+	size_t byteCount = 12 + 8 + 18 + 16 + dataBytes;
+	uint8_t * bytes;
+	uint64_t sampleIndex;
+
+	if (outBytes == NULL || outByteCount == NULL || rendering->sampleCount > UINT32_MAX / sizeof(int16_t)) {
+		return paramErr;
+	}
+
+	bytes = (uint8_t *)SynthScratchAlloc(arena, byteCount);
+	if (bytes == NULL) {
+		return memFullErr;
+	}
+
+	// A FORM with a common chunk for 16-bit mono, then the sound data chunk.
+	memcpy(bytes, "FORM", 4);
+	PutBigEndian32(bytes + 4, (uint32_t)(byteCount - 8));
+	memcpy(bytes + 8, "AIFF", 4);
+	memcpy(bytes + 12, "COMM", 4);
+	PutBigEndian32(bytes + 16, 18);
+	PutBigEndian16(bytes + 20, 1);
+	PutBigEndian32(bytes + 22, (uint32_t)rendering->sampleCount);
+	PutBigEndian16(bytes + 26, 16);
+	PutExtended80(bytes + 28, rendering->sampleRate);
+	memcpy(bytes + 38, "SSND", 4);
+	PutBigEndian32(bytes + 42, (uint32_t)(8 + dataBytes));
+	PutBigEndian32(bytes + 46, 0);
+	PutBigEndian32(bytes + 50, 0);
+	for (sampleIndex = 0; sampleIndex < rendering->sampleCount; sampleIndex++) {
+		PutBigEndian16(bytes + 54 + 2 * sampleIndex, (uint16_t)rendering->samples[sampleIndex]);
+	}
+
+	*outBytes = bytes;
+	*outByteCount = byteCount;
+	return noErr;
+}
+
+static int CompareUnits(const void * a, const void * b)
+{
+	const SynthUnitDescription * unitA = (const SynthUnitDescription *)a;
+	const SynthUnitDescription * unitB = (const SynthUnitDescription *)b;
+	uint32_t keyA = (uint32_t)unitA->phoneme << 16 | (uint32_t)unitA->leftContext << 8 | unitA->rightContext;
+	uint32_t keyB = (uint32_t)unitB->phoneme << 16 | (uint32_t)unitB->leftContext << 8 | unitB->rightContext;
+
+	// Keep units with the same key in the order they were given.
+	if (keyA != keyB) {
+		return (keyA < keyB) ? -1 : 1;
+	}
+	return (unitA < unitB) ? -1 : (unitA > unitB) ? 1 : 0;
+}
+
+static uint64_t AlignOffset(uint64_t offset)
+{
+	return (offset + kArrayAlignment - 1) & ~(uint64_t)(kArrayAlignment - 1);
+}
+
+static long WriteBytes(FILE * file, const void * bytes, size_t byteCount)
+{
+	return (byteCount == 0 || fwrite(bytes, 1, byteCount, file) == byteCount) ? noErr : ioErr;
+}
+
+static long PadTo(FILE * file, uint64_t offset)
+{
+	long position = ftell(file);
+
+	if (position < 0) {
+		return ioErr;
+	}
+	for (; (uint64_t)position < offset; position++) {
+		if (fputc(0, file) == EOF) {
+			return ioErr;
+		}
+	}
+	return noErr;
+}
+
+static long MapInventory(const char * path, SynthUnitInventory * inventory)
+{
+	const InventoryHeader * header;
+	struct stat fileInfo;
+	const uint8_t * base;
+	uint32_t unitIndex;
+	int file;
+
+	file = open(path, O_RDONLY);
+	if (file < 0) {
+		return fnfErr;
+	}
+	if (fstat(file, &fileInfo) != 0 || fileInfo.st_size < (off_t)sizeof(InventoryHeader)) {
+		close(file);
+		return badDictFormat;
+	}
+	inventory->mappingSize = (size_t)fileInfo.st_size;
+	inventory->mapping = mmap(NULL, inventory->mappingSize, PROT_READ, MAP_SHARED, file, 0);
+	close(file);
+	if (inventory->mapping == MAP_FAILED) {
+		return memFullErr;
+	}
+
+	// Check that every array is inside the file before trusting any of them.
+	base = (const uint8_t *)inventory->mapping;
+	header = (const InventoryHeader *)base;
+	if (header->magic != kInventoryMagic || header->version != kInventoryVersion || header->sampleRate == 0
+		|| header->phonemeFirstOffset + (kSynthUnitPhonemeCount + 1) * sizeof(uint32_t) > inventory->mappingSize
+		|| header->contextKeysOffset + header->unitCount * sizeof(uint16_t) > inventory->mappingSize
+		|| header->startPitchesOffset + header->unitCount * sizeof(uint16_t) > inventory->mappingSize
+		|| header->endPitchesOffset + header->unitCount * sizeof(uint16_t) > inventory->mappingSize
+		|| header->sampleOffsetsOffset + header->unitCount * sizeof(uint32_t) > inventory->mappingSize
+		|| header->sampleLengthsOffset + header->unitCount * sizeof(uint32_t) > inventory->mappingSize
+		|| header->samplesOffset + header->sampleCount * sizeof(int16_t) > inventory->mappingSize) {
+		munmap(inventory->mapping, inventory->mappingSize);
+		return badDictFormat;
+	}
+	inventory->header = header;
+	inventory->phonemeFirst = (const uint32_t *)(base + header->phonemeFirstOffset);
+	inventory->contextKeys = (const uint16_t *)(base + header->contextKeysOffset);
+	inventory->startPitches = (const uint16_t *)(base + header->startPitchesOffset);
+	inventory->endPitches = (const uint16_t *)(base + header->endPitchesOffset);
+	inventory->sampleOffsets = (const uint32_t *)(base + header->sampleOffsetsOffset);
+	inventory->sampleLengths = (const uint32_t *)(base + header->sampleLengthsOffset);
+	inventory->samples = (const int16_t *)(base + header->samplesOffset);
+
+	for (unitIndex = 0; unitIndex < kSynthUnitPhonemeCount; unitIndex++) {
+		if (inventory->phonemeFirst[unitIndex] > inventory->phonemeFirst[unitIndex + 1]) {
+			break;
+		}
+	}
+	if (unitIndex < kSynthUnitPhonemeCount || inventory->phonemeFirst[kSynthUnitPhonemeCount] != header->unitCount) {
+		munmap(inventory->mapping, inventory->mappingSize);
+		return badDictFormat;
+	}
+	for (unitIndex = 0; unitIndex < header->unitCount; unitIndex++) {
+		if ((uint64_t)inventory->sampleOffsets[unitIndex] + inventory->sampleLengths[unitIndex] > header->sampleCount) {
+			break;
+		}
+	}
+	if (unitIndex < header->unitCount) {
+		munmap(inventory->mapping, inventory->mappingSize);
+		return badDictFormat;
+	}
+
+	// The crossfade weights are the same at every join, so work them out once.
+	inventory->crossfadeRamp = (float *)malloc((header->crossfadeSamples ? header->crossfadeSamples : 1) * sizeof(float));
+	inventory->path = strdup(path);
+	if (inventory->crossfadeRamp == NULL || inventory->path == NULL) {
+		free(inventory->crossfadeRamp);
+		free(inventory->path);
+		munmap(inventory->mapping, inventory->mappingSize);
+		return memFullErr;
+	}
+	for (unitIndex = 0; unitIndex < header->crossfadeSamples; unitIndex++) {
+		inventory->crossfadeRamp[unitIndex] = (float)(unitIndex + 1) / (float)(header->crossfadeSamples + 1);
+	}
+
+	return noErr;
+}
+
+static uint32_t LowerBound(const uint16_t * keys, uint32_t first, uint32_t last, uint16_t key)
+{
+	while (first < last) {
+		uint32_t middle = first + (last - first) / 2;
+		if (keys[middle] < key) {
+			first = middle + 1;
+		}
+		else {
+			last = middle;
+		}
+	}
+	return first;
+}
+
+static void Crossfade(int16_t * restrict output, const int16_t * restrict incoming, const float * restrict ramp, uint32_t count)
+{
+	uint32_t sampleIndex;
+
+	// A straight loop over contiguous arrays with no branches, which the compiler turns into vector code.
+	for (sampleIndex = 0; sampleIndex < count; sampleIndex++) {
+		float outgoing = (float)output[sampleIndex];
+		output[sampleIndex] = (int16_t)(outgoing + ((float)incoming[sampleIndex] - outgoing) * ramp[sampleIndex]);
+	}
+}
+
+static void PutBigEndian16(uint8_t * bytes, uint16_t value)
+{
+	bytes[0] = (uint8_t)(value >> 8);
+	bytes[1] = (uint8_t)value;
+}
+
+static void PutBigEndian32(uint8_t * bytes, uint32_t value)
+{
+	bytes[0] = (uint8_t)(value >> 24);
+	bytes[1] = (uint8_t)(value >> 16);
+	bytes[2] = (uint8_t)(value >> 8);
+	bytes[3] = (uint8_t)value;
+}
+
+static void PutExtended80(uint8_t * bytes, uint32_t value)
+{
+	// The sample rate of an AIFF file is an 80-bit IEEE extended number; whole numbers are all that's needed.
+	int exponent = 31;
+
+	memset(bytes, 0, 10);
+	if (value == 0) {
+		return;
+	}
+	while ((value & 0x80000000) == 0) {
+		value <<= 1;
+		exponent--;
+	}
+	PutBigEndian16(bytes, (uint16_t)(16383 + exponent));
+	PutBigEndian32(bytes + 2, value);
+}
@@ -0,0 +1,121 @@
+/*
+	SynthUnitInventory.h
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: The unit inventory of a concatenative voice and the back end that speaks with it.
+	A voice bundle carries its inventory as the UnitInventory.units resource: recorded
+	units of speech, one phoneme each in the context of its neighbors, and an index
+	stored as flat, cache-aligned arrays so units can be selected without chasing
+	pointers.  The file is mapped and shared by every channel using the voice.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#ifndef __SYNTHUNITINVENTORY__
+#define __SYNTHUNITINVENTORY__
+
+#include "SynthEngineBase.h"
+#include "SynthArena.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define kSynthUnitInventoryResourceName		"UnitInventory"
+#define kSynthUnitInventoryResourceType		"units"
+
+// Phonemes are MacinTalk opcodes, as in SynthTextAnalysis; opcode 0 is silence.
+#define kSynthUnitPhonemeCount				256
+#define kSynthUnitSilencePhoneme			0
+
+// A unit as passed to SynthUnitInventoryWrite.
+typedef struct SynthUnitDescription {
+	uint8_t		phoneme;
+	uint8_t		leftContext;		// Phoneme before the unit where it was recorded.
+	uint8_t		rightContext;		// Phoneme after it.
+	uint8_t		reserved;
+	uint16_t	startPitch;			// Hz, for matching the join to the previous unit.
+	uint16_t	endPitch;
+	uint32_t	sampleOffset;		// Into the samples passed along with the units.
+	uint32_t	sampleLength;
+} SynthUnitDescription;
+
+typedef struct SynthUnitInventory SynthUnitInventory;
+
+// The result of speaking a phoneme sequence: 16-bit mono samples at the inventory's sample rate, and the
+// sample at which each phoneme starts, with one extra entry for the end.
+typedef struct SynthUnitRendering {
+	int16_t *	samples;
+	uint64_t	sampleCount;
+	uint64_t *	phonemeStarts;
+	uint32_t	phonemeCount;
+	uint32_t	sampleRate;
+	SynthArena *	arena;			// Where the samples and starts came from, or NULL for malloc.
+} SynthUnitRendering;
+
+// Sorts the units into the index and writes the inventory file.  crossfadeSamples is the length of the
+// overlap at every join, and pauseSamples the silence used for a phoneme the inventory has no unit for.
+long		SynthUnitInventoryWrite(const char * path, uint32_t sampleRate, uint32_t crossfadeSamples, uint32_t pauseSamples, const SynthUnitDescription * units, uint32_t unitCount, const int16_t * samples, uint64_t sampleCount);
+
+// Maps an inventory file, or passes back the inventory already open for path with another reference.
+long		SynthUnitInventoryOpen(const char * path, SynthUnitInventory ** outInventory);
+SynthUnitInventory *	SynthUnitInventoryRetain(SynthUnitInventory * inventory);
+void		SynthUnitInventoryRelease(SynthUnitInventory * inventory);
+uint32_t	SynthUnitInventorySampleRate(const SynthUnitInventory * inventory);
+
+// Reads the whole inventory into memory, so a voice can be loaded ahead of the utterance that first uses it.
+void		SynthUnitInventoryPrefetch(const SynthUnitInventory * inventory);
+
+// Picks the unit for each phoneme, preferring one recorded between the same neighbors, then the one whose
+// pitch joins most smoothly to the previous unit.  Passes back -1 for a phoneme with no units.
+long		SynthUnitInventorySelect(const SynthUnitInventory * inventory, const uint8_t * phonemes, uint32_t phonemeCount, int32_t * unitIndexes);
+
+// Selects units for the phonemes and joins them, crossfading where they overlap.  The rendering is scratch memory
+// from arena, if one is passed, and lasts until the arena is rewound; otherwise it's allocated with malloc.
+long		SynthUnitInventoryRender(const SynthUnitInventory * inventory, const uint8_t * phonemes, uint32_t phonemeCount, SynthArena * arena, SynthUnitRendering * rendering);
+void		SynthUnitRenderingDispose(SynthUnitRendering * rendering);
+
+// Wraps the rendering's samples in an AIFF file image, in scratch memory from arena, or without one, allocated with malloc.
+long		SynthUnitRenderingCopyAIFF(const SynthUnitRendering * rendering, SynthArena * arena, void ** outBytes, size_t * outByteCount);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,164 @@
+/*
+	SynthUtteranceRenderer.c
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Utterance rendering.  See SynthUtteranceRenderer.h.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#include <stdlib.h>
+#include "SynthUtteranceRenderer.h"
+
+static long		RenderUnits(const SynthTextAnalysis * analysis, const SynthUnitInventory * inventory, SynthArena * arena, uint64_t * positions, void ** audio, size_t * audioBytes);
+
+long SynthUtteranceRender(const SynthTextAnalysis * analysis, const uint32_t * originalOffsets, const SynthUnitInventory * inventory, uint32_t samplesPerCharacter, const void * fallbackAudio, size_t fallbackAudioBytes, const SynthAudioCacheKey * key, SynthArena * arena, SynthRenderedUtterance ** outUtterance)
+{
+	uint64_t * positions;
+	SynthTimelineEvent * events;
+	void * unitAudio = NULL;
+	size_t unitAudioBytes = 0;
+	SynthBoundaryIndex boundaries;
+	SynthArenaMark mark;
+	uint32_t index;
+	long error = noErr;
+
+	if (analysis == NULL || originalOffsets == NULL || key == NULL || outUtterance == NULL) {
+		return paramErr;
+	}
+	*outUtterance = NULL;
+	if (arena) {
+		mark = SynthArenaGetMark(arena);
+	}
+
+	// The sample at which each character of the normalized text is spoken.
+	positions = (uint64_t *)SynthScratchAlloc(arena, (analysis->textLength + 1) * sizeof(uint64_t));
+	events = (SynthTimelineEvent *)SynthScratchAlloc(arena, (analysis->eventCount ? analysis->eventCount : 1) * sizeof(SynthTimelineEvent));
+
+	// The analysis says how many boundaries there are, so their arrays are made full size and never have to grow.
+	SynthBoundaryIndexInit(&boundaries);
+	boundaries.wordEnds = (uint64_t *)SynthScratchAlloc(arena, (analysis->boundaries.wordCount ? analysis->boundaries.wordCount : 1) * sizeof(uint64_t));
+	boundaries.sentenceEnds = (uint64_t *)SynthScratchAlloc(arena, (analysis->boundaries.sentenceCount ? analysis->boundaries.sentenceCount : 1) * sizeof(uint64_t));
+	boundaries.wordCapacity = analysis->boundaries.wordCount;
+	boundaries.sentenceCapacity = analysis->boundaries.sentenceCount;
+	if (positions == NULL || events == NULL || boundaries.wordEnds == NULL || boundaries.sentenceEnds == NULL) {
+		error = memFullErr;
+	}
+	if (error == noErr) {
+		if (inventory) {
+			error = RenderUnits(analysis, inventory, arena, positions, &unitAudio, &unitAudioBytes);
+		}
+		else {
+			for (index = 0; index <= analysis->textLength; index++) {
+				positions[index] = (uint64_t)originalOffsets[index] * samplesPerCharacter;
+			}
+		}
+	}
+
+	// Place the events and boundaries on the timeline of the text as the client passed it.
+	if (error == noErr) {
+		for (index = 0; index < analysis->eventCount; index++) {
+			const SynthTextEvent * event = &analysis->events[index];
+			events[index].samplePosition = positions[event->characterOffset];
+			events[index].kind = event->kind;
+			events[index].characterOffset = originalOffsets[event->characterOffset];
+			events[index].length = (event->kind == kSynthTextWordEvent) ? originalOffsets[event->characterOffset + event->length - 1] + 1 - events[index].characterOffset : event->length;
+			events[index].phonemeCode = event->phonemeCode;
+		}
+		
+		// The analysis has the boundaries in characters of the normalized text.
+		for (index = 0; index < analysis->boundaries.wordCount && error == noErr; index++) {
+			error = SynthBoundaryIndexAddWordEnd(&boundaries, positions[analysis->boundaries.wordEnds[index]]);
+		}
+		for (index = 0; index < analysis->boundaries.sentenceCount && error == noErr; index++) {
+			error = SynthBoundaryIndexAddSentenceEnd(&boundaries, positions[analysis->boundaries.sentenceEnds[index]]);
+		}
+		boundaries.totalSamples = positions[analysis->textLength];
+	}
+	if (error == noErr) {
+		if (unitAudio) {
+			error = SynthRenderedUtteranceCreate(key, unitAudio, unitAudioBytes, events, analysis->eventCount, &boundaries, outUtterance);
+		}
+		else {
+			error = SynthRenderedUtteranceCreate(key, fallbackAudio, fallbackAudioBytes, events, analysis->eventCount, &boundaries, outUtterance);
+		}
+	}
+
+	// The rendered utterance has its own copies of everything, so the scratch memory can all go.
+	if (arena) {
+		SynthArenaRewind(arena, mark);
+	}
+	else {
+		free(boundaries.wordEnds);
+		free(boundaries.sentenceEnds);
+		free(positions);
+		free(events);
+		free(unitAudio);
+	}
+	return error;
+}
+
+static long RenderUnits(const SynthTextAnalysis * analysis, const SynthUnitInventory * inventory, SynthArena * arena, uint64_t * positions, void ** audio, size_t * audioBytes)
+{
+	uint8_t * phonemes = (uint8_t *)SynthScratchCalloc(arena, analysis->textLength ? analysis->textLength : 1, sizeof(uint8_t));
+	SynthUnitRendering rendering;
+	uint32_t index;
+	long error;
+
+	if (phonemes == NULL) {
+		return memFullErr;
+	}
+
+	// One phoneme for each character: the one the analysis gave it, else silence, which the inventory speaks as a pause.
+	for (index = 0; index < analysis->eventCount; index++) {
+		if (analysis->events[index].kind == kSynthTextPhonemeEvent) {
+			phonemes[analysis->events[index].characterOffset] = (uint8_t)analysis->events[index].phonemeCode;
+		}
+	}
+	error = SynthUnitInventoryRender(inventory, phonemes, (uint32_t)analysis->textLength, arena, &rendering);
+	if (error == noErr) {
+		for (index = 0; index <= rendering.phonemeCount; index++) {
+			positions[index] = rendering.phonemeStarts[index] * kSynthEngineSampleRate / rendering.sampleRate;
+		}
+		error = SynthUnitRenderingCopyAIFF(&rendering, arena, audio, audioBytes);
+		SynthUnitRenderingDispose(&rendering);
+	}
+	SynthScratchFree(arena, phonemes);
+	return error;
+}
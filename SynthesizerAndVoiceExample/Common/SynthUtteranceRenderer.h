@@ -0,0 +1,70 @@
+/*
+	SynthUtteranceRenderer.h
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Turns a text analysis into a rendered utterance: audio, timed events and
+	boundaries.  Shared by the plug-in and the synthesis server.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#ifndef __SYNTHUTTERANCERENDERER__
+#define __SYNTHUTTERANCERENDERER__
+
+#include "SynthEngineBase.h"
+#include "SynthTextAnalysis.h"
+#include "SynthAudioCache.h"
+#include "SynthUnitInventory.h"
+#include "SynthArena.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Renders the analysis of a text with the voice's unit inventory, or, without one, lays its events out at
+// samplesPerCharacter and uses fallbackAudio as the sound.  originalOffsets maps the normalized text the
+// analysis was made from back to the text as the client passed it, as SynthTextNormalize fills it in.  The working
+// buffers come from arena, if one is passed, which is left as it was found; otherwise from malloc.
+long		SynthUtteranceRender(const SynthTextAnalysis * analysis, const uint32_t * originalOffsets, const SynthUnitInventory * inventory, uint32_t samplesPerCharacter, const void * fallbackAudio, size_t fallbackAudioBytes, const SynthAudioCacheKey * key, SynthArena * arena, SynthRenderedUtterance ** outUtterance);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,482 @@
+/*
+	SynthVoiceIndex.c
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Writing, mapping and reading voice index files.  See SynthVoiceIndex.h.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "SynthVoiceIndex.h"
+
+#define kIndexMagic				0x53564958		// 'SVIX'
+#define kIndexVersion			1
+#define kNoModificationTime		(-1)
+
+// The file is this header, then the voice records, the directory records, the hash table of
+// voices by creator and id, the character ranges and the strings, all in native byte order.
+typedef struct IndexHeader {
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	voiceCount;
+	uint32_t	directoryCount;
+	uint32_t	slotCount;				// A power of two; each slot is 0 or a voice index plus one.
+	uint32_t	rangeCount;
+	uint32_t	stringBytes;
+	uint32_t	reserved;
+	uint64_t	voicesOffset;
+	uint64_t	directoriesOffset;
+	uint64_t	slotsOffset;
+	uint64_t	rangesOffset;
+	uint64_t	stringsOffset;
+} IndexHeader;
+
+typedef struct DirectoryRecord {
+	uint32_t	pathOffset;
+	uint32_t	reserved;
+	int64_t		modificationTime;
+} DirectoryRecord;
+
+struct SynthVoiceIndex {
+	void *							mapping;
+	size_t							mappingSize;
+	const IndexHeader *				header;
+	const SynthVoiceRecord *		voices;
+	const DirectoryRecord *			directories;
+	const uint32_t *				slots;
+	const SynthVoiceCharacterRange *	ranges;
+	const char *					strings;
+};
+
+// The string pool being built by SynthVoiceIndexWrite.  Offset 0 is always the empty string.
+typedef struct StringPool {
+	char *		bytes;
+	uint32_t	length;
+	uint32_t	capacity;
+} StringPool;
+
+static int64_t		ModificationTime(const char * path);
+static uint32_t		VoiceHash(uint32_t creator, uint32_t id);
+static long			AddString(StringPool * pool, const char * string, uint32_t * outOffset);
+static Boolean		IsValidString(const SynthVoiceIndex * index, uint32_t offset);
+
+long SynthVoiceIndexWrite(const char * path, const char * const * directories, uint32_t directoryCount, const SynthVoiceEntry * voices, uint32_t voiceCount)
+{
+	SynthVoiceRecord * records = NULL;
+	DirectoryRecord * directoryRecords = NULL;
+	SynthVoiceCharacterRange * ranges = NULL;
+	uint32_t * slots = NULL;
+	StringPool pool = { NULL, 0, 0 };
+	IndexHeader header;
+	char temporaryPath[PATH_MAX];
+	uint32_t rangeCount = 0;
+	uint32_t slotCount = 1;
+	uint32_t itemIndex;
+	long error = noErr;
+	FILE * file;
+
+	if (path == NULL || (directoryCount > 0 && directories == NULL) || (voiceCount > 0 && voices == NULL)) {
+		return paramErr;
+	}
+
+	// Keep the table at most half full, so probes stay short.
+	while (slotCount < 2 * voiceCount) {
+		slotCount *= 2;
+	}
+	for (itemIndex = 0; itemIndex < voiceCount; itemIndex++) {
+		rangeCount += voices[itemIndex].supportedCharacterRangeCount + voices[itemIndex].individuallySpokenCharacterRangeCount;
+	}
+	records = (SynthVoiceRecord *)calloc(voiceCount ? voiceCount : 1, sizeof(SynthVoiceRecord));
+	directoryRecords = (DirectoryRecord *)calloc(directoryCount ? directoryCount : 1, sizeof(DirectoryRecord));
+	ranges = (SynthVoiceCharacterRange *)calloc(rangeCount ? rangeCount : 1, sizeof(SynthVoiceCharacterRange));
+	slots = (uint32_t *)calloc(slotCount, sizeof(uint32_t));
+	if (records == NULL || directoryRecords == NULL || ranges == NULL || slots == NULL) {
+		error = memFullErr;
+	}
+	if (error == noErr) {
+		uint32_t emptyOffset;
+		error = AddString(&pool, "", &emptyOffset);
+	}
+
+	for (itemIndex = 0; itemIndex < directoryCount && error == noErr; itemIndex++) {
+		directoryRecords[itemIndex].modificationTime = ModificationTime(directories[itemIndex]);
+		error = AddString(&pool, directories[itemIndex], &directoryRecords[itemIndex].pathOffset);
+	}
+
+	rangeCount = 0;
+	for (itemIndex = 0; itemIndex < voiceCount && error == noErr; itemIndex++) {
+		const SynthVoiceEntry * voice = &voices[itemIndex];
+		SynthVoiceRecord * record = &records[itemIndex];
+		uint32_t slot = VoiceHash(voice->creator, voice->id) & (slotCount - 1);
+
+		record->creator = voice->creator;
+		record->id = voice->id;
+		record->age = voice->age;
+		record->gender = voice->gender;
+		record->bundleModificationTime = (voice->bundlePath) ? SynthVoiceIndexBundleModificationTime(voice->bundlePath) : kNoModificationTime;
+		if ((error = AddString(&pool, voice->name, &record->nameOffset)) == noErr
+			&& (error = AddString(&pool, voice->identifier, &record->identifierOffset)) == noErr
+			&& (error = AddString(&pool, voice->localeIdentifier, &record->localeIdentifierOffset)) == noErr
+			&& (error = AddString(&pool, voice->demoText, &record->demoTextOffset)) == noErr) {
+			error = AddString(&pool, voice->bundlePath, &record->bundlePathOffset);
+		}
+
+		record->supportedCharactersFirst = rangeCount;
+		record->supportedCharacterRangeCount = voice->supportedCharacterRangeCount;
+		if (voice->supportedCharacterRangeCount > 0) {
+			memcpy(ranges + rangeCount, voice->supportedCharacters, voice->supportedCharacterRangeCount * sizeof(SynthVoiceCharacterRange));
+			rangeCount += voice->supportedCharacterRangeCount;
+		}
+		record->individuallySpokenCharactersFirst = rangeCount;
+		record->individuallySpokenCharacterRangeCount = voice->individuallySpokenCharacterRangeCount;
+		if (voice->individuallySpokenCharacterRangeCount > 0) {
+			memcpy(ranges + rangeCount, voice->individuallySpokenCharacters, voice->individuallySpokenCharacterRangeCount * sizeof(SynthVoiceCharacterRange));
+			rangeCount += voice->individuallySpokenCharacterRangeCount;
+		}
+
+		// When two bundles claim the same voice, the first one found is the one looked up.
+		while (slots[slot] != 0 && (records[slots[slot] - 1].creator != voice->creator || records[slots[slot] - 1].id != voice->id)) {
+			slot = (slot + 1) & (slotCount - 1);
+		}
+		if (slots[slot] == 0) {
+			slots[slot] = itemIndex + 1;
+		}
+	}
+
+	if (error == noErr) {
+		memset(&header, 0, sizeof(header));
+		header.magic = kIndexMagic;
+		header.version = kIndexVersion;
+		header.voiceCount = voiceCount;
+		header.directoryCount = directoryCount;
+		header.slotCount = slotCount;
+		header.rangeCount = rangeCount;
+		header.stringBytes = pool.length;
+		header.voicesOffset = sizeof(IndexHeader);
+		header.directoriesOffset = header.voicesOffset + voiceCount * sizeof(SynthVoiceRecord);
+		header.slotsOffset = header.directoriesOffset + directoryCount * sizeof(DirectoryRecord);
+		header.rangesOffset = header.slotsOffset + slotCount * sizeof(uint32_t);
+		header.stringsOffset = header.rangesOffset + rangeCount * sizeof(SynthVoiceCharacterRange);
+
+		// Every section is a multiple of 4 bytes long and the voice and directory records are 8 byte aligned,
+		// so the sections can be written back to back.  Write under a temporary name so readers never see half a file.
+		snprintf(temporaryPath, sizeof(temporaryPath), "%s.partial", path);
+		file = fopen(temporaryPath, "wb");
+		if (file == NULL) {
+			error = ioErr;
+		}
+		else {
+			if (fwrite(&header, sizeof(header), 1, file) != 1
+				|| fwrite(records, sizeof(SynthVoiceRecord), voiceCount, file) != voiceCount
+				|| fwrite(directoryRecords, sizeof(DirectoryRecord), directoryCount, file) != directoryCount
+				|| fwrite(slots, sizeof(uint32_t), slotCount, file) != slotCount
+				|| fwrite(ranges, sizeof(SynthVoiceCharacterRange), rangeCount, file) != rangeCount
+				|| fwrite(pool.bytes, 1, pool.length, file) != pool.length) {
+				error = ioErr;
+			}
+			if (fclose(file) != 0 && error == noErr) {
+				error = ioErr;
+			}
+			if (error == noErr && rename(temporaryPath, path) != 0) {
+				error = ioErr;
+			}
+			if (error != noErr) {
+				unlink(temporaryPath);
+			}
+		}
+	}
+
+	free(records);
+	free(directoryRecords);
+	free(ranges);
+	free(slots);
+	free(pool.bytes);
+	return error;
+}
+
+long SynthVoiceIndexGetDefaultPath(char * path, size_t pathSize)
+{
+	const char * overridePath = getenv(kSynthVoiceIndexPathVariable);
+	const char * home = getenv("HOME");
+	int length;
+
+	if (path == NULL || pathSize == 0) {
+		return paramErr;
+	}
+	if (overridePath && *overridePath) {
+		length = snprintf(path, pathSize, "%s", overridePath);
+	}
+	else if (home && *home) {
+		length = snprintf(path, pathSize, "%s/%s", home, kSynthVoiceIndexDefaultPath);
+	}
+	else {
+		return fnfErr;
+	}
+	return (length < 0 || (size_t)length >= pathSize) ? bufTooSmall : noErr;
+}
+
+long SynthVoiceIndexOpen(const char * path, SynthVoiceIndex ** outIndex)
+{
+	SynthVoiceIndex * index;
+	const IndexHeader * header;
+	struct stat fileInfo;
+	const uint8_t * base;
+	uint32_t itemIndex;
+	long error = noErr;
+	int file;
+
+	if (path == NULL || outIndex == NULL) {
+		return paramErr;
+	}
+	*outIndex = NULL;
+
+	file = open(path, O_RDONLY);
+	if (file < 0) {
+		return fnfErr;
+	}
+	if (fstat(file, &fileInfo) != 0 || fileInfo.st_size < (off_t)sizeof(IndexHeader)) {
+		close(file);
+		return badDictFormat;
+	}
+	index = (SynthVoiceIndex *)calloc(1, sizeof(SynthVoiceIndex));
+	if (index == NULL) {
+		close(file);
+		return memFullErr;
+	}
+	index->mappingSize = (size_t)fileInfo.st_size;
+	index->mapping = mmap(NULL, index->mappingSize, PROT_READ, MAP_SHARED, file, 0);
+	close(file);
+	if (index->mapping == MAP_FAILED) {
+		free(index);
+		return memFullErr;
+	}
+
+	// Check the sections fit in the file and end where the next begins.
+	base = (const uint8_t *)index->mapping;
+	header = (const IndexHeader *)base;
+	if (header->magic != kIndexMagic || header->version != kIndexVersion || header->slotCount == 0
+		|| (header->slotCount & (header->slotCount - 1)) != 0 || header->stringBytes == 0
+		|| header->voicesOffset != sizeof(IndexHeader)
+		|| header->directoriesOffset != header->voicesOffset + (uint64_t)header->voiceCount * sizeof(SynthVoiceRecord)
+		|| header->slotsOffset != header->directoriesOffset + (uint64_t)header->directoryCount * sizeof(DirectoryRecord)
+		|| header->rangesOffset != header->slotsOffset + (uint64_t)header->slotCount * sizeof(uint32_t)
+		|| header->stringsOffset != header->rangesOffset + (uint64_t)header->rangeCount * sizeof(SynthVoiceCharacterRange)
+		|| header->stringsOffset + header->stringBytes != index->mappingSize
+		|| base[index->mappingSize - 1] != '\0') {
+		error = badDictFormat;
+	}
+	if (error == noErr) {
+		index->header = header;
+		index->voices = (const SynthVoiceRecord *)(base + header->voicesOffset);
+		index->directories = (const DirectoryRecord *)(base + header->directoriesOffset);
+		index->slots = (const uint32_t *)(base + header->slotsOffset);
+		index->ranges = (const SynthVoiceCharacterRange *)(base + header->rangesOffset);
+		index->strings = (const char *)(base + header->stringsOffset);
+
+		// Then every offset inside them, so lookups never have to check again.
+		for (itemIndex = 0; itemIndex < header->voiceCount && error == noErr; itemIndex++) {
+			const SynthVoiceRecord * record = &index->voices[itemIndex];
+			if (! IsValidString(index, record->nameOffset) || ! IsValidString(index, record->identifierOffset)
+				|| ! IsValidString(index, record->localeIdentifierOffset) || ! IsValidString(index, record->demoTextOffset)
+				|| ! IsValidString(index, record->bundlePathOffset)
+				|| (uint64_t)record->supportedCharactersFirst + record->supportedCharacterRangeCount > header->rangeCount
+				|| (uint64_t)record->individuallySpokenCharactersFirst + record->individuallySpokenCharacterRangeCount > header->rangeCount) {
+				error = badDictFormat;
+			}
+		}
+		for (itemIndex = 0; itemIndex < header->directoryCount && error == noErr; itemIndex++) {
+			if (! IsValidString(index, index->directories[itemIndex].pathOffset)) {
+				error = badDictFormat;
+			}
+		}
+		for (itemIndex = 0; itemIndex < header->slotCount && error == noErr; itemIndex++) {
+			if (index->slots[itemIndex] > header->voiceCount) {
+				error = badDictFormat;
+			}
+		}
+	}
+
+	if (error != noErr) {
+		munmap(index->mapping, index->mappingSize);
+		free(index);
+		return error;
+	}
+	*outIndex = index;
+	return noErr;
+}
+
+void SynthVoiceIndexClose(SynthVoiceIndex * index)
+{
+	if (index) {
+		munmap(index->mapping, index->mappingSize);
+		free(index);
+	}
+}
+
+Boolean SynthVoiceIndexIsCurrent(const SynthVoiceIndex * index)
+{
+	uint32_t itemIndex;
+
+	// A bundle added to or removed from a directory changes the directory's time; an edited bundle changes its own.
+	for (itemIndex = 0; itemIndex < index->header->directoryCount; itemIndex++) {
+		const DirectoryRecord * directory = &index->directories[itemIndex];
+		if (ModificationTime(index->strings + directory->pathOffset) != directory->modificationTime) {
+			return false;
+		}
+	}
+	for (itemIndex = 0; itemIndex < index->header->voiceCount; itemIndex++) {
+		const SynthVoiceRecord * record = &index->voices[itemIndex];
+		if (index->strings[record->bundlePathOffset] != '\0'
+			&& SynthVoiceIndexBundleModificationTime(index->strings + record->bundlePathOffset) != record->bundleModificationTime) {
+			return false;
+		}
+	}
+	return true;
+}
+
+uint32_t SynthVoiceIndexGetCount(const SynthVoiceIndex * index)
+{
+	return index->header->voiceCount;
+}
+
+const SynthVoiceRecord * SynthVoiceIndexGetVoice(const SynthVoiceIndex * index, uint32_t voiceIndex)
+{
+	return (voiceIndex < index->header->voiceCount) ? &index->voices[voiceIndex] : NULL;
+}
+
+const SynthVoiceRecord * SynthVoiceIndexFindVoice(const SynthVoiceIndex * index, uint32_t creator, uint32_t id)
+{
+	uint32_t mask = index->header->slotCount - 1;
+	uint32_t slot = VoiceHash(creator, id) & mask;
+
+	while (index->slots[slot] != 0) {
+		const SynthVoiceRecord * record = &index->voices[index->slots[slot] - 1];
+		if (record->creator == creator && record->id == id) {
+			return record;
+		}
+		slot = (slot + 1) & mask;
+	}
+	return NULL;
+}
+
+const char * SynthVoiceIndexGetString(const SynthVoiceIndex * index, uint32_t offset)
+{
+	return (offset < index->header->stringBytes) ? index->strings + offset : "";
+}
+
+const SynthVoiceCharacterRange * SynthVoiceIndexGetRanges(const SynthVoiceIndex * index, uint32_t first)
+{
+	return index->ranges + first;
+}
+
+int64_t SynthVoiceIndexBundleModificationTime(const char * bundlePath)
+{
+	static const char * const sAttributeFiles[] = { "Contents/Info.plist", "Contents/Resources", "Contents/Resources/VoiceDescription" };
+	int64_t latestTime = ModificationTime(bundlePath);
+	size_t fileIndex;
+
+	if (latestTime == kNoModificationTime) {
+		return kNoModificationTime;
+	}
+	for (fileIndex = 0; fileIndex < sizeof(sAttributeFiles) / sizeof(sAttributeFiles[0]); fileIndex++) {
+		char path[PATH_MAX];
+		int64_t fileTime;
+		snprintf(path, sizeof(path), "%s/%s", bundlePath, sAttributeFiles[fileIndex]);
+		fileTime = ModificationTime(path);
+		if (fileTime > latestTime) {
+			latestTime = fileTime;
+		}
+	}
+	return latestTime;
+}
+
+static int64_t ModificationTime(const char * path)
+{
+	struct stat fileInfo;
+	return (stat(path, &fileInfo) == 0) ? (int64_t)fileInfo.st_mtime : kNoModificationTime;
+}
+
+static uint32_t VoiceHash(uint32_t creator, uint32_t id)
+{
+	uint32_t hash = creator * 2654435761u ^ id;
+	return hash ^ (hash >> 16);
+}
+
+static long AddString(StringPool * pool, const char * string, uint32_t * outOffset)
+{
+	size_t length;
+
+	// Missing strings share the empty string at the start of the pool.
+	if (string == NULL || (*string == '\0' && pool->length > 0)) {
+		*outOffset = 0;
+		return noErr;
+	}
+	length = strlen(string) + 1;
+	if (pool->length + length > pool->capacity) {
+		uint32_t newCapacity = (pool->capacity) ? pool->capacity : 1024;
+		char * newBytes;
+		while (pool->length + length > newCapacity) {
+			newCapacity *= 2;
+		}
+		newBytes = (char *)realloc(pool->bytes, newCapacity);
+		if (newBytes == NULL) {
+			return memFullErr;
+		}
+		pool->bytes = newBytes;
+		pool->capacity = newCapacity;
+	}
+	memcpy(pool->bytes + pool->length, string, length);
+	*outOffset = pool->length;
+	pool->length += (uint32_t)length;
+	return noErr;
+}
+
+static Boolean IsValidString(const SynthVoiceIndex * index, uint32_t offset)
+{
+	// The strings section ends with a NUL, so any offset inside it starts a terminated string.
+	return (offset < index->header->stringBytes);
+}
@@ -0,0 +1,141 @@
+/*
+	SynthVoiceIndex.h
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: A precompiled index of the attributes of every installed voice, so clients can
+	enumerate voices and look them up without opening each bundle and parsing its
+	Info.plist or VoiceDescription.  The index is a single file, mapped when opened,
+	and records the modification times of the voice directories and bundles it was
+	compiled from so a client can tell when it's out of date.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#ifndef __SYNTHVOICEINDEX__
+#define __SYNTHVOICEINDEX__
+
+#include "SynthEngineBase.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Where the index lives, unless overridden by kSynthVoiceIndexPathVariable: relative to the home directory.
+#define kSynthVoiceIndexPathVariable			"SYNTH_VOICE_INDEX_PATH"
+#define kSynthVoiceIndexDefaultPath				"Library/Caches/SpeechVoices.voiceindex"
+
+enum {
+	kSynthVoiceGenderNeuter		= 0,
+	kSynthVoiceGenderMale		= 1,
+	kSynthVoiceGenderFemale		= 2
+};
+
+// An inclusive range of UTF-16 code units, as in VoiceSupportedCharacters.
+typedef struct SynthVoiceCharacterRange {
+	uint32_t	first;
+	uint32_t	last;
+} SynthVoiceCharacterRange;
+
+// A voice as passed to SynthVoiceIndexWrite.  Strings are UTF-8 and may be NULL.
+typedef struct SynthVoiceEntry {
+	uint32_t							creator;				// VoiceSynthesizerNumericID, the VoiceSpec creator.
+	uint32_t							id;						// VoiceNumericID.
+	int32_t								age;
+	int32_t								gender;
+	const char *						name;
+	const char *						identifier;				// CFBundleIdentifier, as NSSpeechSynthesizer names voices.
+	const char *						localeIdentifier;
+	const char *						demoText;
+	const char *						bundlePath;
+	const SynthVoiceCharacterRange *	supportedCharacters;
+	uint32_t							supportedCharacterRangeCount;
+	const SynthVoiceCharacterRange *	individuallySpokenCharacters;
+	uint32_t							individuallySpokenCharacterRangeCount;
+} SynthVoiceEntry;
+
+// A voice in an open index.  The offsets are for SynthVoiceIndexGetString and SynthVoiceIndexGetRanges.
+typedef struct SynthVoiceRecord {
+	uint32_t	creator;
+	uint32_t	id;
+	int32_t		age;
+	int32_t		gender;
+	uint32_t	nameOffset;
+	uint32_t	identifierOffset;
+	uint32_t	localeIdentifierOffset;
+	uint32_t	demoTextOffset;
+	uint32_t	bundlePathOffset;
+	uint32_t	supportedCharactersFirst;
+	uint32_t	supportedCharacterRangeCount;
+	uint32_t	individuallySpokenCharactersFirst;
+	uint32_t	individuallySpokenCharacterRangeCount;
+	uint32_t	reserved;
+	int64_t		bundleModificationTime;
+} SynthVoiceRecord;
+
+typedef struct SynthVoiceIndex SynthVoiceIndex;
+
+// Writes an index of the voices found in the given voice directories.  The bundle modification times are read here.
+long		SynthVoiceIndexWrite(const char * path, const char * const * directories, uint32_t directoryCount, const SynthVoiceEntry * voices, uint32_t voiceCount);
+
+// Scans the voice directories for bundles, reads their attributes and writes the index.  Needs CoreFoundation.
+long		SynthVoiceIndexCompile(const char * path, const char * const * directories, uint32_t directoryCount);
+
+// Fills in path with the index location from the environment or the default.
+long		SynthVoiceIndexGetDefaultPath(char * path, size_t pathSize);
+
+long		SynthVoiceIndexOpen(const char * path, SynthVoiceIndex ** outIndex);
+void		SynthVoiceIndexClose(SynthVoiceIndex * index);
+
+// False once a voice directory or bundle has changed since the index was compiled.  Only looks at modification times.
+Boolean		SynthVoiceIndexIsCurrent(const SynthVoiceIndex * index);
+
+uint32_t	SynthVoiceIndexGetCount(const SynthVoiceIndex * index);
+const SynthVoiceRecord *	SynthVoiceIndexGetVoice(const SynthVoiceIndex * index, uint32_t voiceIndex);
+const SynthVoiceRecord *	SynthVoiceIndexFindVoice(const SynthVoiceIndex * index, uint32_t creator, uint32_t id);
+const char *				SynthVoiceIndexGetString(const SynthVoiceIndex * index, uint32_t offset);
+const SynthVoiceCharacterRange *	SynthVoiceIndexGetRanges(const SynthVoiceIndex * index, uint32_t first);
+
+// The latest modification time of the bundle and the files its attributes are read from.
+int64_t		SynthVoiceIndexBundleModificationTime(const char * bundlePath);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
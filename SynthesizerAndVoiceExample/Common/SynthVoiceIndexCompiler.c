@@ -0,0 +1,363 @@
+/*
+	SynthVoiceIndexCompiler.c
+	SynthesizerAndVoiceExample
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Reads the attributes of the voice bundles in a set of voice directories and
+	writes them to a voice index.  See SynthVoiceIndex.h.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#include <CoreFoundation/CoreFoundation.h>
+#include <dirent.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "SynthVoiceIndex.h"
+
+#define kVoiceBundleExtension			".SpeechVoice"
+
+// Offsets into the legacy VoiceDescription resource, which is big-endian.
+#define kVoiceDescriptionCreator		4
+#define kVoiceDescriptionID				8
+#define kVoiceDescriptionName			16
+#define kVoiceDescriptionComment		80
+#define kVoiceDescriptionGender			336
+#define kVoiceDescriptionAge			338
+#define kVoiceDescriptionSize			362
+
+typedef struct VoiceList {
+	SynthVoiceEntry *		entries;
+	uint32_t				count;
+	uint32_t				capacity;
+} VoiceList;
+
+static long		AddVoicesInDirectory(VoiceList * list, const char * directory);
+static long		ReadVoiceBundle(const char * bundlePath, SynthVoiceEntry * entry);
+static void		ReadVoiceDescription(CFBundleRef bundle, SynthVoiceEntry * entry);
+static void		ReadVoiceAttributes(CFDictionaryRef attributes, SynthVoiceEntry * entry);
+static SynthVoiceCharacterRange *	CopyRanges(CFArrayRef rangeArray, uint32_t * outCount);
+static char *	CopyUTF8String(CFStringRef string);
+static Boolean	GetNumber(CFDictionaryRef dictionary, CFStringRef key, int32_t * value);
+static void		DisposeEntry(SynthVoiceEntry * entry);
+static int		CompareNames(const void * a, const void * b);
+
+long SynthVoiceIndexCompile(const char * path, const char * const * directories, uint32_t directoryCount)
+{
+	VoiceList list = { NULL, 0, 0 };
+	uint32_t itemIndex;
+	long error = noErr;
+
+	if (path == NULL || (directoryCount > 0 && directories == NULL)) {
+		return paramErr;
+	}
+
+	for (itemIndex = 0; itemIndex < directoryCount && error == noErr; itemIndex++) {
+		error = AddVoicesInDirectory(&list, directories[itemIndex]);
+	}
+	if (error == noErr) {
+		error = SynthVoiceIndexWrite(path, directories, directoryCount, list.entries, list.count);
+	}
+
+	for (itemIndex = 0; itemIndex < list.count; itemIndex++) {
+		DisposeEntry(&list.entries[itemIndex]);
+	}
+	free(list.entries);
+	return error;
+}
+
+static long AddVoicesInDirectory(VoiceList * list, const char * directory)
+{
+	char ** names = NULL;
+	size_t nameCount = 0;
+	size_t nameCapacity = 0;
+	size_t nameIndex;
+	struct dirent * item;
+	DIR * voices;
+	long error = noErr;
+
+	// A missing directory has no voices; its absence is still recorded in the index.
+	voices = opendir(directory);
+	if (voices == NULL) {
+		return noErr;
+	}
+	while ((item = readdir(voices)) != NULL && error == noErr) {
+		size_t length = strlen(item->d_name);
+		if (length <= strlen(kVoiceBundleExtension) || strcmp(item->d_name + length - strlen(kVoiceBundleExtension), kVoiceBundleExtension) != 0) {
+			continue;
+		}
+		if (nameCount == nameCapacity) {
+			size_t newCapacity = (nameCapacity) ? nameCapacity * 2 : 16;
+			char ** newNames = (char **)realloc(names, newCapacity * sizeof(char *));
+			if (newNames == NULL) {
+				error = memFullErr;
+				break;
+			}
+			names = newNames;
+			nameCapacity = newCapacity;
+		}
+		names[nameCount] = strdup(item->d_name);
+		if (names[nameCount] == NULL) {
+			error = memFullErr;
+		}
+		else {
+			nameCount++;
+		}
+	}
+	closedir(voices);
+
+	// Index the bundles in name order, so the voice order doesn't depend on the file system.
+	if (nameCount > 0) {
+		qsort(names, nameCount, sizeof(char *), CompareNames);
+	}
+	for (nameIndex = 0; nameIndex < nameCount; nameIndex++) {
+		if (error == noErr && list->count == list->capacity) {
+			uint32_t newCapacity = (list->capacity) ? list->capacity * 2 : 16;
+			SynthVoiceEntry * newEntries = (SynthVoiceEntry *)realloc(list->entries, newCapacity * sizeof(SynthVoiceEntry));
+			if (newEntries == NULL) {
+				error = memFullErr;
+			}
+			else {
+				list->entries = newEntries;
+				list->capacity = newCapacity;
+			}
+		}
+		if (error == noErr) {
+			char bundlePath[PATH_MAX];
+			snprintf(bundlePath, sizeof(bundlePath), "%s/%s", directory, names[nameIndex]);
+
+			// A bundle that can't be read isn't a usable voice, so it's left out rather than failing the whole index.
+			if (ReadVoiceBundle(bundlePath, &list->entries[list->count]) == noErr) {
+				list->count++;
+			}
+		}
+		free(names[nameIndex]);
+	}
+	free(names);
+	return error;
+}
+
+static long ReadVoiceBundle(const char * bundlePath, SynthVoiceEntry * entry)
+{
+	CFURLRef bundleURL;
+	CFBundleRef bundle;
+	CFDictionaryRef info;
+	long error = noErr;
+
+	memset(entry, 0, sizeof(SynthVoiceEntry));
+	bundleURL = CFURLCreateFromFileSystemRepresentation(NULL, (const UInt8 *)bundlePath, strlen(bundlePath), true);
+	if (bundleURL == NULL) {
+		return memFullErr;
+	}
+	bundle = CFBundleCreate(NULL, bundleURL);
+	CFRelease(bundleURL);
+	if (bundle == NULL) {
+		return fnfErr;
+	}
+
+	// Voices made for Mac OS X 10.4 and earlier describe themselves in a VoiceDescription resource; the
+	// VoiceAttributes in the Info.plist fill in or override it.
+	ReadVoiceDescription(bundle, entry);
+	info = CFBundleGetInfoDictionary(bundle);
+	if (info) {
+		CFTypeRef attributes = CFDictionaryGetValue(info, CFSTR("VoiceAttributes"));
+		CFTypeRef identifier = CFDictionaryGetValue(info, kCFBundleIdentifierKey);
+		if (attributes && CFGetTypeID(attributes) == CFDictionaryGetTypeID()) {
+			ReadVoiceAttributes((CFDictionaryRef)attributes, entry);
+		}
+		if (identifier && CFGetTypeID(identifier) == CFStringGetTypeID()) {
+			entry->identifier = CopyUTF8String((CFStringRef)identifier);
+		}
+	}
+	CFRelease(bundle);
+
+	entry->bundlePath = strdup(bundlePath);
+	if (entry->name == NULL || entry->bundlePath == NULL) {
+		DisposeEntry(entry);
+		error = voiceNotFound;
+	}
+	return error;
+}
+
+static void ReadVoiceDescription(CFBundleRef bundle, SynthVoiceEntry * entry)
+{
+	CFURLRef descriptionURL = CFBundleCopyResourceURL(bundle, CFSTR("VoiceDescription"), NULL, NULL);
+	UInt8 bytes[kVoiceDescriptionSize];
+	char path[PATH_MAX];
+	FILE * file = NULL;
+
+	if (descriptionURL) {
+		if (CFURLGetFileSystemRepresentation(descriptionURL, true, (UInt8 *)path, sizeof(path))) {
+			file = fopen(path, "rb");
+		}
+		CFRelease(descriptionURL);
+	}
+	if (file == NULL) {
+		return;
+	}
+	if (fread(bytes, 1, sizeof(bytes), file) == sizeof(bytes)) {
+		CFStringRef name = CFStringCreateWithPascalString(NULL, bytes + kVoiceDescriptionName, kCFStringEncodingMacRoman);
+		CFStringRef comment = CFStringCreateWithPascalString(NULL, bytes + kVoiceDescriptionComment, kCFStringEncodingMacRoman);
+
+		entry->creator = (uint32_t)bytes[kVoiceDescriptionCreator] << 24 | (uint32_t)bytes[kVoiceDescriptionCreator + 1] << 16 | (uint32_t)bytes[kVoiceDescriptionCreator + 2] << 8 | bytes[kVoiceDescriptionCreator + 3];
+		entry->id = (uint32_t)bytes[kVoiceDescriptionID] << 24 | (uint32_t)bytes[kVoiceDescriptionID + 1] << 16 | (uint32_t)bytes[kVoiceDescriptionID + 2] << 8 | bytes[kVoiceDescriptionID + 3];
+		entry->gender = (int16_t)(bytes[kVoiceDescriptionGender] << 8 | bytes[kVoiceDescriptionGender + 1]);
+		entry->age = (int16_t)(bytes[kVoiceDescriptionAge] << 8 | bytes[kVoiceDescriptionAge + 1]);
+		if (name) {
+			entry->name = CopyUTF8String(name);
+			CFRelease(name);
+		}
+		if (comment) {
+			entry->demoText = CopyUTF8String(comment);
+			CFRelease(comment);
+		}
+	}
+	fclose(file);
+}
+
+static void ReadVoiceAttributes(CFDictionaryRef attributes, SynthVoiceEntry * entry)
+{
+	CFTypeRef value;
+	int32_t number;
+
+	if (GetNumber(attributes, CFSTR("VoiceSynthesizerNumericID"), &number)) {
+		entry->creator = (uint32_t)number;
+	}
+	if (GetNumber(attributes, CFSTR("VoiceNumericID"), &number)) {
+		entry->id = (uint32_t)number;
+	}
+	if (GetNumber(attributes, CFSTR("VoiceAge"), &number)) {
+		entry->age = number;
+	}
+	value = CFDictionaryGetValue(attributes, CFSTR("VoiceGender"));
+	if (value && CFGetTypeID(value) == CFStringGetTypeID()) {
+		if (CFEqual(value, CFSTR("VoiceGenderMale"))) {
+			entry->gender = kSynthVoiceGenderMale;
+		}
+		else if (CFEqual(value, CFSTR("VoiceGenderFemale"))) {
+			entry->gender = kSynthVoiceGenderFemale;
+		}
+		else {
+			entry->gender = kSynthVoiceGenderNeuter;
+		}
+	}
+	value = CFDictionaryGetValue(attributes, CFSTR("VoiceName"));
+	if (value && CFGetTypeID(value) == CFStringGetTypeID()) {
+		free((void *)entry->name);
+		entry->name = CopyUTF8String((CFStringRef)value);
+	}
+	value = CFDictionaryGetValue(attributes, CFSTR("VoiceDemoText"));
+	if (value && CFGetTypeID(value) == CFStringGetTypeID()) {
+		free((void *)entry->demoText);
+		entry->demoText = CopyUTF8String((CFStringRef)value);
+	}
+	value = CFDictionaryGetValue(attributes, CFSTR("VoiceLocaleIdentifier"));
+	if (value && CFGetTypeID(value) == CFStringGetTypeID()) {
+		entry->localeIdentifier = CopyUTF8String((CFStringRef)value);
+	}
+	value = CFDictionaryGetValue(attributes, CFSTR("VoiceSupportedCharacters"));
+	if (value && CFGetTypeID(value) == CFArrayGetTypeID()) {
+		entry->supportedCharacters = CopyRanges((CFArrayRef)value, &entry->supportedCharacterRangeCount);
+	}
+	value = CFDictionaryGetValue(attributes, CFSTR("VoiceIndividuallySpokenCharacters"));
+	if (value && CFGetTypeID(value) == CFArrayGetTypeID()) {
+		entry->individuallySpokenCharacters = CopyRanges((CFArrayRef)value, &entry->individuallySpokenCharacterRangeCount);
+	}
+}
+
+static SynthVoiceCharacterRange * CopyRanges(CFArrayRef rangeArray, uint32_t * outCount)
+{
+	CFIndex rangeCount = CFArrayGetCount(rangeArray);
+	SynthVoiceCharacterRange * ranges;
+	CFIndex rangeIndex;
+
+	*outCount = 0;
+	ranges = (SynthVoiceCharacterRange *)malloc((rangeCount ? rangeCount : 1) * sizeof(SynthVoiceCharacterRange));
+	if (ranges == NULL) {
+		return NULL;
+	}
+	for (rangeIndex = 0; rangeIndex < rangeCount; rangeIndex++) {
+		CFTypeRef range = CFArrayGetValueAtIndex(rangeArray, rangeIndex);
+		int32_t first, last;
+		if (CFGetTypeID(range) == CFDictionaryGetTypeID()
+			&& GetNumber((CFDictionaryRef)range, CFSTR("UnicodeCharBegin"), &first)
+			&& GetNumber((CFDictionaryRef)range, CFSTR("UnicodeCharEnd"), &last)) {
+			ranges[*outCount].first = (uint32_t)first;
+			ranges[*outCount].last = (uint32_t)last;
+			(*outCount)++;
+		}
+	}
+	return ranges;
+}
+
+static char * CopyUTF8String(CFStringRef string)
+{
+	CFIndex bufferSize = CFStringGetMaximumSizeForEncoding(CFStringGetLength(string), kCFStringEncodingUTF8) + 1;
+	char * buffer = (char *)malloc(bufferSize);
+
+	if (buffer && ! CFStringGetCString(string, buffer, bufferSize, kCFStringEncodingUTF8)) {
+		free(buffer);
+		buffer = NULL;
+	}
+	return buffer;
+}
+
+static Boolean GetNumber(CFDictionaryRef dictionary, CFStringRef key, int32_t * value)
+{
+	CFTypeRef number = CFDictionaryGetValue(dictionary, key);
+	return (number && CFGetTypeID(number) == CFNumberGetTypeID() && CFNumberGetValue((CFNumberRef)number, kCFNumberSInt32Type, value));
+}
+
+static void DisposeEntry(SynthVoiceEntry * entry)
+{
+	free((void *)entry->name);
+	free((void *)entry->identifier);
+	free((void *)entry->localeIdentifier);
+	free((void *)entry->demoText);
+	free((void *)entry->bundlePath);
+	free((void *)entry->supportedCharacters);
+	free((void *)entry->individuallySpokenCharacters);
+	memset(entry, 0, sizeof(SynthVoiceEntry));
+}
+
+static int CompareNames(const void * a, const void * b)
+{
+	return strcmp(*(char * const *)a, *(char * const *)b);
+}
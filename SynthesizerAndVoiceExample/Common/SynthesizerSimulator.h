@@ -47,13 +47,125 @@
 
 #include "SpeechEngine.h"
 
+// Channel properties specific to this engine.  Each key is a four-character code, so clients of the
+// buffer-based API can use it as a SetSpeechInfo/GetSpeechInfo selector as well.
+
+// CFNumber holding a SynthEnginePriority: kSynthEnginePriorityInteractive (the default) for speech someone is
+// listening to, kSynthEnginePriorityBulk for offline renders that should only use spare capacity.
+#define kSynthEnginePriorityProperty			CFSTR("prio")
+#define soSynthEnginePriority					'prio'
+
+// Read only.  CFDictionary of CFNumbers counting the channel's own deadline misses and the engine-wide job and miss counts.
+#define kSynthEngineDeadlineStatisticsProperty	CFSTR("dlms")
+#define kSynthEngineChannelDeadlineMisses		CFSTR("ChannelDeadlineMisses")
+#define kSynthEngineInteractiveJobs				CFSTR("InteractiveJobs")
+#define kSynthEngineInteractiveDeadlineMisses	CFSTR("InteractiveDeadlineMisses")
+#define kSynthEngineWorstInteractiveLateness	CFSTR("WorstInteractiveLateness")
+#define kSynthEngineBulkJobs					CFSTR("BulkJobs")
+#define kSynthEngineInteractiveLatenessHistogram	CFSTR("InteractiveLatenessHistogram")	// CFArray; see kSynthEngineLatenessBuckets.
+
+// CFNumber holding a SynthEngineEventQueue *.  While set, the channel posts its word, phoneme and done events to the
+// queue, tagged with the utterance's kSynthEngineUtteranceTagProperty, so they can be pulled instead of called back.
+#define kSynthEngineEventQueueProperty			CFSTR("evtq")
+#define soSynthEngineEventQueue					'evtq'
+
+// CFNumber copied into every event and completion of the utterances that are started after it's set.
+#define kSynthEngineUtteranceTagProperty		CFSTR("utag")
+#define soSynthEngineUtteranceTag				'utag'
+
+// CFNumber holding a SynthEngineCompletionProcPtr.  Called exactly once for every utterance, when it's finished
+// (status noErr) or when it's stopped or replaced before the end (status userCanceledErr).  Like every client callback,
+// it's made with none of the channel's locks held, so it may call back into the channel, though a call made from a
+// callback has its own callbacks made after that one returns.
+#define kSynthEngineCompletionCallBack			CFSTR("cmcb")
+#define soSynthEngineCompletionCallBack			'cmcb'
+
+// CFDictionary of counters of the phoneme cache shared by all channels.  Hits and misses count speak and
+// SECopyPhonemesFromText requests whose text analysis was or wasn't already cached.
+#define kSynthEnginePhonemeCacheStatisticsProperty	CFSTR("pcst")
+#define kSynthEnginePhonemeCacheHits			CFSTR("PhonemeCacheHits")
+#define kSynthEnginePhonemeCacheMisses			CFSTR("PhonemeCacheMisses")
+#define kSynthEnginePhonemeCacheEvictions		CFSTR("PhonemeCacheEvictions")
+#define kSynthEnginePhonemeCacheEntries			CFSTR("PhonemeCacheEntries")
+#define kSynthEnginePhonemeCacheBytes			CFSTR("PhonemeCacheBytes")
+
+// CFDictionary of counters of the rendered-audio cache shared by all channels, when it's turned on with the
+// SYNTH_ENGINE_AUDIO_CACHE_DIRECTORY environment variable.  Spills are utterances moved from memory to disk.
+#define kSynthEngineAudioCacheStatisticsProperty	CFSTR("acst")
+#define kSynthEngineAudioCacheMemoryHits		CFSTR("AudioCacheMemoryHits")
+#define kSynthEngineAudioCacheDiskHits			CFSTR("AudioCacheDiskHits")
+#define kSynthEngineAudioCacheMisses			CFSTR("AudioCacheMisses")
+#define kSynthEngineAudioCacheSpills			CFSTR("AudioCacheSpills")
+#define kSynthEngineAudioCacheEvictions			CFSTR("AudioCacheEvictions")
+#define kSynthEngineAudioCacheMemoryBytes		CFSTR("AudioCacheMemoryBytes")
+#define kSynthEngineAudioCacheDiskBytes			CFSTR("AudioCacheDiskBytes")
+
+// Read only.  CFNumber holding a SynthCharacterSet * compiled from the current voice's VoiceSupportedCharacters or
+// VoiceIndividuallySpokenCharacters when the voice was chosen, or no value if the voice doesn't declare them.  The
+// copy carries a reference to the set, which the caller gives up with SynthCharacterSetRelease.
+#define kSynthEngineSupportedCharactersProperty	CFSTR("spch")
+#define kSynthEngineIndividuallySpokenCharactersProperty	CFSTR("ispc")
+
+// Write only.  CFDictionary of an utterance to speak once the ones before it are done, joined to them without a gap: its
+// text under kSynthEngineQueuedText and, optionally, under kSynthEngineQueuedProperties a CFDictionary of channel properties
+// set as it starts, such as its own kSpeechRateProperty, kSpeechRefConProperty or kSynthEngineUtteranceTagProperty.  The
+// next utterance is rendered while the one before it is spoken.  Each completes on its own through kSynthEngineCompletionCallBack;
+// the speech-done callback comes once the queue has run dry.  An idle channel starts on the utterance right away, and
+// speaking text or stopping the channel throws away whatever is queued.
+#define kSynthEngineEnqueueUtteranceProperty	CFSTR("enqu")
+#define kSynthEngineQueuedText					CFSTR("QueuedText")
+#define kSynthEngineQueuedProperties			CFSTR("QueuedProperties")
+
+// Write only.  CFNumber holding the kSynthEngineUtteranceTagProperty of queued utterances to drop before they start.
+// Each completes with userCanceledErr.
+#define kSynthEngineCancelQueuedProperty		CFSTR("qcan")
+#define soSynthEngineCancelQueued				'qcan'
+
+// Write only.  Any value drops every utterance still waiting in the queue; the one being spoken carries on.
+#define kSynthEngineFlushQueueProperty			CFSTR("qfls")
+#define soSynthEngineFlushQueue					'qfls'
+
+// Read only.  CFNumber counting the utterances waiting in the queue, not counting the one being spoken.
+#define kSynthEngineQueueLengthProperty			CFSTR("qlen")
+#define soSynthEngineQueueLength				'qlen'
+
+// Write only.  CFString of text the channel expects to be asked to speak next.  It's rendered ahead at kSynthEnginePriorityBulk,
+// with the channel's settings as they are then, and the rendering is kept by the channel.  The next utterance the channel has
+// to render settles every speculation: if its text is one of them and nothing the rendering depends on has changed since, it
+// starts from the kept rendering; the rest are dropped.  A channel keeps up to kSynthEngineMaxSpeculations, dropping the oldest
+// for a new one.  Any value that isn't a string drops them all.
+#define kSynthEngineSpeculateTextProperty		CFSTR("spec")
+#define kSynthEngineMaxSpeculations				4
+
+// Read only.  CFDictionary of CFNumbers counting how the channel's speculations went.  A hit is an utterance that started from
+// one; a late hit matched one still being rendered, and waited for it to finish; a miss matched none of those outstanding.  Wasted
+// samples and seconds are the audio, and the time taken rendering it, of speculations that were dropped.
+#define kSynthEngineSpeculationStatisticsProperty	CFSTR("spst")
+#define kSynthEngineSpeculationHits				CFSTR("SpeculationHits")
+#define kSynthEngineSpeculationLateHits			CFSTR("SpeculationLateHits")
+#define kSynthEngineSpeculationMisses			CFSTR("SpeculationMisses")
+#define kSynthEngineSpeculationsDropped			CFSTR("SpeculationsDropped")
+#define kSynthEngineSpeculationWastedSamples	CFSTR("SpeculationWastedSamples")
+#define kSynthEngineSpeculationWastedSeconds	CFSTR("SpeculationWastedSeconds")
+
+// Environment variables that limit what the engine takes on, read when the first channel is opened.  Opening a channel
+// fails with synthOpenFailed once SYNTH_ENGINE_MAX_CHANNELS are open, or once the resident memory of the process the
+// engine is loaded into has reached SYNTH_ENGINE_MEMORY_BUDGET bytes.  Neither is limited if it isn't set.
+#define kSynthEngineMaxChannelsVariable			"SYNTH_ENGINE_MAX_CHANNELS"
+#define kSynthEngineMemoryBudgetVariable		"SYNTH_ENGINE_MEMORY_BUDGET"
+
+typedef void (*SynthEngineCompletionProcPtr)(SpeechChannel chan, SRefCon refCon, uint64_t utteranceTag, long status);
+
 SpeechChannelIdentifier SynthSimCreateChannel();
 long SynthSimDisposeChannel(SpeechChannelIdentifier chan);
-long SynthSimUseVoice(SpeechChannelIdentifier chan, VoiceSpec * voiceSpec);
+long SynthSimUseVoice(SpeechChannelIdentifier chan, VoiceSpec * voiceSpec, CFBundleRef voiceBundle);
 long SynthSimStartSpeaking(SpeechChannelIdentifier chan, CFStringRef string);
-long SynthSimStopSpeaking(SpeechChannelIdentifier chan);
-long SynthSimPauseSpeaking(SpeechChannelIdentifier chan);
+long SynthSimStartSpeakingBuffer(SpeechChannelIdentifier chan, const char * textBuf, long byteLength);
+long SynthSimStopSpeakingAt(SpeechChannelIdentifier chan, unsigned long whereToStop);
+long SynthSimPauseSpeakingAt(SpeechChannelIdentifier chan, unsigned long whereToPause);
 long SynthSimContinueSpeaking(SpeechChannelIdentifier chan);
+long SynthSimCopyPhonemesFromText(SpeechChannelIdentifier chan, CFStringRef text, CFStringRef * phonemes);
+long SynthSimUseSpeechDictionary(SpeechChannelIdentifier chan, CFDictionaryRef speechDictionary);
 long SynthSimSetProperty(SpeechChannelIdentifier chan, CFStringRef property, CFTypeRef object);
 long SynthSimCopyProperty(SpeechChannelIdentifier chan, CFStringRef property, CFTypeRef * object);
 long SynthSimSetSpeechInfo(SpeechChannelIdentifier chan, unsigned long selector, void* speechInfo);
@@ -47,247 +47,1979 @@
 
 #import <Cocoa/Cocoa.h>
 #import <ApplicationServices/ApplicationServices.h>
+#import <mach/mach.h>
+#import <pthread.h>
 #import "SynthesizerSimulator.h"
+#import "SynthBoundaryIndex.h"
+#import "SynthEngineStatus.h"
+#import "SynthEngineWorkers.h"
+#import "SynthEngineEvents.h"
+#import "SynthPhonemeCache.h"
+#import "SynthAudioCache.h"
+#import "SynthUnitInventory.h"
+#import "SynthCharacterSet.h"
+#import "SynthUtteranceRenderer.h"
+#import "SynthServerClient.h"
+#import "SynthArena.h"
+#import "SynthDictionary.h"
+#import "SynthTextNormalizer.h"
+#import "SynthOffsetMap.h"
 
-NSMutableArray * sChannels = NULL;
+// The simulated callbacks advance one character per tick, so that's the simulated speaking rate.
+#define kSynthSimCallbackInterval			0.1
+#define kSynthSimSamplesPerCharacter		((uint32_t)(kSynthEngineSampleRate * kSynthSimCallbackInterval))
+#define kSynthSimAudioFormat				'AIFF'
+
+// soWordCallBack has no CF name; SynthSimSetSpeechInfo keeps it under its selector like the others.
+#define kSynthSimWordCallBackProperty		CFSTR("wdcb")
+
+// Every API call checks its channel against this, so it's a set: with many channels open the check would otherwise dominate.
+// It compares pointers only, since a stale or bogus channel can't be sent a message, and holds a reference to each channel.
+// Calls come in on any thread, so it's only touched with sChannelsLock held.
+static CFMutableSetRef sChannels = NULL;
+static pthread_mutex_t sChannelsLock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long sMaxChannels = 0;
+static unsigned long long sMemoryBudget = 0;
 
 static Boolean ConvertCFStringToOSType(CFStringRef string, OSType * type);
 static CFStringRef CopyCFStringFromOSType(OSType type);
+static void PerformSimulatorJob(void * context);
+static SynthCharacterSet * CreateCharacterSetFromRanges(NSArray * rangeArray);
+static unsigned long long ResidentBytes(void);
+
+@class SynthesizerSimulator;
+
+static SynthesizerSimulator * RetainChannel(SpeechChannelIdentifier chan);
+
+// Kinds of work a channel schedules on the engine's workers.
+enum {
+	kSynthSimRenderJob		= 0,
+	kSynthSimBoundaryJob	= 1,
+	kSynthSimVoiceLoadJob	= 2,
+	kSynthSimPrerenderJob	= 3,
+	kSynthSimTextDoneJob	= 4,
+	kSynthSimSpeculateJob	= 5
+};
+
+// Where a voice switch is: requested and waiting for a worker, being loaded, or loaded and waiting for the
+// channel to be between utterances.
+enum {
+	kSynthSimNoPendingVoice		= 0,
+	kSynthSimVoiceQueued		= 1,
+	kSynthSimVoiceLoading		= 2,
+	kSynthSimVoiceLoaded		= 3
+};
+
+// What a voice brings to a channel besides its VoiceSpec.
+typedef struct SynthSimVoiceAssets {
+	SynthUnitInventory *	inventory;
+	SynthCharacterSet *		supportedCharacters;
+	SynthCharacterSet *		individuallySpokenCharacters;
+} SynthSimVoiceAssets;
+
+static void DisposeVoiceAssets(SynthSimVoiceAssets * assets);
+
+// What a rendering depends on besides the text.  Taken from the channel under its lock, so the rendering itself needn't
+// hold it.  The dictionary is a snapshot: an utterance is said with the dictionary it started with, whatever is published meanwhile.
+typedef struct SynthSimRenderSettings {
+	SynthUnitInventory *	inventory;				// Retained.
+	SynthDictionary *		dictionary;				// Retained.
+	uint64_t				dictionaryGeneration;
+	SynthAudioCacheKey		key;
+} SynthSimRenderSettings;
+
+static void ReleaseRenderSettings(SynthSimRenderSettings * settings);
+
+// An utterance waiting its turn on a channel.  The one at the head is rendered ahead, while the one before it is spoken.
+typedef struct SynthSimQueuedUtterance {
+	struct SynthSimQueuedUtterance *	next;
+	uint64_t				serial;
+	NSString *				text;
+	NSDictionary *			properties;				// Set on the channel as the utterance starts, if there are any.
+	uint64_t				tag;
+	long					refCon;
+	BOOL					isRendering;
+	SynthRenderedUtterance *	rendering;
+	SynthSimRenderSettings	renderingSettings;		// What rendering was made with; its inventory and dictionary aren't retained.
+	SynthOffsetMap *		offsetMap;				// For a buffer handed back by the text-done callback.
+} SynthSimQueuedUtterance;
+
+static void DisposeQueuedUtterance(SynthBlockPool * pool, SynthSimQueuedUtterance * item);
+
+// Where a speculation still being rendered hands its rendering to an utterance that started waiting for it.  It's on
+// the stack of the worker rendering, which doesn't return before it has taken the channel's lock again, so it lasts
+// as long as an utterance holding that lock might look at it.  Guarded by the channel's _speculationCondition.
+typedef struct SynthSimSpeculationHandoff {
+	BOOL					isClaimed;
+	BOOL					isDone;
+	SynthRenderedUtterance *	rendering;
+} SynthSimSpeculationHandoff;
+
+// Text rendered ahead on the client's guess that it will be spoken next.  Kept until the next utterance settles it.
+typedef struct SynthSimSpeculation {
+	struct SynthSimSpeculation *	next;
+	uint64_t				serial;
+	NSString *				text;
+	BOOL					isRendering;
+	SynthSimSpeculationHandoff *	handoff;		// While it's being rendered.
+	SynthRenderedUtterance *	rendering;
+	SynthSimRenderSettings	renderingSettings;		// What rendering is made with; its inventory and dictionary aren't retained.
+	double					renderSeconds;
+} SynthSimSpeculation;
+
+static void DisposeSpeculation(SynthSimSpeculation * speculation);
+static long CreateStringOfBuffer(const char * bytes, long byteLength, Boolean copyBytes, SynthOffsetMap ** map, NSString ** string);
+
+// A job scheduled on the engine's workers for one channel.  The job retains the simulator, and carries the
+// generation that was current when it was scheduled, so a job made stale by a stop, pause or new utterance does nothing.
+// Jobs come from the channel's pool, since one is scheduled for every event of every utterance.
+typedef struct SynthSimJob {
+	SynthesizerSimulator *	simulator;
+	SynthBlockPool *		pool;
+	uint64_t				generation;
+	int						kind;
+	double					dueTime;
+} SynthSimJob;
+
+// A client callback the channel owes.  Callbacks are collected under the channel's lock and made, in the order they were
+// owed, once it has been let go, so a client that takes a lock of its own in a callback can't deadlock against another of
+// its threads calling into the channel.  Those for an event are dropped if speech is stopped or paused before they're made.
+enum {
+	kSynthSimSpeechDoneCallBack		= 0,
+	kSynthSimCompletionCallBack		= 1,
+	kSynthSimWordCFCallBack			= 2,
+	kSynthSimBufferWordCallBack		= 3,
+	kSynthSimPhonemeCallBack		= 4,
+	kSynthSimErrorCFCallBack		= 5
+};
+
+typedef struct SynthSimCallBack {
+	int						kind;
+	long					procPtr;
+	long					refCon;
+	BOOL					isEvent;
+	uint64_t				generation;				// The channel's _callBackGeneration, for an event.
+	uint64_t				tag;
+	long					arguments[2];
+	CFTypeRef				object;					// Retained: the spoken string, or the error.
+} SynthSimCallBack;
+
+static void MakeCallBack(SpeechChannel chan, const SynthSimCallBack * callBack);
 
 @interface SynthesizerSimulator : NSObject {
 
 	NSSound *				_sound;
+	NSData *				_soundData;
 	NSString *				_spokenString;
+	SynthOffsetMap *		_offsetMap;				// Between the bytes of a buffer being spoken and _spokenString.
 	VoiceSpec				_voiceSpec;
 	NSMutableDictionary *	_properties;
-	NSTimer *				_wordCallbackTimer;
-	NSTimer *				_phonemeCallbackTimer;
 	long					_phonemeCallbackCharIndex;
-	long					_wordCallbackCharIndex;
+	SynthBoundaryIndex		_boundaryIndex;
+	SynthBoundarySchedule	_boundarySchedule;
+	SynthEngineStatus		_status;
+	SynthEngineWorkers *	_workers;
+	NSRecursiveLock *		_lock;
+	SynthEnginePriority		_priority;
+	uint64_t				_deadlineMisses;
+	uint64_t				_renderGeneration;
+	uint64_t				_boundaryGeneration;
+	uint64_t				_soundSamples;
+	uint64_t				_utteranceSamples;
+	double					_utteranceStartTime;
+	double					_pauseStartTime;
+	BOOL					_paused;
+	uint64_t				_utteranceTag;
+	uint64_t				_utteranceSerial;
+	BOOL					_utteranceActive;
+	SynthRenderedUtterance *	_utterance;
+	uint32_t				_eventIndex;
+
+	// The channel's pronunciation dictionary, which can be replaced at any time without the lock.
+	SynthDictionarySlot		_dictionarySlot;
+	SynthSimVoiceAssets		_voiceAssets;
+
+	// A voice switch in progress, guarded by _voiceCondition rather than _lock, so a channel waiting for the load
+	// never holds up the worker doing it.
+	NSCondition *			_voiceCondition;
+	int						_pendingVoiceState;
+	uint64_t				_pendingVoiceGeneration;
+	VoiceSpec				_pendingVoiceSpec;
+	CFBundleRef				_pendingVoiceBundle;
+	SynthSimVoiceAssets		_pendingVoiceAssets;
+
+	// In server mode, the connection to the synthesis server, which holds the voice's inventory and renders for the channel.
+	SynthServerChannel *	_remote;
+
+	// Utterances queued to follow the one being spoken.
+	SynthSimQueuedUtterance *	_queueHead;
+	SynthSimQueuedUtterance *	_queueTail;
+	uint32_t				_queueLength;
+	uint64_t				_queueSerial;
+
+	// Renderings of text the client expects to speak, newest first, and how they've turned out.
+	SynthSimSpeculation *	_speculations;
+	NSCondition *			_speculationCondition;
+	uint32_t				_speculationCount;
+	uint64_t				_speculationSerial;
+	uint64_t				_speculationHits;
+	uint64_t				_speculationLateHits;
+	uint64_t				_speculationMisses;
+	uint64_t				_speculationsDropped;
+	uint64_t				_speculationWastedSamples;
+	double					_speculationWastedSeconds;
+
+	// Scratch memory and records for the speak path, so its own bookkeeping doesn't go to malloc once the channel has
+	// warmed up; the NSSound each utterance plays, and the objects handed to the client, are still made every time.
+	// _arena is used with _lock held and reset as each utterance starts; _prerenderArena by the one prerender that has it.
+	SynthArena *			_arena;
+	SynthArena *			_prerenderArena;
+	BOOL					_prerenderArenaInUse;
+	SynthBlockPool *		_jobPool;
+	SynthBlockPool *		_queuePool;				// Taken from with _lock held.
+
+	// Callbacks owed to the client, a ring that grows as needed and is then reused, and whether a thread is making them.
+	SynthSimCallBack *		_callBacks;
+	uint32_t				_callBackCapacity;
+	uint32_t				_callBackHead;
+	uint32_t				_callBackCount;
+	uint64_t				_callBackGeneration;
+	BOOL					_makingCallBacks;
 
 }
 
 - (id)init;
-- (void)setVoice:(VoiceSpec *)voiceSpec;
+- (void)setVoice:(VoiceSpec *)voiceSpec bundle:(CFBundleRef)voiceBundle;
 - (void)getVoice:(VoiceSpec *)voiceSpec;
+- (void)loadPendingVoice;
+- (void)waitForPendingVoice;
+- (void)applyPendingVoice;
 - (void)startSpeaking:(NSString *)string;
+- (long)startSpeakingBuffer:(const char *)bytes length:(long)byteLength;
+- (void)releaseSpokenString;
+- (long)textLeftAfter:(long)characterOffset;
+- (void)beginUtterance:(NSString *)string rendering:(SynthRenderedUtterance *)rendering atTime:(double)startTime;
+- (void)requestNextBuffer:(uint64_t)serial;
+- (long)enqueueUtterance:(NSDictionary *)description;
+- (void)startQueuedUtteranceAtTime:(double)startTime;
+- (void)prerenderQueuedUtterance:(uint64_t)serial;
+- (void)removeQueuedUtterancesWithTag:(NSNumber *)tag;
+- (void)speculateText:(NSString *)text;
+- (void)renderSpeculation:(uint64_t)serial;
+- (SynthSimSpeculation **)linkToSpeculation:(uint64_t)serial;
+- (SynthRenderedUtterance *)takeSpeculationOfText:(NSString *)text settings:(const SynthSimRenderSettings *)settings;
+- (void)dropSpeculation:(SynthSimSpeculation *)speculation;
+- (void)dropSpeculations;
 - (void)stopSpeaking;
+- (void)stopSpeakingAt:(unsigned long)whereToStop;
 - (void)pauseSpeaking;
+- (void)pauseSpeakingAt:(unsigned long)whereToPause;
 - (void)continueSpeaking;
+- (long)copyAnalysisOfText:(NSString *)text settings:(const SynthSimRenderSettings *)settings arena:(SynthArena *)arena normalizedText:(SynthNormalizedText *)normalizedText analysis:(SynthTextAnalysis **)analysis;
+- (void)getRenderSettings:(SynthSimRenderSettings *)settings forText:(NSString *)text properties:(NSDictionary *)properties;
+- (long)copyRenderedUtteranceOfText:(NSString *)text settings:(const SynthSimRenderSettings *)settings arena:(SynthArena *)arena utterance:(SynthRenderedUtterance **)utterance;
+- (void)layOutBoundaries;
+- (void)releaseUtterance;
+- (long)copyPhonemes:(CFStringRef *)phonemes fromText:(NSString *)text;
+- (long)addDictionaryEntries:(NSDictionary *)speechDictionary;
+- (uint64_t)currentSamplePosition;
+- (uint64_t)nextEventPosition;
+- (void)scheduleJob:(int)kind generation:(uint64_t)generation atTime:(double)dueTime;
+- (void)scheduleJob:(int)kind generation:(uint64_t)generation atTime:(double)dueTime priority:(SynthEnginePriority)priority;
+- (void)performJob:(int)kind generation:(uint64_t)generation dueTime:(double)dueTime;
+- (void)performScheduledBoundaryAction;
+- (void)renderNextEvent;
+- (void)finishSpeaking;
+- (void)completeUtterance:(long)status;
+- (void)postCompletion:(long)status tag:(uint64_t)tag refCon:(long)refCon;
+- (void)postEvent:(uint32_t)kind characterOffset:(long)characterOffset length:(long)length code:(long)code tag:(uint64_t)tag;
+- (void)oweCallBack:(const SynthSimCallBack *)callBack;
+- (void)makeOwedCallBacks;
 - (void)setObject:(id)object forProperty:(NSString *)property;
 - (id)copyProperty:(NSString *)property;
+- (void)getStatus:(SynthEngineStatusSnapshot *)snapshot;
 - (void)performSimulatedCallbacks;
 
 @end
 
 
-@implementation SynthesizerSimulator
+@implementation SynthesizerSimulator
+
+- (id)init
+{
+	if ((self = [super init])) {
+		
+		_soundData = [[NSData alloc] initWithContentsOfFile:[[NSBundle bundleForClass:[SynthesizerSimulator class]] pathForResource:[NSString stringWithFormat:@"Sound0"] ofType:@"aiff"]];
+		_properties = [NSMutableDictionary new];			
+		_lock = [NSRecursiveLock new];
+		_voiceCondition = [NSCondition new];
+		_speculationCondition = [NSCondition new];
+		_workers = SynthEngineWorkersShared();
+		SynthBoundaryIndexInit(&_boundaryIndex);
+		SynthEngineStatusInit(&_status);
+		SynthDictionarySlotInit(&_dictionarySlot);
+		
+		[_properties setObject:(NSString *)kSpeechModeText forKey:(NSString *)kSpeechInputModeProperty];
+		[_properties setObject:(NSString *)kSpeechModeNormal forKey:(NSString *)kSpeechCharacterModeProperty];
+		[_properties setObject:(NSString *)kSpeechModeNormal forKey:(NSString *)kSpeechNumberModeProperty];
+		[_properties setObject:[NSNumber numberWithFloat:180.0] forKey:(NSString *)kSpeechRateProperty];
+		[_properties setObject:[NSNumber numberWithFloat:100.0] forKey:(NSString *)kSpeechPitchBaseProperty];
+		[_properties setObject:[NSNumber numberWithFloat:30.0] forKey:(NSString *)kSpeechPitchModProperty];
+		[_properties setObject:[NSNumber numberWithFloat:1.0] forKey:(NSString *)kSpeechVolumeProperty];
+		[_properties setObject:[NSNumber numberWithInt:kSynthEnginePriorityInteractive] forKey:(NSString *)kSynthEnginePriorityProperty];
+
+		if (SynthArenaCreate(0, &_arena) != noErr || SynthArenaCreate(0, &_prerenderArena) != noErr || SynthBlockPoolCreate(sizeof(SynthSimJob), 32, &_jobPool) != noErr
+				|| SynthBlockPoolCreate(sizeof(SynthSimQueuedUtterance), 8, &_queuePool) != noErr) {
+			[self release];
+			self = NULL;
+		}
+		else if (_workers == NULL || _soundData == NULL || _voiceCondition == NULL || _speculationCondition == NULL) {
+			[self release];
+			self = NULL;
+		}
+
+		// A server that can't be reached leaves the channel rendering for itself.
+		else if (SynthServerGetSocketPath() && SynthServerChannelCreate(SynthServerGetSocketPath(), &_remote) != noErr) {
+			_remote = NULL;
+		}
+	}
+	return self;
+}
+
+- (void)dealloc;
+{
+	[self releaseUtterance];
+	[self releaseSpokenString];
+	[_soundData release];
+	[_properties release];
+	[_lock release];
+	[_voiceCondition release];
+	[_speculationCondition release];
+	if (_pendingVoiceBundle) {
+		CFRelease(_pendingVoiceBundle);
+	}
+	DisposeVoiceAssets(&_pendingVoiceAssets);
+	DisposeVoiceAssets(&_voiceAssets);
+	SynthBoundaryIndexDispose(&_boundaryIndex);
+	SynthServerChannelDispose(_remote);
+	while (_queueHead) {
+		SynthSimQueuedUtterance * item = _queueHead;
+		_queueHead = item->next;
+		DisposeQueuedUtterance(_queuePool, item);
+	}
+	while (_speculations) {
+		SynthSimSpeculation * speculation = _speculations;
+		_speculations = speculation->next;
+		DisposeSpeculation(speculation);
+	}
+	while (_callBackCount) {
+		if (_callBacks[_callBackHead].object) {
+			CFRelease(_callBacks[_callBackHead].object);
+		}
+		_callBackHead = (_callBackHead + 1) % _callBackCapacity;
+		_callBackCount--;
+	}
+	free(_callBacks);
+
+	// Every job gives its record back before it lets go of the channel, so by now they're all in the pool.
+	SynthBlockPoolDispose(_jobPool);
+	SynthBlockPoolDispose(_queuePool);
+	SynthArenaDispose(_prerenderArena);
+	SynthArenaDispose(_arena);
+	SynthDictionarySlotDispose(&_dictionarySlot);
+	
+	[super dealloc];
+}
+
+- (void)setVoice:(VoiceSpec *)voiceSpec bundle:(CFBundleRef)voiceBundle
+{
+	uint64_t generation;
+
+	// Switching voices keeps the channel, its properties and its callbacks.  The voice is loaded by a worker and
+	// takes over at the next utterance, or right away if the channel is idle by then.
+	[_voiceCondition lock];
+	if (_pendingVoiceBundle) {
+		CFRelease(_pendingVoiceBundle);
+	}
+	DisposeVoiceAssets(&_pendingVoiceAssets);
+	_pendingVoiceSpec = *voiceSpec;
+	_pendingVoiceBundle = (voiceBundle) ? (CFBundleRef)CFRetain(voiceBundle) : NULL;
+	_pendingVoiceState = kSynthSimVoiceQueued;
+	generation = ++_pendingVoiceGeneration;
+	[_voiceCondition unlock];
+
+	[_lock lock];
+	[self scheduleJob:kSynthSimVoiceLoadJob generation:generation atTime:SynthEngineWorkersCurrentTime(_workers)];
+	[_lock unlock];
+}
+
+- (void)getVoice:(VoiceSpec *)voiceSpec
+{
+	// A voice that's been asked for is the current voice as far as the client is concerned.
+	[_voiceCondition lock];
+	if (_pendingVoiceState != kSynthSimNoPendingVoice) {
+		*voiceSpec = _pendingVoiceSpec;
+		[_voiceCondition unlock];
+		return;
+	}
+	[_voiceCondition unlock];
+
+	[_lock lock];
+	*voiceSpec = _voiceSpec;
+	[_lock unlock];
+}
+
+- (void)loadPendingVoice
+{
+	SynthSimVoiceAssets assets = { NULL, NULL, NULL };
+	CFBundleRef voiceBundle;
+	VoiceSpec voiceSpec;
+	uint64_t generation;
+
+	// Whoever gets to a queued voice first loads it: the worker, or a channel that can't wait any longer.
+	[_voiceCondition lock];
+	if (_pendingVoiceState != kSynthSimVoiceQueued) {
+		[_voiceCondition unlock];
+		return;
+	}
+	_pendingVoiceState = kSynthSimVoiceLoading;
+	generation = _pendingVoiceGeneration;
+	voiceSpec = _pendingVoiceSpec;
+	voiceBundle = (_pendingVoiceBundle) ? (CFBundleRef)CFRetain(_pendingVoiceBundle) : NULL;
+	[_voiceCondition unlock];
+
+	// A voice that carries a unit inventory is spoken by concatenating its units; any other plays the example sound.
+	// In server mode the server opens the inventory, once for every channel that speaks with it.
+	char path[PATH_MAX];
+	Boolean hasInventory = false;
+	if (voiceBundle) {
+		CFURLRef inventoryURL = CFBundleCopyResourceURL(voiceBundle, CFSTR(kSynthUnitInventoryResourceName), CFSTR(kSynthUnitInventoryResourceType), NULL);
+		if (inventoryURL) {
+			hasInventory = CFURLGetFileSystemRepresentation(inventoryURL, true, (UInt8 *)path, sizeof(path));
+			if (hasInventory && ! _remote && SynthUnitInventoryOpen(path, &assets.inventory) == noErr) {
+				SynthUnitInventoryPrefetch(assets.inventory);
+			}
+			CFRelease(inventoryURL);
+		}
+
+		// Compile the character ranges once here, so asking whether the voice handles a character is a bitmap lookup.
+		NSDictionary * voiceAttributes = (NSDictionary *)CFBundleGetValueForInfoDictionaryKey(voiceBundle, CFSTR("VoiceAttributes"));
+		if ([voiceAttributes isKindOfClass:[NSDictionary class]]) {
+			assets.supportedCharacters = CreateCharacterSetFromRanges([voiceAttributes objectForKey:@"VoiceSupportedCharacters"]);
+			assets.individuallySpokenCharacters = CreateCharacterSetFromRanges([voiceAttributes objectForKey:@"VoiceIndividuallySpokenCharacters"]);
+		}
+		CFRelease(voiceBundle);
+	}
+	if (_remote) {
+		SynthServerChannelUseVoice(_remote, voiceSpec.creator, voiceSpec.id, (hasInventory) ? path : NULL);
+	}
+
+	// Another voice may have been asked for meanwhile; it has its own load queued.
+	[_voiceCondition lock];
+	if (generation == _pendingVoiceGeneration) {
+		_pendingVoiceAssets = assets;
+		_pendingVoiceState = kSynthSimVoiceLoaded;
+	}
+	else {
+		DisposeVoiceAssets(&assets);
+	}
+	[_voiceCondition broadcast];
+	[_voiceCondition unlock];
+}
+
+- (void)waitForPendingVoice
+{
+	// Load the voice here if no worker has started on it yet, rather than wait behind other channels' jobs.
+	[self loadPendingVoice];
+
+	[_voiceCondition lock];
+	while (_pendingVoiceState == kSynthSimVoiceLoading) {
+		[_voiceCondition wait];
+	}
+	[_voiceCondition unlock];
+}
+
+- (void)applyPendingVoice
+{
+	// Called with _lock held, between utterances.
+	[_voiceCondition lock];
+	if (_pendingVoiceState == kSynthSimVoiceLoaded) {
+		DisposeVoiceAssets(&_voiceAssets);
+		_voiceAssets = _pendingVoiceAssets;
+		memset(&_pendingVoiceAssets, 0, sizeof(_pendingVoiceAssets));
+		_voiceSpec = _pendingVoiceSpec;
+		if (_pendingVoiceBundle) {
+			CFRelease(_pendingVoiceBundle);
+			_pendingVoiceBundle = NULL;
+		}
+		_pendingVoiceState = kSynthSimNoPendingVoice;
+	}
+	[_voiceCondition unlock];
+}
+
+- (void)startSpeaking:(NSString *)string;
+{
+	// A voice switch asked for before this utterance applies to it.
+	[self waitForPendingVoice];
+
+	[_lock lock];
+	if (! [_properties objectForKey:(NSString *)kSpeechOutputToFileURLProperty]) {
+
+		// Starting a new utterance abandons whatever the channel was saying, and whatever it had queued.
+		if (_spokenString || _paused || _queueHead) {
+			[self stopSpeaking];
+		}
+		[self applyPendingVoice];
+		[self beginUtterance:string rendering:NULL atTime:SynthEngineWorkersCurrentTime(_workers)];
+	}
+	[_lock unlock];
+}
+
+- (long)startSpeakingBuffer:(const char *)bytes length:(long)byteLength
+{
+	SynthOffsetMap * map = NULL;
+	NSString * string = nil;
+	long error;
+
+	[self waitForPendingVoice];
+	[_lock lock];
+	if (! [_properties objectForKey:(NSString *)kSpeechOutputToFileURLProperty]) {
+
+		// The client keeps the buffer until the channel is done speaking it, so the string is made over the buffer rather
+		// than from a copy, and the text is read from it by the same front end as any other.  A client with a text-done
+		// callback may reuse the buffer once that's called, though, so then the string has to have its own copy.
+		error = CreateStringOfBuffer(bytes, byteLength, [_properties objectForKey:(NSString *)kSpeechTextDoneCallBack] != nil, &map, &string);
+		if (error == noErr) {
+			if (_spokenString || _paused || _queueHead) {
+				[self stopSpeaking];
+			}
+			[self applyPendingVoice];
+			_offsetMap = map;
+			map = NULL;
+			[self beginUtterance:string rendering:NULL atTime:SynthEngineWorkersCurrentTime(_workers)];
+		}
+	}
+	else {
+		error = noErr;
+	}
+	[_lock unlock];
+	SynthOffsetMapDispose(map);
+	[string release];
+	return error;
+}
+
+- (void)releaseSpokenString
+{
+	[_spokenString release];
+	_spokenString = NULL;
+	SynthOffsetMapDispose(_offsetMap);
+	_offsetMap = NULL;
+}
+
+- (long)textLeftAfter:(long)characterOffset
+{
+	// In bytes for a buffer, as SpeechStatusInfo's inputBytesLeft has it.
+	if (_offsetMap) {
+		return _offsetMap->byteLength - SynthOffsetMapByteOffset(_offsetMap, (uint32_t)characterOffset);
+	}
+	return [_spokenString length] - characterOffset;
+}
+
+- (void)beginUtterance:(NSString *)string rendering:(SynthRenderedUtterance *)rendering atTime:(double)startTime
+{
+	// Called with _lock held, on an idle channel.  Takes over the reference to rendering, if there is one.
+	// We're simulating word and phoneme callbacks by having the engine's workers replay the events recorded in the
+	// rendered utterance as the simulated speaking reaches them.  An utterance rendered before comes from the audio cache.
+	SynthArenaReset(_arena);
+	_spokenString = [string retain];
+	_utteranceSerial++;
+	_phonemeCallbackCharIndex = 0;
+	_eventIndex = 0;
+	if (rendering == NULL) {
+		SynthSimRenderSettings settings;
+		[self getRenderSettings:&settings forText:_spokenString properties:_properties];
+		rendering = [self takeSpeculationOfText:_spokenString settings:&settings];
+		if (rendering == NULL && [self copyRenderedUtteranceOfText:_spokenString settings:&settings arena:_arena utterance:&rendering] != noErr) {
+			rendering = NULL;
+		}
+		ReleaseRenderSettings(&settings);
+	}
+	_utterance = rendering;
+	if (_utterance) {
+	
+		// Play straight from the utterance's audio, which may be a mapped cache file.
+		_sound = [[NSSound alloc] initWithData:[NSData dataWithBytesNoCopy:(void *)_utterance->audio length:_utterance->audioBytes freeWhenDone:NO]];
+	}
+	_soundSamples = (_sound) ? SynthEngineSecondsToSamples([_sound duration]) : 0;
+
+	// Lay out the word and sentence boundaries once, so stopping or pausing at one never has to look at the text again.
+	[self layOutBoundaries];
+	_boundarySchedule.isPending = false;
+	_paused = NO;
+	_utteranceTag = [[_properties objectForKey:(NSString *)kSynthEngineUtteranceTagProperty] unsignedLongLongValue];
+	_utteranceActive = YES;
+
+	// The utterance lasts until both the text and the sound have been played.
+	_utteranceSamples = (_boundaryIndex.totalSamples > _soundSamples) ? _boundaryIndex.totalSamples : _soundSamples;
+	_utteranceStartTime = startTime;
+
+	// Do our simluated speaking by playing an audio file, which is static and has no relationship to the given text.
+	// A queued utterance starts on the timeline where the one before it ended, so if the worker got here late the
+	// sound skips what it missed rather than pushing everything after it back.
+	// On a virtual clock nothing is played: time only passes when the test harness says so, and the sound would run on the wall clock.
+	double now = SynthEngineWorkersCurrentTime(_workers);
+	[_sound setCurrentTime:(now > startTime) ? now - startTime : 0.0];
+	if (! SynthEngineWorkersIsVirtual(_workers)) {
+		[_sound play];
+	}
+	SynthEngineStatusPublishProgress(&_status, 0, [self textLeftAfter:0], 0, 0);
+	SynthEngineStatusPublishState(&_status, true, false);
+
+	[self scheduleJob:kSynthSimRenderJob generation:++_renderGeneration atTime:_utteranceStartTime];
+
+	// A buffer has been taken in as a whole by now, so a client streaming its text is asked for the next one while this
+	// one is still being spoken.  That's left to a worker, so the callback never runs inside the client's SpeakText.
+	if (_offsetMap && [_properties objectForKey:(NSString *)kSpeechTextDoneCallBack]) {
+		[self scheduleJob:kSynthSimTextDoneJob generation:_utteranceSerial atTime:SynthEngineWorkersCurrentTime(_workers)];
+	}
+}
+
+- (void)requestNextBuffer:(uint64_t)serial
+{
+	// Called without _lock, while the buffer the text-done callback is about is still being spoken.  Another buffer
+	// handed back goes at the front of the queue, so it's rendered ahead and follows this one without a gap.
+	SpeechTextDoneProcPtr callBackProcPtr;
+	long refCon;
+	const void * nextBuf = NULL;
+	unsigned long byteLen = 0;
+	SInt32 controlFlags = 0;
+	SynthOffsetMap * map = NULL;
+	NSString * text = nil;
+	SynthSimQueuedUtterance * item;
+
+	[_lock lock];
+	callBackProcPtr = (SpeechTextDoneProcPtr)[[_properties objectForKey:(NSString *)kSpeechTextDoneCallBack] longValue];
+	refCon = [[_properties objectForKey:(NSString *)kSpeechRefConProperty] longValue];
+	if (serial != _utteranceSerial || ! _spokenString) {
+		callBackProcPtr = NULL;
+	}
+	[_lock unlock];
+
+	if (callBackProcPtr == NULL) {
+		return;
+	}
+	(*callBackProcPtr)((SpeechChannel)self, refCon, &nextBuf, &byteLen, &controlFlags);
+
+	// The callback may have stopped speech, or started something else, in the meantime.
+	if (nextBuf == NULL || byteLen == 0 || byteLen > INT32_MAX) {
+		return;
+	}
+	if (CreateStringOfBuffer((const char *)nextBuf, (long)byteLen, true, &map, &text) != noErr) {
+		return;
+	}
+
+	[_lock lock];
+	item = (serial == _utteranceSerial && _spokenString) ? (SynthSimQueuedUtterance *)SynthBlockPoolGet(_queuePool) : NULL;
+	if (item == NULL) {
+		[_lock unlock];
+		SynthOffsetMapDispose(map);
+		[text release];
+		return;
+	}
+	memset(item, 0, sizeof(SynthSimQueuedUtterance));
+	item->text = text;
+	item->offsetMap = map;
+	item->tag = _utteranceTag;
+	item->refCon = refCon;
+	item->serial = ++_queueSerial;
+	item->next = _queueHead;
+	_queueHead = item;
+	if (_queueTail == NULL) {
+		_queueTail = item;
+	}
+	_queueLength++;
+	[self scheduleJob:kSynthSimPrerenderJob generation:item->serial atTime:SynthEngineWorkersCurrentTime(_workers)];
+	[_lock unlock];
+}
+
+- (long)enqueueUtterance:(NSDictionary *)description
+{
+	NSString * text = [description isKindOfClass:[NSDictionary class]] ? [description objectForKey:(NSString *)kSynthEngineQueuedText] : nil;
+	NSDictionary * properties = [description isKindOfClass:[NSDictionary class]] ? [description objectForKey:(NSString *)kSynthEngineQueuedProperties] : nil;
+	SynthSimQueuedUtterance * item;
+
+	if (! [text isKindOfClass:[NSString class]] || (properties && ! [properties isKindOfClass:[NSDictionary class]])) {
+		return paramErr;
+	}
+
+	// An idle channel starts on it right away, which is when a voice switch gets to apply.
+	[self waitForPendingVoice];
+
+	// Records come from the channel's pool, so a client keeping the queue topped up doesn't go to malloc for each one.
+	[_lock lock];
+	item = (SynthSimQueuedUtterance *)SynthBlockPoolGet(_queuePool);
+	if (item == NULL) {
+		[_lock unlock];
+		return memFullErr;
+	}
+	memset(item, 0, sizeof(SynthSimQueuedUtterance));
+	item->text = [text copy];
+	item->properties = [properties copy];
+
+	// The tag and refCon it will complete with, whether it's spoken or dropped.
+	id tag = [item->properties objectForKey:(NSString *)kSynthEngineUtteranceTagProperty];
+	id refCon = [item->properties objectForKey:(NSString *)kSpeechRefConProperty];
+	item->tag = [(tag) ? tag : [_properties objectForKey:(NSString *)kSynthEngineUtteranceTagProperty] unsignedLongLongValue];
+	item->refCon = [(refCon) ? refCon : [_properties objectForKey:(NSString *)kSpeechRefConProperty] longValue];
+	item->serial = ++_queueSerial;
+	if (_queueTail) {
+		_queueTail->next = item;
+	}
+	else {
+		_queueHead = item;
+	}
+	_queueTail = item;
+	_queueLength++;
+
+	if (! _spokenString && ! _paused) {
+		[self applyPendingVoice];
+		[self startQueuedUtteranceAtTime:SynthEngineWorkersCurrentTime(_workers)];
+	}
+	else if (_queueHead == item) {
+		[self scheduleJob:kSynthSimPrerenderJob generation:item->serial atTime:SynthEngineWorkersCurrentTime(_workers)];
+	}
+	[_lock unlock];
+	return noErr;
+}
+
+- (void)startQueuedUtteranceAtTime:(double)startTime
+{
+	// Called with _lock held, on an idle channel with something queued.
+	SynthSimQueuedUtterance * item = _queueHead;
+	SynthRenderedUtterance * rendering;
+	NSEnumerator * keys;
+	NSString * key;
+
+	_queueHead = item->next;
+	if (_queueHead == NULL) {
+		_queueTail = NULL;
+	}
+	_queueLength--;
+
+	// Its properties apply from here on, just as if they'd been set between utterances.
+	keys = [item->properties keyEnumerator];
+	while ((key = [keys nextObject])) {
+		[self setObject:[item->properties objectForKey:key] forProperty:key];
+	}
+
+	// The rendering made ahead is only good if nothing it depends on, like the voice or the dictionary, has changed since.
+	rendering = item->rendering;
+	item->rendering = NULL;
+	if (rendering) {
+		SynthSimRenderSettings settings;
+		[self getRenderSettings:&settings forText:item->text properties:_properties];
+		if (settings.dictionaryGeneration != item->renderingSettings.dictionaryGeneration || memcmp(&settings.key, &item->renderingSettings.key, sizeof(SynthAudioCacheKey)) != 0) {
+			SynthRenderedUtteranceRelease(rendering);
+			rendering = NULL;
+		}
+		ReleaseRenderSettings(&settings);
+	}
+	_offsetMap = item->offsetMap;
+	item->offsetMap = NULL;
+	[self beginUtterance:item->text rendering:rendering atTime:startTime];
+	DisposeQueuedUtterance(_queuePool, item);
+
+	if (_queueHead) {
+		[self scheduleJob:kSynthSimPrerenderJob generation:_queueHead->serial atTime:SynthEngineWorkersCurrentTime(_workers)];
+	}
+}
+
+- (void)prerenderQueuedUtterance:(uint64_t)serial
+{
+	SynthSimRenderSettings settings;
+	SynthRenderedUtterance * rendering = NULL;
+	NSMutableDictionary * properties;
+	NSString * text;
+	SynthArena * arena = NULL;
+	long error;
+
+	[_lock lock];
+	if (_queueHead == NULL || _queueHead->serial != serial || _queueHead->isRendering || _queueHead->rendering) {
+		[_lock unlock];
+		return;
+	}
+	_queueHead->isRendering = YES;
+	text = [_queueHead->text retain];
+	properties = [_properties mutableCopy];
+	if (_queueHead->properties) {
+		[properties addEntriesFromDictionary:_queueHead->properties];
+	}
+	[self getRenderSettings:&settings forText:text properties:properties];
+	[properties release];
+
+	// The head can start while it's being rendered, letting the next one's prerender begin before this one ends,
+	// so the second of them makes do with malloc.
+	if (! _prerenderArenaInUse) {
+		_prerenderArenaInUse = YES;
+		arena = _prerenderArena;
+		SynthArenaReset(arena);
+	}
+	[_lock unlock];
+
+	// Rendered without the lock, so the utterance being spoken keeps its timing meanwhile.
+	error = [self copyRenderedUtteranceOfText:text settings:&settings arena:arena utterance:&rendering];
+
+	// The utterance may have started or been dropped meanwhile, which leaves the rendering unused.
+	[_lock lock];
+	if (arena) {
+		_prerenderArenaInUse = NO;
+	}
+	if (_queueHead && _queueHead->serial == serial) {
+		_queueHead->isRendering = NO;
+		if (error == noErr) {
+			_queueHead->rendering = rendering;
+			_queueHead->renderingSettings = settings;
+			rendering = NULL;
+		}
+	}
+	[_lock unlock];
+
+	SynthRenderedUtteranceRelease(rendering);
+	ReleaseRenderSettings(&settings);
+	[text release];
+}
+
+- (void)removeQueuedUtterancesWithTag:(NSNumber *)tag
+{
+	SynthSimQueuedUtterance ** link = &_queueHead;
+	SynthSimQueuedUtterance * removed = NULL, ** removedTail = &removed;
+	SynthSimQueuedUtterance * item;
+
+	// Called with _lock held.  A nil tag removes them all.  Unlink first, then complete, since a completion may queue more.
+	_queueTail = NULL;
+	while ((item = *link)) {
+		if (tag == nil || item->tag == [tag unsignedLongLongValue]) {
+			*link = item->next;
+			item->next = NULL;
+			*removedTail = item;
+			removedTail = &item->next;
+			_queueLength--;
+		}
+		else {
+			_queueTail = item;
+			link = &item->next;
+		}
+	}
+	while ((item = removed)) {
+		removed = item->next;
+		[self postCompletion:userCanceledErr tag:item->tag refCon:item->refCon];
+		DisposeQueuedUtterance(_queuePool, item);
+	}
+
+	// A new head needs rendering ahead if the channel is still speaking.
+	if (_queueHead && ! _queueHead->rendering && (_spokenString || _paused)) {
+		[self scheduleJob:kSynthSimPrerenderJob generation:_queueHead->serial atTime:SynthEngineWorkersCurrentTime(_workers)];
+	}
+}
+
+- (void)speculateText:(NSString *)text
+{
+	SynthSimSpeculation * speculation;
+	SynthSimSpeculation ** link;
+
+	// Called with _lock held.  Text that's already being speculated on is left as it is.
+	for (speculation = _speculations; speculation; speculation = speculation->next) {
+		if ([speculation->text isEqualToString:text]) {
+			return;
+		}
+	}
+	speculation = (SynthSimSpeculation *)calloc(1, sizeof(SynthSimSpeculation));
+	if (speculation == NULL) {
+		return;
+	}
+	speculation->serial = ++_speculationSerial;
+	speculation->text = [text copy];
+	speculation->next = _speculations;
+	_speculations = speculation;
+	if (++_speculationCount > kSynthEngineMaxSpeculations) {
+		link = &_speculations;
+		while ((*link)->next) {
+			link = &(*link)->next;
+		}
+		[self dropSpeculation:*link];
+		*link = NULL;
+		_speculationCount--;
+	}
+
+	// A guess only gets the capacity nothing else wants, whatever the channel's own priority.
+	[self scheduleJob:kSynthSimSpeculateJob generation:speculation->serial atTime:SynthEngineWorkersCurrentTime(_workers) priority:kSynthEnginePriorityBulk];
+}
+
+- (void)renderSpeculation:(uint64_t)serial
+{
+	SynthSimRenderSettings settings;
+	SynthRenderedUtterance * rendering = NULL;
+	SynthSimSpeculation ** link;
+	SynthSimSpeculation * speculation;
+	SynthSimSpeculationHandoff handoff = { NO, NO, NULL };
+	NSString * text;
+	CFAbsoluteTime renderStart;
+	double renderSeconds;
+	long error;
+
+	[_lock lock];
+	link = [self linkToSpeculation:serial];
+	if (link == NULL || (*link)->isRendering || (*link)->rendering) {
+		[_lock unlock];
+		return;
+	}
+	(*link)->isRendering = YES;
+	(*link)->handoff = &handoff;
+	text = [(*link)->text retain];
+	[self getRenderSettings:&settings forText:text properties:_properties];
+	(*link)->renderingSettings = settings;
+	[_lock unlock];
+
+	// Rendered without the lock, and with malloc rather than either of the channel's arenas, which belong to real utterances.
+	renderStart = CFAbsoluteTimeGetCurrent();
+	error = [self copyRenderedUtteranceOfText:text settings:&settings arena:NULL utterance:&rendering];
+	renderSeconds = CFAbsoluteTimeGetCurrent() - renderStart;
+	if (error != noErr) {
+		SynthRenderedUtteranceRelease(rendering);
+		rendering = NULL;
+	}
+
+	// An utterance that started on this text while it was being rendered may be waiting for it, holding the lock,
+	// so the rendering is offered to it before the lock is taken.
+	[_speculationCondition lock];
+	handoff.rendering = rendering;
+	handoff.isDone = YES;
+	[_speculationCondition broadcast];
+	[_speculationCondition unlock];
+
+	[_lock lock];
+	[_speculationCondition lock];
+	rendering = handoff.rendering;
+	handoff.rendering = NULL;
+	[_speculationCondition unlock];
+	if (handoff.isClaimed) {
+
+		// Taken by the utterance, which settled the speculation, so the rendering wasn't wasted.
+		[_lock unlock];
+		ReleaseRenderSettings(&settings);
+		[text release];
+		return;
+	}
+
+	// The speculation may have been settled or dropped meanwhile, in which case the work was for nothing.
+	link = [self linkToSpeculation:serial];
+	if (link) {
+		(*link)->handoff = NULL;
+	}
+	if (link && error == noErr) {
+		(*link)->isRendering = NO;
+		(*link)->rendering = rendering;
+		(*link)->renderingSettings = settings;
+		(*link)->renderSeconds = renderSeconds;
+		rendering = NULL;
+	}
+	else {
+		if (link) {
+			speculation = *link;
+			*link = speculation->next;
+			_speculationCount--;
+			DisposeSpeculation(speculation);
+		}
+		_speculationWastedSeconds += renderSeconds;
+		if (rendering) {
+			_speculationWastedSamples += rendering->totalSamples;
+		}
+	}
+	[_lock unlock];
+
+	SynthRenderedUtteranceRelease(rendering);
+	ReleaseRenderSettings(&settings);
+	[text release];
+}
+
+- (SynthSimSpeculation **)linkToSpeculation:(uint64_t)serial
+{
+	SynthSimSpeculation ** link;
+
+	// Called with _lock held.
+	for (link = &_speculations; *link; link = &(*link)->next) {
+		if ((*link)->serial == serial) {
+			return link;
+		}
+	}
+	return NULL;
+}
+
+- (SynthRenderedUtterance *)takeSpeculationOfText:(NSString *)text settings:(const SynthSimRenderSettings *)settings
+{
+	SynthRenderedUtterance * rendering = NULL;
+	SynthSimSpeculation * speculation;
+
+	// Called with _lock held, as an utterance that needs rendering starts.  Whether or not one of them matches,
+	// this settles every speculation outstanding.
+	if (_speculations == NULL) {
+		return NULL;
+	}
+	for (speculation = _speculations; speculation; speculation = speculation->next) {
+		if ([speculation->text isEqualToString:text]) {
+			break;
+		}
+	}
+	if (speculation && (speculation->isRendering || speculation->rendering) && settings->dictionaryGeneration == speculation->renderingSettings.dictionaryGeneration
+			&& memcmp(&settings->key, &speculation->renderingSettings.key, sizeof(SynthAudioCacheKey)) == 0) {
+		if (speculation->isRendering) {
+
+			// Half rendered is still closer to done than not started, so the utterance waits for it rather than
+			// render the same text a second time.  The worker rendering hands it over without the lock.
+			SynthSimSpeculationHandoff * handoff = speculation->handoff;
+			_speculationLateHits++;
+			speculation->isRendering = NO;
+			speculation->handoff = NULL;
+			[self dropSpeculations];
+			[_speculationCondition lock];
+			handoff->isClaimed = YES;
+			while (! handoff->isDone) {
+				[_speculationCondition wait];
+			}
+			rendering = handoff->rendering;
+			handoff->rendering = NULL;
+			[_speculationCondition unlock];
+			return rendering;
+		}
+		_speculationHits++;
+		rendering = speculation->rendering;
+		speculation->rendering = NULL;
+	}
+	else {
+		_speculationMisses++;
+	}
+	[self dropSpeculations];
+	return rendering;
+}
+
+- (void)dropSpeculation:(SynthSimSpeculation *)speculation
+{
+	// Called with _lock held, once speculation is unlinked.  One still being rendered is charged for its rendering when that's done,
+	// unless an utterance has claimed it.
+	if (speculation->rendering) {
+		_speculationsDropped++;
+		_speculationWastedSamples += speculation->rendering->totalSamples;
+		_speculationWastedSeconds += speculation->renderSeconds;
+	}
+	else if (speculation->isRendering) {
+		_speculationsDropped++;
+	}
+	DisposeSpeculation(speculation);
+}
+
+- (void)dropSpeculations
+{
+	// Called with _lock held.
+	while (_speculations) {
+		SynthSimSpeculation * speculation = _speculations;
+		_speculations = speculation->next;
+		[self dropSpeculation:speculation];
+	}
+	_speculationCount = 0;
+}
+
+- (void)stopSpeaking
+{
+	[_lock lock];
+
+	// Anything already scheduled for the old utterance is now stale, and so are the callbacks for its events.
+	_renderGeneration++;
+	_boundaryGeneration++;
+	_callBackGeneration++;
+	_boundarySchedule.isPending = false;
+	SynthBoundaryIndexReset(&_boundaryIndex);
+	[self releaseUtterance];
+	[self releaseSpokenString];
+	_paused = NO;
+	
+	SynthEngineStatusPublishState(&_status, false, false);
+	[self completeUtterance:userCanceledErr];
+	[self removeQueuedUtterancesWithTag:nil];
+	[self applyPendingVoice];
+
+	[_lock unlock];
+}
+
+- (void)stopSpeakingAt:(unsigned long)whereToStop
+{
+	[_lock lock];
+	if (whereToStop == kImmediate || ! _spokenString || _paused) {
+		[self stopSpeaking];
+	}
+	else {
+		SynthBoundaryIndexSchedule(&_boundaryIndex, [self currentSamplePosition], whereToStop, false, &_boundarySchedule);
+		_boundaryGeneration++;
+		[self performScheduledBoundaryAction];
+	}
+	[_lock unlock];
+}
+
+- (void)pauseSpeaking
+{
+	[_lock lock];
+	_renderGeneration++;
+	_boundaryGeneration++;
+	_callBackGeneration++;
+	_boundarySchedule.isPending = false;
+	if (! _paused) {
+		_pauseStartTime = SynthEngineWorkersCurrentTime(_workers);
+		_paused = YES;
+	}
+
+	[_sound pause];
+	SynthEngineStatusPublishState(&_status, false, true);
+	[_lock unlock];
+}
+
+- (void)pauseSpeakingAt:(unsigned long)whereToPause
+{
+	[_lock lock];
+	if (whereToPause == kImmediate || ! _spokenString || _paused) {
+		[self pauseSpeaking];
+	}
+	else {
+		SynthBoundaryIndexSchedule(&_boundaryIndex, [self currentSamplePosition], whereToPause, true, &_boundarySchedule);
+		_boundaryGeneration++;
+		[self performScheduledBoundaryAction];
+	}
+	[_lock unlock];
+}
+
+- (void)continueSpeaking
+{
+	[_lock lock];
+
+	// Continuing before a scheduled pause was reached cancels the pause.
+	if (_boundarySchedule.isPending && _boundarySchedule.isPause) {
+		_boundaryGeneration++;
+		_boundarySchedule.isPending = false;
+	}
+	if (_paused) {
+		_utteranceStartTime += SynthEngineWorkersCurrentTime(_workers) - _pauseStartTime;
+		_paused = NO;
+
+		[_sound resume];
+		SynthEngineStatusPublishState(&_status, true, false);
+		[self scheduleJob:kSynthSimRenderJob generation:++_renderGeneration atTime:SynthEngineWorkersCurrentTime(_workers)];
+	}
+
+	[_lock unlock];
+}
+
+- (long)copyAnalysisOfText:(NSString *)text settings:(const SynthSimRenderSettings *)settings arena:(SynthArena *)arena normalizedText:(SynthNormalizedText *)normalizedText analysis:(SynthTextAnalysis **)analysis
+{
+	long error = memFullErr;
+	long length = [text length];
+	SynthNormalizedText normalized;
+	SynthArenaMark mark;
+
+	// If normalizedText isn't NULL it gets the normalized text, and a caller passing an arena rewinds it after.
+	*analysis = NULL;
+	if (arena) {
+		mark = SynthArenaGetMark(arena);
+	}
+	UniChar * characters = (UniChar *)SynthScratchAlloc(arena, length * sizeof(UniChar));
+	if (characters) {
+		[text getCharacters:characters range:NSMakeRange(0, length)];
+		error = SynthTextNormalize(characters, length, settings->key.textModes, arena, &normalized);
+		if (error == noErr) {
+		
+			// The analysis depends on the voice and on the channel's pronunciation dictionary as well as the text.
+			SynthPhonemeCache * cache = SynthPhonemeCacheShared();
+			if (cache) {
+				error = SynthPhonemeCacheCopyAnalysis(cache, normalized.characters, normalized.length, settings->key.voice, settings->dictionary, analysis);
+			}
+			else {
+				error = SynthTextAnalyze(normalized.characters, normalized.length, settings->dictionary, analysis);
+			}
+		}
+		SynthScratchFree(arena, characters);
+		if (error == noErr && normalizedText) {
+			*normalizedText = normalized;
+			return noErr;
+		}
+		SynthNormalizedTextDispose(&normalized);
+	}
+	if (arena) {
+		SynthArenaRewind(arena, mark);
+	}
+	return error;
+}
+
+- (void)getRenderSettings:(SynthSimRenderSettings *)settings forText:(NSString *)text properties:(NSDictionary *)properties
+{
+	long length = [text length];
+	SynthArenaMark mark = SynthArenaGetMark(_arena);
+	UniChar * characters = (UniChar *)SynthArenaAlloc(_arena, length * sizeof(UniChar));
+	SynthAudioCacheKey * key = &settings->key;
+
+	// Called with _lock held, which is what lets it use the channel's arena.  properties are the channel's as they'll
+	// be when the text is spoken.
+	settings->inventory = (_voiceAssets.inventory) ? SynthUnitInventoryRetain(_voiceAssets.inventory) : NULL;
+	settings->dictionary = SynthDictionarySlotCopy(&_dictionarySlot);
+	settings->dictionaryGeneration = SynthDictionaryGeneration(settings->dictionary);
+
+	// Everything that changes what the channel would say, and how.
+	memset(key, 0, sizeof(SynthAudioCacheKey));
+	key->voice = ((uint64_t)_voiceSpec.creator << 32) | (uint32_t)_voiceSpec.id;
+	key->rate = [[properties objectForKey:(NSString *)kSpeechRateProperty] floatValue];
+	key->pitchBase = [[properties objectForKey:(NSString *)kSpeechPitchBaseProperty] floatValue];
+	key->pitchMod = [[properties objectForKey:(NSString *)kSpeechPitchModProperty] floatValue];
+	key->volume = [[properties objectForKey:(NSString *)kSpeechVolumeProperty] floatValue];
+	key->audioFormat = kSynthSimAudioFormat;
+	if ([[properties objectForKey:(NSString *)kSpeechNumberModeProperty] isEqual:(NSString *)kSpeechModeLiteral]) {
+		key->textModes |= kSynthTextLiteralNumbers;
+	}
+	if ([[properties objectForKey:(NSString *)kSpeechCharacterModeProperty] isEqual:(NSString *)kSpeechModeLiteral]) {
+		key->textModes |= kSynthTextLiteralCharacters;
+	}
+	if (characters) {
+		[text getCharacters:characters range:NSMakeRange(0, length)];
+		key->textHash = SynthTextHash(characters, length);
+	}
+	SynthArenaRewind(_arena, mark);
+}
+
+- (long)copyRenderedUtteranceOfText:(NSString *)text settings:(const SynthSimRenderSettings *)settings arena:(SynthArena *)arena utterance:(SynthRenderedUtterance **)utterance
+{
+	SynthAudioCache * cache = SynthAudioCacheShared();
+	SynthArenaMark mark;
+	long length = [text length];
+	long error;
+
+	// A channel with its own pronunciation dictionary says things its own way, so only the others share rendered audio.
+	*utterance = NULL;
+	if (cache && settings->dictionaryGeneration == kSynthNoDictionaryGeneration && SynthAudioCacheCopyUtterance(cache, &settings->key, utterance)) {
+		return noErr;
+	}
+
+	// Whatever's rendered here is copied into the utterance, so the working memory all goes back to the arena after.
+	if (arena) {
+		mark = SynthArenaGetMark(arena);
+	}
+
+	// The server has no pronunciation dictionaries, so a channel with one renders for itself.  So does a channel whose
+	// server has gone away, with the example sound.
+	if (_remote && settings->dictionaryGeneration == kSynthNoDictionaryGeneration) {
+		UniChar * characters = (UniChar *)SynthScratchAlloc(arena, length * sizeof(UniChar));
+		error = memFullErr;
+		if (characters) {
+			[text getCharacters:characters range:NSMakeRange(0, length)];
+			error = SynthServerChannelRender(_remote, characters, length, kSynthSimSamplesPerCharacter, [_soundData bytes], [_soundData length], &settings->key, utterance);
+			SynthScratchFree(arena, characters);
+		}
+		if (arena) {
+			SynthArenaRewind(arena, mark);
+		}
+		if (error == noErr) {
+			if (cache) {
+				SynthAudioCacheAddUtterance(cache, &settings->key, *utterance);
+			}
+			return noErr;
+		}
+	}
+
+	// Render it: analyze the text, then place its events and boundaries on the timeline of the spoken string.
+	// Without a unit inventory the "rendering" is always the example sound file.
+	SynthTextAnalysis * analysis = NULL;
+	SynthNormalizedText normalized;
+
+	error = [self copyAnalysisOfText:text settings:settings arena:arena normalizedText:&normalized analysis:&analysis];
+	if (error == noErr) {
+		error = SynthUtteranceRender(analysis, normalized.originalOffsets, settings->inventory, kSynthSimSamplesPerCharacter, [_soundData bytes], [_soundData length], &settings->key, arena, utterance);
+		SynthNormalizedTextDispose(&normalized);
+	}
+	if (error == noErr && cache && settings->dictionaryGeneration == kSynthNoDictionaryGeneration) {
+		SynthAudioCacheAddUtterance(cache, &settings->key, *utterance);
+	}
+
+	SynthTextAnalysisRelease(analysis);
+	if (arena) {
+		SynthArenaRewind(arena, mark);
+	}
+	return error;
+}
+
+- (void)layOutBoundaries
+{
+	SynthBoundaryIndexReset(&_boundaryIndex);
+
+	// The utterance's boundaries are already on its timeline.
+	if (_utterance) {
+		uint32_t boundaryIndex;
+		for (boundaryIndex = 0; boundaryIndex < _utterance->wordCount; boundaryIndex++) {
+			SynthBoundaryIndexAddWordEnd(&_boundaryIndex, _utterance->wordEnds[boundaryIndex]);
+		}
+		for (boundaryIndex = 0; boundaryIndex < _utterance->sentenceCount; boundaryIndex++) {
+			SynthBoundaryIndexAddSentenceEnd(&_boundaryIndex, _utterance->sentenceEnds[boundaryIndex]);
+		}
+		_boundaryIndex.totalSamples = _utterance->totalSamples;
+	}
+}
+
+- (void)releaseUtterance
+{
+	// The sound plays from the utterance's bytes, so it has to go first.
+	[_sound stop];
+	[_sound release];
+	_sound = NULL;
+	SynthRenderedUtteranceRelease(_utterance);
+	_utterance = NULL;
+}
+
+- (long)copyPhonemes:(CFStringRef *)phonemes fromText:(NSString *)text
+{
+	SynthTextAnalysis * analysis = NULL;
+	SynthSimRenderSettings settings;
+
+	// Phonemes are the voice's, so a switch the channel is free to make now has to be made first.
+	[self waitForPendingVoice];
+	[_lock lock];
+	if (! _spokenString && ! _paused) {
+		[self applyPendingVoice];
+	}
+	[self getRenderSettings:&settings forText:text properties:_properties];
+	if (_remote && settings.dictionary == NULL) {
+		long length = [text length];
+		SynthArenaMark mark = SynthArenaGetMark(_arena);
+		UniChar * characters = (UniChar *)SynthArenaAlloc(_arena, length * sizeof(UniChar));
+		UniChar * phonemeCharacters = NULL;
+		long phonemeLength = 0;
+		long error = memFullErr;
+		if (characters) {
+			[text getCharacters:characters range:NSMakeRange(0, length)];
+			error = SynthServerChannelCopyPhonemes(_remote, characters, length, &phonemeCharacters, &phonemeLength);
+		}
+		SynthArenaRewind(_arena, mark);
+		[_lock unlock];
+		ReleaseRenderSettings(&settings);
+		if (error == noErr) {
+			*phonemes = CFStringCreateWithCharacters(NULL, phonemeCharacters, phonemeLength);
+			if (*phonemes == NULL) {
+				error = memFullErr;
+			}
+			free(phonemeCharacters);
+		}
+		return error;
+	}
+	long error = [self copyAnalysisOfText:text settings:&settings arena:_arena normalizedText:NULL analysis:&analysis];
+	[_lock unlock];
+	ReleaseRenderSettings(&settings);
+
+	if (error == noErr) {
+		*phonemes = CFStringCreateWithCharacters(NULL, analysis->phonemes, analysis->phonemeLength);
+		if (*phonemes == NULL) {
+			error = memFullErr;
+		}
+		SynthTextAnalysisRelease(analysis);
+	}
+	return error;
+}
+
+- (long)addDictionaryEntries:(NSDictionary *)speechDictionary
+{
+	NSArray * lists[2];
+	NSMutableArray * strings = [NSMutableArray array];
+	SynthDictionaryEntry * entries;
+	UniChar * characters;
+	NSUInteger characterCount = 0, listIndex, stringIndex;
+	long error = noErr;
+
+	// Doesn't take the lock: the new dictionary is made from the published one and published in its place, so
+	// utterances keep speaking with the one they started with and the next one to start picks up this one.
+	if (! [speechDictionary isKindOfClass:[NSDictionary class]]) {
+		return badDictFormat;
+	}
+	lists[0] = [speechDictionary objectForKey:(NSString *)kSpeechDictionaryPronunciations];
+	lists[1] = [speechDictionary objectForKey:(NSString *)kSpeechDictionaryAbbreviations];
+	for (listIndex = 0; listIndex < 2 && error == noErr; listIndex++) {
+		NSEnumerator * entryEnumerator;
+		NSDictionary * entry;
+		if (lists[listIndex] == nil) {
+			continue;
+		}
+		if (! [lists[listIndex] isKindOfClass:[NSArray class]]) {
+			error = badDictFormat;
+			break;
+		}
+		entryEnumerator = [lists[listIndex] objectEnumerator];
+		while ((entry = [entryEnumerator nextObject]) && error == noErr) {
+			NSString * spelling = [entry isKindOfClass:[NSDictionary class]] ? [entry objectForKey:(NSString *)kSpeechDictionaryEntrySpelling] : nil;
+			NSString * phonemes = [entry isKindOfClass:[NSDictionary class]] ? [entry objectForKey:(NSString *)kSpeechDictionaryEntryPhonemes] : nil;
+			if (! [spelling isKindOfClass:[NSString class]] || ! [phonemes isKindOfClass:[NSString class]]) {
+				error = badDictFormat;
+			}
+			else {
+				[strings addObject:spelling];
+				[strings addObject:phonemes];
+				characterCount += [spelling length] + [phonemes length];
+			}
+		}
+	}
+	if (error != noErr) {
+		return error;
+	}
+
+	entries = (SynthDictionaryEntry *)malloc(([strings count] / 2 + 1) * sizeof(SynthDictionaryEntry));
+	characters = (UniChar *)malloc((characterCount + 1) * sizeof(UniChar));
+	if (entries && characters) {
+		UniChar * nextCharacters = characters;
+		for (stringIndex = 0; stringIndex < [strings count]; stringIndex += 2) {
+			NSString * spelling = [strings objectAtIndex:stringIndex];
+			NSString * phonemes = [strings objectAtIndex:stringIndex + 1];
+			SynthDictionaryEntry * entry = &entries[stringIndex / 2];
+			entry->spelling = nextCharacters;
+			entry->spellingLength = [spelling length];
+			[spelling getCharacters:nextCharacters range:NSMakeRange(0, entry->spellingLength)];
+			nextCharacters += entry->spellingLength;
+			entry->phonemes = nextCharacters;
+			entry->phonemesLength = [phonemes length];
+			[phonemes getCharacters:nextCharacters range:NSMakeRange(0, entry->phonemesLength)];
+			nextCharacters += entry->phonemesLength;
+		}
+		error = SynthDictionarySlotAddEntries(&_dictionarySlot, entries, (uint32_t)([strings count] / 2));
+	}
+	else {
+		error = memFullErr;
+	}
+	free(entries);
+	free(characters);
+	return error;
+}
+
+- (uint64_t)currentSamplePosition
+{
+	double now = (_paused) ? _pauseStartTime : SynthEngineWorkersCurrentTime(_workers);
+	return (now > _utteranceStartTime) ? SynthEngineSecondsToSamples(now - _utteranceStartTime) : 0;
+}
+
+- (uint64_t)nextEventPosition
+{
+	if (_utterance && _eventIndex < _utterance->eventCount) {
+		return _utterance->events[_eventIndex].samplePosition;
+	}
+	return UINT64_MAX;
+}
+
+- (void)scheduleJob:(int)kind generation:(uint64_t)generation atTime:(double)dueTime
+{
+	[self scheduleJob:kind generation:generation atTime:dueTime priority:_priority];
+}
+
+- (void)scheduleJob:(int)kind generation:(uint64_t)generation atTime:(double)dueTime priority:(SynthEnginePriority)priority
+{
+	// Called with _lock held, which makes this the only thread taking jobs from the pool.
+	SynthSimJob * job = (SynthSimJob *)SynthBlockPoolGet(_jobPool);
+	if (job) {
+		job->simulator = [self retain];
+		job->pool = _jobPool;
+		job->generation = generation;
+		job->kind = kind;
+		job->dueTime = dueTime;
+		if (SynthEngineWorkersSubmitAt(_workers, priority, dueTime, PerformSimulatorJob, job) != noErr) {
+			SynthBlockPoolPut(_jobPool, job);
+			[self release];
+		}
+	}
+}
 
-- (id)init
+- (void)performJob:(int)kind generation:(uint64_t)generation dueTime:(double)dueTime
 {
-	if ((self = [super init])) {
-		
-		_sound = [[NSSound alloc] initWithContentsOfFile:[[NSBundle bundleForClass:[SynthesizerSimulator class]] pathForResource:[NSString stringWithFormat:@"Sound0"] ofType:@"aiff"] byReference:false];
-		[_sound setDelegate:self];
-		_properties = [NSMutableDictionary new];			
-		
-		[_properties setObject:(NSString *)kSpeechModeText forKey:(NSString *)kSpeechInputModeProperty];
-		[_properties setObject:(NSString *)kSpeechModeNormal forKey:(NSString *)kSpeechCharacterModeProperty];
-		[_properties setObject:(NSString *)kSpeechModeNormal forKey:(NSString *)kSpeechNumberModeProperty];
-		[_properties setObject:[NSNumber numberWithFloat:180.0] forKey:(NSString *)kSpeechRateProperty];
-		[_properties setObject:[NSNumber numberWithFloat:100.0] forKey:(NSString *)kSpeechPitchBaseProperty];
-		[_properties setObject:[NSNumber numberWithFloat:30.0] forKey:(NSString *)kSpeechPitchModProperty];
-		[_properties setObject:[NSNumber numberWithFloat:1.0] forKey:(NSString *)kSpeechVolumeProperty];
-		[_properties setObject:[NSDictionary dictionaryWithObjectsAndKeys:[NSNumber numberWithLong:0], kSpeechStatusOutputBusy, [NSNumber numberWithLong:0], kSpeechStatusOutputPaused, [NSNumber numberWithLong:0], kSpeechStatusNumberOfCharactersLeft, [NSNumber numberWithLong:0], kSpeechStatusPhonemeCode, NULL] forKey:(NSString *)kSpeechStatusProperty];
+	// Loading a voice doesn't touch the channel's speaking state, so it runs without the lock.
+	if (kind == kSynthSimVoiceLoadJob) {
+		[self loadPendingVoice];
 
+		[_lock lock];
+		if (! _spokenString && ! _paused) {
+			[self applyPendingVoice];
+		}
+		[_lock unlock];
+		return;
 	}
-	return self;
+	if (kind == kSynthSimPrerenderJob) {
+		[self prerenderQueuedUtterance:generation];
+		return;
+	}
+	if (kind == kSynthSimSpeculateJob) {
+		[self renderSpeculation:generation];
+		return;
+	}
+	if (kind == kSynthSimTextDoneJob) {
+		[self requestNextBuffer:generation];
+		return;
+	}
+
+	[_lock lock];
+	if (_priority == kSynthEnginePriorityInteractive && SynthEngineWorkersCurrentTime(_workers) - dueTime > kSynthEngineInteractiveDeadline) {
+		_deadlineMisses++;
+	}
+	if (kind == kSynthSimRenderJob && generation == _renderGeneration) {
+		[self renderNextEvent];
+	}
+	else if (kind == kSynthSimBoundaryJob && generation == _boundaryGeneration) {
+		[self performScheduledBoundaryAction];
+	}
+	[_lock unlock];
+
+	// The callbacks the events, or the end of speech, left owed are made only now the channel is unlocked.
+	[self makeOwedCallBacks];
 }
 
-- (void)dealloc;
+- (void)performScheduledBoundaryAction
 {
-	[_phonemeCallbackTimer invalidate];
-	[_phonemeCallbackTimer release];
-	[_spokenString release];
-	[_sound release];
-	[_properties release];
-	
-	[super dealloc];
+	if (_boundarySchedule.isPending) {
+		uint64_t position = [self currentSamplePosition];
+		if (position >= _boundarySchedule.target) {
+		
+			// The boundary has been reached. The fade ramp before it only matters to a back end that renders
+			// its own samples; the simulator's sound is stopped or paused outright.
+			Boolean isPause = _boundarySchedule.isPause;
+			_boundarySchedule.isPending = false;
+			if (isPause) {
+				[self pauseSpeaking];
+			}
+			else {
+				[self stopSpeaking];
+			}
+		}
+		else {
+			// Come back exactly when output reaches the boundary.
+			[self scheduleJob:kSynthSimBoundaryJob generation:_boundaryGeneration atTime:_utteranceStartTime + SynthEngineSamplesToSeconds(_boundarySchedule.target)];
+		}
+	}
 }
 
-- (void)setVoice:(VoiceSpec *)voiceSpec
+- (void)renderNextEvent
 {
-	_voiceSpec = *voiceSpec;
+	uint64_t position = [self currentSamplePosition];
+
+	if (position >= _utteranceSamples) {
+		[self finishSpeaking];
+	}
+	else {
+		// Deliver the events that are due, then come back when the next one is, or when the utterance ends.
+		// Their callbacks are only owed here, and made once the job has let go of the lock.
+		uint64_t generation = _renderGeneration;
+		while (generation == _renderGeneration && ! _paused && [self nextEventPosition] <= position) {
+			[self performSimulatedCallbacks];
+		}
+
+		if (generation == _renderGeneration && _spokenString && ! _paused) {
+			uint64_t nextPosition = [self nextEventPosition];
+			if (nextPosition > _utteranceSamples) {
+				nextPosition = _utteranceSamples;
+			}
+			[self scheduleJob:kSynthSimRenderJob generation:_renderGeneration atTime:_utteranceStartTime + SynthEngineSamplesToSeconds(nextPosition)];
+		}
+	}
 }
 
-- (void)getVoice:(VoiceSpec *)voiceSpec
+- (void)finishSpeaking
 {
-	*voiceSpec = _voiceSpec;
+	double endTime = _utteranceStartTime + SynthEngineSamplesToSeconds(_utteranceSamples);
+
+	// We're done with the simulated callbacks
+	_renderGeneration++;
+	_boundaryGeneration++;
+	_boundarySchedule.isPending = false;
+	[self releaseUtterance];
+	[self releaseSpokenString];
+	_paused = NO;
+
+	// The next queued utterance picks up exactly where this one ended, without a round trip through the client.
+	// A voice switch that's still loading waits for the utterance after.
+	if (_queueHead) {
+		[self completeUtterance:noErr];
+		[self applyPendingVoice];
+		[self startQueuedUtteranceAtTime:endTime];
+		return;
+	}
+	SynthEngineStatusPublishState(&_status, false, false);
+
+	// The utterance completes before the speech-done callback, as one followed by a queued utterance does, so a client
+	// that starts speaking again from the callback never has its new utterance's completion confused with this one's.
+	[self completeUtterance:noErr];
+	[self applyPendingVoice];
+
+	long callBackProcPtr = [[_properties objectForKey:(NSString *)kSpeechSpeechDoneCallBack] longValue];
+	if (callBackProcPtr) {
+		SynthSimCallBack callBack = { kSynthSimSpeechDoneCallBack, callBackProcPtr, [[_properties objectForKey:(NSString *)kSpeechRefConProperty] longValue], NO, 0, _utteranceTag, { 0, 0 }, NULL };
+		[self oweCallBack:&callBack];
+	}
 }
 
-- (void)startSpeaking:(NSString *)string;
+- (void)completeUtterance:(long)status
 {
-	if (! [_properties objectForKey:(NSString *)kSpeechOutputToFileURLProperty]) {
+	// Each utterance completes exactly once, however it ends.
+	if (_utteranceActive) {
+		_utteranceActive = NO;
+		[self postCompletion:status tag:_utteranceTag refCon:[[_properties objectForKey:(NSString *)kSpeechRefConProperty] longValue]];
+	}
+}
 
-		// We're simulating word and phoneme callbacks by having a timer perform the callback every 1/4 second.
-		_spokenString = [string retain];
-		_phonemeCallbackCharIndex = 0;
-		_phonemeCallbackTimer = [[NSTimer scheduledTimerWithTimeInterval:0.1 target:self selector:@selector(performSimulatedCallbacks) userInfo:NULL repeats:YES] retain];
+- (void)postCompletion:(long)status tag:(uint64_t)tag refCon:(long)refCon
+{
+	[self postEvent:kSynthEngineSpeechDoneEvent characterOffset:0 length:0 code:status tag:tag];
 
-		// Do our simluated speaking by playing an audio file, which is static and has no relationship to the given text.
-		[_sound setCurrentTime:0.0];
-		[_sound play];
-		[_properties setObject:[NSDictionary dictionaryWithObjectsAndKeys:[NSNumber numberWithLong:1], kSpeechStatusOutputBusy, [NSNumber numberWithLong:0], kSpeechStatusOutputPaused, [NSNumber numberWithLong:0], kSpeechStatusNumberOfCharactersLeft, [NSNumber numberWithLong:0], kSpeechStatusPhonemeCode, NULL] forKey:(NSString *)kSpeechStatusProperty];
+	long completionProcPtr = [[_properties objectForKey:(NSString *)kSynthEngineCompletionCallBack] longValue];
+	if (completionProcPtr) {
+		SynthSimCallBack callBack = { kSynthSimCompletionCallBack, completionProcPtr, refCon, NO, 0, tag, { status, 0 }, NULL };
+		[self oweCallBack:&callBack];
 	}
 }
 
-- (void)stopSpeaking
+- (void)postEvent:(uint32_t)kind characterOffset:(long)characterOffset length:(long)length code:(long)code tag:(uint64_t)tag
 {
-	// We're done with the simulated callbacks, release our timer.
-	[_phonemeCallbackTimer invalidate];
-	[_phonemeCallbackTimer release];
-	_phonemeCallbackTimer = NULL;
-	[_spokenString release];
-	_spokenString = NULL;
-	
-	[_sound stop];
-	[_properties setObject:[NSDictionary dictionaryWithObjectsAndKeys:[NSNumber numberWithLong:0], kSpeechStatusOutputBusy, [NSNumber numberWithLong:0], kSpeechStatusOutputPaused, [NSNumber numberWithLong:0], kSpeechStatusNumberOfCharactersLeft, [NSNumber numberWithLong:0], kSpeechStatusPhonemeCode, NULL] forKey:(NSString *)kSpeechStatusProperty];
+	SynthEngineEventQueue * queue = (SynthEngineEventQueue *)[[_properties objectForKey:(NSString *)kSynthEngineEventQueueProperty] longValue];
+	if (queue) {
+		SynthEngineEvent event;
+		event.kind = kind;
+		event.channel = (long)self;
+		event.utteranceTag = tag;
+		event.samplePosition = [self currentSamplePosition];
+		event.characterOffset = characterOffset;
+		event.length = length;
+		event.code = code;
+		
+		// A full queue drops the event and counts it; the reader is never allowed to stall speech.
+		SynthEngineEventQueuePost(queue, &event);
+	}
 }
 
-- (void)pauseSpeaking
+- (void)oweCallBack:(const SynthSimCallBack *)callBack
 {
-	[_sound pause];
-	[_properties setObject:[NSDictionary dictionaryWithObjectsAndKeys:[NSNumber numberWithLong:0], kSpeechStatusOutputBusy, [NSNumber numberWithLong:1], kSpeechStatusOutputPaused, [NSNumber numberWithLong:0], kSpeechStatusNumberOfCharactersLeft, [NSNumber numberWithLong:0], kSpeechStatusPhonemeCode, NULL] forKey:(NSString *)kSpeechStatusProperty];
+	// Called with _lock held.  Takes over the reference to the callback's object.
+	if (_callBackCount == _callBackCapacity) {
+		uint32_t capacity = (_callBackCapacity) ? _callBackCapacity * 2 : 16;
+		SynthSimCallBack * callBacks = (SynthSimCallBack *)malloc(capacity * sizeof(SynthSimCallBack));
+		uint32_t index;
+
+		// Out of memory, the callback is made here and now rather than lost.
+		if (callBacks == NULL) {
+			MakeCallBack((SpeechChannel)self, callBack);
+			if (callBack->object) {
+				CFRelease(callBack->object);
+			}
+			return;
+		}
+		for (index = 0; index < _callBackCount; index++) {
+			callBacks[index] = _callBacks[(_callBackHead + index) % _callBackCapacity];
+		}
+		free(_callBacks);
+		_callBacks = callBacks;
+		_callBackCapacity = capacity;
+		_callBackHead = 0;
+	}
+	_callBacks[(_callBackHead + _callBackCount) % _callBackCapacity] = *callBack;
+	_callBackCount++;
 }
 
-- (void)continueSpeaking
+- (void)makeOwedCallBacks
 {
-	[_sound resume];
-	[_properties setObject:[NSDictionary dictionaryWithObjectsAndKeys:[NSNumber numberWithLong:1], kSpeechStatusOutputBusy, [NSNumber numberWithLong:0], kSpeechStatusOutputPaused, [NSNumber numberWithLong:0], kSpeechStatusNumberOfCharactersLeft, [NSNumber numberWithLong:0], kSpeechStatusPhonemeCode, NULL] forKey:(NSString *)kSpeechStatusProperty];
+	SynthSimCallBack callBack;
+
+	// Called without _lock.  One thread at a time makes a channel's callbacks, so they can't overtake each other; one
+	// owed meanwhile, even by a call the client makes from a callback, is left to the thread already making them.
+	[_lock lock];
+	if (_makingCallBacks) {
+		[_lock unlock];
+		return;
+	}
+	_makingCallBacks = YES;
+	while (_callBackCount) {
+		callBack = _callBacks[_callBackHead];
+		_callBackHead = (_callBackHead + 1) % _callBackCapacity;
+		_callBackCount--;
+		if (! callBack.isEvent || callBack.generation == _callBackGeneration) {
+			[_lock unlock];
+			MakeCallBack((SpeechChannel)self, &callBack);
+			[_lock lock];
+		}
+		if (callBack.object) {
+			CFRelease(callBack.object);
+		}
+	}
+	_makingCallBacks = NO;
+	[_lock unlock];
 }
 
 - (void)setObject:(id)object forProperty:(NSString *)property
 {
+	[_lock lock];
+
+	// Queue operations act on the queue rather than being kept as properties.
+	if ([property isEqualToString:(NSString *)kSynthEngineCancelQueuedProperty] || [property isEqualToString:(NSString *)kSynthEngineFlushQueueProperty]) {
+		if ([property isEqualToString:(NSString *)kSynthEngineFlushQueueProperty]) {
+			[self removeQueuedUtterancesWithTag:nil];
+		}
+		else if ([object isKindOfClass:[NSNumber class]]) {
+			[self removeQueuedUtterancesWithTag:object];
+		}
+		[_lock unlock];
+		return;
+	}
+
+	// So do speculations, which are kept as renderings.
+	if ([property isEqualToString:(NSString *)kSynthEngineSpeculateTextProperty]) {
+		if ([object isKindOfClass:[NSString class]]) {
+			[self speculateText:object];
+		}
+		else {
+			[self dropSpeculations];
+		}
+		[_lock unlock];
+		return;
+	}
+	if ([property isEqualToString:(NSString *)kSynthEnginePriorityProperty]) {
+		// Takes effect with the next job the channel schedules.
+		_priority = ([object intValue] == kSynthEnginePriorityBulk) ? kSynthEnginePriorityBulk : kSynthEnginePriorityInteractive;
+	}
+	if (_remote && [object isKindOfClass:[NSNumber class]] && ([property isEqualToString:(NSString *)kSpeechRateProperty] || [property isEqualToString:(NSString *)kSpeechPitchBaseProperty] || [property isEqualToString:(NSString *)kSpeechPitchModProperty] || [property isEqualToString:(NSString *)kSpeechVolumeProperty])) {
+		// The properties that shape the rendering go to the server as well.
+		OSType selector;
+		if (ConvertCFStringToOSType((CFStringRef)property, &selector)) {
+			SynthServerChannelSetProperty(_remote, selector, [object doubleValue]);
+		}
+	}
+	if (_remote && [object isKindOfClass:[NSString class]] && ([property isEqualToString:(NSString *)kSpeechNumberModeProperty] || [property isEqualToString:(NSString *)kSpeechCharacterModeProperty])) {
+		// So do the modes the server reads the text with.
+		SynthServerChannelSetProperty(_remote, [property isEqualToString:(NSString *)kSpeechNumberModeProperty] ? kSynthServerNumberModeSelector : kSynthServerCharacterModeSelector,
+				[object isEqualToString:(NSString *)kSpeechModeLiteral] ? 1.0 : 0.0);
+	}
 	if (object) {
 		[_properties setObject:object forKey:property];
 	}
 	else {
 		[_properties removeObjectForKey:property];
 	}
+	[_lock unlock];
 }
 
 - (id)copyProperty:(NSString *)property
 {
-	return [[_properties objectForKey:property] retain];
-}
-
-- (void)sound:(NSSound *)sound didFinishPlaying:(BOOL)aBool
-{
-	// We're done with the simulated callbacks
-	[_phonemeCallbackTimer invalidate];
-	[_phonemeCallbackTimer release];
-	_phonemeCallbackTimer = NULL;
-	[_spokenString release];
-	_spokenString = NULL;
+	id object;
 
-	[_properties setObject:[NSDictionary dictionaryWithObjectsAndKeys:[NSNumber numberWithLong:0], kSpeechStatusOutputBusy, [NSNumber numberWithLong:0], kSpeechStatusOutputPaused, [NSNumber numberWithLong:0], kSpeechStatusNumberOfCharactersLeft, [NSNumber numberWithLong:0], kSpeechStatusPhonemeCode, NULL] forKey:(NSString *)kSpeechStatusProperty];
+	// The status is built from the published snapshot rather than stored, so it's always current.
+	if ([property isEqualToString:(NSString *)kSpeechStatusProperty]) {
+		SynthEngineStatusSnapshot snapshot;
+		SynthEngineStatusRead(&_status, &snapshot);
+		return [[NSDictionary alloc] initWithObjectsAndKeys:[NSNumber numberWithLong:snapshot.outputBusy], kSpeechStatusOutputBusy, [NSNumber numberWithLong:snapshot.outputPaused], kSpeechStatusOutputPaused, [NSNumber numberWithLong:snapshot.charactersLeft], kSpeechStatusNumberOfCharactersLeft, [NSNumber numberWithLong:snapshot.phonemeCode], kSpeechStatusPhonemeCode, NULL];
+	}
 
-	SpeechDoneProcPtr callBackProcPtr = (SpeechDoneProcPtr)[[_properties objectForKey:(NSString *)kSpeechSpeechDoneCallBack] longValue];
-	if (callBackProcPtr) {
-		(*callBackProcPtr)((SpeechChannel)self, [[_properties objectForKey:(NSString *)kSpeechRefConProperty] longValue]);
+	[_lock lock];
+	if ([property isEqualToString:(NSString *)kSynthEngineDeadlineStatisticsProperty]) {
+		SynthEngineWorkerStatistics statistics;
+		NSMutableArray * histogram = [NSMutableArray arrayWithCapacity:kSynthEngineLatenessBuckets];
+		uint32_t bucket;
+		SynthEngineWorkersGetStatistics(_workers, &statistics);
+		for (bucket = 0; bucket < kSynthEngineLatenessBuckets; bucket++) {
+			[histogram addObject:[NSNumber numberWithUnsignedLongLong:statistics.latenessHistogram[kSynthEnginePriorityInteractive][bucket]]];
+		}
+		object = [[NSDictionary alloc] initWithObjectsAndKeys:histogram, kSynthEngineInteractiveLatenessHistogram, [NSNumber numberWithUnsignedLongLong:_deadlineMisses], kSynthEngineChannelDeadlineMisses, [NSNumber numberWithUnsignedLongLong:statistics.jobsRun[kSynthEnginePriorityInteractive]], kSynthEngineInteractiveJobs, [NSNumber numberWithUnsignedLongLong:statistics.deadlineMisses[kSynthEnginePriorityInteractive]], kSynthEngineInteractiveDeadlineMisses, [NSNumber numberWithDouble:statistics.worstLateness[kSynthEnginePriorityInteractive]], kSynthEngineWorstInteractiveLateness, [NSNumber numberWithUnsignedLongLong:statistics.jobsRun[kSynthEnginePriorityBulk]], kSynthEngineBulkJobs, NULL];
+	}
+	else if ([property isEqualToString:(NSString *)kSynthEnginePhonemeCacheStatisticsProperty] && SynthPhonemeCacheShared()) {
+		SynthPhonemeCacheStatistics statistics;
+		SynthPhonemeCacheGetStatistics(SynthPhonemeCacheShared(), &statistics);
+		object = [[NSDictionary alloc] initWithObjectsAndKeys:[NSNumber numberWithUnsignedLongLong:statistics.hits], kSynthEnginePhonemeCacheHits, [NSNumber numberWithUnsignedLongLong:statistics.misses], kSynthEnginePhonemeCacheMisses, [NSNumber numberWithUnsignedLongLong:statistics.evictions], kSynthEnginePhonemeCacheEvictions, [NSNumber numberWithUnsignedLong:statistics.entryCount], kSynthEnginePhonemeCacheEntries, [NSNumber numberWithUnsignedLong:statistics.byteCount], kSynthEnginePhonemeCacheBytes, NULL];
+	}
+	else if ([property isEqualToString:(NSString *)kSynthEngineAudioCacheStatisticsProperty] && SynthAudioCacheShared()) {
+		SynthAudioCacheStatistics statistics;
+		SynthAudioCacheGetStatistics(SynthAudioCacheShared(), &statistics);
+		object = [[NSDictionary alloc] initWithObjectsAndKeys:[NSNumber numberWithUnsignedLongLong:statistics.memoryHits], kSynthEngineAudioCacheMemoryHits, [NSNumber numberWithUnsignedLongLong:statistics.diskHits], kSynthEngineAudioCacheDiskHits, [NSNumber numberWithUnsignedLongLong:statistics.misses], kSynthEngineAudioCacheMisses, [NSNumber numberWithUnsignedLongLong:statistics.spills], kSynthEngineAudioCacheSpills, [NSNumber numberWithUnsignedLongLong:statistics.evictions], kSynthEngineAudioCacheEvictions, [NSNumber numberWithUnsignedLong:statistics.memoryBytes], kSynthEngineAudioCacheMemoryBytes, [NSNumber numberWithUnsignedLong:statistics.diskBytes], kSynthEngineAudioCacheDiskBytes, NULL];
+	}
+	else if ([property isEqualToString:(NSString *)kSynthEngineSupportedCharactersProperty]) {
+		object = _voiceAssets.supportedCharacters ? [[NSNumber alloc] initWithLong:(long)SynthCharacterSetRetain(_voiceAssets.supportedCharacters)] : nil;
 	}
+	else if ([property isEqualToString:(NSString *)kSynthEngineIndividuallySpokenCharactersProperty]) {
+		object = _voiceAssets.individuallySpokenCharacters ? [[NSNumber alloc] initWithLong:(long)SynthCharacterSetRetain(_voiceAssets.individuallySpokenCharacters)] : nil;
+	}
+	else if ([property isEqualToString:(NSString *)kSynthEngineSpeculationStatisticsProperty]) {
+		object = [[NSDictionary alloc] initWithObjectsAndKeys:[NSNumber numberWithUnsignedLongLong:_speculationHits], kSynthEngineSpeculationHits, [NSNumber numberWithUnsignedLongLong:_speculationLateHits], kSynthEngineSpeculationLateHits, [NSNumber numberWithUnsignedLongLong:_speculationMisses], kSynthEngineSpeculationMisses, [NSNumber numberWithUnsignedLongLong:_speculationsDropped], kSynthEngineSpeculationsDropped, [NSNumber numberWithUnsignedLongLong:_speculationWastedSamples], kSynthEngineSpeculationWastedSamples, [NSNumber numberWithDouble:_speculationWastedSeconds], kSynthEngineSpeculationWastedSeconds, NULL];
+	}
+	else if ([property isEqualToString:(NSString *)kSynthEngineQueueLengthProperty]) {
+		object = [[NSNumber alloc] initWithUnsignedLong:_queueLength];
+	}
+	else {
+		object = [[_properties objectForKey:property] retain];
+	}
+	[_lock unlock];
+	return object;
 }
 
-- (void)performSimulatedCallbacks
+- (void)getStatus:(SynthEngineStatusSnapshot *)snapshot
 {
+	SynthEngineStatusRead(&_status, snapshot);
+}
 
-	if (_spokenString && _phonemeCallbackCharIndex < [_spokenString length]) {
+- (void)performSimulatedCallbacks
+{
+	if (_spokenString && ! _paused && _utterance && _eventIndex < _utterance->eventCount) {
 	
-		// Skip whitespace, and determine if this is the beginning of the next word
-		BOOL foundWordBoundary = (_phonemeCallbackCharIndex == 0);
-		while (_phonemeCallbackCharIndex < [_spokenString length] && ! [[NSCharacterSet alphanumericCharacterSet] characterIsMember:[_spokenString characterAtIndex:_phonemeCallbackCharIndex]]) {
-			_phonemeCallbackCharIndex++;
-
-			// Make CF-based error callback whenever it sees the beginning of an embedded command.
-			// Note: this not the recommended approach for handling embedded commands, but only an example of how to call the error callback function.
-			SpeechErrorCFProcPtr errorCallBackProcPtr = (SpeechErrorCFProcPtr)[[_properties objectForKey:(NSString *)kSpeechErrorCFCallBack] longValue];
-			if (errorCallBackProcPtr && _phonemeCallbackCharIndex < [_spokenString length] - 1 && [_spokenString characterAtIndex:_phonemeCallbackCharIndex] == '[' && [_spokenString characterAtIndex:_phonemeCallbackCharIndex+1] == '[') {
-					
-				CFMutableDictionaryRef mutableUserInfo = CFDictionaryCreateMutable(NULL, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
-				if (mutableUserInfo) {
-					CFDictionarySetValue(mutableUserInfo, (const void *)kCFErrorDescriptionKey, (const void *)CFSTR("Beginning of embedded command.  This is just a demonstration of a CF-based error callback and not an actual error."));
-					CFDictionarySetValue(mutableUserInfo, (const void *)kSpeechErrorCallbackSpokenString, (const void *)_spokenString);
-					
-					CFNumberRef offsetAsCFNumber = CFNumberCreate(NULL, kCFNumberLongType, (const void *)&_phonemeCallbackCharIndex);
-					if (offsetAsCFNumber) {
-						CFDictionarySetValue(mutableUserInfo, (const void *)kSpeechErrorCallbackCharacterOffset, (const void *)offsetAsCFNumber);
-						CFRelease(offsetAsCFNumber);
-					}
+		// The callbacks are only owed here, and made once the channel has been unlocked.
+		SynthTimelineEvent event = _utterance->events[_eventIndex++];
+		long refCon = [[_properties objectForKey:(NSString *)kSpeechRefConProperty] longValue];
+		_phonemeCallbackCharIndex = event.characterOffset;
+
+		switch (event.kind) {
+		
+			case kSynthTextEmbeddedCommandEvent:
+				{
+					// Make CF-based error callback whenever it sees the beginning of an embedded command.
+					// Note: this not the recommended approach for handling embedded commands, but only an example of how to call the error callback function.
+					long errorCallBackProcPtr = [[_properties objectForKey:(NSString *)kSpeechErrorCFCallBack] longValue];
+					if (errorCallBackProcPtr) {
+							
+						CFMutableDictionaryRef mutableUserInfo = CFDictionaryCreateMutable(NULL, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+						if (mutableUserInfo) {
+							CFDictionarySetValue(mutableUserInfo, (const void *)kCFErrorDescriptionKey, (const void *)CFSTR("Beginning of embedded command.  This is just a demonstration of a CF-based error callback and not an actual error."));
+							CFDictionarySetValue(mutableUserInfo, (const void *)kSpeechErrorCallbackSpokenString, (const void *)_spokenString);
+							
+							CFNumberRef offsetAsCFNumber = CFNumberCreate(NULL, kCFNumberLongType, (const void *)&_phonemeCallbackCharIndex);
+							if (offsetAsCFNumber) {
+								CFDictionarySetValue(mutableUserInfo, (const void *)kSpeechErrorCallbackCharacterOffset, (const void *)offsetAsCFNumber);
+								CFRelease(offsetAsCFNumber);
+							}
 
-					CFErrorRef theError =  CFErrorCreate(NULL, kCFErrorDomainOSStatus, noErr, mutableUserInfo);
-					if (theError) {
-						(*errorCallBackProcPtr)((SpeechChannel)self, [[_properties objectForKey:(NSString *)kSpeechRefConProperty] longValue], theError);
-						CFRelease(theError);
+							CFErrorRef theError =  CFErrorCreate(NULL, kCFErrorDomainOSStatus, noErr, mutableUserInfo);
+							if (theError) {
+								SynthSimCallBack callBack = { kSynthSimErrorCFCallBack, errorCallBackProcPtr, refCon, YES, _callBackGeneration, _utteranceTag, { 0, 0 }, theError };
+								[self oweCallBack:&callBack];
+							}
+							CFRelease(mutableUserInfo);
+						}
 					}
-					CFRelease(mutableUserInfo);
 				}
-			}			
+				break;
 
-			foundWordBoundary = true;
-		}
-		
+			case kSynthTextPhonemeEvent:
+				{
+					// Make simulated phoneme callback
+					// Note: the opcodes come from the simulated front end in SynthTextAnalysis.c, which just spells each word out.
+					SInt16 phonemeOpcode = (SInt16)event.phonemeCode;
+					SynthEngineStatusPublishProgress(&_status, _phonemeCallbackCharIndex, [self textLeftAfter:_phonemeCallbackCharIndex], phonemeOpcode, [self currentSamplePosition]);
+					[self postEvent:kSynthEnginePhonemeEvent characterOffset:_phonemeCallbackCharIndex length:1 code:phonemeOpcode tag:_utteranceTag];
 
-		if (_phonemeCallbackCharIndex < [_spokenString length]) {
-			
-			// Make simulated phoneme callback
-			// Note: we just send a random phoneme opcode.
-			SpeechPhonemeProcPtr phonemeCallBackProcPtr = (SpeechPhonemeProcPtr)[[_properties objectForKey:(NSString *)kSpeechPhonemeCallBack] longValue];
-			if (phonemeCallBackProcPtr) {
-				(*phonemeCallBackProcPtr)((SpeechChannel)self, [[_properties objectForKey:(NSString *)kSpeechRefConProperty] longValue], (SInt16)((random() % 47) + 2));
-			}
-			
-			if (foundWordBoundary) {
-			
-				// Make simulated word callback before the beginnin of words
-				SpeechWordCFProcPtr wordCallBackProcPtr = (SpeechWordCFProcPtr)[[_properties objectForKey:(NSString *)kSpeechWordCFCallBack] longValue];
-				if (wordCallBackProcPtr) {
-					
-					// Find end of word in order to determine length of word.
-					// Note: a normal synthesizer would have already parsed the text in a much more sophisticated way, so this is not an example of who a synthesizer should determine word boundaries.
-					CFIndex charIndex = _phonemeCallbackCharIndex;
-					while (charIndex < [_spokenString length] && ! [[NSCharacterSet whitespaceCharacterSet] characterIsMember:[_spokenString characterAtIndex:charIndex]]) {
-						charIndex++;
+					long phonemeCallBackProcPtr = [[_properties objectForKey:(NSString *)kSpeechPhonemeCallBack] longValue];
+					if (phonemeCallBackProcPtr) {
+						SynthSimCallBack callBack = { kSynthSimPhonemeCallBack, phonemeCallBackProcPtr, refCon, YES, _callBackGeneration, _utteranceTag, { phonemeOpcode, 0 }, NULL };
+						[self oweCallBack:&callBack];
 					}
-					CFIndex wordLength = 0;
-					if (charIndex >= [_spokenString length] && _phonemeCallbackCharIndex < [_spokenString length]) {
-						wordLength = [_spokenString length] - _phonemeCallbackCharIndex; 
+				}
+				break;
+
+			case kSynthTextWordEvent:
+				{
+					// Make simulated word callback before the beginning of words
+					CFRange wordRange = CFRangeMake(_phonemeCallbackCharIndex, event.length);
+					[self postEvent:kSynthEngineWordEvent characterOffset:wordRange.location length:wordRange.length code:noErr tag:_utteranceTag];
+
+					long wordCallBackProcPtr = [[_properties objectForKey:(NSString *)kSpeechWordCFCallBack] longValue];
+					if (wordCallBackProcPtr) {
+						SynthSimCallBack callBack = { kSynthSimWordCFCallBack, wordCallBackProcPtr, refCon, YES, _callBackGeneration, _utteranceTag, { wordRange.location, wordRange.length }, CFRetain((CFStringRef)_spokenString) };
+						[self oweCallBack:&callBack];
 					}
-					else if (charIndex > _phonemeCallbackCharIndex) {
-						wordLength = charIndex - _phonemeCallbackCharIndex; 
+
+					// The buffer calls' word callback has the word in bytes of the buffer, when it's a buffer being spoken.
+					long bufferWordCallBackProcPtr = [[_properties objectForKey:(NSString *)kSynthSimWordCallBackProperty] longValue];
+					if (bufferWordCallBackProcPtr) {
+						unsigned long wordStart = wordRange.location;
+						unsigned long wordEnd = wordRange.location + wordRange.length;
+						if (_offsetMap) {
+							wordStart = SynthOffsetMapByteOffset(_offsetMap, (uint32_t)wordStart);
+							wordEnd = SynthOffsetMapByteOffset(_offsetMap, (uint32_t)wordEnd);
+						}
+						SynthSimCallBack callBack = { kSynthSimBufferWordCallBack, bufferWordCallBackProcPtr, refCon, YES, _callBackGeneration, _utteranceTag, { (long)wordStart, (long)(wordEnd - wordStart) }, NULL };
+						[self oweCallBack:&callBack];
 					}
-					
-					CFRange wordRange = CFRangeMake(_phonemeCallbackCharIndex, wordLength);
-					(*wordCallBackProcPtr)((SpeechChannel)self, [[_properties objectForKey:(NSString *)kSpeechRefConProperty] longValue], (CFStringRef)_spokenString, wordRange);
 				}
-			}
+				break;
 		}
-		_phonemeCallbackCharIndex++;
 	}
 }
 
 @end
 
 
+static void MakeCallBack(SpeechChannel chan, const SynthSimCallBack * callBack)
+{
+	switch (callBack->kind) {
+		case kSynthSimSpeechDoneCallBack:
+			(*(SpeechDoneProcPtr)callBack->procPtr)(chan, callBack->refCon);
+			break;
+		case kSynthSimCompletionCallBack:
+			(*(SynthEngineCompletionProcPtr)callBack->procPtr)(chan, callBack->refCon, callBack->tag, callBack->arguments[0]);
+			break;
+		case kSynthSimWordCFCallBack:
+			(*(SpeechWordCFProcPtr)callBack->procPtr)(chan, callBack->refCon, (CFStringRef)callBack->object, CFRangeMake(callBack->arguments[0], callBack->arguments[1]));
+			break;
+		case kSynthSimBufferWordCallBack:
+			(*(SpeechWordProcPtr)callBack->procPtr)(chan, callBack->refCon, (unsigned long)callBack->arguments[0], (unsigned short)callBack->arguments[1]);
+			break;
+		case kSynthSimPhonemeCallBack:
+			(*(SpeechPhonemeProcPtr)callBack->procPtr)(chan, callBack->refCon, (SInt16)callBack->arguments[0]);
+			break;
+		case kSynthSimErrorCFCallBack:
+			(*(SpeechErrorCFProcPtr)callBack->procPtr)(chan, callBack->refCon, (CFErrorRef)callBack->object);
+			break;
+	}
+}
+
+static void PerformSimulatorJob(void * context)
+{
+	// Workers are plain threads, so each job needs its own autorelease pool.
+	NSAutoreleasePool * pool = [NSAutoreleasePool new];
+	SynthSimJob job = *(SynthSimJob *)context;
+
+	// The record goes back to the pool first, while the job's reference still keeps the channel, and its pool, alive.
+	SynthBlockPoolPut(job.pool, context);
+	[job.simulator performJob:job.kind generation:job.generation dueTime:job.dueTime];
+	[job.simulator release];
+
+	[pool release];
+}
+
+
 SpeechChannelIdentifier SynthSimCreateChannel()
 {
+	SynthesizerSimulator * simulator;
+	Boolean isFull;
 
+	pthread_mutex_lock(&sChannelsLock);
 	if (sChannels == NULL) {
-		sChannels = [NSMutableArray new];
+		const char * limitString;
+		sChannels = CFSetCreateMutable(NULL, 0, NULL);
+		if ((limitString = getenv(kSynthEngineMaxChannelsVariable))) {
+			sMaxChannels = strtoul(limitString, NULL, 10);
+		}
+		if ((limitString = getenv(kSynthEngineMemoryBudgetVariable))) {
+			sMemoryBudget = strtoull(limitString, NULL, 10);
+		}
+	}
+	isFull = (sChannels == NULL || (sMaxChannels && (unsigned long)CFSetGetCount(sChannels) >= sMaxChannels));
+	pthread_mutex_unlock(&sChannelsLock);
+
+	// Refuse a channel the engine couldn't keep up with rather than let every channel suffer for it.
+	if (isFull || (sMemoryBudget && ResidentBytes() >= sMemoryBudget)) {
+		return NULL;
 	}
 
-	SynthesizerSimulator * simulator = [SynthesizerSimulator new];
-	[sChannels addObject:simulator];
-	[simulator release];
+	// The set takes over the reference from new.
+	simulator = [SynthesizerSimulator new];
+	if (simulator) {
+		pthread_mutex_lock(&sChannelsLock);
+		CFSetAddValue(sChannels, simulator);
+		pthread_mutex_unlock(&sChannelsLock);
+	}
 	
 	return (SpeechChannelIdentifier)simulator;
 }
@@ -295,8 +2027,22 @@ SpeechChannelIdentifier SynthSimCreateChannel()
 long SynthSimDisposeChannel(SpeechChannelIdentifier chan)
 {
 	long error = noErr;
-	if ([sChannels containsObject:(id)chan]) {
-		[sChannels removeObject:(id)chan];
+	Boolean isChannel = false;
+
+	// Only one caller can take a channel out of the set, so a channel disposed of twice at once is only released once.
+	pthread_mutex_lock(&sChannelsLock);
+	if (sChannels && CFSetContainsValue(sChannels, (const void *)chan)) {
+		CFSetRemoveValue(sChannels, (const void *)chan);
+		isChannel = true;
+	}
+	pthread_mutex_unlock(&sChannelsLock);
+
+	if (isChannel) {
+		// Make any work still scheduled for the channel stale before letting it go.  Calls already in progress on
+		// other threads hold their own reference, and any that come after get noSynthFound.
+		[(SynthesizerSimulator *)chan stopSpeaking];
+		[(SynthesizerSimulator *)chan makeOwedCallBacks];
+		[(SynthesizerSimulator *)chan release];
 	}
 	else {
 		error = noSynthFound;
@@ -304,11 +2050,13 @@ long SynthSimDisposeChannel(SpeechChannelIdentifier chan)
 	return error;
 }
 
-long SynthSimUseVoice(SpeechChannelIdentifier chan, VoiceSpec * voiceSpec)
+long SynthSimUseVoice(SpeechChannelIdentifier chan, VoiceSpec * voiceSpec, CFBundleRef voiceBundle)
 {
 	long error = noErr;
-	if ([sChannels containsObject:(id)chan]) {
-		[(SynthesizerSimulator *)chan setVoice:voiceSpec];
+	SynthesizerSimulator * simulator;
+	if ((simulator = RetainChannel(chan))) {
+		[simulator setVoice:voiceSpec bundle:voiceBundle];
+		[simulator release];
 	}
 	else {
 		error = noSynthFound;
@@ -319,8 +2067,11 @@ long SynthSimUseVoice(SpeechChannelIdentifier chan, VoiceSpec * voiceSpec)
 long SynthSimStartSpeaking(SpeechChannelIdentifier chan, CFStringRef string)
 {
 	long error = noErr;
-	if ([sChannels containsObject:(id)chan]) {
-		[(SynthesizerSimulator *)chan startSpeaking:(NSString *)string];
+	SynthesizerSimulator * simulator;
+	if ((simulator = RetainChannel(chan))) {
+		[simulator startSpeaking:(NSString *)string];
+		[simulator makeOwedCallBacks];
+		[simulator release];
 	}
 	else {
 		error = noSynthFound;
@@ -328,11 +2079,69 @@ long SynthSimStartSpeaking(SpeechChannelIdentifier chan, CFStringRef string)
 	return error;
 }
 
-long SynthSimStopSpeaking(SpeechChannelIdentifier chan)
+long SynthSimStartSpeakingBuffer(SpeechChannelIdentifier chan, const char * textBuf, long byteLength)
 {
 	long error = noErr;
-	if ([sChannels containsObject:(id)chan]) {
-		[(SynthesizerSimulator *)chan stopSpeaking];
+	SynthesizerSimulator * simulator;
+	if (byteLength < 0 || byteLength > INT32_MAX || (byteLength > 0 && textBuf == NULL)) {
+		error = paramErr;
+	}
+	else if ((simulator = RetainChannel(chan))) {
+		error = [simulator startSpeakingBuffer:textBuf length:byteLength];
+		[simulator makeOwedCallBacks];
+		[simulator release];
+	}
+	else {
+		error = noSynthFound;
+	}
+	return error;
+}
+
+long SynthSimStopSpeakingAt(SpeechChannelIdentifier chan, unsigned long whereToStop)
+{
+	long error = noErr;
+	SynthesizerSimulator * simulator;
+	if (whereToStop != kImmediate && whereToStop != kEndOfWord && whereToStop != kEndOfSentence) {
+		error = paramErr;
+	}
+	else if ((simulator = RetainChannel(chan))) {
+		[simulator stopSpeakingAt:whereToStop];
+		[simulator makeOwedCallBacks];
+		[simulator release];
+	}
+	else {
+		error = noSynthFound;
+	}
+	return error;
+}
+
+long SynthSimPauseSpeakingAt(SpeechChannelIdentifier chan, unsigned long whereToPause)
+{
+	long error = noErr;
+	SynthesizerSimulator * simulator;
+	if (whereToPause != kImmediate && whereToPause != kEndOfWord && whereToPause != kEndOfSentence) {
+		error = paramErr;
+	}
+	else if ((simulator = RetainChannel(chan))) {
+		[simulator pauseSpeakingAt:whereToPause];
+		[simulator release];
+	}
+	else {
+		error = noSynthFound;
+	}
+	return error;
+}
+
+long SynthSimCopyPhonemesFromText(SpeechChannelIdentifier chan, CFStringRef text, CFStringRef * phonemes)
+{
+	long error = noErr;
+	SynthesizerSimulator * simulator;
+	if (text == NULL || phonemes == NULL) {
+		error = paramErr;
+	}
+	else if ((simulator = RetainChannel(chan))) {
+		error = [simulator copyPhonemes:phonemes fromText:(NSString *)text];
+		[simulator release];
 	}
 	else {
 		error = noSynthFound;
@@ -340,11 +2149,16 @@ long SynthSimStopSpeaking(SpeechChannelIdentifier chan)
 	return error;
 }
 
-long SynthSimPauseSpeaking(SpeechChannelIdentifier chan)
+long SynthSimUseSpeechDictionary(SpeechChannelIdentifier chan, CFDictionaryRef speechDictionary)
 {
 	long error = noErr;
-	if ([sChannels containsObject:(id)chan]) {
-		[(SynthesizerSimulator *)chan pauseSpeaking];
+	SynthesizerSimulator * simulator;
+	if ((simulator = RetainChannel(chan))) {
+		// Only the CF form of a dictionary can be read; the legacy binary one is accepted and changes nothing.
+		if (speechDictionary) {
+			error = [simulator addDictionaryEntries:(NSDictionary *)speechDictionary];
+		}
+		[simulator release];
 	}
 	else {
 		error = noSynthFound;
@@ -355,8 +2169,10 @@ long SynthSimPauseSpeaking(SpeechChannelIdentifier chan)
 long SynthSimContinueSpeaking(SpeechChannelIdentifier chan)
 {
 	long error = noErr;
-	if ([sChannels containsObject:(id)chan]) {
-		[(SynthesizerSimulator *)chan continueSpeaking];
+	SynthesizerSimulator * simulator;
+	if ((simulator = RetainChannel(chan))) {
+		[simulator continueSpeaking];
+		[simulator release];
 	}
 	else {
 		error = noSynthFound;
@@ -367,10 +2183,18 @@ long SynthSimContinueSpeaking(SpeechChannelIdentifier chan)
 long SynthSimSetProperty(SpeechChannelIdentifier chan, CFStringRef property, CFTypeRef object)
 {
 	long error = noErr;
-	if ([sChannels containsObject:(id)chan]) {
-	
+	SynthesizerSimulator * simulator;
+	if ((simulator = RetainChannel(chan))) {
 	
-		[(SynthesizerSimulator *)chan setObject:(id)object forProperty:(NSString *)property];
+		// Queuing an utterance can fail, so it isn't just another property.
+		if (property && CFEqual(property, kSynthEngineEnqueueUtteranceProperty)) {
+			error = [simulator enqueueUtterance:(NSDictionary *)object];
+		}
+		else {
+			[simulator setObject:(id)object forProperty:(NSString *)property];
+		}
+		[simulator makeOwedCallBacks];
+		[simulator release];
 	}
 	else {
 		error = noSynthFound;
@@ -381,13 +2205,15 @@ long SynthSimSetProperty(SpeechChannelIdentifier chan, CFStringRef property, CFT
  long SynthSimCopyProperty(SpeechChannelIdentifier chan, CFStringRef property, CFTypeRef * object)
 {
 	long error = noErr;
-	if ([sChannels containsObject:(id)chan]) {
+	SynthesizerSimulator * simulator;
+	if ((simulator = RetainChannel(chan))) {
 		if (object) {
-			*object = [(SynthesizerSimulator *)chan copyProperty:(NSString *)property];
+			*object = [simulator copyProperty:(NSString *)property];
 		}
 		else {
 			error = paramErr;
 		}
+		[simulator release];
 	}
 	else {
 		error = noSynthFound;
@@ -398,21 +2224,35 @@ long SynthSimSetProperty(SpeechChannelIdentifier chan, CFStringRef property, CFT
 long SynthSimSetSpeechInfo(SpeechChannelIdentifier chan, unsigned long selector, void * speechInfo)
 {
 	long error = noErr;
-	if ([sChannels containsObject:(id)chan]) {
+	SynthesizerSimulator * simulator;
+	if ((simulator = RetainChannel(chan))) {
 	
+		// Values are created and released here rather than autoreleased, so a client calling from a
+		// thread without an autorelease pool doesn't leak them, and a tight loop of calls doesn't
+		// grow the pool of one that has.
 		NSString * property = (NSString *)CopyCFStringFromOSType(selector);
+		id value = nil;
 		switch(selector) {
 		
 			case soInputMode:
 			case soCharacterMode:
 			case soNumberMode:
-				{
-					NSString * stringValue = (NSString *)CopyCFStringFromOSType(*(long *)speechInfo);
-					[(SynthesizerSimulator *)chan setObject:stringValue forProperty:property];
-					[stringValue release];
-				}
+				value = (NSString *)CopyCFStringFromOSType(*(long *)speechInfo);
 				break;
 			
+			case soSynthEnginePriority:
+				value = [[NSNumber alloc] initWithLong:*(long *)speechInfo];
+				break;
+
+			case soSynthEngineUtteranceTag:
+			case soSynthEngineCancelQueued:
+				value = [[NSNumber alloc] initWithUnsignedLongLong:*(uint64_t *)speechInfo];
+				break;
+
+			case soSynthEngineFlushQueue:
+				value = [[NSNumber alloc] initWithLong:0];
+				break;
+
 			case soRefCon:
 			case soTextDoneCallBack:
 			case soSpeechDoneCallBack:
@@ -421,14 +2261,16 @@ long SynthSimSetSpeechInfo(SpeechChannelIdentifier chan, unsigned long selector,
 			case soPhonemeCallBack:
 			case soWordCallBack:
 			case soOutputToFileWithCFURL:
-				[(SynthesizerSimulator *)chan setObject:[NSNumber numberWithLong:(long)speechInfo] forProperty:property];
+			case soSynthEngineEventQueue:
+			case soSynthEngineCompletionCallBack:
+				value = [[NSNumber alloc] initWithLong:(long)speechInfo];
 				break;
 				
 			case soRate:
 			case soPitchBase:
 			case soPitchMod:
 			case soVolume:
-				[(SynthesizerSimulator *)chan setObject:[NSNumber numberWithFloat:(float)(*(Fixed *)speechInfo / 65536.0)] forProperty:property];
+				value = [[NSNumber alloc] initWithFloat:(float)(*(Fixed *)speechInfo / 65536.0)];
 				break;
 				
 			case soReset:
@@ -439,7 +2281,13 @@ long SynthSimSetSpeechInfo(SpeechChannelIdentifier chan, unsigned long selector,
 				break;
 		}
 
+		if (value) {
+			[simulator setObject:value forProperty:property];
+			[simulator makeOwedCallBacks];
+			[value release];
+		}
 		[property release];
+		[simulator release];
 	}
 	else {
 		error = noSynthFound;
@@ -450,10 +2298,21 @@ long SynthSimSetSpeechInfo(SpeechChannelIdentifier chan, unsigned long selector,
 long SynthSimGetSpeechInfo(SpeechChannelIdentifier chan, unsigned long selector, void* speechInfo)
 {
 	long error = noErr;
-	if ([sChannels containsObject:(id)chan]) {
-		if (speechInfo) {
+	SynthesizerSimulator * simulator;
+	if ((simulator = RetainChannel(chan))) {
+		if (speechInfo && selector == soStatus) {
+		
+			// Status is polled frequently, so read the published snapshot directly instead of going through a property object.
+			SynthEngineStatusSnapshot snapshot;
+			[simulator getStatus:&snapshot];
+			((SpeechStatusInfo *)speechInfo)->outputBusy = snapshot.outputBusy;
+			((SpeechStatusInfo *)speechInfo)->outputPaused = snapshot.outputPaused;
+			((SpeechStatusInfo *)speechInfo)->inputBytesLeft = snapshot.charactersLeft;
+			((SpeechStatusInfo *)speechInfo)->phonemeCode = snapshot.phonemeCode;
+		}
+		else if (speechInfo) {
 			NSString * property = (NSString *)CopyCFStringFromOSType(selector);
-			id object = [(SynthesizerSimulator *)chan copyProperty:property];
+			id object = [simulator copyProperty:property];
 			
 			if (object) {
 			
@@ -466,6 +2325,8 @@ long SynthSimGetSpeechInfo(SpeechChannelIdentifier chan, unsigned long selector,
 						break;
 						
 					case soRecentSync:
+					case soSynthEnginePriority:
+					case soSynthEngineQueueLength:
 						*(SInt32 *)speechInfo = [object longValue];
 						break;
 				
@@ -476,17 +2337,14 @@ long SynthSimGetSpeechInfo(SpeechChannelIdentifier chan, unsigned long selector,
 						*(Fixed *)speechInfo = [object floatValue] * 65536.0;
 						break;
 						
-					case soCurrentVoice:
-						[(SynthesizerSimulator *)chan getVoice:(VoiceSpec *)speechInfo];
+					case soSynthEngineUtteranceTag:
+						*(uint64_t *)speechInfo = [object unsignedLongLongValue];
 						break;
 
-					case soStatus:
-						((SpeechStatusInfo *)speechInfo)->outputBusy = [[object objectForKey:(NSString *)kSpeechStatusOutputBusy] longValue];
-						((SpeechStatusInfo *)speechInfo)->outputPaused = [[object objectForKey:(NSString *)kSpeechStatusOutputPaused] longValue];
-						((SpeechStatusInfo *)speechInfo)->inputBytesLeft = [[object objectForKey:(NSString *)kSpeechStatusNumberOfCharactersLeft] longValue];
-						((SpeechStatusInfo *)speechInfo)->phonemeCode = [[object objectForKey:(NSString *)kSpeechStatusPhonemeCode] longValue];
+					case soCurrentVoice:
+						[simulator getVoice:(VoiceSpec *)speechInfo];
 						break;
-						
+
 					default:
 						error = siUnknownInfoType;
 						break;
@@ -502,6 +2360,7 @@ long SynthSimGetSpeechInfo(SpeechChannelIdentifier chan, unsigned long selector,
 		else {
 			error = paramErr;
 		}
+		[simulator release];
 	}
 	else {
 		error = noSynthFound;
@@ -510,6 +2369,110 @@ long SynthSimGetSpeechInfo(SpeechChannelIdentifier chan, unsigned long selector,
 }
 
 
+static SynthCharacterSet * CreateCharacterSetFromRanges(NSArray * rangeArray)
+{
+	SynthCharacterSet * set = NULL;
+	SynthVoiceCharacterRange * ranges;
+	uint32_t rangeCount = 0;
+	NSEnumerator * rangeEnumerator;
+	NSDictionary * range;
+
+	if (! [rangeArray isKindOfClass:[NSArray class]] || [rangeArray count] == 0) {
+		return NULL;
+	}
+	ranges = (SynthVoiceCharacterRange *)malloc([rangeArray count] * sizeof(SynthVoiceCharacterRange));
+	if (ranges == NULL) {
+		return NULL;
+	}
+	rangeEnumerator = [rangeArray objectEnumerator];
+	while ((range = [rangeEnumerator nextObject])) {
+		if ([range isKindOfClass:[NSDictionary class]] && [range objectForKey:@"UnicodeCharBegin"] && [range objectForKey:@"UnicodeCharEnd"]) {
+			ranges[rangeCount].first = [[range objectForKey:@"UnicodeCharBegin"] unsignedLongValue];
+			ranges[rangeCount].last = [[range objectForKey:@"UnicodeCharEnd"] unsignedLongValue];
+			rangeCount++;
+		}
+	}
+	SynthCharacterSetCreate(ranges, rangeCount, &set);
+	free(ranges);
+	return set;
+}
+
+static void DisposeVoiceAssets(SynthSimVoiceAssets * assets)
+{
+	SynthUnitInventoryRelease(assets->inventory);
+	SynthCharacterSetRelease(assets->supportedCharacters);
+	SynthCharacterSetRelease(assets->individuallySpokenCharacters);
+	memset(assets, 0, sizeof(SynthSimVoiceAssets));
+}
+
+static void ReleaseRenderSettings(SynthSimRenderSettings * settings)
+{
+	SynthUnitInventoryRelease(settings->inventory);
+	SynthDictionaryRelease(settings->dictionary);
+}
+
+static void DisposeQueuedUtterance(SynthBlockPool * pool, SynthSimQueuedUtterance * item)
+{
+	[item->text release];
+	[item->properties release];
+	SynthRenderedUtteranceRelease(item->rendering);
+	SynthOffsetMapDispose(item->offsetMap);
+	SynthBlockPoolPut(pool, item);
+}
+
+static SynthesizerSimulator * RetainChannel(SpeechChannelIdentifier chan)
+{
+	// The reference keeps the channel alive until the caller's done with it, even if another thread disposes of it meanwhile.
+	SynthesizerSimulator * simulator = NULL;
+
+	pthread_mutex_lock(&sChannelsLock);
+	if (chan && sChannels && CFSetContainsValue(sChannels, (const void *)chan)) {
+		simulator = [(SynthesizerSimulator *)chan retain];
+	}
+	pthread_mutex_unlock(&sChannelsLock);
+
+	return simulator;
+}
+
+static unsigned long long ResidentBytes(void)
+{
+	struct task_basic_info info;
+	mach_msg_type_number_t count = TASK_BASIC_INFO_COUNT;
+
+	if (task_info(mach_task_self(), TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) {
+		return 0;
+	}
+	return info.resident_size;
+}
+
+static void DisposeSpeculation(SynthSimSpeculation * speculation)
+{
+	[speculation->text release];
+	SynthRenderedUtteranceRelease(speculation->rendering);
+	free(speculation);
+}
+
+static long CreateStringOfBuffer(const char * bytes, long byteLength, Boolean copyBytes, SynthOffsetMap ** map, NSString ** string)
+{
+	// Word positions go back to the client in bytes through a map made once, here.
+	long error = SynthOffsetMapCreate(bytes, (uint32_t)byteLength, map);
+	if (error == noErr) {
+		CFStringEncoding encoding = ((*map)->encoding == kSynthUTF8Encoding) ? kCFStringEncodingUTF8 : kCFStringEncodingMacRoman;
+		if (copyBytes) {
+			*string = (NSString *)CFStringCreateWithBytes(NULL, (const UInt8 *)bytes, byteLength, encoding, false);
+		}
+		else {
+			*string = (NSString *)CFStringCreateWithBytesNoCopy(NULL, (const UInt8 *)bytes, byteLength, encoding, false, kCFAllocatorNull);
+		}
+		if (*string == nil) {
+			SynthOffsetMapDispose(*map);
+			*map = NULL;
+			error = memFullErr;
+		}
+	}
+	return error;
+}
+
 static Boolean ConvertCFStringToOSType(CFStringRef string, OSType * type)
 {
 	Boolean wasSuccessful = false;
@@ -526,6 +2489,47 @@ static Boolean ConvertCFStringToOSType(CFStringRef string, OSType * type)
 
 static CFStringRef CopyCFStringFromOSType(OSType type)
 {
-	OSType theType = CFSwapInt32HostToBig(type);
-	return CFStringCreateWithBytes(NULL, (const UInt8 *)&theType, 4, kCFStringEncodingMacRoman, false);
+	// Every buffer-based call converts its selector, and sometimes its value, through here.  The
+	// selectors and modes this engine knows about are answered with constant strings, which cost
+	// nothing to retain and release, so only unknown codes allocate.
+	CFStringRef string = NULL;
+	switch(type) {
+		case soStatus:							string = CFSTR("stat");	break;
+		case soInputMode:						string = CFSTR("inpt");	break;
+		case soCharacterMode:					string = CFSTR("char");	break;
+		case soNumberMode:						string = CFSTR("nmbr");	break;
+		case soRate:							string = CFSTR("rate");	break;
+		case soPitchBase:						string = CFSTR("pbas");	break;
+		case soPitchMod:						string = CFSTR("pmod");	break;
+		case soVolume:							string = CFSTR("volm");	break;
+		case soRecentSync:						string = CFSTR("sync");	break;
+		case soCurrentVoice:					string = CFSTR("cvox");	break;
+		case soReset:							string = CFSTR("rset");	break;
+		case soRefCon:							string = CFSTR("refc");	break;
+		case soTextDoneCallBack:				string = CFSTR("tdcb");	break;
+		case soSpeechDoneCallBack:				string = CFSTR("sdcb");	break;
+		case soSyncCallBack:					string = CFSTR("sycb");	break;
+		case soErrorCallBack:					string = CFSTR("ercb");	break;
+		case soPhonemeCallBack:					string = CFSTR("phcb");	break;
+		case soWordCallBack:					string = CFSTR("wdcb");	break;
+		case soOutputToFileWithCFURL:			string = CFSTR("opaf");	break;
+		case soSynthEnginePriority:				string = CFSTR("prio");	break;
+		case soSynthEngineEventQueue:			string = CFSTR("evtq");	break;
+		case soSynthEngineUtteranceTag:			string = CFSTR("utag");	break;
+		case soSynthEngineCompletionCallBack:	string = CFSTR("cmcb");	break;
+		case soSynthEngineCancelQueued:			string = CFSTR("qcan");	break;
+		case soSynthEngineFlushQueue:			string = CFSTR("qfls");	break;
+		case soSynthEngineQueueLength:			string = CFSTR("qlen");	break;
+		case modeText:							string = CFSTR("TEXT");	break;
+		case modePhonemes:						string = CFSTR("PHON");	break;
+		case modeNormal:						string = CFSTR("NORM");	break;
+		case modeLiteral:						string = CFSTR("LTRL");	break;
+	}
+	if (string) {
+		return (CFStringRef)CFRetain(string);
+	}
+	else {
+		OSType theType = CFSwapInt32HostToBig(type);
+		return CFStringCreateWithBytes(NULL, (const UInt8 *)&theType, 4, kCFStringEncodingMacRoman, false);
+	}
 }
@@ -0,0 +1,246 @@
+/*
+	main.c
+	PhonemeExporter
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Writes the phonemes of a text file of any size, reading it a chunk at a
+	time and converting chunks on all the processors, with the output in order.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "SynthPhonemeExport.h"
+#include "SynthTextNormalizer.h"
+
+#define kFileBufferSize		65536
+
+// Reads UTF-8 text, a buffer at a time.  Malformed bytes read as U+FFFD.
+typedef struct TextReader {
+	FILE *		file;
+	uint8_t		bytes[kFileBufferSize];
+	size_t		start;
+	size_t		end;
+	Boolean		atEnd;
+	UniChar		lowSurrogate;		// The second half of a pair that didn't fit last time, or 0.
+} TextReader;
+
+typedef struct PhonemeWriter {
+	FILE *		file;
+	uint8_t		bytes[kFileBufferSize];
+} PhonemeWriter;
+
+static long		ReadText(void * refCon, UniChar * characters, long capacity, long * outLength);
+static long		WritePhonemes(void * refCon, const UniChar * phonemes, long length);
+static void		PrintUsage(const char * toolName);
+
+int main(int argc, char * argv[])
+{
+	SynthPhonemeExportOptions options = { 0, NULL, 0, 0 };
+	const char * outputPath = NULL;
+	static TextReader reader;
+	static PhonemeWriter writer;
+	long processorCount = sysconf(_SC_NPROCESSORS_ONLN);
+	long error;
+	int option;
+
+	options.threadCount = (processorCount > 0) ? (uint32_t)processorCount : 1;
+	while ((option = getopt(argc, argv, "cj:no:")) != -1) {
+		switch (option) {
+			case 'c':
+				options.textModes |= kSynthTextLiteralCharacters;
+				break;
+			case 'j':
+				options.threadCount = (uint32_t)strtoul(optarg, NULL, 10);
+				break;
+			case 'n':
+				options.textModes |= kSynthTextLiteralNumbers;
+				break;
+			case 'o':
+				outputPath = optarg;
+				break;
+			default:
+				PrintUsage(argv[0]);
+				return 1;
+		}
+	}
+	if (argc - optind > 1) {
+		PrintUsage(argv[0]);
+		return 1;
+	}
+
+	reader.file = (optind < argc) ? fopen(argv[optind], "rb") : stdin;
+	if (reader.file == NULL) {
+		fprintf(stderr, "%s: couldn't read %s (%s)\n", argv[0], argv[optind], strerror(errno));
+		return 1;
+	}
+	writer.file = (outputPath) ? fopen(outputPath, "wb") : stdout;
+	if (writer.file == NULL) {
+		fprintf(stderr, "%s: couldn't write %s (%s)\n", argv[0], outputPath, strerror(errno));
+		return 1;
+	}
+
+	error = SynthPhonemeExport(ReadText, &reader, WritePhonemes, &writer, &options);
+	if (error == noErr) {
+		fputc('\n', writer.file);
+	}
+	if (fclose(writer.file) != 0 && error == noErr) {
+		error = ioErr;
+	}
+	if (reader.file != stdin) {
+		fclose(reader.file);
+	}
+	if (error != noErr) {
+		fprintf(stderr, "%s: couldn't convert the text (error %ld)\n", argv[0], error);
+		return 1;
+	}
+	return 0;
+}
+
+static long ReadText(void * refCon, UniChar * characters, long capacity, long * outLength)
+{
+	TextReader * reader = (TextReader *)refCon;
+	long count = 0;
+
+	if (reader->lowSurrogate && capacity > 0) {
+		characters[count++] = reader->lowSurrogate;
+		reader->lowSurrogate = 0;
+	}
+	while (count < capacity) {
+		uint32_t c, sequenceLength, index;
+
+		// Keep a whole sequence in the buffer, so one is never split between reads.
+		if (reader->end - reader->start < 4 && ! reader->atEnd) {
+			size_t read;
+			memmove(reader->bytes, reader->bytes + reader->start, reader->end - reader->start);
+			reader->end -= reader->start;
+			reader->start = 0;
+			read = fread(reader->bytes + reader->end, 1, sizeof(reader->bytes) - reader->end, reader->file);
+			if (read == 0) {
+				if (ferror(reader->file)) {
+					return ioErr;
+				}
+				reader->atEnd = true;
+			}
+			reader->end += read;
+		}
+		if (reader->start == reader->end) {
+			break;
+		}
+
+		c = reader->bytes[reader->start];
+		sequenceLength = (c < 0x80) ? 1 : (c >= 0xC2 && c <= 0xDF) ? 2 : (c >= 0xE0 && c <= 0xEF) ? 3 : (c >= 0xF0 && c <= 0xF4) ? 4 : 0;
+		if (sequenceLength > 1 && reader->start + sequenceLength <= reader->end) {
+			c &= 0xFF >> (sequenceLength + 1);
+			for (index = 1; index < sequenceLength && (reader->bytes[reader->start + index] & 0xC0) == 0x80; index++) {
+				c = (c << 6) | (reader->bytes[reader->start + index] & 0x3F);
+			}
+			if (index < sequenceLength || (sequenceLength == 3 && (c < 0x800 || (c >= 0xD800 && c <= 0xDFFF))) || (sequenceLength == 4 && (c < 0x10000 || c > 0x10FFFF))) {
+				sequenceLength = 0;
+			}
+		}
+		else if (sequenceLength > 1) {
+			sequenceLength = 0;
+		}
+		if (sequenceLength == 0) {
+			c = 0xFFFD;
+			sequenceLength = 1;
+		}
+		reader->start += sequenceLength;
+
+		if (c >= 0x10000) {
+			c -= 0x10000;
+			characters[count++] = (UniChar)(0xD800 + (c >> 10));
+			if (count < capacity) {
+				characters[count++] = (UniChar)(0xDC00 + (c & 0x3FF));
+			}
+			else {
+				reader->lowSurrogate = (UniChar)(0xDC00 + (c & 0x3FF));
+			}
+		}
+		else {
+			characters[count++] = (UniChar)c;
+		}
+	}
+	*outLength = count;
+	return noErr;
+}
+
+static long WritePhonemes(void * refCon, const UniChar * phonemes, long length)
+{
+	PhonemeWriter * writer = (PhonemeWriter *)refCon;
+	size_t count = 0;
+	long index;
+
+	// Phoneme symbols are ASCII, but dictionary pronunciations are passed on as they are.
+	for (index = 0; index < length; index++) {
+		UniChar c = phonemes[index];
+		if (count + 3 > sizeof(writer->bytes)) {
+			if (fwrite(writer->bytes, 1, count, writer->file) != count) {
+				return ioErr;
+			}
+			count = 0;
+		}
+		if (c < 0x80) {
+			writer->bytes[count++] = (uint8_t)c;
+		}
+		else if (c < 0x800) {
+			writer->bytes[count++] = (uint8_t)(0xC0 | (c >> 6));
+			writer->bytes[count++] = (uint8_t)(0x80 | (c & 0x3F));
+		}
+		else {
+			writer->bytes[count++] = (uint8_t)(0xE0 | (c >> 12));
+			writer->bytes[count++] = (uint8_t)(0x80 | ((c >> 6) & 0x3F));
+			writer->bytes[count++] = (uint8_t)(0x80 | (c & 0x3F));
+		}
+	}
+	return (fwrite(writer->bytes, 1, count, writer->file) == count) ? noErr : ioErr;
+}
+
+static void PrintUsage(const char * toolName)
+{
+	fprintf(stderr, "usage: %s [-c] [-n] [-j threads] [-o output] [text file]\n", toolName);
+	fprintf(stderr, "  -c  spell out words character by character\n");
+	fprintf(stderr, "  -n  say numbers digit by digit\n");
+	fprintf(stderr, "  -j  convert on this many threads instead of one for each processor\n");
+	fprintf(stderr, "  -o  write the phonemes here instead of to standard output\n");
+}
@@ -0,0 +1,91 @@
+/*
+	main.c
+	SynthesisServer
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Runs the synthesis server that plug-ins in server mode connect to.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "SynthServer.h"
+
+static SynthServer * sServer = NULL;
+
+static void HandleSignal(int signalNumber);
+
+int main(int argc, char * argv[])
+{
+	const char * socketPath = kSynthServerDefaultSocketPath;
+	long error;
+
+	if (argc > 2) {
+		fprintf(stderr, "usage: %s [socket]\n", argv[0]);
+		return 1;
+	}
+	if (argc == 2) {
+		socketPath = argv[1];
+	}
+
+	error = SynthServerCreate(socketPath, &sServer);
+	if (error != noErr) {
+		fprintf(stderr, "%s: couldn't listen on %s (error %ld)\n", argv[0], socketPath, error);
+		return 1;
+	}
+
+	// Stopping only sets a flag, so it's safe from a signal handler; the server winds down from its own thread.
+	signal(SIGINT, HandleSignal);
+	signal(SIGTERM, HandleSignal);
+	signal(SIGPIPE, SIG_IGN);
+	printf("%s: listening on %s; set %s=%s for clients\n", argv[0], socketPath, kSynthServerSocketVariable, socketPath);
+	fflush(stdout);
+
+	SynthServerRun(sServer);
+	SynthServerDispose(sServer);
+	return 0;
+}
+
+static void HandleSignal(int signalNumber)
+{
+	(void)signalNumber;
+	SynthServerStop(sServer);
+}
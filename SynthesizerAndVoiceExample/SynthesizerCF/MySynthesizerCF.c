@@ -69,11 +69,12 @@ long	SEOpenSpeechChannel( SpeechChannelIdentifier* ssr )
     return (newChannel)?noErr:synthOpenFailed;
 }
 
-/* Set the voice to be used for the channel. Voice type guaranteed to be compatible with above spec */
+/* Set the voice to be used for the channel. Voice type guaranteed to be compatible with above spec.
+   On a channel that is already speaking, the new voice is loaded in the background and used from the next utterance. */
 long 	SEUseVoice( SpeechChannelIdentifier ssr, VoiceSpec* voice, CFBundleRef inVoiceSpecBundle )
 {
 
-	long error = SynthSimUseVoice(ssr, voice);
+	long error = SynthSimUseVoice(ssr, voice, inVoiceSpecBundle);
 
     // Show info about this call
     printf( "SEUseVoice - speech channel identifier: %d, voice creator: %d, voice identifier: %d, voice bundle info: \n", (int)ssr, (voice)?voice->creator:0, (voice)?voice->id:0 );
@@ -133,7 +134,7 @@ long 	SESpeakCFString( SpeechChannelIdentifier ssr, CFStringRef text, CFDictiona
 long 	SEStopSpeechAt( SpeechChannelIdentifier ssr, unsigned long whereToStop)
 {
 
-	long error = SynthSimStopSpeaking(ssr);
+	long error = SynthSimStopSpeakingAt(ssr, whereToStop);
 
     // Show info about this call
     printf( "SEStopSpeechAt - speech channel identifier: %d, whereToStop: %d\n", (int)ssr, (int)whereToStop );
@@ -150,7 +151,7 @@ long 	SEStopSpeechAt( SpeechChannelIdentifier ssr, unsigned long whereToStop)
 long 	SEPauseSpeechAt( SpeechChannelIdentifier ssr, unsigned long whereToPause )
 {
 
-	long error = SynthSimPauseSpeaking(ssr);
+	long error = SynthSimPauseSpeakingAt(ssr, whereToPause);
 
     // Show info about this call
     printf( "SEPauseSpeechAt - speech channel identifier: %d, whereToPause: %d\n", (int)ssr, (int)whereToPause );
@@ -182,6 +183,8 @@ long 	SEContinueSpeech( SpeechChannelIdentifier ssr )
 long 	SECopyPhonemesFromText 	( SpeechChannelIdentifier ssr, CFStringRef text, CFStringRef * phonemes)
 {
 
+	long error = SynthSimCopyPhonemesFromText(ssr, text, phonemes);
+
     // Show info about this call
     printf( "SECopyPhonemesFromText - speech channel identifier: %d\n", (int)ssr);
 	CFShow(text);
@@ -191,12 +194,16 @@ long 	SECopyPhonemesFromText 	( SpeechChannelIdentifier ssr, CFStringRef text, C
     //	paramErr			-50		Invalid value passed in a parameter. Your application passed an invalid parameter for dialog options. 
     //	noSynthFound		-240	Could not find the specified speech synthesizer 
 
-    return noErr;
+    return error;
 } 
 
 long 	SEUseSpeechDictionary( SpeechChannelIdentifier ssr, CFDictionaryRef speechDictionary )
 {
 
+	// The entries are added to the channel's dictionary and used from the next utterance on, even while the channel
+	// is speaking; the utterance being spoken finishes with the dictionary it started with.
+	long error = (speechDictionary) ? SynthSimUseSpeechDictionary(ssr, speechDictionary) : paramErr;
+
     // Show info about this call
     printf( "SETextToPhonemes - speech channel identifier: %d\n", (int)ssr);
 
@@ -207,7 +214,7 @@ long 	SEUseSpeechDictionary( SpeechChannelIdentifier ssr, CFDictionaryRef speech
     //	bufTooSmall			-243	Output buffer is too small to hold result 
     //	badDictFormat		-246	Pronunciation dictionary format error 
 
-    return noErr;
+    return error;
 } 
 
 
@@ -233,6 +240,11 @@ long 	SECopySpeechProperty( SpeechChannelIdentifier ssr, CFStringRef property, C
     // kSpeechRecentSyncProperty
     // kSpeechPhonemeSymbolsProperty
 	//
+	// This engine also supports kSynthEnginePriorityProperty, kSynthEngineDeadlineStatisticsProperty,
+	// kSynthEngineEventQueueProperty, kSynthEngineUtteranceTagProperty, kSynthEngineCompletionCallBack,
+	// kSynthEnginePhonemeCacheStatisticsProperty, kSynthEngineAudioCacheStatisticsProperty, kSynthEngineQueueLengthProperty
+	// and kSynthEngineSpeculationStatisticsProperty, defined in SynthesizerSimulator.h.
+	//
     // NOTE: kSpeechCurrentVoiceProperty is automatically handled by the API
     //
 
@@ -277,6 +289,13 @@ long 	SESetSpeechProperty( SpeechChannelIdentifier ssr, CFStringRef property, CF
     // kSpeechWordCFCallBack
     // kSpeechOutputToFileURLProperty
 	//
+	// This engine also supports kSynthEnginePriorityProperty, kSynthEngineEventQueueProperty,
+	// kSynthEngineUtteranceTagProperty and kSynthEngineCompletionCallBack, defined in SynthesizerSimulator.h.
+	// SpeechEngineAsync.h builds completion handles and event streams on top of the last three.
+	// Utterances queued with kSynthEngineEnqueueUtteranceProperty follow each other without a gap; see
+	// kSynthEngineCancelQueuedProperty and kSynthEngineFlushQueueProperty to drop them.  Text set with
+	// kSynthEngineSpeculateTextProperty is rendered ahead in case it's spoken next.
+	//
     // NOTE: Setting kSpeechCurrentVoiceProperty is automatically converted to a SEUseVoice call.
 	//
 
@@ -0,0 +1,416 @@
+/*
+	MySynthesizerUnified.c
+	SynthesizerAndVoiceExample
+
+	Copyright (c) 2002-2007 Apple Inc. All rights reserved.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+#import <ApplicationServices/ApplicationServices.h>
+#import <stdlib.h>
+#import "SynthesizerSimulator.h"
+
+// This example exports both the synthesizer plug-in API supported in Mac OS X 10.4 and earlier
+// versions and the one supported in Mac OS X 10.5 and later.  The Speech Synthesis Manager uses
+// the CFString-based entry points where it knows them, and the buffer-based ones otherwise.  Both
+// families are thin shims over the same SynthesizerSimulator calls, so a client gets the same
+// engine whichever one it goes through, and APIBenchmark can compare the cost of the two.
+
+// Defining this causes SpeechEngine.h to define the older synthesizer plug-in API as well.
+#define _SUPPORT_SPEECH_SYNTHESIS_IN_MAC_OS_X_VERSION_10_0_THROUGH_10_4__ true
+#import "SpeechEngine.h"
+
+// Unlike the other example synthesizers, this one only shows info about each call when this
+// environment variable is set, so the entry points cost no more than the work they do.
+#define kSynthEngineTraceVariable	"SYNTH_ENGINE_TRACE"
+
+static int sTrace = -1;
+
+static Boolean TraceEnabled(void)
+{
+	if (sTrace < 0) {
+		sTrace = (getenv(kSynthEngineTraceVariable) != NULL);
+	}
+	return (sTrace != 0);
+}
+
+#define Trace(...)	do { if (TraceEnabled()) { printf(__VA_ARGS__); } } while (0)
+
+
+/* Open channel - called from NewSpeechChannel, passes back in *ssr a unique SpeechChannelIdentifier value of your choosing. */
+long	SEOpenSpeechChannel( SpeechChannelIdentifier* ssr )
+{
+
+    // Pass back an identifier for this new channel.
+	SpeechChannelIdentifier newChannel = SynthSimCreateChannel();
+    if (ssr) {
+        *ssr = newChannel;
+	}
+        
+    Trace( "SEOpenSpeechChannel - speech channel identifier: %d\n", (ssr)?(int)*ssr:0 );
+    
+    // This routine normally returns one of the following values:
+    //	noErr				0		No error 
+    //	synthOpenFailed		-241	Could not open another speech synthesizer channel 
+
+    return (newChannel)?noErr:synthOpenFailed;
+}
+
+/* Set the voice to be used for the channel. Voice type guaranteed to be compatible with above spec.
+   On a channel that is already speaking, the new voice is loaded in the background and used from the next utterance. */
+long 	SEUseVoice( SpeechChannelIdentifier ssr, VoiceSpec* voice, CFBundleRef inVoiceSpecBundle )
+{
+
+	long error = SynthSimUseVoice(ssr, voice, inVoiceSpecBundle);
+
+    Trace( "SEUseVoice - speech channel identifier: %d, voice creator: %d, voice identifier: %d\n", (int)ssr, (voice)?(int)voice->creator:0, (voice)?(int)voice->id:0 );
+	
+    // This routine normally returns one of the following values:
+    //	noErr				0		No error 
+    //	noSynthFound		-240	Could not find the specified speech synthesizer 
+    //	voiceNotFound		-244	Voice resource not found 
+
+    return error;
+}
+
+/* Close channel */
+long	SECloseSpeechChannel( SpeechChannelIdentifier ssr )
+{
+
+	long error = SynthSimDisposeChannel(ssr);
+
+    Trace( "SECloseSpeechChannel - speech channel identifier: %d\n", (int)ssr );
+
+    // This routine normally returns one of the following values:
+    //	noErr				0		No error 
+    //	noSynthFound		-240	Could not find the specified speech synthesizer 
+
+    return error;
+} 
+
+ 
+long 	SEStopSpeechAt( SpeechChannelIdentifier ssr, unsigned long whereToStop)
+{
+
+	long error = SynthSimStopSpeakingAt(ssr, whereToStop);
+
+    Trace( "SEStopSpeechAt - speech channel identifier: %d, whereToStop: %d\n", (int)ssr, (int)whereToStop );
+
+    // This routine normally returns one of the following values:
+    //	noErr				0		No error 
+    //	paramErr			-50		Invalid value passed in a parameter. Your application passed an invalid parameter for dialog options. 
+    //	noSynthFound		-240	Could not find the specified speech synthesizer 
+
+    return error;
+} 
+
+ 
+long 	SEPauseSpeechAt( SpeechChannelIdentifier ssr, unsigned long whereToPause )
+{
+
+	long error = SynthSimPauseSpeakingAt(ssr, whereToPause);
+
+    Trace( "SEPauseSpeechAt - speech channel identifier: %d, whereToPause: %d\n", (int)ssr, (int)whereToPause );
+
+    // This routine normally returns one of the following values:
+    //	noErr				0		No error 
+    //	paramErr			-50		Invalid value passed in a parameter. Your application passed an invalid parameter for dialog options. 
+    //	noSynthFound		-240	Could not find the specified speech synthesizer 
+
+    return error;
+} 
+
+
+long 	SEContinueSpeech( SpeechChannelIdentifier ssr )
+{
+
+	long error = SynthSimContinueSpeaking(ssr);
+
+    Trace( "SEContinueSpeech - speech channel identifier: %d\n", (int)ssr);
+
+    // This routine normally returns one of the following values:
+    //	noErr				0		No error 
+    //	noSynthFound		-240	Could not find the specified speech synthesizer 
+
+    return error;
+} 
+
+
+// ---------- Mac OS X 10.4 and earlier API ----------
+
+/* Same as SEGetSpeechInfo(ssr, soStatus, status). Future versions of MacOS X may use SEGetSpeechInfo instead. */
+long 	SESpeechStatus( SpeechChannelIdentifier ssr, SpeechStatusInfo * status )
+{
+
+	long error = SynthSimGetSpeechInfo(ssr, soStatus, status);
+
+    Trace( "SESpeechStatus - speech channel identifier: %d\n", (int)ssr );
+
+    // This routine normally returns one of the following values:
+    //	noErr				0		No error 
+    //	paramErr			-50		Invalid value passed in a parameter. Your application passed an invalid parameter for dialog options. 
+    //	noSynthFound		-240	Could not find the specified speech synthesizer 
+
+    return error;
+} 
+
+
+/* Must also be able to parse and handle the embedded commands defined in Inside Macintosh: Speech */
+long 	SESpeakBuffer( SpeechChannelIdentifier ssr, Ptr textBuf, long byteLen, long controlFlags )
+{
+
+	// The text is spoken from the buffer itself, which the client keeps until speaking is done.
+	long error = SynthSimStartSpeakingBuffer(ssr, (const char *)textBuf, byteLen);
+	
+    Trace( "SESpeakBuffer - speech channel identifier: %d, length: %d, control flags: %d\n", (int)ssr, (int)byteLen, (int)controlFlags );
+
+    // This routine normally returns one of the following values:
+    //	noErr				0		No error 
+    //	paramErr			-50		Invalid value passed in a parameter. 
+    //	noSynthFound		-240	Could not find the specified speech synthesizer 
+    //	synthNotReady		-242	Speech synthesizer is still busy speaking 
+
+    return error;
+} 
+
+
+long 	SETextToPhonemes( SpeechChannelIdentifier ssr, char* textBuf, long textBytes, void** phonemeBuf, long* phonBytes)
+{
+
+	long error = paramErr;
+	if (textBuf && textBytes >= 0 && phonemeBuf && phonBytes) {
+	
+		// The buffer API passes text and phonemes as Mac Roman bytes.  The text is only read during
+		// the call, so it's wrapped rather than copied.
+		CFStringRef text = CFStringCreateWithBytesNoCopy(NULL, (const UInt8 *)textBuf, textBytes, kCFStringEncodingMacRoman, false, kCFAllocatorNull);
+		CFStringRef phonemes = NULL;
+		error = (text) ? SynthSimCopyPhonemesFromText(ssr, text, &phonemes) : memFullErr;
+		if (error == noErr) {
+			CFIndex length = CFStringGetLength(phonemes);
+			*phonemeBuf = malloc((length) ? length : 1);
+			if (*phonemeBuf) {
+				CFStringGetBytes(phonemes, CFRangeMake(0, length), kCFStringEncodingMacRoman, '?', false, (UInt8 *)*phonemeBuf, length, NULL);
+				*phonBytes = length;
+			}
+			else {
+				error = memFullErr;
+			}
+		}
+		if (phonemes) {
+			CFRelease(phonemes);
+		}
+		if (text) {
+			CFRelease(text);
+		}
+	}
+
+    Trace( "SETextToPhonemes - speech channel identifier: %d\n", (int)ssr);
+
+    // This routine normally returns one of the following values:
+    //	noErr				0		No error 
+    //	paramErr			-50		Invalid value passed in a parameter. Your application passed an invalid parameter for dialog options. 
+    //	noSynthFound		-240	Could not find the specified speech synthesizer 
+
+    return error;
+} 
+
+
+long 	SEUseDictionary( SpeechChannelIdentifier ssr, void* dictionary, long dictLength )
+{
+
+	// The simulator only reads dictionaries in their CFDictionary form, so the legacy one is checked and accepted.
+	long error = (dictionary && dictLength > 0) ? SynthSimUseSpeechDictionary(ssr, NULL) : paramErr;
+
+    Trace( "SEUseDictionary - speech channel identifier: %d\n", (int)ssr);
+
+    // This routine normally returns one of the following values:
+    //	noErr				0		No error 
+    //	paramErr			-50		Invalid value passed in a parameter. Your application passed an invalid parameter for dialog options. 
+    //	noSynthFound		-240	Could not find the specified speech synthesizer 
+    //	bufTooSmall			-243	Output buffer is too small to hold result 
+    //	badDictFormat		-246	Pronunciation dictionary format error 
+
+    return error;
+} 
+
+
+/* 
+    Pass back the information for the designated speech channel and selector.  See MySynthesizer.c for the selectors
+    this routine is required to support; this engine also supports the soSynthEngine selectors in SynthesizerSimulator.h.
+*/
+long 	SEGetSpeechInfo( SpeechChannelIdentifier ssr, unsigned long selector, void* speechInfo )
+{
+
+	long error = SynthSimGetSpeechInfo(ssr, selector, speechInfo);
+
+	if (TraceEnabled()) {
+		OSType selectorAsTypeChars = CFSwapInt32HostToBig(selector);
+		printf( "SEGetSpeechInfo - speech channel identifier: %d, selector: %.4s, result: %d\n", (int)ssr, (char*)&selectorAsTypeChars, (int)error);
+	}
+
+    // This routine normally returns one of the following values:
+    //	noErr				0		No error 
+    //	paramErr			-50		Invalid value passed in a parameter. Your application passed an invalid parameter for dialog options. 
+    //	siUnknownInfoType	-231	Feature not implemented on synthesizer, Unknown type of information 
+    //	noSynthFound		-240	Could not find the specified speech synthesizer 
+
+    return error;
+} 
+
+
+/*
+    Set the information for the designated speech channel and selector.  See MySynthesizer.c for the selectors
+    this routine should support.
+*/
+long 	SESetSpeechInfo( SpeechChannelIdentifier ssr, unsigned long selector, void* speechInfo )
+{
+
+	long error = SynthSimSetSpeechInfo(ssr, selector, speechInfo);
+
+	if (TraceEnabled()) {
+		OSType selectorAsTypeChars = CFSwapInt32HostToBig(selector);
+		printf( "SESetSpeechInfo - speech channel identifier: %d, selector: %.4s, result: %d\n", (int)ssr, (char*)&selectorAsTypeChars, (int)error);
+	}
+
+    // This routine normally returns one of the following values:
+    //	noErr				0		No error 
+    //	paramErr			-50		Invalid value passed in a parameter. Your application passed an invalid parameter for dialog options. 
+    //	siUnknownInfoType	-231	Feature not implemented on synthesizer, Unknown type of information 
+    //	noSynthFound		-240	Could not find the specified speech synthesizer 
+
+    return error;
+} 
+
+
+// ---------- Mac OS X 10.5 and later API ----------
+
+/* Must also be able to parse and handle the embedded commands defined in Inside Macintosh: Speech */
+long 	SESpeakCFString( SpeechChannelIdentifier ssr, CFStringRef text, CFDictionaryRef options )
+{
+
+	long error = SynthSimStartSpeaking(ssr, text);
+	
+    Trace( "SESpeakCFString - speech channel identifier: %d\n", (int)ssr );
+
+    // This routine normally returns one of the following values:
+    //	noErr				0		No error 
+    //	paramErr			-50		Invalid value passed in a parameter. 
+    //	noSynthFound		-240	Could not find the specified speech synthesizer 
+    //	synthNotReady		-242	Speech synthesizer is still busy speaking 
+
+    return error;
+} 
+
+
+long 	SECopyPhonemesFromText 	( SpeechChannelIdentifier ssr, CFStringRef text, CFStringRef * phonemes)
+{
+
+	long error = SynthSimCopyPhonemesFromText(ssr, text, phonemes);
+
+    Trace( "SECopyPhonemesFromText - speech channel identifier: %d\n", (int)ssr);
+	
+    // This routine normally returns one of the following values:
+    //	noErr				0		No error 
+    //	paramErr			-50		Invalid value passed in a parameter. Your application passed an invalid parameter for dialog options. 
+    //	noSynthFound		-240	Could not find the specified speech synthesizer 
+
+    return error;
+} 
+
+
+long 	SEUseSpeechDictionary( SpeechChannelIdentifier ssr, CFDictionaryRef speechDictionary )
+{
+
+	// The entries are added to the channel's dictionary and used from the next utterance on, even while the channel
+	// is speaking; the utterance being spoken finishes with the dictionary it started with.
+	long error = (speechDictionary) ? SynthSimUseSpeechDictionary(ssr, speechDictionary) : paramErr;
+
+    Trace( "SEUseSpeechDictionary - speech channel identifier: %d\n", (int)ssr);
+
+    // This routine normally returns one of the following values:
+    //	noErr				0		No error 
+    //	paramErr			-50		Invalid value passed in a parameter. Your application passed an invalid parameter for dialog options. 
+    //	noSynthFound		-240	Could not find the specified speech synthesizer 
+    //	bufTooSmall			-243	Output buffer is too small to hold result 
+    //	badDictFormat		-246	Pronunciation dictionary format error 
+
+    return error;
+} 
+
+
+/* 
+    Pass back the information for the designated speech channel and property.  See MySynthesizerCF.c for the properties
+    this routine is required to support; this engine also supports the kSynthEngine properties in SynthesizerSimulator.h.
+*/
+long 	SECopySpeechProperty( SpeechChannelIdentifier ssr, CFStringRef property, CFTypeRef * object )
+{
+
+	long error = SynthSimCopyProperty(ssr, property, object);
+
+    Trace( "SECopySpeechProperty - speech channel identifier: %d, result: %d\n", (int)ssr, (int)error);
+
+    // This routine normally returns one of the following values:
+    //	noErr				0		No error 
+    //	paramErr			-50		Invalid value passed in a parameter. Your application passed an invalid parameter for dialog options. 
+    //	siUnknownInfoType	-231	Feature not implemented on synthesizer, Unknown type of information 
+    //	noSynthFound		-240	Could not find the specified speech synthesizer 
+
+    return error;
+} 
+
+
+/*
+    Set the information for the designated speech channel and property.  See MySynthesizerCF.c for the properties
+    this routine is required to support.
+*/
+long 	SESetSpeechProperty( SpeechChannelIdentifier ssr, CFStringRef property, CFTypeRef object)
+{
+
+	long error = SynthSimSetProperty(ssr, property, object);
+
+    Trace( "SESetSpeechProperty - speech channel identifier: %d, result: %d\n", (int)ssr, (int)error);
+
+    // This routine normally returns one of the following values:
+    //	noErr				0		No error 
+    //	paramErr			-50		Invalid value passed in a parameter. Your application passed an invalid parameter for dialog options. 
+    //	siUnknownInfoType	-231	Feature not implemented on synthesizer, Unknown type of information 
+    //	noSynthFound		-240	Could not find the specified speech synthesizer 
+
+    return error;
+}
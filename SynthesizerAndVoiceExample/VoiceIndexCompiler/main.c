@@ -0,0 +1,132 @@
+/*
+	main.c
+	VoiceIndexCompiler
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Command-line tool that compiles the installed voice bundles into a voice index.
+	Run it after installing or removing voices; with no arguments it indexes the
+	standard voice directories and writes the index where clients look for it.
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "SynthVoiceIndex.h"
+
+#define kMaxDirectories		32
+
+static void PrintUsage(const char * toolName);
+
+int main(int argc, char * argv[])
+{
+	const char * directories[kMaxDirectories];
+	uint32_t directoryCount = 0;
+	char userDirectory[PATH_MAX];
+	char indexPath[PATH_MAX];
+	Boolean force = false;
+	SynthVoiceIndex * index;
+	long error;
+	int option;
+
+	if (SynthVoiceIndexGetDefaultPath(indexPath, sizeof(indexPath)) != noErr) {
+		indexPath[0] = '\0';
+	}
+	while ((option = getopt(argc, argv, "fo:")) != -1) {
+		switch (option) {
+			case 'f':
+				force = true;
+				break;
+			case 'o':
+				snprintf(indexPath, sizeof(indexPath), "%s", optarg);
+				break;
+			default:
+				PrintUsage(argv[0]);
+				return 1;
+		}
+	}
+	if (indexPath[0] == '\0' || argc - optind > kMaxDirectories) {
+		PrintUsage(argv[0]);
+		return 1;
+	}
+
+	// The same directories the Speech Synthesis Manager looks in for voices, unless others are given.
+	if (optind < argc) {
+		for (; optind < argc; optind++) {
+			directories[directoryCount++] = argv[optind];
+		}
+	}
+	else {
+		directories[directoryCount++] = "/System/Library/Speech/Voices";
+		directories[directoryCount++] = "/Library/Speech/Voices";
+		if (getenv("HOME")) {
+			snprintf(userDirectory, sizeof(userDirectory), "%s/Library/Speech/Voices", getenv("HOME"));
+			directories[directoryCount++] = userDirectory;
+		}
+	}
+
+	// Leave an index that's still current alone, so running this at every login is cheap.
+	if (! force && SynthVoiceIndexOpen(indexPath, &index) == noErr) {
+		Boolean isCurrent = SynthVoiceIndexIsCurrent(index);
+		SynthVoiceIndexClose(index);
+		if (isCurrent) {
+			return 0;
+		}
+	}
+
+	error = SynthVoiceIndexCompile(indexPath, directories, directoryCount);
+	if (error != noErr) {
+		fprintf(stderr, "%s: couldn't write %s (error %ld)\n", argv[0], indexPath, error);
+		return 1;
+	}
+	if (SynthVoiceIndexOpen(indexPath, &index) == noErr) {
+		printf("%s: indexed %u voices in %s\n", argv[0], (unsigned)SynthVoiceIndexGetCount(index), indexPath);
+		SynthVoiceIndexClose(index);
+	}
+	return 0;
+}
+
+static void PrintUsage(const char * toolName)
+{
+	fprintf(stderr, "usage: %s [-f] [-o index] [voice directory ...]\n", toolName);
+	fprintf(stderr, "  -f  rebuild the index even if it's current\n");
+	fprintf(stderr, "  -o  write the index here instead of the default location\n");
+}
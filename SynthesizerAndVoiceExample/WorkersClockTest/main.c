@@ -0,0 +1,219 @@
+/*
+	main.c
+	WorkersClockTest
+
+	Copyright © 2007 Apple Inc.  All Rights Reserved.
+
+	Description: Runs a fixed set of jobs on the worker pool's virtual clock and compares
+	the order they ran in, and the clock each saw, with a known-good log.  Exits with a
+	non-zero status if they differ.  It only needs the worker pool and POSIX threads,
+	so it also builds off Mac OS X:
+
+		cc -std=gnu11 -ICommon WorkersClockTest/main.c Common/SynthEngineWorkers.c -lpthread -lm
+
+	Disclaimer:  IMPORTANT:  This Apple software is supplied to you by Apple Inc.
+	("Apple") in consideration of your agreement to the following terms, and your
+	use, installation, modification or redistribution of this Apple software
+	constitutes acceptance of these terms.  If you do not agree with these terms,
+	please do not use, install, modify or redistribute this Apple software.
+
+	In consideration of your agreement to abide by the following terms, and subject
+	to these terms, Apple grants you a personal, non-exclusive license, under Apple's
+	copyrights in this original Apple software (the "Apple Software"), to use,
+	reproduce, modify and redistribute the Apple Software, with or without
+	modifications, in source and/or binary forms; provided that if you redistribute
+	the Apple Software in its entirety and without modifications, you must retain
+	this notice and the following text and disclaimers in all such redistributions of
+	the Apple Software.  Neither the name, trademarks, service marks or logos of
+	Apple Inc. may be used to endorse or promote products derived from the
+	Apple Software without specific prior written permission from Apple.  Except as
+	expressly stated in this notice, no other rights or licenses, express or implied,
+	are granted by Apple herein, including but not limited to any patent rights that
+	may be infringed by your derivative works or by other works in which the Apple
+	Software may be incorporated.
+
+	The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+	WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+	WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+	COMBINATION WITH YOUR PRODUCTS.
+
+	IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+	GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+	ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+	OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+	(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+	ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "SynthEngineWorkers.h"
+
+#define kStartTime		10.0
+#define kLogCapacity	4096
+
+#define CheckEqual(actual, expected)		Check((long)(actual), (long)(expected), #actual, __LINE__)
+
+// What the jobs below must log, one line per job with the clock it saw.  Runnable jobs go first,
+// interactive before bulk and each in submission order, including those a job submits.  Then the
+// clock jumps to the earliest due time, the jobs due then are queued in (due time, submission)
+// order, and they run the same way as runnable jobs, before the clock moves on again.
+static const char	kExpectedLog[] =
+	"10.000 runnable interactive 1\n"
+	"10.000 runnable interactive 2\n"
+	"10.000 runnable bulk 1\n"
+	"10.000 runnable bulk 2\n"
+	"10.250 timed interactive at 10.25\n"
+	"10.250 timed bulk at 10.25\n"
+	"10.250 runnable interactive from a job\n"
+	"10.250 runnable bulk from a job\n"
+	"10.500 timed interactive at 10.5, first\n"
+	"10.500 timed interactive at 10.5, second\n"
+	"10.500 timed bulk at 10.5\n"
+	"10.750 timed interactive from a job\n"
+	"ran 12 jobs, clock at 11.000\n"
+	"12.000 timed interactive at 12\n"
+	"ran 1 jobs, clock at 12.000\n";
+
+typedef struct TestJob {
+	SynthEngineWorkers *	workers;
+	const char *			name;
+	Boolean					spawns;		// Submits a runnable and a timed job of its own when run.
+} TestJob;
+
+static char			sLog[kLogCapacity];
+static size_t		sLogLength;
+static int			sFailures;
+
+static void		RunJobs(SynthEngineWorkers * workers);
+static void		LogJob(void * context);
+static void		Log(const char * format, double time, const char * name);
+static void		Check(long actual, long expected, const char * what, int line);
+
+int main(void)
+{
+	SynthEngineWorkers * workers;
+	char sharedLog[kLogCapacity];
+	uint64_t jobsRun;
+	
+	// The shared pool, on a virtual clock because it was asked for before first use.
+	CheckEqual(SynthEngineWorkersSetSharedVirtual(kStartTime), noErr);
+	workers = SynthEngineWorkersShared();
+	CheckEqual(SynthEngineWorkersIsVirtual(workers), true);
+	CheckEqual(SynthEngineWorkersCurrentTime(workers) == kStartTime, true);
+	CheckEqual(SynthEngineWorkersSetSharedVirtual(0.0), synthNotReady);
+	RunJobs(workers);
+	if (strcmp(sLog, kExpectedLog) != 0) {
+		fprintf(stderr, "shared pool ran:\n%sexpected:\n%s", sLog, kExpectedLog);
+		sFailures++;
+	}
+	memcpy(sharedLog, sLog, sizeof(sLog));
+	
+	// A pool of its own must run the same jobs the same way.
+	CheckEqual(SynthEngineWorkersCreateVirtual(kStartTime, &workers), noErr);
+	RunJobs(workers);
+	if (strcmp(sLog, sharedLog) != 0) {
+		fprintf(stderr, "second pool ran:\n%sfirst ran:\n%s", sLog, sharedLog);
+		sFailures++;
+	}
+	SynthEngineWorkersDispose(workers);
+	
+	// Only virtual pools can be run.
+	CheckEqual(SynthEngineWorkersCreate(0, &workers), noErr);
+	CheckEqual(SynthEngineWorkersRunUntil(workers, HUGE_VAL, &jobsRun), paramErr);
+	SynthEngineWorkersDispose(workers);
+	
+	printf("%s\n", (sFailures) ? "FAILED" : "passed");
+	return (sFailures) ? 1 : 0;
+}
+
+/*
+	Submits the jobs in an order that differs from the one they must run in, runs them up to
+	a second after the start, then runs what's left.
+*/
+static void RunJobs(SynthEngineWorkers * workers)
+{
+	static TestJob jobs[] = {
+		{ NULL, "runnable bulk 1", false },
+		{ NULL, "runnable interactive 1", false },
+		{ NULL, "runnable bulk 2", false },
+		{ NULL, "runnable interactive 2", false },
+		{ NULL, "timed interactive at 10.5, first", false },
+		{ NULL, "timed bulk at 10.25", true },
+		{ NULL, "timed interactive at 12", false },
+		{ NULL, "timed interactive at 10.25", false },
+		{ NULL, "timed bulk at 10.5", false },
+		{ NULL, "timed interactive at 10.5, second", false }
+	};
+	uint64_t jobsRun = 0;
+	unsigned jobIndex;
+
+	for (jobIndex = 0; jobIndex < sizeof(jobs) / sizeof(jobs[0]); jobIndex++) {
+		jobs[jobIndex].workers = workers;
+	}
+	sLogLength = 0;
+	sLog[0] = 0;
+
+	CheckEqual(SynthEngineWorkersSubmit(workers, kSynthEnginePriorityBulk, LogJob, &jobs[0]), noErr);
+	CheckEqual(SynthEngineWorkersSubmit(workers, kSynthEnginePriorityInteractive, LogJob, &jobs[1]), noErr);
+	CheckEqual(SynthEngineWorkersSubmit(workers, kSynthEnginePriorityBulk, LogJob, &jobs[2]), noErr);
+	CheckEqual(SynthEngineWorkersSubmit(workers, kSynthEnginePriorityInteractive, LogJob, &jobs[3]), noErr);
+	CheckEqual(SynthEngineWorkersSubmitAt(workers, kSynthEnginePriorityInteractive, kStartTime + 0.5, LogJob, &jobs[4]), noErr);
+	CheckEqual(SynthEngineWorkersSubmitAt(workers, kSynthEnginePriorityBulk, kStartTime + 0.25, LogJob, &jobs[5]), noErr);
+	CheckEqual(SynthEngineWorkersSubmitAt(workers, kSynthEnginePriorityInteractive, kStartTime + 2.0, LogJob, &jobs[6]), noErr);
+	CheckEqual(SynthEngineWorkersSubmitAt(workers, kSynthEnginePriorityInteractive, kStartTime + 0.25, LogJob, &jobs[7]), noErr);
+	CheckEqual(SynthEngineWorkersSubmitAt(workers, kSynthEnginePriorityBulk, kStartTime + 0.5, LogJob, &jobs[8]), noErr);
+	CheckEqual(SynthEngineWorkersSubmitAt(workers, kSynthEnginePriorityInteractive, kStartTime + 0.5, LogJob, &jobs[9]), noErr);
+
+	// Nothing runs until asked.
+	CheckEqual(sLogLength, 0);
+	
+	CheckEqual(SynthEngineWorkersRunUntil(workers, kStartTime + 1.0, &jobsRun), noErr);
+	snprintf(sLog + sLogLength, sizeof(sLog) - sLogLength, "ran %llu jobs, clock at %.3f\n", (unsigned long long)jobsRun, SynthEngineWorkersCurrentTime(workers));
+	sLogLength += strlen(sLog + sLogLength);
+	
+	CheckEqual(SynthEngineWorkersRunUntil(workers, HUGE_VAL, &jobsRun), noErr);
+	snprintf(sLog + sLogLength, sizeof(sLog) - sLogLength, "ran %llu jobs, clock at %.3f\n", (unsigned long long)jobsRun, SynthEngineWorkersCurrentTime(workers));
+	sLogLength += strlen(sLog + sLogLength);
+}
+
+static void LogJob(void * context)
+{
+	static TestJob spawnedJobs[] = {
+		{ NULL, "runnable bulk from a job", false },
+		{ NULL, "runnable interactive from a job", false },
+		{ NULL, "timed interactive from a job", false }
+	};
+	TestJob * job = (TestJob *)context;
+	double now = SynthEngineWorkersCurrentTime(job->workers);
+
+	Log("%.3f %s\n", now, job->name);
+	
+	// A job can't run the pool it's on.
+	CheckEqual(SynthEngineWorkersRunUntil(job->workers, HUGE_VAL, NULL), synthNotReady);
+	
+	if (job->spawns) {
+		spawnedJobs[0].workers = spawnedJobs[1].workers = spawnedJobs[2].workers = job->workers;
+		CheckEqual(SynthEngineWorkersSubmit(job->workers, kSynthEnginePriorityBulk, LogJob, &spawnedJobs[0]), noErr);
+		CheckEqual(SynthEngineWorkersSubmitAt(job->workers, kSynthEnginePriorityInteractive, now + 0.5, LogJob, &spawnedJobs[2]), noErr);
+		CheckEqual(SynthEngineWorkersSubmit(job->workers, kSynthEnginePriorityInteractive, LogJob, &spawnedJobs[1]), noErr);
+	}
+}
+
+static void Log(const char * format, double time, const char * name)
+{
+	snprintf(sLog + sLogLength, sizeof(sLog) - sLogLength, format, time, name);
+	sLogLength += strlen(sLog + sLogLength);
+}
+
+static void Check(long actual, long expected, const char * what, int line)
+{
+	if (actual != expected) {
+		fprintf(stderr, "main.c:%d: %s is %ld, expected %ld\n", line, what, actual, expected);
+		sFailures++;
+	}
+}